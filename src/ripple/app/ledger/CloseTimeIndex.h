@@ -0,0 +1,144 @@
+//------------------------------------------------------------------------------
+/*
+  This file is part of rippled: https://github.com/ripple/rippled
+  Copyright (c) 2012-2015 Ripple Labs Inc.
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose  with  or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+  MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_APP_CLOSETIMEINDEX_H_INCLUDED
+#define RIPPLE_APP_CLOSETIMEINDEX_H_INCLUDED
+
+#include <ripple/protocol/Protocol.h>
+#include <boost/optional.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+namespace ripple {
+
+/** Maps close times to the sequence of validated ledgers.
+
+    Entries are kept in a flat array sorted by sequence. Close times only
+    grow with the sequence, so the same array is sorted by close time too
+    and a lookup is a binary search, with no ledger loaded from the node
+    store. Ledgers are usually added at the end.
+*/
+class CloseTimeIndex
+{
+private:
+    struct Entry
+    {
+        LedgerIndex seq;
+        std::uint32_t closeTime;
+        std::uint32_t parentCloseTime;
+    };
+
+    std::mutex mutable mutex_;
+    std::vector <Entry> entries_;
+
+    std::vector <Entry>::iterator
+    find (LedgerIndex seq)
+    {
+        return std::lower_bound (entries_.begin (), entries_.end (), seq,
+            [](Entry const& e, LedgerIndex s) { return e.seq < s; });
+    }
+
+public:
+    /** Add or replace the close times of a ledger. */
+    void
+    insert (LedgerIndex seq, std::uint32_t closeTime,
+        std::uint32_t parentCloseTime)
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        Entry const entry {seq, closeTime, parentCloseTime};
+        if (entries_.empty () || entries_.back ().seq < seq)
+        {
+            entries_.push_back (entry);
+            return;
+        }
+        auto it = find (seq);
+        if (it != entries_.end () && it->seq == seq)
+            *it = entry;
+        else
+            entries_.insert (it, entry);
+    }
+
+    /** Forget a ledger, its slot in the chain is no longer trusted. */
+    void
+    erase (LedgerIndex seq)
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        auto it = find (seq);
+        if (it != entries_.end () && it->seq == seq)
+            entries_.erase (it);
+    }
+
+    /** Forget every ledger before a sequence. */
+    void
+    eraseBefore (LedgerIndex seq)
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        entries_.erase (entries_.begin (), find (seq));
+    }
+
+    /** Returns the ledger that closed at or first after a time.
+
+        That is the ledger whose parent closed before closeTime while it
+        closed at or after it.
+
+        @return boost::none if that ledger is not in the index.
+    */
+    boost::optional <LedgerIndex>
+    firstClosedAtOrAfter (std::uint32_t closeTime) const
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        auto it = std::lower_bound (entries_.begin (), entries_.end (),
+            closeTime, [](Entry const& e, std::uint32_t t)
+            {
+                return e.closeTime < t;
+            });
+        if (it == entries_.end () || it->parentCloseTime >= closeTime)
+            return boost::none;
+        return it->seq;
+    }
+
+    /** Returns the last indexed ledger that closed at or before a time. */
+    boost::optional <LedgerIndex>
+    lastClosedAtOrBefore (std::uint32_t closeTime) const
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        auto it = std::upper_bound (entries_.begin (), entries_.end (),
+            closeTime, [](std::uint32_t t, Entry const& e)
+            {
+                return t < e.closeTime;
+            });
+        if (it == entries_.begin ())
+            return boost::none;
+        return std::prev (it)->seq;
+    }
+
+    std::size_t
+    size () const
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        return entries_.size ();
+    }
+};
+
+} // ripple
+
+#endif
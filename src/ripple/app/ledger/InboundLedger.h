@@ -136,18 +136,18 @@ private:
 
     bool takeHeader (std::string const& data);
     bool takeTxNode (const std::vector<SHAMapNodeID>& IDs,
-                     const std::vector<Blob>& data,
+                     const std::vector<Slice>& data,
                      SHAMapAddNode&);
-    bool takeTxRootNode (Blob const& data, SHAMapAddNode&);
+    bool takeTxRootNode (Slice const& data, SHAMapAddNode&);
 
     // VFALCO TODO Rename to receiveAccountStateNode
     //             Don't use acronyms, but if we are going to use them at least
     //             capitalize them correctly.
     //
     bool takeAsNode (const std::vector<SHAMapNodeID>& IDs,
-                     const std::vector<Blob>& data,
+                     const std::vector<Slice>& data,
                      SHAMapAddNode&);
-    bool takeAsRootNode (Blob const& data, SHAMapAddNode&);
+    bool takeAsRootNode (Slice const& data, SHAMapAddNode&);
 
 private:
     Ledger::pointer    mLedger;
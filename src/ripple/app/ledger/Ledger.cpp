@@ -20,6 +20,7 @@
 #include <BeastConfig.h>
 #include <ripple/app/ledger/Ledger.h>
 #include <ripple/app/ledger/AcceptedLedger.h>
+#include <ripple/app/ledger/CloseTimeIndex.h>
 #include <ripple/app/ledger/InboundLedgers.h>
 #include <ripple/app/ledger/LedgerMaster.h>
 #include <ripple/app/ledger/LedgerTiming.h>
@@ -735,7 +736,7 @@ Ledger::setup (Config const& config)
 
     try
     {
-        rules_ = Rules(*this);
+        rules_ = Rules(*this, config.features);
     }
     catch (SHAMapMissingNode &)
     {
@@ -793,6 +794,30 @@ void Ledger::visitStateItems (std::function<void (SLE::ref)> callback) const
     }
 }
 
+void Ledger::visitStateItemsParallel (
+    std::function<void (std::size_t part, SLE::ref)> callback,
+    std::size_t threads) const
+{
+    try
+    {
+        if (stateMap_)
+        {
+            stateMap_->visitLeavesParallel(
+                [&callback](std::size_t part,
+                    std::shared_ptr<SHAMapItem const> const& item)
+                {
+                    callback(part, std::make_shared<SLE>(
+                        SerialIter{item->data(), item->size()}, item->key()));
+                }, threads);
+        }
+    }
+    catch (SHAMapMissingNode&)
+    {
+        stateMap_->family().missing_node (info_.hash);
+        Throw();
+    }
+}
+
 bool Ledger::walkLedger (beast::Journal j) const
 {
     std::vector <SHAMapMissingNode> missingNodes1;
@@ -1512,4 +1537,30 @@ getHashesByIndex (std::uint32_t minSeq, std::uint32_t maxSeq,
     return ret;
 }
 
+void
+loadCloseTimes (CloseTimeIndex& index, Application& app)
+{
+    auto db = app.getLedgerDB ().checkoutDb ();
+
+    std::uint64_t ls;
+    boost::optional<std::uint64_t> ct, pct;
+    soci::statement st =
+        (db->prepare << "SELECT LedgerSeq,ClosingTime,PrevClosingTime "
+            "FROM Ledgers ORDER BY LedgerSeq;",
+         soci::into (ls),
+         soci::into (ct),
+         soci::into (pct));
+
+    st.execute ();
+    while (st.fetch ())
+    {
+        index.insert (rangeCheckedCast<std::uint32_t>(ls),
+            rangeCheckedCast<std::uint32_t>(ct.value_or (0)),
+            rangeCheckedCast<std::uint32_t>(pct.value_or (0)));
+    }
+
+    JLOG (app.journal ("Ledger").info)
+        << "Loaded close times of " << index.size () << " ledgers";
+}
+
 } // ripple
@@ -37,6 +37,7 @@
 namespace ripple {
 
 class Application;
+class CloseTimeIndex;
 class Job;
 class TransactionMaster;
 
@@ -340,6 +341,14 @@ public:
 
     void visitStateItems (std::function<void (SLE::ref)>) const;
 
+    /** Visit every state entry using several threads.
+
+        See SHAMap::visitLeavesParallel for how the callback is called.
+    */
+    void visitStateItemsParallel (
+        std::function<void (std::size_t part, SLE::ref)>,
+        std::size_t threads) const;
+
 
     std::vector<uint256> getNeededTransactionHashes (
         int max, SHAMapSyncFilter* filter) const;
@@ -428,6 +437,11 @@ std::map< std::uint32_t, std::pair<uint256, uint256>>
 getHashesByIndex (std::uint32_t minSeq, std::uint32_t maxSeq,
     Application& app);
 
+/** Fill the close time index from every ledger in the ledger database. */
+extern
+void
+loadCloseTimes (CloseTimeIndex& index, Application& app);
+
 /** Deserialize a SHAMapItem containing a single STTx
 
     Throw:
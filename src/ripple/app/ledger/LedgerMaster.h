@@ -32,6 +32,7 @@
 #include <beast/threads/Stoppable.h>
 #include <beast/threads/UnlockGuard.h>
 #include <beast/utility/PropertyStream.h>
+#include <boost/optional.hpp>
 #include <mutex>
 
 #include "ripple.pb.h"
@@ -132,8 +133,13 @@ public:
 
     virtual Ledger::pointer getLedgerByHash (uint256 const& hash) = 0;
 
+    /** Returns the first ledger that closed at or after closeTime. */
     virtual Ledger::pointer getLedgerByCloseTime(uint32 closeTime) = 0;
 
+    /** Returns the last stored ledger that closed at or before closeTime. */
+    virtual boost::optional <LedgerIndex>
+    getLedgerSeqBeforeCloseTime (uint32 closeTime) = 0;
+
     virtual void setLedgerRangePresent (
         std::uint32_t minV, std::uint32_t maxV) = 0;
 
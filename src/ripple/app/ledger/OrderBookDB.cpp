@@ -27,15 +27,49 @@
 #include <ripple/core/JobQueue.h>
 #include <ripple/protocol/Indexes.h>
 #include <ripple/protocol/JsonFields.h>
+#include <boost/optional.hpp>
+#include <algorithm>
 
 namespace ripple {
 
+namespace {
+
+// The book of a root directory of an order book, if sle is one
+boost::optional<Book>
+bookRoot (SLE const& sle)
+{
+    if (sle.getType () != ltDIR_NODE ||
+        !sle.isFieldPresent (sfExchangeRate) ||
+        sle.getFieldH256 (sfRootIndex) != sle.getIndex())
+        return boost::none;
+
+    Book book;
+    book.in.currency.copyFrom(sle.getFieldH160(
+        sfTakerPaysCurrency));
+    book.in.account.copyFrom(sle.getFieldH160 (
+        sfTakerPaysIssuer));
+    book.out.account.copyFrom(sle.getFieldH160(
+        sfTakerGetsIssuer));
+    book.out.currency.copyFrom (sle.getFieldH160(
+        sfTakerGetsCurrency));
+    return book;
+}
+
+}
+
 OrderBookDB::OrderBookDB (Application& app, Stoppable& parent)
     : Stoppable ("OrderBookDB", parent)
     , app_ (app)
     , mSeq (0)
+    , mScanSeq (0)
     , j_ (app.journal ("OrderBookDB"))
 {
+    if (app_.config().PATH_SEARCH_MAX != 0)
+        mStateDiffs = app_.getStateDiffStream().subscribe (
+            [this](LedgerStateDiff const& changes)
+            {
+                onStateDiff (changes);
+            });
 }
 
 void OrderBookDB::invalidate ()
@@ -47,32 +81,40 @@ void OrderBookDB::invalidate ()
 void OrderBookDB::setup(
     std::shared_ptr<ReadView const> const& ledger)
 {
+    if (app_.config().PATH_SEARCH_MAX == 0)
+        return;
+
     {
         std::lock_guard <std::recursive_mutex> sl (mLock);
         auto seq = ledger->info().seq;
 
-        // Do a full update every 256 ledgers
-        if (mSeq != 0)
+        // The books follow each validated ledger, so only rebuild them
+        // here when they're missing or the ledgers jumped away from them
+        auto const current = mScanSeq != 0 ? mScanSeq : mSeq;
+        if (current != 0)
         {
-            if (seq == mSeq)
+            if (seq == current)
                 return;
-            if ((seq > mSeq) && ((seq - mSeq) < 256))
+            if ((seq > current) && ((seq - current) < 256))
                 return;
-            if ((seq < mSeq) && ((mSeq - seq) < 16))
+            if ((seq < current) && ((current - seq) < 16))
                 return;
         }
 
         JLOG (j_.debug)
-            << "Advancing from " << mSeq << " to " << seq;
+            << "Rebuilding from " << seq << ", was " << current;
 
-        mSeq = seq;
+        mScanSeq = seq;
+        mPending.clear();
     }
 
-    if (app_.config().PATH_SEARCH_MAX == 0)
-    {
-        // nothing to do
-    }
-    else if (app_.config().RUN_STANDALONE)
+    scheduleUpdate (ledger);
+}
+
+void OrderBookDB::scheduleUpdate(
+    std::shared_ptr<ReadView const> const& ledger)
+{
+    if (app_.config().RUN_STANDALONE)
         update(ledger);
     else
         app_.getJobQueue().addJob(
@@ -83,10 +125,12 @@ void OrderBookDB::setup(
 void OrderBookDB::update(
     std::shared_ptr<ReadView const> const& ledger)
 {
-    hash_set< uint256 > seen;
+    hash_map< uint256, int > bookDirs;
     OrderBookDB::IssueToOrderBook destMap;
     OrderBookDB::IssueToOrderBook sourceMap;
     hash_set< Issue > XRPBooks;
+    hash_set< Issue > VBCBooks;
+    auto const seq = ledger->info().seq;
 
     JLOG (j_.debug) << "OrderBookDB::update>";
 
@@ -103,28 +147,18 @@ void OrderBookDB::update(
     {
         for(auto& sle : ledger->sles)
         {
-            if (sle->getType () == ltDIR_NODE &&
-                sle->isFieldPresent (sfExchangeRate) &&
-                sle->getFieldH256 (sfRootIndex) == sle->getIndex())
+            if (auto book = bookRoot (*sle))
             {
-                Book book;
-                book.in.currency.copyFrom(sle->getFieldH160(
-                    sfTakerPaysCurrency));
-                book.in.account.copyFrom(sle->getFieldH160 (
-                    sfTakerPaysIssuer));
-                book.out.account.copyFrom(sle->getFieldH160(
-                    sfTakerGetsIssuer));
-                book.out.currency.copyFrom (sle->getFieldH160(
-                    sfTakerGetsCurrency));
-
-                uint256 index = getBookBase (book);
-                if (seen.insert (index).second)
+                uint256 index = getBookBase (*book);
+                if (++bookDirs[index] == 1)
                 {
-                    auto orderBook = std::make_shared<OrderBook> (index, book);
-                    sourceMap[book.in].push_back (orderBook);
-                    destMap[book.out].push_back (orderBook);
-                    if (isXRP(book.out))
-                        XRPBooks.insert(book.in);
+                    auto orderBook = std::make_shared<OrderBook> (index, *book);
+                    sourceMap[book->in].push_back (orderBook);
+                    destMap[book->out].push_back (orderBook);
+                    if (isXRP(book->out.currency))
+                        XRPBooks.insert(book->in);
+                    else if (isVBC(book->out.currency))
+                        VBCBooks.insert(book->in);
                     ++books;
                 }
             }
@@ -135,34 +169,230 @@ void OrderBookDB::update(
         JLOG (j_.info) 
             << "OrderBookDB::update encountered a missing node";
         std::lock_guard <std::recursive_mutex> sl (mLock);
+        if (mScanSeq == seq)
+        {
+            mScanSeq = 0;
+            mPending.clear();
+        }
         mSeq = 0;
         return;
     }
 
     JLOG (j_.debug)
         << "OrderBookDB::update< " << books << " books found";
+
+    std::shared_ptr<ReadView const> rescan;
     {
         std::lock_guard <std::recursive_mutex> sl (mLock);
 
+        // A scan of another ledger was started since
+        if (mScanSeq != 0 && mScanSeq != seq)
+            return;
+
         mXRPBooks.swap(XRPBooks);
+        mVBCBooks.swap(VBCBooks);
+        mBookDirs.swap(bookDirs);
         mSourceMap.swap(sourceMap);
         mDestMap.swap(destMap);
+        mSeq = seq;
+        mScanSeq = 0;
+
+        // Catch up with the ledgers published during the scan
+        for (auto const& changes : mPending)
+        {
+            if (changes.to <= mSeq)
+                continue;
+            if (changes.from != mSeq)
+            {
+                rescan = mPending.back().ledger;
+                mScanSeq = mPending.back().to;
+                break;
+            }
+            applyChanges (changes);
+            mSeq = changes.to;
+        }
+        mPending.clear();
     }
+
+    if (rescan)
+        scheduleUpdate (rescan);
     app_.getLedgerMaster().newOrderBookDB();
 }
 
+void OrderBookDB::onStateDiff (LedgerStateDiff const& changes)
+{
+    BookChanges books;
+    books.to = changes.after->info().seq;
+    books.ledger = changes.after;
+    if (changes.before)
+    {
+        books.from = changes.before->info().seq;
+        for (auto const& diff : changes.diffs)
+        {
+            if (diff.after && !diff.before)
+            {
+                if (auto book = bookRoot (*diff.after))
+                    books.created.push_back (*book);
+            }
+            else if (diff.before && !diff.after)
+            {
+                if (auto book = bookRoot (*diff.before))
+                    books.deleted.push_back (*book);
+            }
+        }
+    }
+
+    bool changed = false;
+    bool rebuild = false;
+    {
+        std::lock_guard <std::recursive_mutex> sl (mLock);
+
+        if (mScanSeq != 0)
+        {
+            if (books.to > mScanSeq)
+            {
+                if (!mPending.empty())
+                    mPending.back().ledger.reset();
+                mPending.push_back (std::move (books));
+            }
+            return;
+        }
+
+        if (mSeq == 0 || !changes.before || books.from != mSeq)
+        {
+            JLOG (j_.debug)
+                << "Ledger " << books.to << " doesn't follow " << mSeq;
+            mScanSeq = books.to;
+            rebuild = true;
+        }
+        else if (books.to <= mSeq)
+        {
+            return;
+        }
+        else
+        {
+            changed = applyChanges (books);
+            mSeq = books.to;
+        }
+    }
+
+    if (rebuild)
+        scheduleUpdate (books.ledger);
+    else if (changed)
+        app_.getLedgerMaster().newOrderBookDB();
+}
+
+bool OrderBookDB::applyChanges (BookChanges const& changes)
+{
+    bool changed = false;
+
+    // A book can have a directory for each quality, so it's only gone
+    // with the last of them
+    for (auto const& book : changes.created)
+    {
+        if (++mBookDirs[getBookBase (book)] == 1)
+            changed = insertBook (book) || changed;
+    }
+
+    for (auto const& book : changes.deleted)
+    {
+        auto it = mBookDirs.find (getBookBase (book));
+        if (it == mBookDirs.end ())
+            continue;
+        if (--it->second == 0)
+        {
+            mBookDirs.erase (it);
+            eraseBook (book);
+            changed = true;
+        }
+    }
+
+    JLOG (j_.trace)
+        << "Ledger " << changes.to << ": " << changes.created.size ()
+        << " book directories created, " << changes.deleted.size ()
+        << " deleted";
+
+    return changed;
+}
+
+bool OrderBookDB::insertBook (Book const& book)
+{
+    auto& books = mSourceMap[book.in];
+    for (auto const& ob : books)
+    {
+        if (ob->book () == book)
+            return false;
+    }
+
+    auto orderBook = std::make_shared<OrderBook> (getBookBase (book), book);
+    books.push_back (orderBook);
+    mDestMap[book.out].push_back (orderBook);
+    if (auto native = nativeBooks (book.out.currency))
+        native->insert (book.in);
+    return true;
+}
+
+void OrderBookDB::eraseBook (Book const& book)
+{
+    auto const erase = [&book](IssueToOrderBook& map, Issue const& issue)
+    {
+        auto it = map.find (issue);
+        if (it == map.end ())
+            return;
+        auto& books = it->second;
+        books.erase (std::remove_if (books.begin (), books.end (),
+            [&book](OrderBook::pointer const& ob)
+            {
+                return ob->book () == book;
+            }), books.end ());
+        if (books.empty ())
+            map.erase (it);
+    };
+
+    erase (mSourceMap, book.in);
+    erase (mDestMap, book.out);
+
+    if (auto native = nativeBooks (book.out.currency))
+    {
+        auto it = mSourceMap.find (book.in);
+        if (it == mSourceMap.end () || std::none_of (
+                it->second.begin (), it->second.end (),
+                [&book](OrderBook::pointer const& ob)
+                {
+                    return ob->getCurrencyOut () == book.out.currency;
+                }))
+            native->erase (book.in);
+    }
+}
+
+hash_map <uint256, int> OrderBookDB::getBookDirs ()
+{
+    std::lock_guard <std::recursive_mutex> sl (mLock);
+    return mBookDirs;
+}
+
+hash_set <Issue>* OrderBookDB::nativeBooks (Currency const& currency)
+{
+    if (isXRP (currency))
+        return &mXRPBooks;
+    if (isVBC (currency))
+        return &mVBCBooks;
+    return nullptr;
+}
+
 void OrderBookDB::addOrderBook(Book const& book)
 {
-    bool toXRP = isXRP (book.out);
     std::lock_guard <std::recursive_mutex> sl (mLock);
+    bool toNative = nativeBooks (book.out.currency) != nullptr;
 
-    if (toXRP)
+    if (toNative)
     {
         // We don't want to search through all the to-XRP or from-XRP order
         // books!
         for (auto ob: mSourceMap[book.in])
         {
-            if (isXRP (ob->getCurrencyOut ())) // also to XRP
+            // also to the same native currency
+            if (ob->getCurrencyOut () == book.out.currency)
                 return;
         }
     }
@@ -177,13 +407,8 @@ void OrderBookDB::addOrderBook(Book const& book)
             }
         }
     }
-    uint256 index = getBookBase(book);
-    auto orderBook = std::make_shared<OrderBook> (index, book);
 
-    mSourceMap[book.in].push_back (orderBook);
-    mDestMap[book.out].push_back (orderBook);
-    if (toXRP)
-        mXRPBooks.insert(book.in);
+    insertBook (book);
 }
 
 // return list of all orderbooks that want this issuerID and currencyID
@@ -206,6 +431,12 @@ bool OrderBookDB::isBookToXRP(Issue const& issue)
     return mXRPBooks.count(issue) > 0;
 }
 
+bool OrderBookDB::isBookToVBC(Issue const& issue)
+{
+    std::lock_guard <std::recursive_mutex> sl (mLock);
+    return mVBCBooks.count(issue) > 0;
+}
+
 BookListeners::pointer OrderBookDB::makeBookListeners (Book const& book)
 {
     std::lock_guard <std::recursive_mutex> sl (mLock);
@@ -22,20 +22,40 @@
 
 #include <ripple/app/ledger/AcceptedLedgerTx.h>
 #include <ripple/app/ledger/BookListeners.h>
+#include <ripple/app/ledger/StateDiffStream.h>
 #include <ripple/app/main/Application.h>
 #include <ripple/app/misc/OrderBook.h>
+#include <boost/signals2/connection.hpp>
 #include <mutex>
+#include <vector>
 
 namespace ripple {
 
+/** The order books in the ledger, for path finding and book subscriptions.
+
+    The books are built by scanning a whole validated ledger at startup or
+    when the published changes leave a gap. After that they follow the
+    book directories created and deleted by each validated ledger.
+*/
 class OrderBookDB
     : public beast::Stoppable
 {
 public:
     OrderBookDB (Application& app, Stoppable& parent);
 
+    /** Make sure the books are built for a ledger near this one. */
     void setup (std::shared_ptr<ReadView const> const& ledger);
+
+    /** Rebuild the books by scanning all of a ledger. */
     void update (std::shared_ptr<ReadView const> const& ledger);
+
+    /** Apply the book directories created and deleted by a ledger.
+
+        If the changes don't follow from the ledger the books are built
+        from, the books are rebuilt from the new ledger instead.
+    */
+    void onStateDiff (LedgerStateDiff const& changes);
+
     void invalidate ();
 
     void addOrderBook(Book const&);
@@ -49,6 +69,10 @@ public:
     int getBookSize(Issue const&);
 
     bool isBookToXRP (Issue const&);
+    bool isBookToVBC (Issue const&);
+
+    /** @return the number of root directories of each book, by book base. */
+    hash_map <uint256, int> getBookDirs ();
 
     BookListeners::pointer getBookListeners (Book const&);
     BookListeners::pointer makeBookListeners (Book const&);
@@ -61,7 +85,22 @@ public:
     using IssueToOrderBook = hash_map <Issue, OrderBook::List>;
 
 private:
-    void rawAddBook(Book const&);
+    // The book directories created and deleted between two ledgers
+    struct BookChanges
+    {
+        std::uint32_t from = 0;
+        std::uint32_t to = 0;
+        // Only kept while the changes are the last ones pending
+        std::shared_ptr<ReadView const> ledger;
+        std::vector<Book> created;
+        std::vector<Book> deleted;
+    };
+
+    void scheduleUpdate (std::shared_ptr<ReadView const> const& ledger);
+    bool applyChanges (BookChanges const&);
+    bool insertBook (Book const&);
+    void eraseBook (Book const&);
+    hash_set <Issue>* nativeBooks (Currency const&);
 
     Application& app_;
 
@@ -74,14 +113,29 @@ private:
     // does an order book to XRP exist
     hash_set <Issue> mXRPBooks;
 
+    // does an order book to VBC exist
+    hash_set <Issue> mVBCBooks;
+
+    // number of root directories, one per quality, by book base
+    hash_map <uint256, int> mBookDirs;
+
     std::recursive_mutex mLock;
 
     using BookToListenersMap = hash_map <Book, BookListeners::pointer>;
 
     BookToListenersMap mListeners;
 
+    // the ledger the books are built from, zero if they must be rebuilt
     std::uint32_t mSeq;
 
+    // the ledger being scanned, zero if none
+    std::uint32_t mScanSeq;
+
+    // changes published while a scan runs
+    std::vector<BookChanges> mPending;
+
+    boost::signals2::scoped_connection mStateDiffs;
+
     beast::Journal j_;
 };
 
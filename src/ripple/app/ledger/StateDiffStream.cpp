@@ -0,0 +1,140 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+#include <BeastConfig.h>
+#include <ripple/app/ledger/StateDiffStream.h>
+#include <ripple/basics/Log.h>
+#include <ripple/protocol/Serializer.h>
+#include <algorithm>
+
+namespace ripple {
+
+void
+visitStateDiffs (SHAMap const& before, SHAMap const& after,
+    std::function<void(StateDiff const&)> const& f)
+{
+    using Items = std::vector<std::shared_ptr<SHAMapItem const>>;
+
+    // The leaves of map which are not in other, sorted by key
+    auto const leaves = [](SHAMap const& map, SHAMap const& other)
+    {
+        Items items;
+        map.visitDifferences (&other, [&items](SHAMapAbstractNode& node)
+        {
+            if (node.isLeaf ())
+                items.push_back (
+                    static_cast<SHAMapTreeNode&>(node).peekItem ());
+            return true;
+        });
+        std::sort (items.begin (), items.end (),
+            [](std::shared_ptr<SHAMapItem const> const& a,
+               std::shared_ptr<SHAMapItem const> const& b)
+            {
+                return a->key () < b->key ();
+            });
+        return items;
+    };
+
+    auto const makeSLE = [](std::shared_ptr<SHAMapItem const> const& item)
+    {
+        return std::make_shared<SLE const> (
+            SerialIter {item->data (), item->size ()}, item->key ());
+    };
+
+    auto const removed = leaves (before, after);
+    auto const added = leaves (after, before);
+
+    auto r = removed.begin ();
+    auto a = added.begin ();
+    StateDiff diff;
+    while (r != removed.end () || a != added.end ())
+    {
+        if (a == added.end () ||
+            (r != removed.end () && (*r)->key () < (*a)->key ()))
+        {
+            diff.key = (*r)->key ();
+            diff.before = makeSLE (*r++);
+            diff.after.reset ();
+        }
+        else if (r == removed.end () || (*a)->key () < (*r)->key ())
+        {
+            diff.key = (*a)->key ();
+            diff.before.reset ();
+            diff.after = makeSLE (*a++);
+        }
+        else
+        {
+            diff.key = (*a)->key ();
+            diff.before = makeSLE (*r++);
+            diff.after = makeSLE (*a++);
+        }
+        f (diff);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+StateDiffStream::StateDiffStream (beast::Journal journal)
+    : j_ (journal)
+{
+}
+
+boost::signals2::connection
+StateDiffStream::subscribe (Signal::slot_type const& slot)
+{
+    return signal_.connect (slot);
+}
+
+void
+StateDiffStream::publish (std::shared_ptr<Ledger const> const& ledger)
+{
+    std::lock_guard <std::mutex> lock (mutex_);
+
+    auto const before = std::move (last_);
+    last_ = ledger;
+    if (signal_.empty ())
+        return;
+
+    LedgerStateDiff changes;
+    changes.after = ledger;
+    if (before)
+    {
+        try
+        {
+            visitStateDiffs (before->stateMap (), ledger->stateMap (),
+                [&changes](StateDiff const& diff)
+                {
+                    changes.diffs.push_back (diff);
+                });
+            changes.before = before;
+        }
+        catch (SHAMapMissingNode const& e)
+        {
+            JLOG (j_.warning) << "Ledger " << ledger->info ().seq <<
+                " changes unknown: " << e;
+            changes.diffs.clear ();
+        }
+    }
+
+    JLOG (j_.debug) << "Ledger " << ledger->info ().seq << ": " <<
+        changes.diffs.size () << " entries changed since " <<
+            (before ? before->info ().seq : 0);
+    signal_ (changes);
+}
+
+} // ripple
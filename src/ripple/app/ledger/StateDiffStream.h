@@ -0,0 +1,106 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+#ifndef RIPPLE_APP_LEDGER_STATEDIFFSTREAM_H_INCLUDED
+#define RIPPLE_APP_LEDGER_STATEDIFFSTREAM_H_INCLUDED
+
+#include <ripple/app/ledger/Ledger.h>
+#include <ripple/protocol/STLedgerEntry.h>
+#include <ripple/shamap/SHAMap.h>
+#include <beast/utility/Journal.h>
+#include <boost/signals2/signal.hpp>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ripple {
+
+/** A ledger entry which differs between two ledgers.
+
+    before is null for a created entry and after is null for a deleted one.
+*/
+struct StateDiff
+{
+    uint256 key;
+    std::shared_ptr<SLE const> before;
+    std::shared_ptr<SLE const> after;
+};
+
+/** Calls f for every entry which differs between two state maps.
+
+    Only the subtrees whose hashes differ are walked. Entries are passed
+    in key order.
+
+    @throws SHAMapMissingNode if a differing node is not available.
+*/
+void
+visitStateDiffs (SHAMap const& before, SHAMap const& after,
+    std::function<void(StateDiff const&)> const& f);
+
+/** The state changes of a validated ledger. */
+struct LedgerStateDiff
+{
+    /** The ledger the changes are relative to, usually the previously
+        published one. When null the changes are unknown and subscribers
+        must rebuild what they keep from the state of after.
+    */
+    std::shared_ptr<Ledger const> before;
+    std::shared_ptr<Ledger const> after;
+
+    /** The entries which differ, in key order. */
+    std::vector<StateDiff> diffs;
+};
+
+/** Publishes the state changes of each newly validated ledger.
+
+    Subscribers which maintain something derived from the ledger state
+    can apply the changes instead of scanning the whole state. Changes are
+    only computed while there are subscribers. A subscriber should check
+    that before is the ledger it last saw, and rebuild otherwise.
+*/
+class StateDiffStream
+{
+public:
+    using Signal = boost::signals2::signal<void(LedgerStateDiff const&)>;
+
+    explicit
+    StateDiffStream (beast::Journal journal);
+
+    /** Subscribe to the changes of each validated ledger.
+
+        The slot is called on the thread publishing ledgers, in ledger
+        order, and should hand long work off to a job.
+    */
+    boost::signals2::connection
+    subscribe (Signal::slot_type const& slot);
+
+    /** Publish the changes of a newly validated ledger. */
+    void
+    publish (std::shared_ptr<Ledger const> const& ledger);
+
+private:
+    std::mutex mutex_;
+    std::shared_ptr<Ledger const> last_;
+    Signal signal_;
+    beast::Journal j_;
+};
+
+} // ripple
+
+#endif
@@ -835,7 +835,7 @@ bool InboundLedger::takeHeader (std::string const& data)
     Call with a lock
 */
 bool InboundLedger::takeTxNode (const std::vector<SHAMapNodeID>& nodeIDs,
-    const std::vector< Blob >& data, SHAMapAddNode& san)
+    const std::vector<Slice>& data, SHAMapAddNode& san)
 {
     if (!mHaveHeader)
     {
@@ -894,7 +894,7 @@ bool InboundLedger::takeTxNode (const std::vector<SHAMapNodeID>& nodeIDs,
     Call with a lock
 */
 bool InboundLedger::takeAsNode (const std::vector<SHAMapNodeID>& nodeIDs,
-    const std::vector< Blob >& data, SHAMapAddNode& san)
+    const std::vector<Slice>& data, SHAMapAddNode& san)
 {
     if (m_journal.trace) m_journal.trace <<
         "got ASdata (" << nodeIDs.size () << ") acquiring ledger " << mHash;
@@ -967,7 +967,7 @@ bool InboundLedger::takeAsNode (const std::vector<SHAMapNodeID>& nodeIDs,
 /** Process AS root node received from a peer
     Call with a lock
 */
-bool InboundLedger::takeAsRootNode (Blob const& data, SHAMapAddNode& san)
+bool InboundLedger::takeAsRootNode (Slice const& data, SHAMapAddNode& san)
 {
     if (mFailed || mHaveState)
     {
@@ -990,7 +990,7 @@ bool InboundLedger::takeAsRootNode (Blob const& data, SHAMapAddNode& san)
 /** Process AS root node received from a peer
     Call with a lock
 */
-bool InboundLedger::takeTxRootNode (Blob const& data, SHAMapAddNode& san)
+bool InboundLedger::takeTxRootNode (Slice const& data, SHAMapAddNode& san)
 {
     if (mFailed || mHaveTransactions)
     {
@@ -1107,14 +1107,14 @@ int InboundLedger::processData (std::shared_ptr<Peer> peer,
 
 
         if (!mHaveState && (packet.nodes ().size () > 1) &&
-            !takeAsRootNode (strCopy (packet.nodes (1).nodedata ()), san))
+            !takeAsRootNode (makeSlice (packet.nodes (1).nodedata ()), san))
         {
             if (m_journal.warning) m_journal.warning <<
                 "Included AS root invalid";
         }
 
         if (!mHaveTransactions && (packet.nodes ().size () > 2) &&
-            !takeTxRootNode (strCopy (packet.nodes (2).nodedata ()), san))
+            !takeTxRootNode (makeSlice (packet.nodes (2).nodedata ()), san))
         {
             if (m_journal.warning) m_journal.warning <<
                 "Included TX root invalid";
@@ -1140,7 +1140,8 @@ int InboundLedger::processData (std::shared_ptr<Peer> peer,
 
         std::vector<SHAMapNodeID> nodeIDs;
         nodeIDs.reserve(packet.nodes().size());
-        std::vector< Blob > nodeData;
+        // The node data is used in place, the packet outlives it
+        std::vector<Slice> nodeData;
         nodeData.reserve(packet.nodes().size());
 
         for (int i = 0; i < packet.nodes ().size (); ++i)
@@ -1157,8 +1158,7 @@ int InboundLedger::processData (std::shared_ptr<Peer> peer,
 
             nodeIDs.push_back (SHAMapNodeID (node.nodeid ().data (),
                 node.nodeid ().size ()));
-            nodeData.push_back (Blob (node.nodedata ().begin (),
-                node.nodedata ().end ()));
+            nodeData.push_back (makeSlice (node.nodedata ()));
         }
 
         SHAMapAddNode san;
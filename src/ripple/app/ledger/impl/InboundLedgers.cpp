@@ -260,7 +260,7 @@ public:
                     return;
 
                 auto newNode = SHAMapAbstractNode::make(
-                    Blob (node.nodedata().begin(), node.nodedata().end()),
+                    makeSlice (node.nodedata()),
                     0, snfWIRE, SHAMapHash{uZero}, false, app_.journal ("SHAMapNodeID"));
 
                 if (!newNode)
@@ -1363,7 +1363,7 @@ void LedgerConsensusImp::accept (std::shared_ptr<SHAMap> set)
             app_.getLedgerMaster().getValidatedLedger();
         boost::optional<Rules> rules;
         if (lastVal)
-            rules.emplace(*lastVal);
+            rules.emplace(*lastVal, app_.config().features);
         else
             rules.emplace();
         app_.openLedger().accept(app_, *rules,
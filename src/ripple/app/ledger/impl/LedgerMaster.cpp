@@ -19,10 +19,12 @@
 
 #include <BeastConfig.h>
 #include <ripple/app/ledger/LedgerMaster.h>
+#include <ripple/app/ledger/CloseTimeIndex.h>
 #include <ripple/app/ledger/InboundLedgers.h>
 #include <ripple/app/ledger/LedgerHistory.h>
 #include <ripple/app/ledger/OpenLedger.h>
 #include <ripple/app/ledger/OrderBookDB.h>
+#include <ripple/app/ledger/StateDiffStream.h>
 #include <ripple/app/ledger/PendingSaves.h>
 #include <ripple/app/ledger/impl/LedgerCleaner.h>
 #include <ripple/app/tx/apply.h>
@@ -31,6 +33,7 @@
 #include <ripple/app/misc/DividendMaster.h>
 #include <ripple/app/misc/HashRouter.h>
 #include <ripple/app/misc/NetworkOPs.h>
+#include <ripple/app/misc/ProposalTally.h>
 #include <ripple/app/misc/CanonicalTXSet.h>
 #include <ripple/app/misc/SHAMapStore.h>
 #include <ripple/app/misc/Transaction.h>
@@ -110,6 +113,11 @@ public:
     std::recursive_mutex mCompleteLock;
     RangeSet mCompleteLedgers;
 
+    // Close times of validated ledgers, filled from the ledger database
+    // on first use.
+    CloseTimeIndex mCloseTimes;
+    std::once_flag mCloseTimesLoaded;
+
     std::unique_ptr <LedgerCleaner> mLedgerCleaner;
 
     int mMinValidations;    // The minimum validations to publish a ledger.
@@ -310,6 +318,8 @@ public:
         mValidLedger.set (l);
         mValidLedgerSign = signTime;
         mValidLedgerSeq = l->info().seq;
+        mCloseTimes.insert (l->info().seq, l->info().closeTime,
+            l->info().parentCloseTime);
         app_.getOPs().updateLocalTx (l);
         app_.getSHAMapStore().onLedgerClosed (getValidatedLedger());
         mLedgerHistory.validatedLedger (l);
@@ -423,6 +433,7 @@ public:
 
     void clearLedger (std::uint32_t seq) override
     {
+        mCloseTimes.erase (seq);
         ScopedLockType sl (mCompleteLock);
         return mCompleteLedgers.clearValue (seq);
     }
@@ -704,6 +715,8 @@ public:
                 ScopedLockType ml (mCompleteLock);
                 mCompleteLedgers.setValue (ledger->info().seq);
             }
+            mCloseTimes.insert (ledger->info().seq, ledger->info().closeTime,
+                ledger->info().parentCloseTime);
 
             ScopedLockType ml (m_mutex);
 
@@ -885,9 +898,55 @@ public:
         app_.getFeeTrack().setRemoteFee(fee);
 
         tryAdvance ();
-        
+
+        // Keep proposal votes counted as of the last validated ledger. The
+        // job moves the tally to the last validated ledger when it runs,
+        // passing through every ledger in between, so one pending job also
+        // covers ledgers validated after it was queued.
+        if (app_.config ().exists (SECTION_PROPOSAL_VOTE) &&
+            app_.getJobQueue ().getJobCount (jtPROPOSAL_TALLY) == 0)
+        {
+            ProposalTally& tally = app_.getProposalTally ();
+            app_.getJobQueue ().addJob (jtPROPOSAL_TALLY,
+                "ProposalTally::update",
+                [this, &tally] (Job&)
+                {
+                    auto const validated = getValidatedLedger ();
+                    if (! validated)
+                        return;
+                    tally.update (validated,
+                        [this] (std::uint32_t seq)
+                        {
+                            return getLedgerBySeq (seq);
+                        });
+                });
+        }
+
         // For Dividend.
         {
+            auto const& dividendAccount = app_.config ()[SECTION_DIVIDEND_ACCOUNT];
+            std::string secret_key = get<std::string> (dividendAccount, "secret_key");
+            if (secret_key.empty())
+                return;
+
+            DividendMaster& dm = app_.getDividendMaster();
+
+            // Keep the account index following validated ledgers. The job
+            // moves the index to the last validated ledger when it runs, so
+            // one pending job also covers ledgers validated after it was
+            // queued. Skipped ledgers lose nothing, the index is moved by
+            // the state differences between the two ledgers.
+            if (app_.getJobQueue ().getJobCount (jtDIVIDEND_IDX) == 0)
+            {
+                app_.getJobQueue ().addJob (jtDIVIDEND_IDX,
+                    "DividendMaster::updateAccountIndex",
+                    [this, &dm] (Job&)
+                    {
+                        if (auto const validated = getValidatedLedger ())
+                            dm.updateAccountIndex (validated);
+                    });
+            }
+
             auto const dividendObj = ledger->read (keylet::dividend ());
 
             if (!dividendObj)
@@ -901,13 +960,7 @@ public:
                 // dividend has already finished or not started.
                 return;
             }
-            
-            auto const& dividendAccount = app_.config ()[SECTION_DIVIDEND_ACCOUNT];
-            std::string secret_key = get<std::string> (dividendAccount, "secret_key");
-            if (secret_key.empty())
-                return;
 
-            DividendMaster& dm = app_.getDividendMaster();
             if (app_.getJobQueue ().getJobCount (jtDIVIDEND) > 0)
             {
                 JLOG (m_journal.debug) << "Dividend job passed.";
@@ -1583,8 +1636,31 @@ public:
         return Ledger::pointer ();
     }
 
+    void loadCloseTimes ()
+    {
+        std::call_once (mCloseTimesLoaded, [this]
+        {
+            ripple::loadCloseTimes (mCloseTimes, app_);
+        });
+    }
+
+    boost::optional <LedgerIndex>
+    getLedgerSeqBeforeCloseTime (uint32 closeTime) override
+    {
+        loadCloseTimes ();
+        return mCloseTimes.lastClosedAtOrBefore (closeTime);
+    }
+
     // find first ledger that it's close time is larger than specified time in log(N) time
     Ledger::pointer getLedgerByCloseTime(uint32 closeTime) override {
+        loadCloseTimes ();
+        if (auto const seq = mCloseTimes.firstClosedAtOrAfter (closeTime))
+        {
+            if (auto ledger = getLedgerBySeq (*seq))
+                return ledger;
+        }
+
+        // Not indexed, search the complete ledgers.
         uint32_t first = mCompleteLedgers.getFirst();
         uint32_t last = mCompleteLedgers.getLast();
         if (first == RangeSet::absent || last == RangeSet::absent) {
@@ -1649,11 +1725,12 @@ public:
 
     void clearPriorLedgers (LedgerIndex seq) override
     {
+        mCloseTimes.eraseBefore (seq);
         ScopedLockType sl (mCompleteLock);
         for (LedgerIndex i = mCompleteLedgers.getFirst(); i < seq; ++i)
         {
-            if (haveLedger (i))
-                clearLedger (i);
+            if (mCompleteLedgers.hasValue (i))
+                mCompleteLedgers.clearValue (i);
         }
     }
 
@@ -1882,6 +1959,7 @@ void LedgerMasterImp::doAdvance ()
 
                 {
                     ScopedUnlockType sul(m_mutex);
+                    app_.getStateDiffStream().publish(ledger);
                     app_.getOPs().pubLedger(ledger);
                 }
             }
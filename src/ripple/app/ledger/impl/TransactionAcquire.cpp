@@ -173,7 +173,7 @@ void TransactionAcquire::trigger (Peer::ptr const& peer)
 }
 
 SHAMapAddNode TransactionAcquire::takeNodes (const std::list<SHAMapNodeID>& nodeIDs,
-        const std::list< Blob >& data, Peer::ptr const& peer)
+        const std::list<Slice>& data, Peer::ptr const& peer)
 {
     ScopedLockType sl (mLock);
 
@@ -195,7 +195,7 @@ SHAMapAddNode TransactionAcquire::takeNodes (const std::list<SHAMapNodeID>& node
             return SHAMapAddNode::invalid ();
 
         std::list<SHAMapNodeID>::const_iterator nodeIDit = nodeIDs.begin ();
-        std::list< Blob >::const_iterator nodeDatait = data.begin ();
+        std::list<Slice>::const_iterator nodeDatait = data.begin ();
         ConsensusTransSetSF sf (app_, app_.getTempNodeCache ());
 
         while (nodeIDit != nodeIDs.end ())
@@ -29,6 +29,7 @@
 #include <ripple/app/ledger/LedgerToJson.h>
 #include <ripple/app/ledger/OpenLedger.h>
 #include <ripple/app/ledger/OrderBookDB.h>
+#include <ripple/app/ledger/StateDiffStream.h>
 #include <ripple/app/ledger/PendingSaves.h>
 #include <ripple/app/ledger/InboundTransactions.h>
 #include <ripple/app/ledger/TransactionMaster.h>
@@ -38,6 +39,7 @@
 #include <ripple/app/main/NodeStoreScheduler.h>
 #include <ripple/app/misc/AmendmentTable.h>
 #include <ripple/app/misc/DividendMaster.h>
+#include <ripple/app/misc/ProposalTally.h>
 #include <ripple/app/misc/HashRouter.h>
 #include <ripple/app/misc/NetworkOPs.h>
 #include <ripple/app/misc/SHAMapStore.h>
@@ -102,6 +104,10 @@ private:
     FullBelowCache fullbelow_;
     NodeStore::Database& db_;
     //bool const shardBacked_;
+    std::size_t const flushThreshold_;
+    ParallelPool flushPool_;
+    beast::insight::Event flushTime_;
+    beast::insight::Event flushParallelTime_;
     beast::Journal j_;
 
     // missing node handler
@@ -124,6 +130,12 @@ public:
         //, shardBacked_ (
         //    dynamic_cast<NodeStore::DatabaseShard*>(&db) != nullptr)
             
+        , flushThreshold_ (app.config().FLUSH_THRESHOLD)
+        , flushPool_ (flushThreshold_ ? parallelThreads () - 1 : 0,
+            "SHAMapFlush")
+        , flushTime_ (collectorManager.group ("shamap")->make_event ("flush"))
+        , flushParallelTime_ (collectorManager.group ("shamap")->make_event (
+            "flush_parallel"))
         , j_ (app.journal("SHAMap"))
     {
     }
@@ -219,6 +231,31 @@ public:
                 hash, 0, InboundLedger::fcGENERIC);
         }
     }
+
+    std::size_t
+    flushThreshold() const override
+    {
+        return flushThreshold_;
+    }
+
+    ParallelPool&
+    flushPool() override
+    {
+        return flushPool_;
+    }
+
+    void
+    onFlush (int nodes, std::size_t threads,
+        std::chrono::microseconds elapsed) override
+    {
+        if (threads > 1)
+            flushParallelTime_.notify (elapsed);
+        else
+            flushTime_.notify (elapsed);
+
+        JLOG (j_.debug) << "Flushed " << nodes << " nodes on " <<
+            threads << " threads in " << elapsed.count () << "us";
+    }
 };
 
 } // detail
@@ -324,6 +361,7 @@ public:
     LocalCredentials m_localCredentials;
 
     std::unique_ptr <Resource::Manager> m_resourceManager;
+    StateDiffStream m_stateDiffStream;
 
     // These are Stoppable-related
     std::unique_ptr <JobQueue> m_jobQueue;
@@ -340,6 +378,7 @@ public:
     std::unique_ptr <ServerHandler> serverHandler_;
     std::unique_ptr <AmendmentTable> m_amendmentTable;
     std::unique_ptr <DividendMaster> m_dividendMaster;
+    std::unique_ptr <ProposalTally> m_proposalTally;
     std::unique_ptr <LoadFeeTrack> mFeeTrack;
     std::unique_ptr <HashRouter> mHashRouter;
     std::unique_ptr <Validations> mValidations;
@@ -418,6 +457,8 @@ public:
         , m_resourceManager (Resource::make_Manager (
             m_collectorManager->collector(), logs_->journal("Resource")))
 
+        , m_stateDiffStream (logs_->journal("StateDiffStream"))
+
         // The JobQueue has to come pretty early since
         // almost everything is a Stoppable child of the JobQueue.
         //
@@ -474,6 +515,11 @@ public:
                             (weeks(2), MAJORITY_FRACTION,
                              logs_->journal("AmendmentTable")))
         , m_dividendMaster (make_DividendMaster (*this, logs_->journal("DividendMaster")))
+        , m_proposalTally (std::make_unique<ProposalTally> (logs_->journal("ProposalTally"),
+            [this](std::uint32_t proposal, ProposalTally::Counts const& counts)
+            {
+                saveProposalCounts (proposal, counts);
+            }))
 
         , mFeeTrack (std::make_unique<LoadFeeTrack>(logs_->journal("LoadManager")))
 
@@ -519,6 +565,7 @@ public:
 
         // VFALCO HACK
         m_nodeStoreScheduler.setJobQueue (*m_jobQueue);
+        m_nodeStoreScheduler.setCollector (m_collectorManager->group ("nodestore"));
 
         add (m_ledgerMaster->getPropertySource ());
         add (*serverHandler_);
@@ -659,6 +706,11 @@ public:
         return m_orderBookDB;
     }
 
+    StateDiffStream& getStateDiffStream () override
+    {
+        return m_stateDiffStream;
+    }
+
     PathRequests& getPathRequests () override
     {
         return *m_pathRequests;
@@ -680,6 +732,11 @@ public:
         return *m_dividendMaster;
     }
 
+    ProposalTally& getProposalTally() override
+    {
+        return *m_proposalTally;
+    }
+
     LoadFeeTrack& getFeeTrack () override
     {
         return *mFeeTrack;
@@ -759,6 +816,25 @@ public:
         return *mVoteCountingDB;
     }
 
+    // Store the counts of a closed proposal the way vote_counting does, so
+    // they survive a restart.
+    void saveProposalCounts (std::uint32_t proposal,
+        ProposalTally::Counts const& counts)
+    {
+        if (!mVoteCountingDB ||
+            mVoteCountingDB->getType () == DatabaseCon::Type::None)
+            return;
+
+        std::uint32_t const ledgerSeq = counts.ledgerSeq;
+        std::string const statistic = counts.statistic ();
+        auto db = mVoteCountingDB->checkoutDb ();
+        *db << "INSERT INTO VoteCounting (Proposal, Ledger, Statistic) "
+               "SELECT :proposal, :ledger, :statistic WHERE NOT EXISTS "
+               "(SELECT 1 FROM VoteCounting WHERE Proposal=:proposal2 AND Ledger=:ledger2);",
+            soci::use (proposal), soci::use (ledgerSeq), soci::use (statistic),
+            soci::use (proposal), soci::use (ledgerSeq);
+    }
+
     bool serverOkay (std::string& reason) override;
 
     beast::Journal journal (std::string const& name) override;
@@ -1062,7 +1138,7 @@ void ApplicationImp::setup()
             try
             {
                 auto node = SHAMapAbstractNode::make (
-                    obj->getData (), 0, snfPREFIX, SHAMapHash (uNodeIndex), true, m_journal);
+                    makeSlice (obj->getData ()), 0, snfPREFIX, SHAMapHash (uNodeIndex), true, m_journal);
                 if (!node || !node->isLeaf ())
                     throw "No such node";
                 std::shared_ptr<STTx const> txn;
@@ -1121,7 +1197,8 @@ void ApplicationImp::setup()
         startGenesisLedger ();
     }
 
-    m_orderBookDB.setup (getLedgerMaster ().getCurrentLedger ());
+    if (auto const ledger = getLedgerMaster ().getValidatedLedger ())
+        m_orderBookDB.setup (ledger);
 
     cluster_ = make_Cluster (config (), logs_->journal("Overlay"));
 
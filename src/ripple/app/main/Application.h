@@ -40,6 +40,7 @@ namespace NodeStore { class Database; class DatabaseShard; }
 // VFALCO TODO Fix forward declares required for header dependency loops
 class AmendmentTable;
 class DividendMaster;
+class ProposalTally;
 class CachedSLEs;
 class CollectorManager;
 class Family;
@@ -57,6 +58,7 @@ class LoadManager;
 class NetworkOPs;
 class OpenLedger;
 class OrderBookDB;
+class StateDiffStream;
 class Overlay;
 class PathRequests;
 class PendingSaves;
@@ -116,6 +118,7 @@ public:
     virtual CachedSLEs&             cachedSLEs() = 0;
     virtual AmendmentTable&         getAmendmentTable() = 0;
     virtual DividendMaster&         getDividendMaster() = 0;
+    virtual ProposalTally&          getProposalTally() = 0;
     virtual HashRouter&             getHashRouter () = 0;
     virtual LoadFeeTrack&           getFeeTrack () = 0;
     virtual LoadManager&            getLoadManager () = 0;
@@ -133,6 +136,7 @@ public:
     virtual LedgerMaster&           getLedgerMaster () = 0;
     virtual NetworkOPs&             getOPs () = 0;
     virtual OrderBookDB&            getOrderBookDB () = 0;
+    virtual StateDiffStream&        getStateDiffStream () = 0;
     virtual TransactionMaster&      getMasterTransaction () = 0;
     virtual LocalCredentials&       getLocalCredentials () = 0;
     virtual Resource::Manager&      getResourceManager () = 0;
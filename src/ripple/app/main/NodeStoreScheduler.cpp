@@ -34,6 +34,13 @@ void NodeStoreScheduler::setJobQueue (JobQueue& jobQueue)
     m_jobQueue = &jobQueue;
 }
 
+void NodeStoreScheduler::setCollector (
+    beast::insight::Collector::ptr const& collector)
+{
+    m_syncRead = collector->make_event ("sync_read");
+    m_asyncRead = collector->make_event ("async_read");
+}
+
 void NodeStoreScheduler::onStop ()
 {
 }
@@ -63,9 +70,12 @@ void NodeStoreScheduler::doTask (NodeStore::Task& task)
 void NodeStoreScheduler::onFetch (NodeStore::FetchReport const& report)
 {
     if (report.wentToDisk)
+    {
         m_jobQueue->addLoadEvents (
             report.isAsync ? jtNS_ASYNC_READ : jtNS_SYNC_READ,
                 1, report.elapsed);
+        (report.isAsync ? m_asyncRead : m_syncRead).notify (report.elapsed);
+    }
 }
 
 void NodeStoreScheduler::onBatchWrite (NodeStore::BatchWriteReport const& report)
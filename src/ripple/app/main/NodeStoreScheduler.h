@@ -22,6 +22,7 @@
 
 #include <ripple/nodestore/Scheduler.h>
 #include <ripple/core/JobQueue.h>
+#include <beast/insight/Collector.h>
 #include <beast/threads/Stoppable.h>
 #include <atomic>
 
@@ -40,6 +41,9 @@ public:
     //
     void setJobQueue (JobQueue& jobQueue);
 
+    /** Report the latency of reads that went to the backend. */
+    void setCollector (beast::insight::Collector::ptr const& collector);
+
     void onStop () override;
     void onChildrenStopped () override;
     void scheduleTask (NodeStore::Task& task) override;
@@ -51,6 +55,8 @@ private:
 
     JobQueue* m_jobQueue;
     std::atomic <int> m_taskCount;
+    beast::insight::Event m_syncRead;
+    beast::insight::Event m_asyncRead;
 };
 
 } // ripple
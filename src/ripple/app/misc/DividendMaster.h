@@ -17,10 +17,20 @@ public:
     } DivdendType;
     typedef enum { DivState_Done = 0, DivState_Start = 1 } DivdendState;
     
-    // <AccountID, DivCoins, DivCoinsVBC, DivCoinsVBCRank, DivCoinsVBCSpd, VRank, VSpd, TSpd>
-    //typedef std::vector<std::tuple<AccountID, uint64_t, uint64_t, uint64_t, uint64_t, uint32_t, uint64_t, uint64_t>> AccountsDividend;
-    
-    typedef std::map<AccountID, std::tuple<uint64_t, uint64_t, uint64_t, uint64_t, uint32_t, uint64_t, uint64_t>> AccountsDividend;
+    struct AccountDividend
+    {
+        AccountID account;
+        uint64_t divCoins;
+        uint64_t divCoinsVBC;
+        uint64_t divCoinsVBCRank;
+        uint64_t divCoinsVBCSprd;
+        uint32_t vRank;
+        uint64_t vSprd;
+        uint64_t tSprd;
+    };
+
+    /// Dividend of each account, at most one entry per account.
+    typedef std::vector<AccountDividend> AccountsDividend;
     
     virtual ~DividendMaster(){}
     
@@ -35,6 +45,9 @@ public:
     virtual bool launchDividend (const uint32_t ledgerIndex) = 0;
     
     virtual void getMissingTxns () = 0;
+
+    /// Bring the referral/balance index up to the state of a validated ledger.
+    virtual void updateAccountIndex (Ledger::pointer const& ledger) = 0;
 };
 
 std::unique_ptr<DividendMaster>
@@ -10,10 +10,12 @@
 
 #if RIPPLE_THRIFT_AVAILABLE
 #include <boost/multiprecision/cpp_int.hpp>
-#include <boost/graph/adjacency_list.hpp>
-#include <boost/graph/depth_first_search.hpp>
 
 #include <beast/threads/RecursiveMutex.h>
+#include <chrono>
+#include <limits>
+#include <mutex>
+#include <numeric>
 
 #include <ripple/app/ledger/LedgerMaster.h>
 
@@ -21,6 +23,7 @@
 
 #include <ripple/app/misc/NetworkOPs.h>
 #include <ripple/basics/Log.h>
+#include <ripple/basics/ParallelFor.h>
 #include <ripple/protocol/SystemParameters.h>
 #include <ripple/protocol/TxFlags.h>
 #include <ripple/json/to_string.h>
@@ -115,114 +118,258 @@ public:
         return std::make_tuple (dividendCoins, dividendCoinsVBC);
     }
 
-    /// Prepare #m_accountsByBalance and #m_accountsGraph for dividend.
-    void prepareAccounts (Ledger::pointer ledger)
+    /// Apply one state difference to #m_accountIndex.
+    /// @param before item in the indexed ledger, may be null.
+    /// @param after item in the new ledger, may be null.
+    void applyAccountDelta (std::shared_ptr<SHAMapItem const> const& before,
+                            std::shared_ptr<SHAMapItem const> const& after)
     {
-        // Accounts that are under minimal VBC requirement and with no
-        // reference yet.
-        std::unordered_map<AccountID, std::shared_ptr<AccountData>> accountsUnqualified;
-
-        auto& accounts = m_accounts;
-        accounts.clear ();
-        auto& accountsByBalance = m_accountsByBalance;
-        accountsByBalance.clear ();
-        auto& accountsGraph = m_accountsGraph;
-        accountsGraph.clear ();
-
-        /// push an AccountData into #accounts and #accountsGraph.
-        /// @return std::pair<iterator in accounts, true as succeeded>.
-        auto pushAccount = [&](const std::shared_ptr<AccountData>& accountData)
+        if (after)
         {
-            auto result = accounts.emplace (accountData->account, accountData);
-            if (result.second)
-                accountData->vertex = boost::add_vertex ({accountData}, accountsGraph);
-            return result;
-        };
+            auto sle = std::make_shared<SLE> (SerialIter{after->data (), after->size ()}, after->key ());
+            if (sle->getType () == ltACCOUNT_ROOT)
+            {
+                indexAccount (sle);
+                return;
+            }
+        }
+        if (before)
+        {
+            // Removed, or no longer an AccountRoot.
+            auto sle = std::make_shared<SLE> (SerialIter{before->data (), before->size ()}, before->key ());
+            if (sle->getType () == ltACCOUNT_ROOT)
+                m_accountIndex.erase (sle->getAccountID (sfAccount));
+        }
+    }
 
-        /// Visit all AccountRoots to fill #accounts, #accountsGraph and #accountsByBalance.
-        auto accountVisitor = [&](SLE::ref sle)
+    void indexAccount (SLE::ref sle)
+    {
+        auto const account = sle->getAccountID (sfAccount);
+        auto& entry = m_accountIndex[account];
+        entry.vbc = sle->getFieldAmount (sfBalanceVBC).mantissa ();
+        entry.referee = sle->getAccountID (sfReferee);
+
+        if (m_progress.dividendLedger != 0 &&
+            sle->isFieldPresent (sfDividendLedger) &&
+            sle->getFieldU32 (sfDividendLedger) == m_progress.dividendLedger)
         {
-            if (sle->getType () != ltACCOUNT_ROOT)
-                return;
+            m_progress.markApplied (account);
+        }
+    }
 
-            uint64_t vbc = sle->getFieldAmount (sfBalanceVBC).mantissa ();
+    /// Bring #m_accountIndex to the state of @p ledger. Uses the differences
+    /// against the last indexed ledger if there are not too many of them,
+    /// else rebuilds from a full state walk.
+    /// @note #m_indexMutex must be held.
+    /// @return false if ledger state could not be read.
+    bool syncAccountIndex (Ledger::pointer const& ledger)
+    {
+        if (m_indexLedger && m_indexLedger->info ().hash == ledger->info ().hash)
+            return true;
 
-            auto account = sle->getAccountID (sfAccount);
-            auto accountParent = sle->getAccountID (sfReferee);
-            bool noParent = !accountParent;
+        // Account changes also advance the dividend progress.
+        std::lock_guard<std::mutex> progressLock (m_progressMutex);
 
-            auto iter = accounts.find (account);
-            
-            // root account stats
-            if (noParent)
+        if (m_indexLedger)
+        {
+            try
             {
-                JLOG (m_journal.info) << "Root account " << account;
+                SHAMap::Delta delta;
+                if (ledger->stateMap ().compare (m_indexLedger->stateMap (), delta, maxIndexDelta))
+                {
+                    // first is the item in ledger, second the one in m_indexLedger.
+                    for (auto const& item : delta)
+                        applyAccountDelta (item.second.second, item.second.first);
+
+                    JLOG (m_journal.debug) << "Account index moved from ledger " << m_indexLedger->info ().seq
+                                           << " to " << ledger->info ().seq << " with " << delta.size () << " differences.";
+                    m_indexLedger = ledger;
+                    return true;
+                }
+                JLOG (m_journal.info) << "Too many differences from indexed ledger " << m_indexLedger->info ().seq
+                                      << " to " << ledger->info ().seq << ", rebuilding account index.";
             }
-            
-            if (iter != accounts.end ())
+            catch (SHAMapMissingNode const& e)
             {
-                // Already qualified as referee.
-                iter->second->vbc = vbc;
+                JLOG (m_journal.warning) << "Account index delta failed: " << e << ", rebuilding.";
             }
-            else if (vbc < SYSTEM_CURRENCY_PARTS_VBC && noParent)
+        }
+
+        m_accountIndex.clear ();
+        m_indexLedger.reset ();
+        try
+        {
+            // Entries are read and parsed in parallel, indexing is serialized.
+            std::mutex indexMutex;
+            ledger->visitStateItemsParallel ([this, &indexMutex](std::size_t, SLE::ref sle)
             {
-                // Not qualified, store in accountsUnqualified temporary.
-                accountsUnqualified.emplace (account, std::make_shared<AccountData> (account, vbc));
-                return;
+                if (sle->getType () != ltACCOUNT_ROOT)
+                    return;
+                std::lock_guard<std::mutex> lock (indexMutex);
+                indexAccount (sle);
+            }, parallelThreads ());
+        }
+        catch (SHAMapMissingNode const& e)
+        {
+            JLOG (m_journal.warning) << "Account index rebuild failed: " << e;
+            m_accountIndex.clear ();
+            return false;
+        }
+        m_indexLedger = ledger;
+
+        JLOG (m_journal.info) << "Account index rebuilt at ledger " << ledger->info ().seq
+                              << " with " << m_accountIndex.size () << " accounts. Mem " << memUsed ();
+        return true;
+    }
+
+    void updateAccountIndex (Ledger::pointer const& ledger) override
+    {
+        std::lock_guard<std::mutex> lock (m_indexMutex);
+        // The index may have been moved to an older ledger by calcDividend,
+        // do not chase ledgers from the past here.
+        if (m_indexLedger && m_indexLedger->info ().seq >= ledger->info ().seq)
+            return;
+        syncAccountIndex (ledger);
+    }
+
+    /// Fetch the root of a stored dividend transaction map.
+    /// @return null if the map is not complete in the node store.
+    std::shared_ptr<SHAMap> fetchDividendMap (SHAMapHash const& hash)
+    {
+        auto map = std::make_shared<SHAMap> (
+            SHAMapType::TRANSACTION, hash.as_uint256 (), app_.family ());
+        if (!map->fetchRoot (hash, nullptr))
+            return {};
+
+        std::vector<SHAMapNodeID> nodeIDs;
+        std::vector<uint256> nodeHashes;
+        map->getMissingNodes (nodeIDs, nodeHashes, 1, nullptr);
+        if (!nodeIDs.empty ())
+            return {};
+        return map;
+    }
+
+    /// Make #m_progress track the dividend @p map of @p dividendLedger.
+    /// While an account index is kept, progress is read from the indexed
+    /// ledger once and then advanced by each index update. Without one it
+    /// is read from the validated ledger on every call.
+    /// @note #m_progressMutex must be held.
+    /// @return false if ledger state could not be read.
+    bool loadProgress (uint32_t dividendLedger, SHAMap const& map)
+    {
+        auto const hash = map.getHash ();
+        if (m_indexLedger && m_progress.dividendLedger == dividendLedger && m_progress.mapHash == hash)
+            return true;
+
+        // Index updates mark progress from m_indexLedger on, so read the
+        // same ledger or marks in between would be missed.
+        auto const ledger = m_indexLedger ? m_indexLedger
+                                          : app_.getLedgerMaster ().getValidatedLedger ();
+        if (!ledger)
+            return false;
+
+        DividendProgress progress;
+        progress.mapHash = hash;
+        progress.dividendLedger = dividendLedger;
+        try
+        {
+            for (auto const& item : map)
+            {
+                auto sitTrans = SerialIter{item.data (), item.size ()};
+                STTx const stTrans (std::ref (sitTrans));
+                auto const account = stTrans.getAccountID (sfDestination);
+
+                auto const sle = ledger->read (keylet::account (account));
+                bool const applied = sle && sle->isFieldPresent (sfDividendLedger) &&
+                    sle->getFieldU32 (sfDividendLedger) == dividendLedger;
+
+                progress.position.emplace (account, static_cast<std::uint32_t> (progress.keys.size ()));
+                progress.keys.push_back (item.key ());
+                progress.applied.push_back (applied);
+                if (applied)
+                    ++progress.done;
             }
-            else
+        }
+        catch (SHAMapMissingNode const& e)
+        {
+            JLOG (m_journal.warning) << "Dividend progress rebuild failed: " << e;
+            return false;
+        }
+        m_progress = std::move (progress);
+
+        JLOG (m_journal.info) << "Dividend progress rebuilt at ledger " << ledger->info ().seq
+                              << ", " << m_progress.done << " done, " << m_progress.left () << " left.";
+        return true;
+    }
+
+    /// Fill #m_accounts from #m_accountIndex.
+    /// @note #m_indexMutex must be held.
+    void prepareAccounts ()
+    {
+        auto& table = m_accounts;
+        table.clear ();
+        table.reserve (m_accountIndex.size ());
+
+        for (auto& it : m_accountIndex)
+            it.second.vertex = AccountTable::noVertex;
+
+        // Referees without AccountRoot, they hold nothing.
+        hash_map<AccountID, std::uint32_t> missingReferees;
+
+        /// Get or push the vertex of an account.
+        auto getVertex = [&](AccountID const& account)
+        {
+            auto found = m_accountIndex.find (account);
+            if (found != m_accountIndex.end ())
             {
-                // Qualified.
-                bool result;
-                std::tie (iter, result) = pushAccount (std::make_shared<AccountData> (account, vbc));
-                if (!result)
+                auto& entry = found->second;
+                if (entry.vertex == AccountTable::noVertex)
+                    entry.vertex = table.add (account, entry.vbc);
+                return entry.vertex;
+            }
+            auto result = missingReferees.emplace (account, AccountTable::noVertex);
+            if (result.second)
+                result.first->second = table.add (account, 0);
+            return result.first->second;
+        };
+
+        std::size_t unqualified = 0;
+        for (auto const& it : m_accountIndex)
+        {
+            auto const& entry = it.second;
+            bool noParent = !entry.referee;
+
+            if (noParent)
+            {
+                JLOG (m_journal.info) << "Root account " << it.first;
+
+                // Under minimal VBC requirement and no reference, only
+                // counted if it turns out to be a referee.
+                if (entry.vbc < SYSTEM_CURRENCY_PARTS_VBC)
                 {
-                    // this should not happen.
-                    JLOG (m_journal.fatal) << "Can not get AccountData for " << account;
+                    ++unqualified;
+                    continue;
                 }
             }
 
-            if (vbc >= SYSTEM_CURRENCY_PARTS_VBC)
+            auto const vertex = getVertex (it.first);
+
+            if (entry.vbc >= SYSTEM_CURRENCY_PARTS_VBC)
             {
-                // Qualified for vRank calc, add to accountsByBalance.
-                accountsByBalance.emplace (vbc, iter->second);
+                // Qualified for vRank calc.
+                table.byBalance.emplace_back (entry.vbc, vertex);
             }
 
-            // Add an edge [referee->reference] in graph.
+            // Link [referee->reference].
             if (!noParent)
             {
-                auto iterParent = accounts.find (accountParent);
-                if (iterParent == accounts.end ())
-                {
-                    // Not in accounts yet, try move from accountsUnqualified or construct an later-init one.
-                    std::shared_ptr<AccountData> accountData;
-                    auto iterUnqualified = accountsUnqualified.find (accountParent);
-                    if (iterUnqualified != accountsUnqualified.end ())
-                    {
-                        accountData = iterUnqualified->second;
-                        accountsUnqualified.erase (iterUnqualified);
-                    }
-                    else
-                    {
-                        accountData.reset (new AccountData (accountParent, 0));
-                    }
-
-                    std::tie (iterParent, std::ignore) = pushAccount (accountData);
-                    if (iterParent == accounts.end ())
-                    {
-                        // this should not happen.
-                        JLOG (m_journal.fatal) << "Can not get AccountData for " << sle->getAccountID (sfAccount);
-                    }
-                }
-                auto& parentPtr = iterParent->second;
-                add_edge (parentPtr->vertex, iter->second->vertex, accountsGraph);
-                iter->second->parent = parentPtr->vertex;
+                table.parent[vertex] = getVertex (entry.referee);
+                ++table.edges;
             }
-        };
-
-        ledger->visitStateItems (accountVisitor);
+        }
 
-        JLOG (m_journal.info) << accountsUnqualified.size () << " unqualified accounts found. Mem " << memUsed ();
+        JLOG (m_journal.info) << unqualified << " unqualified accounts found, "
+                              << missingReferees.size () << " referees without root. Mem " << memUsed ();
     }
 
     bool calcDividend (const uint32_t ledgerIndex) override
@@ -253,10 +400,15 @@ public:
         if (m_journal.info)
             m_journal.info << "Expected dividend: " << dividendCoins << " " << dividendCoinsVBC << " for ledger " << ledgerSeq << ". Mem " << memUsed ();
 
-        prepareAccounts (ledger);
+        {
+            std::lock_guard<std::mutex> lock (m_indexMutex);
+            if (!syncAccountIndex (ledger))
+                return false;
+            prepareAccounts ();
+        }
 
         if (m_journal.info)
-            m_journal.info << m_accountsByBalance.size () << " accounts found for ranking, " << m_accounts.size () << " accounts for sprd. Mem " << memUsed ();
+            m_journal.info << m_accounts.byBalance.size () << " accounts found for ranking, " << m_accounts.size () << " accounts for sprd. Mem " << memUsed ();
 
         ledger.reset ();
 
@@ -270,6 +422,9 @@ public:
                       actualTotalDividend, actualTotalDividendVBC,
                       sumVRank, sumVSpd);
 
+        // Only the result is needed from here.
+        m_accounts.clear ();
+
         return true;
     }
     std::pair<bool, Json::Value> checkDividend (const uint32_t ledgerIndex, const std::string hash) override;
@@ -287,61 +442,130 @@ private:
 
     AccountsDividend m_divResult;
     SHAMapHash m_resultHash;
+
+    /// Dividend transactions applied to the open ledger per job.
+    static int const defaultBatchSize = 4096;
+
+    /// Signed dividend transactions the open ledger did not take, by
+    /// unsigned transaction key, so retries do not sign again. Holds at
+    /// most two batches.
+    hash_map<uint256, std::shared_ptr<STTx const>> m_signed;
+    uint32_t m_signedLedger = 0;
+
+    /// Unsaved transaction map of the last hash only dump.
+    std::shared_ptr<SHAMap> m_divMap;
+    uint32_t m_divMapLedger = 0;
     uint64_t m_dividendTotalCoins;
     uint64_t m_dividendTotalCoinsVBC;
     uint64_t m_dividendVRank;
     uint64_t m_dividendVSprd;
     int m_dividendState = DivType_Start;
     
-    class AccountData
+    /// Flat account table for the vRank/vSprd computation. Vertex i of the
+    /// referral forest is element i of each array.
+    struct AccountTable
     {
-    public:
-        typedef std::shared_ptr<AccountData> Pointer;
-        struct Property
+        static std::uint32_t const noVertex = std::numeric_limits<std::uint32_t>::max ();
+
+        std::vector<AccountID> account;
+        std::vector<uint64_t> vbc;
+        std::vector<std::uint32_t> parent;
+
+        /// Filled by calcDividend.
+        std::vector<std::uint32_t> vRank;
+        std::vector<uint64_t> vSprd, tSprd, maxChildHolding;
+
+        /// Accounts to calculate vRank, as [balance, vertex].
+        std::vector<std::pair<uint64_t, std::uint32_t>> byBalance;
+
+        std::size_t edges = 0;
+
+        std::size_t size () const
         {
-            Pointer data;
-        };
-        typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::directedS, Property> Graph;
-        typedef boost::graph_traits<Graph>::vertex_descriptor Vertex;
+            return account.size ();
+        }
+
+        void reserve (std::size_t n)
+        {
+            account.reserve (n);
+            vbc.reserve (n);
+            parent.reserve (n);
+        }
+
+        std::uint32_t add (AccountID const& id, uint64_t balance)
+        {
+            account.push_back (id);
+            vbc.push_back (balance);
+            parent.push_back (noVertex);
+            return static_cast<std::uint32_t> (account.size () - 1);
+        }
 
-        AccountData (const AccountID& accountId, uint64_t balanceVBC)
-            : account (accountId), vbc (balanceVBC) {}
-        AccountID account;
+        /// Drop all entries and release memory.
+        void clear ()
+        {
+            *this = AccountTable ();
+        }
+    };
+
+    /// Accounts with enough VBC or references.
+    AccountTable m_accounts;
+
+    struct AccountIndexEntry
+    {
         uint64_t vbc = 0;
-        uint64_t vRank = 0, vSprd = 0, tSprd = 0;
-        uint64_t maxChildHolding = 0;
-        Vertex vertex = boost::graph_traits<Graph>::null_vertex ();
-        Vertex parent = boost::graph_traits<Graph>::null_vertex ();
+        AccountID referee;
+        /// Vertex in #m_accounts, only valid while preparing it.
+        std::uint32_t vertex = AccountTable::noVertex;
     };
 
-    class Visitor : public boost::default_dfs_visitor
+    /// Applied state of each transaction of the active dividend map, by
+    /// position of the transaction in map order.
+    struct DividendProgress
     {
-    public:
-        typedef std::function<void(AccountData::Vertex, const AccountData::Graph&)> VertexFunc;
+        SHAMapHash mapHash;
+        uint32_t dividendLedger = 0;
 
-        Visitor (VertexFunc finish_vertex)
-            : m_finish_vertex (finish_vertex)
+        std::vector<uint256> keys;
+        std::vector<bool> applied;
+        hash_map<AccountID, std::uint32_t> position;
+        std::size_t done = 0;
+
+        /// Position the submitter resumes from.
+        std::size_t cursor = 0;
+
+        std::size_t left () const
         {
+            return keys.size () - done;
         }
 
-        template <typename Vertex, typename Graph>
-        void finish_vertex (Vertex vertex, const Graph& accountsGraph)
+        void markApplied (AccountID const& account)
         {
-            m_finish_vertex (vertex, accountsGraph);
+            auto const it = position.find (account);
+            if (it != position.end () && !applied[it->second])
+            {
+                applied[it->second] = true;
+                ++done;
+            }
         }
-
-    private:
-        VertexFunc m_finish_vertex;
     };
 
-    /// Reference Graph
-    AccountData::Graph m_accountsGraph;
+    /// Lock order is #m_indexMutex, then #m_progressMutex.
+    std::mutex m_progressMutex;
 
-    /// Accounts with enough VBC or references.
-    std::unordered_map<AccountID, std::shared_ptr<AccountData>> m_accounts;
+    /// Follows the account index through validated ledgers.
+    DividendProgress m_progress;
+
+    /// Max state differences applied to the index before a full rebuild.
+    static int const maxIndexDelta = 262144;
 
-    /// Accounts to calculate vRank. Sorted by balance.
-    std::multimap<uint64_t, std::shared_ptr<AccountData>> m_accountsByBalance;
+    std::mutex m_indexMutex;
+
+    /// Ledger #m_accountIndex reflects. Set with both mutexes held, so
+    /// either one is enough to read it.
+    Ledger::pointer m_indexLedger;
+
+    /// VBC balance and referee of every AccountRoot in #m_indexLedger.
+    hash_map<AccountID, AccountIndexEntry> m_accountIndex;
 };
 
 void DividendMasterImpl::getMissingTxns ()
@@ -357,93 +581,140 @@ void DividendMasterImpl::getMissingTxns ()
     if (!dividendObj)
         return;
 
-    SHAMapHash fullHash (dividendObj->getFieldH256 (sfDividendHash));
+    if (getDividendState () != DividendMaster::DivType_Start)
+        return;
 
-    std::shared_ptr<SHAMap> fullDivMap = std::make_shared<SHAMap> (
-        SHAMapType::TRANSACTION,
-        fullHash.as_uint256(),
-        app_.family ());
-    std::vector<SHAMapNodeID> nodeIDs;
-    std::vector<uint256> nodeHashes;
-    nodeIDs.reserve (1);
-    nodeHashes.reserve (1);
-    if (fullDivMap->fetchRoot (fullHash, nullptr))
-    {
-        fullDivMap->getMissingNodes(nodeIDs, nodeHashes, 1, nullptr);
-        if (!nodeIDs.empty())
-        {
-            journal.fatal << "Dividend job, full dividend map is empty.";
-            return;
-        }
-    }
-    else
+    auto const startTime = std::chrono::steady_clock::now ();
+
+    SHAMapHash fullHash (dividendObj->getFieldH256 (sfDividendHash));
+    auto const fullDivMap = fetchDividendMap (fullHash);
+    if (!fullDivMap)
     {
-        journal.fatal << "Dividend job, fetch full root hash failed.";
+        journal.fatal << "Dividend job, fetch full dividend map failed.";
         return;
     }
-    
-//    SHAMap const& transMap = curLedger->txMap ();
+
     std::string secret_key = get<std::string> (app_.config ()[SECTION_DIVIDEND_ACCOUNT], "secret_key");
     RippleAddress secret = RippleAddress::createSeedGeneric (secret_key);
     RippleAddress generator = RippleAddress::createGeneratorPublic (secret);
     RippleAddress naAccountPrivate = RippleAddress::createAccountPrivate (generator, secret, 0);
     
     uint32_t dividendLedger = dividendObj->getFieldU32 (sfDividendLedger);
-    uint256 prevTxnID = dividendObj->getFieldH256 (sfDividendMarker);
-    auto txnIter = fullDivMap->upper_bound (prevTxnID);
-    if (txnIter != fullDivMap->end ())
-        txnIter++;
 
-    uint256 lastTxn = prevTxnID;
-    int shots = 256;
-    int passes = 1;
+    std::size_t const batchSize = std::max (1, get<int> (
+        app_.config ()[SECTION_DIVIDEND_ACCOUNT], "batch_size", defaultBatchSize));
 
-    JLOG(journal.info) << "Dividend job, begin submit, dividend state " << getDividendState();
-    while (shots > 0 && getDividendState() == DividendMaster::DivType_Start)
+    if (m_signedLedger != dividendLedger)
     {
-        if (txnIter == fullDivMap->end ())
+        m_signed.clear ();
+        m_signedLedger = dividendLedger;
+    }
+
+    // Take the next unapplied transactions from the progress bitmap,
+    // resuming after the previous batch and wrapping around once.
+    std::vector<uint256> candidates;
+    {
+        std::lock_guard<std::mutex> lock (m_progressMutex);
+        if (!loadProgress (dividendLedger, *fullDivMap))
+            return;
+
+        auto& progress = m_progress;
+        if (progress.left () == 0)
         {
-            txnIter = fullDivMap->begin ();
+            m_signed.clear ();
+            setDividendState (DividendMaster::DivType_Done);
+            JLOG(journal.info) << "Dividend job, all " << progress.done << " transactions applied";
+            return;
         }
-        auto const& item = *txnIter;
-        txnIter++;
 
-        JLOG(journal.trace) << "Dividend job, prev transaction " << prevTxnID;
-        JLOG(journal.trace) << "Dividend job, this transaction " << item.key ();
-        prevTxnID = item.key ();
-        
-        auto sitTrans = SerialIter{item.data (), item.size ()};
-        std::shared_ptr<STTx> stpTrans = std::make_shared<STTx> (std::ref (sitTrans));
-        
-        auto accountSLE = curLedger->read (keylet::account (stpTrans->getAccountID (sfDestination)));
-        if (accountSLE->getFieldU32 (sfDividendLedger) == dividendLedger)
+        auto const count = progress.keys.size ();
+        auto pos = progress.cursor % count;
+        for (std::size_t n = 0; n < count && candidates.size () < batchSize; ++n)
         {
-            if (lastTxn == item.key ())
-            {
-                setDividendState(DividendMaster::DivType_Done);
-                JLOG(journal.debug) << "Dividend job, finish last txn " << lastTxn;
-                break;
-            }
-            JLOG(journal.trace) << "Dividend job, account: "<< stpTrans->getAccountID (sfDestination) << " dividend ledger: " << accountSLE->getFieldU32 (sfDividendLedger);
-            JLOG(journal.trace) << "Dividend job, "<< passes << " pass applied transaction " << item.key ();
-            passes++;
-            continue;
+            if (!progress.applied[pos])
+                candidates.push_back (progress.keys[pos]);
+            pos = (pos + 1) % count;
         }
-        try
+        progress.cursor = pos;
+    }
+
+    // The bitmap follows validated ledgers, skip what the open ledger has.
+    std::vector<std::shared_ptr<SHAMapItem const>> pending;
+    pending.reserve (candidates.size ());
+    std::size_t skipped = 0;
+
+    JLOG(journal.info) << "Dividend job, begin batch, dividend state " << getDividendState();
+    for (auto const& key : candidates)
+    {
+        auto const& item = fullDivMap->peekItem (key);
+        if (!item)
+            continue;
+
+        auto sitTrans = SerialIter{item->data (), item->size ()};
+        STTx const stTrans (std::ref (sitTrans));
+
+        auto accountSLE = curLedger->read (keylet::account (stTrans.getAccountID (sfDestination)));
+        if (accountSLE && accountSLE->getFieldU32 (sfDividendLedger) == dividendLedger)
         {
-            shots--;
-            lastTxn = item.key ();
-            stpTrans->sign(naAccountPrivate);
-            JLOG(journal.debug) << "Dividend job, submit tx " << lastTxn << " with signed tx id " << stpTrans->getTransactionID();
-            app_.getOPs ().submitTransaction (stpTrans);
+            m_signed.erase (key);
+            ++skipped;
+            continue;
+        }
+        pending.push_back (item);
+    }
 
+    if (pending.empty ())
+        return;
+
+    // Sign what has not been signed by an earlier batch.
+    std::vector<std::shared_ptr<STTx const>> txns (pending.size ());
+    std::vector<std::size_t> toSign;
+    for (std::size_t i = 0; i < pending.size (); ++i)
+    {
+        auto const iter = m_signed.find (pending[i]->key ());
+        if (iter != m_signed.end ())
+            txns[i] = iter->second;
+        else
+            toSign.push_back (i);
+    }
+
+    parallel_for (toSign.size (), parallelThreads (),
+        [&] (std::size_t j)
+        {
+            auto const& item = *pending[toSign[j]];
+            auto sitTrans = SerialIter{item.data (), item.size ()};
+            auto stpTrans = std::make_shared<STTx> (std::ref (sitTrans));
+            stpTrans->sign (naAccountPrivate);
+            txns[toSign[j]] = std::move (stpTrans);
+        });
+
+    // Every transaction is still signed once: peers check the signature
+    // of relayed transactions, only the local apply skips it.
+    auto const result = app_.getOPs ().applyLocalBatch (txns);
+
+    std::size_t applied = 0;
+    if (m_signed.size () + toSign.size () > 2 * batchSize)
+        m_signed.clear ();
+    for (std::size_t i = 0; i < pending.size (); ++i)
+    {
+        if (result[i])
+        {
+            ++applied;
+            m_signed.erase (pending[i]->key ());
         }
-        catch (std::runtime_error& e)
+        else
         {
-            JLOG(journal.debug) << "Duplicate transaction applied" << e.what ();
+            m_signed.emplace (pending[i]->key (), txns[i]);
         }
     }
-    JLOG(journal.info) << "Dividend job, ends submit, passes " << passes << ", dividend state " << getDividendState();
+
+    auto const elapsed = std::chrono::duration_cast<std::chrono::milliseconds> (
+        std::chrono::steady_clock::now () - startTime).count ();
+    JLOG(journal.info) << "Dividend job, ledger " << curLedger->info ().seq
+        << ": " << applied << "/" << txns.size () << " applied, "
+        << toSign.size () << " signed, " << skipped << " skipped in "
+        << elapsed << "ms (" << (applied * 1000 / std::max<std::int64_t> (elapsed, 1))
+        << " tx/s), dividend state " << getDividendState ();
 }
 
 static inline uint64_t adjust (uint64_t coin)
@@ -451,14 +722,106 @@ static inline uint64_t adjust (uint64_t coin)
     return coin >= 10000000000 ? coin + 90000000000 : coin * 10;
 }
 
+/// Stable LSD radix sort of [balance, vertex] pairs by balance.
+static void radixSortByBalance (std::vector<std::pair<uint64_t, std::uint32_t>>& items)
+{
+    if (items.size () < 2)
+        return;
+
+    int const digitBits = 16;
+    std::uint64_t const digitMask = (1 << digitBits) - 1;
+
+    std::vector<std::pair<uint64_t, std::uint32_t>> buffer (items.size ());
+    std::vector<std::size_t> offsets (std::size_t (1) << digitBits);
+    for (int shift = 0; shift < 64; shift += digitBits)
+    {
+        std::fill (offsets.begin (), offsets.end (), 0);
+        for (auto const& item : items)
+            ++offsets[(item.first >> shift) & digitMask];
+
+        // Every key has the same digit, nothing to move.
+        if (offsets[(items.front ().first >> shift) & digitMask] == items.size ())
+            continue;
+
+        std::size_t sum = 0;
+        for (auto& offset : offsets)
+        {
+            auto const count = offset;
+            offset = sum;
+            sum += count;
+        }
+        for (auto const& item : items)
+            buffer[offsets[(item.first >> shift) & digitMask]++] = item;
+        items.swap (buffer);
+    }
+}
+
+/// Call @p finish on each vertex of a forest given by parent indices after
+/// all of its children, visiting vertices in the same order as a depth first
+/// search started from each unvisited vertex in turn.
+template <class Finish>
+static void visitPostOrder (std::vector<std::uint32_t> const& parent, std::uint32_t noVertex, Finish&& finish)
+{
+    auto const n = parent.size ();
+
+    // Children of v are children[childBegin[v]] to children[childBegin[v + 1]].
+    std::vector<std::uint32_t> childBegin (n + 1, 0);
+    for (auto const p : parent)
+    {
+        if (p != noVertex)
+            ++childBegin[p + 1];
+    }
+    std::partial_sum (childBegin.begin (), childBegin.end (), childBegin.begin ());
+
+    std::vector<std::uint32_t> children (childBegin[n]);
+    {
+        std::vector<std::uint32_t> next (childBegin.begin (), childBegin.end () - 1);
+        for (std::uint32_t v = 0; v < n; ++v)
+        {
+            if (parent[v] != noVertex)
+                children[next[parent[v]]++] = v;
+        }
+    }
+
+    std::vector<bool> visited (n, false);
+    // [vertex, next child position]
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> stack;
+    for (std::uint32_t root = 0; root < n; ++root)
+    {
+        if (visited[root])
+            continue;
+        visited[root] = true;
+        stack.emplace_back (root, childBegin[root]);
+        while (!stack.empty ())
+        {
+            auto const vertex = stack.back ().first;
+            auto& next = stack.back ().second;
+            if (next < childBegin[vertex + 1])
+            {
+                auto const child = children[next++];
+                if (!visited[child])
+                {
+                    visited[child] = true;
+                    stack.emplace_back (child, childBegin[child]);
+                }
+            }
+            else
+            {
+                finish (vertex);
+                stack.pop_back ();
+            }
+        }
+    }
+}
+
 void DividendMasterImpl::calcDividend (uint64_t dividendCoins, uint64_t dividendCoinsVBC, uint64_t& actualTotalDividend, uint64_t& actualTotalDividendVBC, uint64_t& sumVRank, uint64_t& sumVSpd)
 {
     auto& accountsOut = m_divResult;
     accountsOut.clear ();
-    const auto& accountsByBalance = m_accountsByBalance;
-    const auto& accountsGraph = m_accountsGraph;
+    auto& table = m_accounts;
+    auto const noVertex = AccountTable::noVertex;
 
-    if (accountsByBalance.empty () && num_edges (accountsGraph) == 0)
+    if (table.byBalance.empty () && table.edges == 0)
     {
         actualTotalDividend = 0;
         actualTotalDividendVBC = 0;
@@ -467,81 +830,93 @@ void DividendMasterImpl::calcDividend (uint64_t dividendCoins, uint64_t dividend
         return;
     }
 
-    // traverse accountsByBalance to caculate V ranking into VRank in accountsByReference
+    // traverse accounts sorted by balance to caculate V ranking into vRank
     sumVRank = 0;
+    table.vRank.assign (table.size (), 0);
     {
+        radixSortByBalance (table.byBalance);
+
         uint64_t lastBalance = 0;
         uint32_t pos = 1, rank = 1;
-        for (auto it = accountsByBalance.begin (); it != accountsByBalance.end (); ++pos, ++it)
+        for (auto it = table.byBalance.begin (); it != table.byBalance.end (); ++pos, ++it)
         {
             if (lastBalance < it->first)
             {
                 rank = pos;
                 lastBalance = it->first;
             }
-            it->second->vRank = rank;
+            table.vRank[it->second] = rank;
             sumVRank += rank;
         }
         m_dividendVRank = sumVRank;
+
+        decltype (table.byBalance) ().swap (table.byBalance);
     }
     JLOG (m_journal.info) << "calcDividend got v rank total: " << sumVRank << " Mem " << memUsed ();
 
 
-    // traverse accountsTree to caculate V spreading into VSpd
+    // traverse referral forest to caculate V spreading into vSprd
     sumVSpd = 0;
+    table.vSprd.assign (table.size (), 0);
+    table.tSprd.assign (table.size (), 0);
+    table.maxChildHolding.assign (table.size (), 0);
     {
-        Visitor::VertexFunc finishVertex = [&](AccountData::Vertex vertex, const AccountData::Graph& accountsGraph)
+        auto finishVertex = [&](std::uint32_t vertex)
         {
-            auto& accountData = *accountsGraph[vertex].data;
+            auto& vSprd = table.vSprd[vertex];
+            auto const vbc = table.vbc[vertex];
 
-            if (accountData.vSprd != 0)
+            if (vSprd != 0)
             {
                 // Qualified for vSprd calc
-                if (accountData.vbc >= SYSTEM_CURRENCY_PARTS_VBC)
+                if (vbc >= SYSTEM_CURRENCY_PARTS_VBC)
                 {
-                    accountData.vSprd = accountData.vSprd - adjust (accountData.maxChildHolding) + static_cast<uint64_t> (pow (accountData.maxChildHolding / SYSTEM_CURRENCY_PARTS_VBC, 1.0 / 3) * SYSTEM_CURRENCY_PARTS_VBC);
-                    sumVSpd += accountData.vSprd;
+                    auto const maxChildHolding = table.maxChildHolding[vertex];
+                    vSprd = vSprd - adjust (maxChildHolding) + static_cast<uint64_t> (pow (maxChildHolding / SYSTEM_CURRENCY_PARTS_VBC, 1.0 / 3) * SYSTEM_CURRENCY_PARTS_VBC);
+                    sumVSpd += vSprd;
                 }
             }
 
-            auto& t = accountData.tSprd;
+            auto& t = table.tSprd[vertex];
 
-            t += accountData.vbc;
+            t += vbc;
 
-            if (accountData.parent == boost::graph_traits<AccountData::Graph>::null_vertex ())
+            auto const parent = table.parent[vertex];
+            if (parent == noVertex)
                 return;
 
-            auto& parentData = *accountsGraph[accountData.parent].data;
-
-            parentData.tSprd += t;
-            if (parentData.vbc >= SYSTEM_CURRENCY_PARTS_VBC)
+            table.tSprd[parent] += t;
+            if (table.vbc[parent] >= SYSTEM_CURRENCY_PARTS_VBC)
             {
-                parentData.vSprd += adjust (t);
+                table.vSprd[parent] += adjust (t);
 
-                if (parentData.maxChildHolding < t)
-                    parentData.maxChildHolding = t;
+                if (table.maxChildHolding[parent] < t)
+                    table.maxChildHolding[parent] = t;
             }
         };
-        boost::depth_first_search (accountsGraph, boost::visitor (Visitor (finishVertex)));
+        visitPostOrder (table.parent, noVertex, finishVertex);
         m_dividendVSprd = sumVSpd;
     }
     JLOG (m_journal.info) << "calcDividend got v spread total: " << sumVSpd << " Mem " << memUsed ();
 
-    // traverse accountsByReference to calc dividend
-    //accountsOut.reserve(m_accounts.size()+1);
+    // traverse accounts to calc dividend
     actualTotalDividend = 0; actualTotalDividendVBC = 0;
     uint64_t totalDivVBCbyRank = dividendCoinsVBC / 2;
     uint64_t totalDivVBCbyPower = dividendCoinsVBC - totalDivVBCbyRank;
-    for (const auto& it : m_accounts) {
+    for (std::uint32_t vertex = 0; vertex < table.size (); ++vertex) {
+        auto const& account = table.account[vertex];
+        auto const vbc = table.vbc[vertex];
+        auto const vRank = table.vRank[vertex];
+        auto const vSprd = table.vSprd[vertex];
+        auto const tSprd = table.tSprd[vertex];
         uint64_t divVBC = 0;
-        auto accountPtr = it.second;
         boost::multiprecision::uint128_t divVBCbyRank(0), divVBCbyPower(0);
         if (dividendCoinsVBC > 0 && sumVSpd > 0 && sumVRank > 0) {
             divVBCbyRank = totalDivVBCbyRank;
-            divVBCbyRank *= accountPtr->vRank;
+            divVBCbyRank *= vRank;
             divVBCbyRank /= sumVRank;
             divVBCbyPower = totalDivVBCbyPower;
-            divVBCbyPower *= accountPtr->vSprd;
+            divVBCbyPower *= vSprd;
             divVBCbyPower /= sumVSpd;
             divVBC = static_cast<uint64_t>(divVBCbyRank + divVBCbyPower);
             if (divVBC < VBC_DIVIDEND_MIN) {
@@ -553,25 +928,16 @@ void DividendMasterImpl::calcDividend (uint64_t dividendCoins, uint64_t dividend
         }
         uint64_t div = 0;
         if (dividendCoins > 0 && (dividendCoinsVBC == 0 || divVBC >= VBC_DIVIDEND_MIN)) {
-            div = accountPtr->vbc * VRP_INCREASE_RATE / VRP_INCREASE_RATE_PARTS;
+            div = vbc * VRP_INCREASE_RATE / VRP_INCREASE_RATE_PARTS;
             actualTotalDividend += div;
         }
         
-        JLOG (m_journal.info) << "{\"account\":\"" << accountPtr->account << "\",\"data\":{\"divVBCByRank\":\"" << divVBCbyRank << "\",\"divVBCByPower\":\"" << divVBCbyPower << "\",\"divVBC\":\"" << divVBC << "\",\"divVRP\":\"" << div << "\",\"balance\":\"" << accountPtr->vbc << "\",\"vrank\":\"" << accountPtr->vRank << "\",\"vsprd\":\"" << accountPtr->vSprd << "\",\"tsprd\":\"" << accountPtr->tSprd << "\"}}";
+        JLOG (m_journal.info) << "{\"account\":\"" << account << "\",\"data\":{\"divVBCByRank\":\"" << divVBCbyRank << "\",\"divVBCByPower\":\"" << divVBCbyPower << "\",\"divVBC\":\"" << divVBC << "\",\"divVRP\":\"" << div << "\",\"balance\":\"" << vbc << "\",\"vrank\":\"" << vRank << "\",\"vsprd\":\"" << vSprd << "\",\"tsprd\":\"" << tSprd << "\"}}";
         
-        if (div !=0 || divVBC !=0 || accountPtr->vSprd > MIN_VSPD_TO_GET_FEE_SHARE)
-        {
-            //accountsOut.push_back(std::make_tuple(accountPtr->account, div, divVBC, static_cast<uint64_t>(divVBCbyRank), static_cast<uint64_t>(divVBCbyPower), accountPtr->vRank, accountPtr->vSprd, accountPtr->tSprd));
-            
-            std::pair<AccountsDividend::iterator, bool> ret = accountsOut.emplace(std::piecewise_construct, 
-                        std::forward_as_tuple(accountPtr->account), 
-                        std::forward_as_tuple(div, divVBC, static_cast<uint64_t>(divVBCbyRank), 
-                            static_cast<uint64_t>(divVBCbyPower), accountPtr->vRank, 
-                            accountPtr->vSprd, accountPtr->tSprd));
-            if (ret.second == false)
-            {
-                JLOG (m_journal.warning) << "Insert same account: " << accountPtr->account << "into dividend account map!";
-            }
+        if (div !=0 || divVBC !=0 || vSprd > MIN_VSPD_TO_GET_FEE_SHARE)
+        {
+            accountsOut.push_back ({account, div, divVBC, static_cast<uint64_t> (divVBCbyRank),
+                                    static_cast<uint64_t> (divVBCbyPower), vRank, vSprd, tSprd});
         }
     }
     
@@ -589,18 +955,17 @@ void DividendMasterImpl::calcDividend (uint64_t dividendCoins, uint64_t dividend
     }
     if (remainCoins > 0 || remainCoinsVBC > 0)
     {
-        //accountsOut.push_back (std::make_tuple (from_hex_text<AccountID> ("0x56CE5173B6A2CBEDF203BD69159212094C651041"), remainCoins, remainCoinsVBC, 0, 0, 0, 0, 0));
-        AccountsDividend::iterator spec = accountsOut.find (from_hex_text<AccountID> ("0x56CE5173B6A2CBEDF203BD69159212094C651041"));
+        auto const remainAccount = from_hex_text<AccountID> ("0x56CE5173B6A2CBEDF203BD69159212094C651041");
+        auto spec = std::find_if (accountsOut.begin (), accountsOut.end (),
+            [&remainAccount](AccountDividend const& div) { return div.account == remainAccount; });
         if (spec != accountsOut.end())
         {
-            std::get<0> (spec->second) += remainCoins;
-            std::get<1> (spec->second) += remainCoinsVBC;
+            spec->divCoins += remainCoins;
+            spec->divCoinsVBC += remainCoinsVBC;
         }
         else
         {
-            accountsOut.emplace(std::piecewise_construct, 
-                std::forward_as_tuple(from_hex_text<AccountID> ("0x56CE5173B6A2CBEDF203BD69159212094C651041")), 
-                std::forward_as_tuple(remainCoins, remainCoinsVBC, 0, 0, 0, 0, 0));
+            accountsOut.push_back ({remainAccount, remainCoins, remainCoinsVBC, 0, 0, 0, 0, 0});
         }
     }
 
@@ -612,51 +977,27 @@ DividendMasterImpl::checkDividend (const uint32_t ledgerIndex, const std::string
 {
     Json::Value jvResult;
     SHAMapHash fullHash (from_hex_text<uint256>(hash));
-    std::shared_ptr<SHAMap> fullDivMap = std::make_shared<SHAMap> (
-        SHAMapType::TRANSACTION,
-        fullHash.as_uint256(),
-        app_.family ());
-    std::vector<SHAMapNodeID> nodeIDs;
-    std::vector<uint256> nodeHashes;
-    nodeIDs.reserve (1);
-    nodeHashes.reserve (1);
 
-    if (fullDivMap->fetchRoot (fullHash, nullptr))
+    // Only nodes producing dividends keep an account index, progress is
+    // read from the validated ledger on the others.
+    std::lock_guard<std::mutex> lock (m_progressMutex);
+    if (!m_indexLedger || m_progress.dividendLedger != ledgerIndex || m_progress.mapHash != fullHash)
     {
-        fullDivMap->getMissingNodes(nodeIDs, nodeHashes, 1, nullptr);
-        if (!nodeIDs.empty())
+        auto const fullDivMap = fetchDividendMap (fullHash);
+        if (!fullDivMap)
         {
-            jvResult[jss::error_message] = "can not fetch node in dividend full map.";
+            jvResult[jss::error_message] = "can not fetch dividend full map.";
             return std::pair<bool, Json::Value> (false, jvResult);
         }
-    }
-    else
-    {
-        jvResult[jss::error_message] = "can not fetch dividend full map root hash";
-        return std::pair<bool, Json::Value> (false, jvResult);
-    }
-    JLOG(m_journal.info) << "check dividend start";
-    auto ledger = app_.getLedgerMaster ().getCurrentLedger ();
-    uint32 txnDone = 0;
-    uint32 txnLeft = 0;
-    for (auto item = fullDivMap->begin (); item != fullDivMap->end (); ++item)
-    {
-        auto sitTrans = SerialIter{item->data (), item->size ()};
-        std::shared_ptr<STTx> stpTrans = std::make_shared<STTx> (std::ref (sitTrans));
-        auto accountSLE = ledger->read (keylet::account (stpTrans->getAccountID (sfDestination)));
-        if (accountSLE->getFieldU32 (sfDividendLedger) == ledgerIndex)
+        JLOG(m_journal.info) << "check dividend, loading progress";
+        if (!loadProgress (ledgerIndex, *fullDivMap))
         {
-            // dividend is in progress
-            JLOG(m_journal.trace) << "dividend in progress txn " << stpTrans->getTransactionID();
-            txnDone++;
-        }
-        else
-        {
-            txnLeft++;
+            jvResult[jss::error_message] = "can not read dividend progress from ledger.";
+            return std::pair<bool, Json::Value> (false, jvResult);
         }
     }
-    jvResult ["done"] = txnDone;
-    jvResult ["left"] = txnLeft;
+    jvResult ["done"] = static_cast<Json::UInt> (m_progress.done);
+    jvResult ["left"] = static_cast<Json::UInt> (m_progress.left ());
 
     return std::pair<bool, Json::Value> (true, jvResult);
 }
@@ -704,54 +1045,71 @@ bool DividendMasterImpl::dumpTransactionMap(const uint32_t ledgerIndex, const st
     RippleAddress naAccountPrivate = RippleAddress::createAccountPrivate (generator, secret, 0);
     RippleAddress accountPublic = RippleAddress::createAccountPublic (generator, 0);
 
-    std::shared_ptr<SHAMap> divUnsignedMap = std::make_shared<SHAMap> (
-        SHAMapType::TRANSACTION,
-        app_.family ());
+    std::shared_ptr<SHAMap> divUnsignedMap;
 
-    for (auto const& div : m_divResult)
+    // The map built to compute the hash is kept to be saved by the next call.
+    if (doSave && m_divMap && m_divMapLedger == ledgerIndex &&
+        to_string (m_divMap->getHash ()) == hash)
     {
-        // make transaction
-        STTx trans (ttDIVIDEND);
-        trans.setFieldU8 (sfDividendType, DividendMaster::DivType_Apply);
-        trans.setFieldU32 (sfDividendLedger, ledgerIndex);
-        trans.setFieldU32 (sfFlags, tfFullyCanonicalSig);
-        trans.setAccountID (sfAccount, AccountID ());
-        
-        trans.setAccountID (sfDestination, div.first);
-        trans.setFieldU64 (sfDividendCoins, std::get<0> (div.second));
-        trans.setFieldU64 (sfDividendCoinsVBC, std::get<1> (div.second));
-        trans.setFieldU64 (sfDividendCoinsVBCRank, std::get<2> (div.second));
-        trans.setFieldU64 (sfDividendCoinsVBCSprd, std::get<3> (div.second));
-        trans.setFieldU64 (sfDividendVRank, std::get<4> (div.second));
-        trans.setFieldU64 (sfDividendVSprd, std::get<5> (div.second));
-        trans.setFieldU64 (sfDividendTSprd, std::get<6> (div.second));
-        trans.setFieldVL (sfSigningPubKey, accountPublic.getAccountPublic ());
-
-        uint256 txID = trans.getHash(HashPrefix::transactionID);
-        Serializer s;
-        trans.add (s);
-        auto tItem = std::make_shared<SHAMapItem> (txID, s.peekData ());
-
-        if (!divUnsignedMap->addGiveItem (tItem, true, false))
-        {
-            if (m_journal.fatal)
-            {
-                m_journal.fatal << "Add transaction hash " << txID
-                                << " to transaction unsigned map hash failed.";
-            }
-            return false;
-        }
-        else
+        divUnsignedMap = std::move (m_divMap);
+        JLOG(m_journal.info) << "Reuse transaction map built for ledger " << ledgerIndex;
+    }
+    else
+    {
+        m_divMap.reset ();
+
+        // Build, serialize and hash the transactions in parallel.
+        std::vector<std::shared_ptr<SHAMapItem const>> items (m_divResult.size ());
+        auto const signingPubKey = accountPublic.getAccountPublic ();
+        parallel_for (m_divResult.size (), parallelThreads (), [&](std::size_t i)
         {
+            auto const& div = m_divResult[i];
+
+            // make transaction
+            STTx trans (ttDIVIDEND);
+            trans.setFieldU8 (sfDividendType, DividendMaster::DivType_Apply);
+            trans.setFieldU32 (sfDividendLedger, ledgerIndex);
+            trans.setFieldU32 (sfFlags, tfFullyCanonicalSig);
+            trans.setAccountID (sfAccount, AccountID ());
+
+            trans.setAccountID (sfDestination, div.account);
+            trans.setFieldU64 (sfDividendCoins, div.divCoins);
+            trans.setFieldU64 (sfDividendCoinsVBC, div.divCoinsVBC);
+            trans.setFieldU64 (sfDividendCoinsVBCRank, div.divCoinsVBCRank);
+            trans.setFieldU64 (sfDividendCoinsVBCSprd, div.divCoinsVBCSprd);
+            trans.setFieldU64 (sfDividendVRank, div.vRank);
+            trans.setFieldU64 (sfDividendVSprd, div.vSprd);
+            trans.setFieldU64 (sfDividendTSprd, div.tSprd);
+            trans.setFieldVL (sfSigningPubKey, signingPubKey);
+
+            uint256 txID = trans.getHash(HashPrefix::transactionID);
+            Serializer s;
+            trans.add (s);
+            items[i] = std::make_shared<SHAMapItem> (txID, s.peekData ());
+
             if (m_journal.trace)
             {
                 m_journal.trace << "Add transaction hash " << txID
                                 << " to transaction unsigned map hash.";
                 m_journal.trace << trans.STObject::getJson (0);
             }
+        });
+
+        divUnsignedMap = std::make_shared<SHAMap> (
+            SHAMapType::TRANSACTION,
+            app_.family ());
+
+        if (!divUnsignedMap->addGiveItems (std::move (items), true, false, parallelThreads ()))
+        {
+            if (m_journal.fatal)
+            {
+                m_journal.fatal << "Add " << m_divResult.size ()
+                                << " transactions to transaction unsigned map failed.";
+            }
+            return false;
         }
     }
-    
+
     setResultHash (divUnsignedMap->getHash ());
 
     JLOG(m_journal.info) << "Transaction full unsigned map hash is " << getResultHash ();
@@ -768,6 +1126,11 @@ bool DividendMasterImpl::dumpTransactionMap(const uint32_t ledgerIndex, const st
         divUnsignedMap->flushDirty (hotTRANSACTION_NODE, 0);
         setResultHash (divUnsignedMap->getHash ());
     }
+    else
+    {
+        m_divMap = std::move (divUnsignedMap);
+        m_divMapLedger = ledgerIndex;
+    }
     return true;
 }
 
@@ -798,6 +1161,7 @@ public:
     bool launchDividend (const uint32_t ledgerIndex) {return true;}
     int getMarkerAccount(uint32_t ledgerIndex, AccountID& marker) {return 0;}
     void getMissingTxns () {}
+    void updateAccountIndex (Ledger::pointer const& ledger) {}
     bool floodDividend(AccountID dst, uint64_t value, bool bFlood) {return true;}
 };
 
@@ -219,6 +219,8 @@ public:
 
     // Must complete immediately.
     void submitTransaction (std::shared_ptr<STTx const> const&) override;
+    std::vector<bool> applyLocalBatch (
+        std::vector<std::shared_ptr<STTx const>> const& txns) override;
 
     void processTransaction (
         std::shared_ptr<Transaction>& transaction,
@@ -789,6 +791,75 @@ void NetworkOPsImp::submitTransaction (std::shared_ptr<STTx const> const& iTrans
     });
 }
 
+std::vector<bool> NetworkOPsImp::applyLocalBatch (
+    std::vector<std::shared_ptr<STTx const>> const& txns)
+{
+    std::vector<bool> applied (txns.size (), false);
+    if (txns.empty () || isNeedNetworkLedger ())
+        return applied;
+
+    auto lock = beast::make_lock(app_.getMasterMutex());
+    {
+        std::lock_guard <std::recursive_mutex> ledgerLock (
+            m_ledgerMaster.peekMutex());
+
+        app_.openLedger().modify(
+            [&](OpenView& view, beast::Journal j)
+        {
+            bool changed = false;
+            for (std::size_t i = 0; i < txns.size (); ++i)
+            {
+                auto const& tx = txns[i];
+                // One bad transaction must not abort the batch
+                try
+                {
+                    auto const result = ripple::apply (
+                        app_, view, *tx, tapNO_CHECK_SIGN, j);
+                    if (result.second)
+                        changed = applied[i] = true;
+                    else
+                        JLOG(m_journal.trace) << "Batch transaction " <<
+                            tx->getTransactionID() << " not applied: " <<
+                            transToken (result.first);
+                }
+                catch (std::exception const& e)
+                {
+                    JLOG(m_journal.warning) << "Exception applying batch " <<
+                        "transaction " << tx->getTransactionID() << ": " <<
+                        e.what();
+                }
+            }
+            return changed;
+        });
+    }
+
+    // Peers which never saw a transaction vote against it, relay the
+    // applied ones the same way apply() does.
+    for (std::size_t i = 0; i < txns.size (); ++i)
+    {
+        if (!applied[i])
+            continue;
+
+        std::set<Peer::id_t> peers;
+        if (app_.getHashRouter().swapSet (
+                txns[i]->getTransactionID(), peers, SF_RELAYED))
+        {
+            protocol::TMTransaction tx;
+            Serializer s;
+
+            txns[i]->add (s);
+            tx.set_rawtransaction (&s.getData().front(), s.getLength());
+            tx.set_status (protocol::tsCURRENT);
+            tx.set_receivetimestamp (app_.timeKeeper().now().time_since_epoch().count());
+            app_.overlay().foreach (send_if_not (
+                std::make_shared<Message> (tx, protocol::mtTRANSACTION),
+                peer_in_set(peers)));
+        }
+    }
+
+    return applied;
+}
+
 void NetworkOPsImp::processTransaction (std::shared_ptr<Transaction>& transaction,
         bool bUnlimited, bool bLocal, FailHard failType)
 {
@@ -922,6 +993,14 @@ void NetworkOPsImp::apply (std::unique_lock<std::mutex>& batchLock)
             app_.openLedger().modify(
                 [&](OpenView& view, beast::Journal j)
             {
+                {
+                    std::vector<std::shared_ptr<STTx const>> txns;
+                    txns.reserve (transactions.size ());
+                    for (auto const& e : transactions)
+                        txns.push_back (e.transaction->getSTransaction ());
+                    preverifyRingWithdraws (app_, view, txns, j);
+                }
+
                 bool changed = false;
                 for (TransactionStatus& e : transactions)
                 {
@@ -1374,7 +1453,7 @@ void NetworkOPsImp::switchLastClosedLedger (
             app_.getLedgerMaster().getValidatedLedger();
         boost::optional<Rules> rules;
         if (lastVal)
-            rules.emplace(*lastVal);
+            rules.emplace(*lastVal, app_.config().features);
         else
             rules.emplace();
         app_.openLedger().accept(app_, *rules,
@@ -113,6 +113,18 @@ public:
     // must complete immediately
     virtual void submitTransaction (std::shared_ptr<STTx const> const&) = 0;
 
+    /**
+     * Apply a batch of locally built transactions directly to the open
+     * ledger. The transactions skip the signature check and the transaction
+     * queue. Applied ones are relayed like any other transaction, so peers
+     * have them when they vote on our proposed set.
+     *
+     * @param txns Transactions to apply, in order.
+     * @return For each transaction, whether it was applied.
+     */
+    virtual std::vector<bool> applyLocalBatch (
+        std::vector<std::shared_ptr<STTx const>> const& txns) = 0;
+
     /**
      * Process transactions as they arrive from the network or which are
      * submitted by clients. Process local transactions synchronously
@@ -0,0 +1,333 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2014 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/app/misc/ProposalTally.h>
+#include <ripple/basics/Log.h>
+#include <ripple/basics/ParallelFor.h>
+#include <ripple/protocol/SField.h>
+#include <algorithm>
+#include <sstream>
+
+namespace ripple {
+
+std::string
+ProposalTally::Counts::statistic () const
+{
+    std::stringstream ss;
+    for (std::size_t i = 0; i < accounts.size (); ++i)
+    {
+        if (i != 0)
+            ss << "|";
+        ss << accounts[i];
+    }
+    ss << ";";
+    for (std::size_t i = 0; i < vbc.size (); ++i)
+    {
+        if (i != 0)
+            ss << "|";
+        ss << vbc[i];
+    }
+    return ss.str ();
+}
+
+ProposalTally::ProposalTally (beast::Journal journal, ClosedHandler onClosed)
+    : journal_ (journal)
+    , onClosed_ (std::move (onClosed))
+{
+}
+
+void
+ProposalTally::update (std::shared_ptr<Ledger const> const& ledger,
+    LedgerFetch const& fetch)
+{
+    // The next snapshot is built on a copy, so readers are only held up
+    // while it is swapped in, not through a recount or a long walk.
+    std::lock_guard<std::mutex> updateLock (updateMutex_);
+    Snapshot next;
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        next = snapshot_;
+    }
+
+    auto const seq = ledger->info ().seq;
+    if (next.ledger && next.ledger->info ().seq >= seq)
+        return;
+
+    Closed closed;
+    // Closures are only seen when passing from a ledger to the next one.
+    if (next.ledger && seq - next.ledger->info ().seq <= maxWalk)
+    {
+        for (auto i = next.ledger->info ().seq + 1; i < seq; ++i)
+        {
+            auto const between = fetch ? fetch (i) : nullptr;
+            if (!between || between->info ().seq != i)
+            {
+                JLOG (journal_.warning) << "Proposal tally can not fetch ledger " << i
+                                        << ", closures up to " << seq << " are not recorded.";
+                break;
+            }
+            if (!sync (next, between, closed))
+                break;
+        }
+    }
+    else if (next.ledger)
+    {
+        JLOG (journal_.warning) << "Proposal tally jumps from ledger " << next.ledger->info ().seq
+                                << " to " << seq << ", closures in between are not recorded.";
+    }
+    sync (next, ledger, closed);
+
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        snapshot_ = std::move (next);
+        for (auto const& item : closed)
+            closed_.emplace (item.first, item.second);
+    }
+
+    if (onClosed_)
+    {
+        for (auto const& item : closed)
+            onClosed_ (item.first, item.second);
+    }
+}
+
+boost::optional<ProposalTally::Counts>
+ProposalTally::counts (std::uint32_t proposal, std::uint32_t seq) const
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+
+    auto const closed = closed_.find (proposal);
+    if (closed != closed_.end ())
+    {
+        if (closed->second.ledgerSeq == seq)
+            return closed->second;
+        return boost::none;
+    }
+
+    if (!snapshot_.ledger || snapshot_.ledger->info ().seq != seq)
+        return boost::none;
+    auto const info = snapshot_.proposals.find (proposal);
+    if (info == snapshot_.proposals.end ())
+        return boost::none;
+    return makeCounts (snapshot_, proposal, info->second);
+}
+
+std::uint32_t
+ProposalTally::ledgerSeq () const
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+    return snapshot_.ledger ? snapshot_.ledger->info ().seq : 0;
+}
+
+bool
+ProposalTally::sync (Snapshot& snapshot,
+    std::shared_ptr<Ledger const> const& ledger, Closed& closed) const
+{
+    auto const previous = snapshot.ledger;
+
+    if (previous)
+    {
+        try
+        {
+            SHAMap::Delta delta;
+            if (ledger->stateMap ().compare (previous->stateMap (), delta, maxDelta))
+            {
+                // first is the item in ledger, second the one in previous.
+                for (auto const& item : delta)
+                {
+                    applyItem (snapshot, item.second.second, false);
+                    applyItem (snapshot, item.second.first, true);
+                }
+                snapshot.ledger = ledger;
+                recordClosed (snapshot, *previous, *ledger, closed);
+
+                JLOG (journal_.debug) << "Proposal tally moved from ledger " << previous->info ().seq
+                                      << " to " << ledger->info ().seq << " with " << delta.size () << " differences.";
+                return true;
+            }
+            JLOG (journal_.info) << "Too many differences from tallied ledger " << previous->info ().seq
+                                 << " to " << ledger->info ().seq << ", recounting.";
+        }
+        catch (SHAMapMissingNode const& e)
+        {
+            JLOG (journal_.warning) << "Proposal tally delta failed: " << e << ", recounting.";
+        }
+    }
+
+    snapshot = Snapshot ();
+    try
+    {
+        // Entries are read and parsed in parallel, summing is serialized.
+        std::mutex applyMutex;
+        ledger->visitStateItemsParallel ([&snapshot, &applyMutex](std::size_t, SLE::ref sle)
+        {
+            std::lock_guard<std::mutex> lock (applyMutex);
+            apply (snapshot, *sle, true);
+        }, parallelThreads ());
+    }
+    catch (SHAMapMissingNode const& e)
+    {
+        JLOG (journal_.warning) << "Proposal tally recount failed: " << e;
+        snapshot = Snapshot ();
+        return false;
+    }
+    snapshot.ledger = ledger;
+    if (previous)
+        recordClosed (snapshot, *previous, *ledger, closed);
+
+    JLOG (journal_.info) << "Proposal tally recounted at ledger " << ledger->info ().seq
+                         << " with " << snapshot.totalAccounts << " accounts and "
+                         << snapshot.proposals.size () << " proposals.";
+    return true;
+}
+
+void
+ProposalTally::applyItem (Snapshot& snapshot,
+    std::shared_ptr<SHAMapItem const> const& item, bool add)
+{
+    if (!item)
+        return;
+    auto const sle = std::make_shared<SLE> (SerialIter{item->data (), item->size ()}, item->key ());
+    apply (snapshot, *sle, add);
+}
+
+void
+ProposalTally::apply (Snapshot& snapshot, SLE const& sle, bool add)
+{
+    if (sle.getType () == ltPROPOSAL)
+    {
+        auto const index = sle.getFieldU32 (sfProposalIndex);
+        if (!add)
+        {
+            snapshot.proposals.erase (index);
+            return;
+        }
+        auto& info = snapshot.proposals[index];
+        info.options = sle.getFieldU8 (sfProposalOptions);
+        info.expire = sle.getFieldU32 (sfProposalExpire);
+        info.closeLedger = sle.isFieldPresent (sfProposalCloseLedger) ?
+            sle.getFieldU32 (sfProposalCloseLedger) : 0;
+        return;
+    }
+
+    if (sle.getType () != ltACCOUNT_ROOT)
+        return;
+
+    // Removing runs the same sums backwards, unsigned wrap around cancels
+    // whatever the entry added before.
+    std::uint64_t const one = add ? 1 : std::uint64_t (-1);
+    std::uint64_t const vbc = sle.getFieldAmount (sfBalanceVBC).mantissa ();
+    std::uint64_t const weight = add ? vbc : std::uint64_t (0) - vbc;
+    snapshot.totalAccounts += one;
+    snapshot.totalVBC += weight;
+
+    if (!sle.isFieldPresent (sfProposalVotes))
+        return;
+
+    std::vector<std::uint32_t> seen;
+    for (auto const& vote : sle.getFieldArray (sfProposalVotes))
+    {
+        auto const index = vote.getFieldU32 (sfProposalIndex);
+        auto const option = vote.getFieldU8 (sfProposalVote);
+        // Only the first record of a proposal counts.
+        if (std::find (seen.begin (), seen.end (), index) != seen.end ())
+            continue;
+        seen.push_back (index);
+        if (option == 0)
+            continue;
+
+        auto& votes = snapshot.votes[index];
+        if (votes.accounts.size () <= option)
+        {
+            votes.accounts.resize (option + 1, 0);
+            votes.vbc.resize (option + 1, 0);
+        }
+        votes.accounts[option] += one;
+        votes.vbc[option] += weight;
+    }
+}
+
+ProposalTally::Counts
+ProposalTally::makeCounts (Snapshot const& snapshot, std::uint32_t proposal,
+    Proposal const& info)
+{
+    Counts result;
+    result.ledgerSeq = snapshot.ledger->info ().seq;
+    result.accounts.assign (info.options + 1, 0);
+    result.vbc.assign (info.options + 1, 0);
+
+    std::uint64_t votedAccounts = 0;
+    std::uint64_t votedVBC = 0;
+    auto const votes = snapshot.votes.find (proposal);
+    if (votes != snapshot.votes.end ())
+    {
+        auto const& v = votes->second;
+        for (std::size_t i = 1; i <= info.options && i < v.accounts.size (); ++i)
+        {
+            result.accounts[i] = v.accounts[i];
+            result.vbc[i] = v.vbc[i];
+            votedAccounts += v.accounts[i];
+            votedVBC += v.vbc[i];
+        }
+    }
+    // Everyone else did not vote, or voted for an option that does not exist.
+    result.accounts[0] = snapshot.totalAccounts - votedAccounts;
+    result.vbc[0] = snapshot.totalVBC - votedVBC;
+    return result;
+}
+
+void
+ProposalTally::recordClosed (Snapshot const& snapshot, Ledger const& previous,
+    Ledger const& ledger, Closed& closed) const
+{
+    // A proposal closed on a ledger we jumped over can not be recovered.
+    if (previous.info ().seq + 1 != ledger.info ().seq)
+        return;
+
+    auto const seq = ledger.info ().seq;
+    auto const lastClose = previous.info ().closeTime;
+    auto const close = ledger.info ().closeTime;
+    for (auto const& item : snapshot.proposals)
+    {
+        auto const& info = item.second;
+        // An expired proposal closes on the first ledger at or after its
+        // expire time, the way vote_counting looks it up.
+        bool const isClosed = info.closeLedger != 0 ?
+            info.closeLedger == seq :
+            lastClose < info.expire && info.expire <= close;
+        if (!isClosed)
+            continue;
+
+        // closed_ is only changed by update, which holds updateMutex_.
+        if (closed_.find (item.first) != closed_.end () ||
+            std::any_of (closed.begin (), closed.end (),
+                [&item](Closed::value_type const& c)
+                {
+                    return c.first == item.first;
+                }))
+            continue;
+
+        closed.emplace_back (item.first,
+            makeCounts (snapshot, item.first, info));
+        JLOG (journal_.debug) << "Proposal " << item.first << " closed on ledger " << seq;
+    }
+}
+
+} // ripple
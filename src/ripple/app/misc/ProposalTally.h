@@ -0,0 +1,169 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2014 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_APP_MISC_PROPOSALTALLY_H_INCLUDED
+#define RIPPLE_APP_MISC_PROPOSALTALLY_H_INCLUDED
+
+#include <ripple/app/ledger/Ledger.h>
+#include <ripple/basics/UnorderedContainers.h>
+#include <beast/utility/Journal.h>
+#include <boost/optional.hpp>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ripple {
+
+/** Running vote counts of every proposal.
+
+    The tally follows validated ledgers. Moving to a new ledger only looks
+    at the state entries that changed since the last one, so answering how
+    a proposal stands costs O(options) instead of a walk over every
+    account. When a proposal closes on a ledger the tally passes through,
+    the counts at that ledger are kept and handed to the closed handler,
+    which stores them so they outlive the process.
+*/
+class ProposalTally
+{
+public:
+    /** Votes on a proposal as of a ledger.
+
+        Both vectors have one entry per option plus entry 0, which counts
+        the accounts that did not vote on the proposal. VBC is summed by
+        mantissa.
+    */
+    struct Counts
+    {
+        std::uint32_t ledgerSeq = 0;
+        std::vector<std::uint64_t> accounts;
+        std::vector<std::uint64_t> vbc;
+
+        /** The "accounts;vbc" form stored in the VoteCounting table. */
+        std::string
+        statistic () const;
+    };
+
+    /** Returns the ledger with a sequence, or null if it is not at hand. */
+    using LedgerFetch =
+        std::function<std::shared_ptr<Ledger const> (std::uint32_t)>;
+
+    /** Called with the counts of a proposal on the ledger it closed on. */
+    using ClosedHandler =
+        std::function<void (std::uint32_t proposal, Counts const&)>;
+
+    ProposalTally (beast::Journal journal, ClosedHandler onClosed);
+
+    /** Bring the tally up to the state of a validated ledger.
+
+        The ledgers between the last one tallied and this one are fetched
+        and passed through in order, so no proposal closing on one of them
+        is missed. If one can not be fetched, the tally jumps over the rest
+        and the closures on them are not recorded.
+    */
+    void
+    update (std::shared_ptr<Ledger const> const& ledger,
+        LedgerFetch const& fetch);
+
+    /** Returns the votes on a proposal as of ledger seq.
+
+        Only the ledger the tally is at and the ledgers proposals closed
+        on are known.
+    */
+    boost::optional<Counts>
+    counts (std::uint32_t proposal, std::uint32_t seq) const;
+
+    /** The sequence of the ledger the tally reflects, 0 if none. */
+    std::uint32_t
+    ledgerSeq () const;
+
+private:
+    // Accounts and VBC voting for each option of one proposal
+    struct Votes
+    {
+        std::vector<std::uint64_t> accounts;
+        std::vector<std::uint64_t> vbc;
+    };
+
+    // What is needed to tell when a proposal closes
+    struct Proposal
+    {
+        std::uint8_t options = 0;
+        std::uint32_t expire = 0;
+        std::uint32_t closeLedger = 0;
+    };
+
+    // What the tally knows as of one ledger
+    struct Snapshot
+    {
+        std::shared_ptr<Ledger const> ledger;
+        std::uint64_t totalAccounts = 0;
+        std::uint64_t totalVBC = 0;
+        hash_map<std::uint32_t, Votes> votes;
+        hash_map<std::uint32_t, Proposal> proposals;
+    };
+
+    // Proposals found closed by an update, with their counts
+    using Closed = std::vector<std::pair<std::uint32_t, Counts>>;
+
+    bool
+    sync (Snapshot& snapshot, std::shared_ptr<Ledger const> const& ledger,
+        Closed& closed) const;
+
+    static
+    void
+    apply (Snapshot& snapshot, SLE const& sle, bool add);
+
+    static
+    void
+    applyItem (Snapshot& snapshot,
+        std::shared_ptr<SHAMapItem const> const& item, bool add);
+
+    static
+    Counts
+    makeCounts (Snapshot const& snapshot, std::uint32_t proposal,
+        Proposal const& info);
+
+    void
+    recordClosed (Snapshot const& snapshot, Ledger const& previous,
+        Ledger const& ledger, Closed& closed) const;
+
+    static int const maxDelta = 262144;
+
+    // Most ledgers passed through one by one in a single update
+    static std::uint32_t const maxWalk = 1024;
+
+    beast::Journal journal_;
+    ClosedHandler onClosed_;
+    // Serializes updates, which build the next snapshot without mutex_
+    std::mutex updateMutex_;
+    mutable std::mutex mutex_;
+    Snapshot snapshot_;
+    // Counts of closed proposals at the ledger they closed on. Only
+    // changed by update, under both mutexes.
+    std::map<std::uint32_t, Counts> closed_;
+};
+
+} // ripple
+
+#endif
@@ -127,6 +127,9 @@ std::string pathTypeToString (Pathfinder::PathType const& type)
             case Pathfinder::nt_XRP_BOOK:
                 ret.append("x");
                 break;
+            case Pathfinder::nt_VBC_BOOK:
+                ret.append("v");
+                break;
             case Pathfinder::nt_DEST_BOOK:
                 ret.append("f");
                 break;
@@ -847,6 +850,10 @@ STPathSet& Pathfinder::addPathsForType (PathType const& pathType)
         addLinks (parentPaths, pathsOut, afADD_BOOKS | afOB_XRP);
         break;
 
+    case nt_VBC_BOOK:
+        addLinks (parentPaths, pathsOut, afADD_BOOKS | afOB_VBC);
+        break;
+
     case nt_DEST_BOOK:
         addLinks (parentPaths, pathsOut, afADD_BOOKS | afOB_LAST);
         break;
@@ -1107,6 +1114,20 @@ void Pathfinder::addLink (
                 incompletePaths.assembleAdd (currentPath, pathElement);
             }
         }
+        else if (addFlags & afOB_VBC)
+        {
+            // to VBC only
+            if (!bOnVBC && app_.getOrderBookDB ().isBookToVBC (
+                    {uEndCurrency, uEndIssuer}))
+            {
+                STPathElement pathElement(
+                    STPathElement::typeCurrency,
+                    vbcAccount (),
+                    vbcCurrency (),
+                    vbcAccount ());
+                incompletePaths.assembleAdd (currentPath, pathElement);
+            }
+        }
         else
         {
             bool bDestOnly = (addFlags & afOB_LAST) != 0;
@@ -1237,6 +1258,10 @@ Pathfinder::PathType makePath (char const *string)
                 ret.push_back (Pathfinder::nt_XRP_BOOK);
                 break;
 
+            case 'v': // vbc book
+                ret.push_back (Pathfinder::nt_VBC_BOOK);
+                break;
+
             case 'f': // book to final currency
                 ret.push_back (Pathfinder::nt_DEST_BOOK);
                 break;
@@ -1322,6 +1347,8 @@ void Pathfinder::initPathTable ()
 
     fillPaths(
         pt_nonXRP_to_VBC,  {
+            {1, "svd"},     // gateway buys VBC
+            {2, "savd"},    // source -> gateway -> book(VBC) -> dest
             {3, "safd"},    // source -> gateway -> book -> destination
             {5, "sbfd"},
         });
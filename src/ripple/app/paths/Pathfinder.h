@@ -74,6 +74,7 @@ public:
         nt_ACCOUNTS,   // Accounts that connect from this source/currency.
         nt_BOOKS,      // Order books that connect to this currency.
         nt_XRP_BOOK,   // The order book from this currency to XRP.
+        nt_VBC_BOOK,   // The order book from this currency to VBC.
         nt_DEST_BOOK,  // The order book to the destination currency/issuer.
         nt_DESTINATION // The destination account only.
     };
@@ -208,6 +209,9 @@ private:
     // Add order book to XRP only
     static std::uint32_t const afOB_XRP = 0x010;
 
+    // Add order book to VBC only
+    static std::uint32_t const afOB_VBC = 0x020;
+
     // Must link to destination currency
     static std::uint32_t const afOB_LAST = 0x040;
 
@@ -1,6 +1,8 @@
 #include <BeastConfig.h>
 #include <ripple/test/jtx.h>
 #include <ripple/protocol/JsonFields.h>
+#include <chrono>
+#include <limits>
 
 namespace ripple
 {
@@ -602,6 +604,59 @@ struct Asset_test : public beast::unit_test::suite
                           gw.id (), ASSET.currency)));
     }
 
+    void testReleaseCursor ()
+    {
+        using namespace jtx;
+        auto const gw = Account ("gw");
+        auto const ASSET = gw["4153534554000000000000000000000000000000"];
+
+        Env env (*this);
+        env.fund (XRP (100000), "alice", "bob", gw);
+        auto jv = issue (gw, "alice", ASSET (40000000));
+        appendReleasePoint (jv, 0, 5 * 10000000);
+        appendReleasePoint (jv, 86400, 10 * 10000000);
+        appendReleasePoint (jv, 172800, 100 * 10000000);
+        env (jv);
+        env.close (std::chrono::seconds (86400 + 600));
+
+        auto nextRelease = [&]() -> std::uint32_t
+        {
+            auto const line = env.le (
+                keylet::line (Account ("bob").id (), gw.id (), ASSET.currency));
+            if (!line || !line->isFieldPresent (sfNextReleaseTime))
+                return 0;
+            return line->getFieldU32 (sfNextReleaseTime);
+        };
+
+        env (trust ("bob", ASSET (200)));
+        env (pay ("alice", "bob", ASSET (100)));
+        expectBalanceAndReserve (env, Account ("bob"), gw, ASSET, 5, 95);
+
+        // The cursor is the next release point of the only tranche.
+        auto const parentCloseTime = env.open ()->info ().parentCloseTime;
+        auto const bought = parentCloseTime - parentCloseTime % 86400;
+        expect (nextRelease () == bought + 86400, "bad release cursor");
+
+        // Nothing is due, balances stay while the cursor is not reached.
+        env.close ();
+        env (pay ("bob", "alice", ASSET (5)));
+        expectBalanceAndReserve (env, Account ("bob"), gw, ASSET, 0, 95);
+        expect (nextRelease () == bought + 86400, "release cursor moved");
+
+        // Past the cursor the release happens and the cursor advances.
+        env.close (std::chrono::seconds (86400));
+        env (pay ("bob", "alice", ASSET (5)));
+        expectBalanceAndReserve (env, Account ("bob"), gw, ASSET, 0, 90);
+        expect (nextRelease () == bought + 172800, "release cursor not advanced");
+
+        // Fully released, no tranche is left to wait for.
+        env.close (std::chrono::seconds (86400));
+        env (pay ("bob", "alice", ASSET (90)));
+        expectBalanceAndReserve (env, Account ("bob"), gw, ASSET, 0, 0);
+        expect (nextRelease () == std::numeric_limits<std::uint32_t>::max (),
+                "bad release cursor for released line");
+    }
+
     void run () override
     {
         testIssue ();
@@ -609,10 +664,71 @@ struct Asset_test : public beast::unit_test::suite
         testRelease (0, 10, 95);
         testPayment ();
         testOffer ();
+        testReleaseCursor ();
     }
 };
 
 BEAST_DEFINE_TESTSUITE (Asset, test, ripple);
 
+/** Payment cost on lines holding many asset tranches. */
+struct AssetRelease_test : public beast::unit_test::suite
+{
+    // Time payments out of a line holding one tranche per day. Each tranche
+    // releases enough for one payment.
+    void timePayments (std::size_t tranches, std::size_t payments)
+    {
+        using namespace jtx;
+        auto const gw = Account ("gw");
+        auto const ASSET = gw["4153534554000000000000000000000000000000"];
+
+        Env env (*this);
+        env.fund (XRP (1000000), "alice", "bob", gw);
+
+        // Release 5% at once and the rest long after the test ends.
+        Json::Value jv;
+        jv[jss::Account] = gw.human ();
+        jv[jss::Destination] = Account ("alice").human ();
+        jv[jss::Amount] = STAmount (ASSET (40000000)).getJson (0);
+        jv[jss::TransactionType] = "Issue";
+        auto& releaseSchedule = jv["ReleaseSchedule"];
+        auto& first = releaseSchedule.append (Json::Value::null)["ReleasePoint"];
+        first["Expiration"] = 0;
+        first["ReleaseRate"] = to_string (5 * 10000000);
+        auto& last = releaseSchedule.append (Json::Value::null)["ReleasePoint"];
+        last["Expiration"] = 86400 * 10000;
+        last["ReleaseRate"] = to_string (100 * 10000000);
+        env (jv);
+
+        env (trust ("bob", ASSET (10000000)));
+        for (std::size_t i = 0; i < tranches; ++i)
+        {
+            env.close (std::chrono::seconds (86400));
+            env (pay ("alice", "bob", ASSET (100)));
+        }
+        env.close ();
+
+        using clock_type = std::chrono::steady_clock;
+        auto const start = clock_type::now ();
+        for (std::size_t i = 0; i < payments; ++i)
+            env (pay ("bob", "alice", ASSET (5)));
+        auto const elapsed = std::chrono::duration_cast<
+            std::chrono::microseconds> (clock_type::now () - start);
+
+        log << tranches << " tranches: " << payments << " payments in " <<
+            elapsed.count () / 1000 << "ms, " <<
+            elapsed.count () / payments << "us per payment";
+        pass ();
+    }
+
+    void run () override
+    {
+        timePayments (10, 10);
+        timePayments (1000, 200);
+        timePayments (4000, 200);
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL (AssetRelease, test, ripple);
+
 } // test
 } // ripple
@@ -0,0 +1,123 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2015 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/app/ledger/CloseTimeIndex.h>
+#include <beast/unit_test/suite.h>
+
+namespace ripple {
+namespace test {
+
+class CloseTimeIndex_test : public beast::unit_test::suite
+{
+    // Ledger seq closes at 100 + 10 * seq, its parent 10 earlier.
+    static
+    void
+    add (CloseTimeIndex& index, LedgerIndex seq)
+    {
+        index.insert (seq, 100 + 10 * seq, 90 + 10 * seq);
+    }
+
+    void
+    testLookup ()
+    {
+        testcase ("lookup");
+
+        CloseTimeIndex index;
+        expect (! index.firstClosedAtOrAfter (100));
+        expect (! index.lastClosedAtOrBefore (100));
+
+        for (LedgerIndex seq = 1; seq <= 10; ++seq)
+            add (index, seq);
+        expect (index.size () == 10);
+
+        // Ledger 3 closed at 130, ledger 2 at 120.
+        expect (index.firstClosedAtOrAfter (130) == LedgerIndex (3));
+        expect (index.firstClosedAtOrAfter (125) == LedgerIndex (3));
+        expect (index.firstClosedAtOrAfter (121) == LedgerIndex (3));
+        expect (index.firstClosedAtOrAfter (120) == LedgerIndex (2));
+        expect (! index.firstClosedAtOrAfter (201));
+        // Ledger 1's parent closed at 100, earlier is not indexed.
+        expect (! index.firstClosedAtOrAfter (100));
+
+        expect (index.lastClosedAtOrBefore (130) == LedgerIndex (3));
+        expect (index.lastClosedAtOrBefore (139) == LedgerIndex (3));
+        expect (index.lastClosedAtOrBefore (5000) == LedgerIndex (10));
+        expect (! index.lastClosedAtOrBefore (109));
+    }
+
+    void
+    testGaps ()
+    {
+        testcase ("gaps");
+
+        CloseTimeIndex index;
+        add (index, 1);
+        add (index, 2);
+        add (index, 6);
+        add (index, 7);
+
+        // Ledgers 3 to 5 are missing, the ledger closing at 140 is one
+        // of them.
+        expect (! index.firstClosedAtOrAfter (140));
+        expect (index.firstClosedAtOrAfter (160) == LedgerIndex (6));
+        expect (index.lastClosedAtOrBefore (150) == LedgerIndex (2));
+
+        // Backfill out of order.
+        add (index, 4);
+        add (index, 3);
+        expect (index.size () == 6);
+        expect (index.firstClosedAtOrAfter (140) == LedgerIndex (4));
+        expect (index.firstClosedAtOrAfter (131) == LedgerIndex (4));
+        expect (index.lastClosedAtOrBefore (150) == LedgerIndex (4));
+
+        // Replacing and erasing.
+        index.insert (4, 145, 130);
+        expect (index.size () == 6);
+        expect (index.firstClosedAtOrAfter (145) == LedgerIndex (4));
+        index.erase (4);
+        index.erase (5);
+        expect (index.size () == 5);
+        expect (! index.firstClosedAtOrAfter (140));
+        expect (index.lastClosedAtOrBefore (150) == LedgerIndex (3));
+
+        // Erasing a prefix, ledger 5 is already gone.
+        index.eraseBefore (5);
+        expect (index.size () == 2);
+        expect (! index.lastClosedAtOrBefore (150));
+        expect (index.firstClosedAtOrAfter (160) == LedgerIndex (6));
+        index.eraseBefore (1);
+        expect (index.size () == 2);
+        index.eraseBefore (100);
+        expect (index.size () == 0);
+    }
+
+public:
+    void
+    run ()
+    {
+        testLookup ();
+        testGaps ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(CloseTimeIndex, app, ripple)
+
+} // test
+} // ripple
@@ -0,0 +1,299 @@
+//------------------------------------------------------------------------------
+/*
+  This file is part of rippled: https://github.com/ripple/rippled
+  Copyright (c) 2012-2015 Ripple Labs Inc.
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose  with  or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+  MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+#include <BeastConfig.h>
+#include <ripple/app/ledger/OrderBookDB.h>
+#include <ripple/app/ledger/StateDiffStream.h>
+#include <ripple/protocol/Indexes.h>
+#include <ripple/protocol/JsonFields.h>
+#include <ripple/test/jtx.h>
+#include <beast/unit_test/suite.h>
+
+namespace ripple {
+namespace test {
+
+class OrderBookDB_test : public beast::unit_test::suite
+{
+    static
+    std::shared_ptr<Ledger const>
+    closed (jtx::Env& env)
+    {
+        return std::dynamic_pointer_cast<Ledger const> (env.closed ());
+    }
+
+    // The changes from one closed ledger to another
+    static
+    LedgerStateDiff
+    changes (std::shared_ptr<Ledger const> const& before,
+        std::shared_ptr<Ledger const> const& after)
+    {
+        LedgerStateDiff changes;
+        changes.before = before;
+        changes.after = after;
+        visitStateDiffs (before->stateMap (), after->stateMap (),
+            [&changes](StateDiff const& diff)
+            {
+                changes.diffs.push_back (diff);
+            });
+        return changes;
+    }
+
+    static
+    Json::Value
+    cancel (jtx::Account const& account, std::uint32_t seq)
+    {
+        Json::Value jv;
+        jv[jss::TransactionType] = "OfferCancel";
+        jv[jss::Account] = account.human ();
+        jv[jss::OfferSequence] = seq;
+        return jv;
+    }
+
+    // The root directory of a book at one quality
+    static
+    std::shared_ptr<SLE const>
+    bookDir (Book const& book, std::uint64_t rate)
+    {
+        auto const index = getQualityIndex (getBookBase (book), rate);
+        auto sle = std::make_shared<SLE> (ltDIR_NODE, index);
+        sle->setFieldH256 (sfRootIndex, index);
+        sle->setFieldH160 (sfTakerPaysCurrency, book.in.currency);
+        sle->setFieldH160 (sfTakerPaysIssuer, book.in.account);
+        sle->setFieldH160 (sfTakerGetsCurrency, book.out.currency);
+        sle->setFieldH160 (sfTakerGetsIssuer, book.out.account);
+        sle->setFieldU64 (sfExchangeRate, rate);
+        return sle;
+    }
+
+public:
+    void
+    testIncremental ()
+    {
+        testcase ("incremental");
+
+        using namespace jtx;
+        Env env (*this);
+        auto const gw = Account ("gateway");
+        auto const alice = Account ("alice");
+        auto const USD = gw["USD"];
+        env.fund (XRP (10000), alice, gw);
+        env.trust (USD (1000), alice);
+        env (pay (gw, alice, USD (100)));
+        env.close ();
+
+        auto& db = env.app ().getOrderBookDB ();
+        auto last = closed (env);
+        db.update (last);
+        expect (db.getBookSize (USD.issue ()) == 0);
+        expect (! db.isBookToXRP (USD.issue ()));
+
+        auto const next = [&]()
+        {
+            env.close ();
+            auto const ledger = closed (env);
+            db.onStateDiff (changes (last, ledger));
+            last = ledger;
+        };
+
+        // Two qualities of the same book share it
+        auto const first = env.seq (alice);
+        env (offer (alice, USD (10), XRP (10)));
+        next ();
+        expect (db.getBookSize (USD.issue ()) == 1);
+        expect (db.isBookToXRP (USD.issue ()));
+
+        auto const second = env.seq (alice);
+        env (offer (alice, USD (20), XRP (10)));
+        env (offer (alice, XRP (10), USD (5)));
+        next ();
+        expect (db.getBookSize (USD.issue ()) == 1);
+        expect (db.getBookSize (xrpIssue ()) == 1);
+
+        // The book stays until its last directory is gone
+        env (cancel (alice, first));
+        next ();
+        expect (db.getBookSize (USD.issue ()) == 1);
+        expect (db.isBookToXRP (USD.issue ()));
+
+        env (cancel (alice, second));
+        next ();
+        expect (db.getBookSize (USD.issue ()) == 0);
+        expect (! db.isBookToXRP (USD.issue ()));
+        expect (db.getBookSize (xrpIssue ()) == 1);
+    }
+
+    void
+    testSameAsScan ()
+    {
+        testcase ("same as a scan");
+
+        using namespace jtx;
+        Env env (*this);
+        auto const gw = Account ("gateway");
+        auto const alice = Account ("alice");
+        auto const USD = gw["USD"];
+        auto const EUR = gw["EUR"];
+        env.fund (XRP (10000), alice, gw);
+        env.trust (USD (1000), alice);
+        env.trust (EUR (1000), alice);
+        env (pay (gw, alice, USD (100)));
+        env (pay (gw, alice, EUR (100)));
+        env.close ();
+
+        auto& db = env.app ().getOrderBookDB ();
+        auto last = closed (env);
+        db.update (last);
+
+        auto const next = [&]()
+        {
+            env.close ();
+            auto const ledger = closed (env);
+            db.onStateDiff (changes (last, ledger));
+            last = ledger;
+        };
+
+        // The directories kept from the changes, checked against a scan
+        // of the same ledger
+        auto const expectScan = [&]()
+        {
+            auto const followed = db.getBookDirs ();
+            db.update (last);
+            expect (db.getBookDirs () == followed);
+        };
+
+        Book const usd {USD.issue (), xrpIssue ()};
+        auto const first = env.seq (alice);
+        env (offer (alice, USD (10), XRP (10)));
+        auto const second = env.seq (alice);
+        env (offer (alice, USD (20), XRP (10)));
+        env (offer (alice, EUR (10), XRP (10)));
+        next ();
+        auto const dirs = db.getBookDirs ();
+        auto const iter = dirs.find (getBookBase (usd));
+        expect (iter != dirs.end () && iter->second == 2);
+        expectScan ();
+
+        // The book is gone once it is empty, the other one stays
+        env (cancel (alice, first));
+        next ();
+        env (cancel (alice, second));
+        next ();
+        expect (db.getBookDirs ().count (getBookBase (usd)) == 0);
+        expect (db.getBookDirs ().size () == 1);
+        expectScan ();
+    }
+
+    void
+    testRebuild ()
+    {
+        testcase ("rebuild");
+
+        using namespace jtx;
+        Env env (*this);
+        auto const gw = Account ("gateway");
+        auto const alice = Account ("alice");
+        auto const USD = gw["USD"];
+        env.fund (XRP (10000), alice, gw);
+        env.trust (USD (1000), alice);
+        env (pay (gw, alice, USD (100)));
+        env.close ();
+
+        auto& db = env.app ().getOrderBookDB ();
+        auto const before = closed (env);
+        db.update (before);
+
+        env (offer (alice, USD (10), XRP (10)));
+        env.close ();
+        auto const after = closed (env);
+
+        // Unknown changes rebuild the books from the new ledger, which
+        // runs right away when standalone
+        LedgerStateDiff unknown;
+        unknown.after = after;
+        db.onStateDiff (unknown);
+        expect (db.getBookSize (USD.issue ()) == 1);
+        expect (db.isBookToXRP (USD.issue ()));
+
+        // Changes which don't follow the books rebuild them
+        db.update (before);
+        expect (db.getBookSize (USD.issue ()) == 0);
+        db.onStateDiff (changes (after, after));
+        expect (db.getBookSize (USD.issue ()) == 1);
+
+        // So do changes to an older ledger
+        db.onStateDiff (changes (before, before));
+        expect (db.getBookSize (USD.issue ()) == 0);
+    }
+
+    void
+    testVBC ()
+    {
+        testcase ("VBC");
+
+        using namespace jtx;
+        Env env (*this);
+        auto const gw = Account ("gateway");
+        auto const USD = gw["USD"];
+        env.fund (XRP (10000), gw);
+        env.close ();
+
+        auto& db = env.app ().getOrderBookDB ();
+        auto last = closed (env);
+        db.update (last);
+
+        auto const next = [&](StateDiff const& diff)
+        {
+            env.close ();
+            auto const ledger = closed (env);
+            auto c = changes (last, ledger);
+            c.diffs.push_back (diff);
+            db.onStateDiff (c);
+            last = ledger;
+        };
+
+        // Books to VBC are kept apart from books to XRP
+        Book const book {USD.issue (), vbcIssue ()};
+        auto const dir = bookDir (book, 1000000);
+        next ({dir->key (), nullptr, dir});
+        expect (db.getBookSize (USD.issue ()) == 1);
+        expect (db.isBookToVBC (USD.issue ()));
+        expect (! db.isBookToXRP (USD.issue ()));
+
+        auto const books = db.getBooksByTakerPays (USD.issue ());
+        expect (books.size () == 1 &&
+            isVBC (books.front ()->getCurrencyOut ()));
+
+        next ({dir->key (), dir, nullptr});
+        expect (db.getBookSize (USD.issue ()) == 0);
+        expect (! db.isBookToVBC (USD.issue ()));
+    }
+
+    void
+    run ()
+    {
+        testIncremental ();
+        testSameAsScan ();
+        testRebuild ();
+        testVBC ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(OrderBookDB,app,ripple);
+
+} // test
+} // ripple
@@ -18,6 +18,8 @@
 //==============================================================================
 
 #include <BeastConfig.h>
+#include <ripple/app/ledger/OpenLedger.h>
+#include <ripple/app/ledger/OrderBookDB.h>
 #include <ripple/app/paths/AccountCurrencies.h>
 #include <ripple/basics/contract.h>
 #include <ripple/json/json_reader.h>
@@ -138,9 +140,9 @@ std::tuple <STPathSet, STAmount, STAmount>
 find_paths(jtx::Env& env,
     jtx::Account const& src, jtx::Account const& dst,
         STAmount const& saDstAmount,
-            boost::optional<STAmount> const& saSendMax = boost::none)
+            boost::optional<STAmount> const& saSendMax = boost::none,
+                int level = 8)
 {
-    static int const level = 8;
     auto const& view = env.open ();
     auto cache = std::make_shared<RippleLineCache>(view);
     auto currencies = accountSourceCurrencies(src, cache, true);
@@ -685,6 +687,62 @@ public:
             Account("bob")["USD"].issue())) == nullptr);
     }
 
+    // VBC drops, genesis holds none so tests give it out directly
+    static
+    STAmount
+    vbc (std::uint64_t drops)
+    {
+        return STAmount (vbcIssue (), drops);
+    }
+
+    void
+    via_offers_via_vbc_book()
+    {
+        using namespace jtx;
+        testcase("via VBC book");
+        Env env(*this);
+        auto const gw = Account("gateway");
+        auto const USD = gw["USD"];
+        env.fund(XRP(10000), "alice", "bob", "carol", gw);
+        env.trust(USD(1000), "alice", "carol");
+        env(pay(gw, "alice", USD(100)));
+
+        env.app().openLedger().modify(
+            [&](OpenView& view, beast::Journal)
+            {
+                auto const sle = std::make_shared<SLE>(*view.read(
+                    keylet::account(Account("carol").id())));
+                sle->setFieldAmount(sfBalanceVBC, vbc(1000000000));
+                view.rawReplace(sle);
+                return true;
+            });
+        env(offer("carol", USD(50), vbc(50000000)));
+        expect(env.app().getOrderBookDB().isBookToVBC(USD.issue()));
+
+        // source -> gateway -> book to VBC -> destination, which only the
+        // VBC book node finds at the cheapest search levels
+        auto const viaVBCBook = [&](STPathSet const& st)
+        {
+            return std::any_of(st.begin(), st.end(),
+                [&](STPath const& p)
+                {
+                    return p.size() == 2 &&
+                        p[0].getAccountID() == gw.id() &&
+                        isVBC(p[1].getCurrency());
+                });
+        };
+
+        for (int level : {2, 8})
+        {
+            STPathSet st;
+            STAmount sa;
+            std::tie(st, sa, std::ignore) = find_paths(env,
+                "alice", "bob", vbc(10000000), boost::none, level);
+            expect(viaVBCBook(st));
+            expect(equal(sa, Account("alice")["USD"](10)));
+        }
+    }
+
     void
     run()
     {
@@ -701,6 +759,7 @@ public:
         issues_path_negative_ripple_client_issue_23_smaller();
         issues_path_negative_ripple_client_issue_23_larger();
         via_offers_via_gateway();
+        via_offers_via_vbc_book();
         indirect_paths_path_find();
         quality_paths_quality_set_and_test();
         trust_auto_clear_trust_normal_clear();
@@ -0,0 +1,327 @@
+//------------------------------------------------------------------------------
+/*
+  This file is part of rippled: https://github.com/ripple/rippled
+  Copyright (c) 2012-2015 Ripple Labs Inc.
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose  with  or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+  MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+#include <BeastConfig.h>
+#include <ripple/app/main/Application.h>
+#include <ripple/app/misc/ProposalTally.h>
+#include <ripple/core/ConfigSections.h>
+#include <ripple/protocol/JsonFields.h>
+#include <ripple/test/jtx.h>
+#include <beast/unit_test/suite.h>
+#include <map>
+
+namespace ripple {
+namespace test {
+
+class ProposalTally_test : public beast::unit_test::suite
+{
+    // The account Env funds everything from
+    static
+    jtx::Account const&
+    master ()
+    {
+        static jtx::Account const account ("master", generateKeyPair (
+            KeyType::secp256k1, generateSeed ("masterpassphrase")));
+        return account;
+    }
+
+    static
+    std::unique_ptr<Config const>
+    makeConfig ()
+    {
+        auto p = std::make_unique<Config> ();
+        setupConfigForUnitTests (*p);
+        p->section (SECTION_PROPOSAL_VOTE).set ("vote_admin",
+            master ().human ());
+        return std::move (p);
+    }
+
+    static
+    Json::Value
+    create (std::uint8_t options, std::uint32_t expire)
+    {
+        Json::Value jv;
+        jv[jss::Account] = master ().human ();
+        jv[jss::TransactionType] = "CreateProposal";
+        jv["ProposalOptions"] = options;
+        jv["ProposalExpire"] = expire;
+        return jv;
+    }
+
+    static
+    Json::Value
+    vote (jtx::Account const& account, std::uint32_t proposal,
+        std::uint8_t option)
+    {
+        Json::Value jv;
+        jv[jss::Account] = account.human ();
+        jv[jss::TransactionType] = "VoteProposal";
+        jv["ProposalIndex"] = proposal;
+        jv["ProposalVote"] = option;
+        return jv;
+    }
+
+    static
+    Json::Value
+    close (std::uint32_t proposal)
+    {
+        Json::Value jv;
+        jv[jss::Account] = master ().human ();
+        jv[jss::TransactionType] = "CloseProposal";
+        jv["ProposalIndex"] = proposal;
+        return jv;
+    }
+
+    // Counts by walking every account, the way vote_counting falls back to.
+    static
+    ProposalTally::Counts
+    recount (Ledger const& ledger, std::uint32_t proposal,
+        std::uint8_t options)
+    {
+        ProposalTally::Counts counts;
+        counts.ledgerSeq = ledger.info ().seq;
+        counts.accounts.assign (options + 1, 0);
+        counts.vbc.assign (options + 1, 0);
+        ledger.visitStateItems ([&](SLE::ref sle)
+        {
+            if (sle->getType () != ltACCOUNT_ROOT)
+                return;
+            std::uint8_t option = 0;
+            if (sle->isFieldPresent (sfProposalVotes))
+            {
+                for (auto const& v : sle->getFieldArray (sfProposalVotes))
+                {
+                    if (v.getFieldU32 (sfProposalIndex) == proposal)
+                    {
+                        option = v.getFieldU8 (sfProposalVote);
+                        break;
+                    }
+                }
+            }
+            if (option > options)
+                option = 0;
+            counts.accounts[option] += 1;
+            counts.vbc[option] += sle->getFieldAmount (sfBalanceVBC).mantissa ();
+        });
+        return counts;
+    }
+
+    static
+    bool
+    same (boost::optional<ProposalTally::Counts> const& a,
+        ProposalTally::Counts const& b)
+    {
+        return a && a->ledgerSeq == b.ledgerSeq &&
+            a->accounts == b.accounts && a->vbc == b.vbc;
+    }
+
+    // Closes the open ledger and keeps it by sequence
+    static
+    std::shared_ptr<Ledger const>
+    closeLedger (jtx::Env& env,
+        std::map<std::uint32_t, std::shared_ptr<Ledger const>>& ledgers)
+    {
+        env.close ();
+        auto const ledger =
+            std::dynamic_pointer_cast<Ledger const> (env.closed ());
+        ledgers[ledger->info ().seq] = ledger;
+        return ledger;
+    }
+
+public:
+    void
+    testCounts ()
+    {
+        testcase ("counts");
+
+        using namespace jtx;
+        Env env (*this, makeConfig ());
+        std::map<std::uint32_t, std::shared_ptr<Ledger const>> ledgers;
+        auto const fetch = [&ledgers](std::uint32_t seq)
+        {
+            auto const iter = ledgers.find (seq);
+            return iter == ledgers.end () ? nullptr : iter->second;
+        };
+
+        Account const alice ("alice");
+        Account const bob ("bob");
+        Account const carol ("carol");
+        env.fund (XRP (10000), alice, bob, carol);
+        env (create (2, env.open ()->info ().parentCloseTime + 100000));
+        auto const first = closeLedger (env, ledgers);
+
+        ProposalTally tally (beast::Journal (), nullptr);
+        tally.update (first, fetch);
+        expect (tally.ledgerSeq () == first->info ().seq);
+        expect (same (tally.counts (1, first->info ().seq),
+            recount (*first, 1, 2)));
+
+        env (vote (alice, 1, 1));
+        env (vote (bob, 1, 2));
+        auto const second = closeLedger (env, ledgers);
+        tally.update (second, fetch);
+        auto const counts = tally.counts (1, second->info ().seq);
+        expect (same (counts, recount (*second, 1, 2)));
+        expect (counts && counts->accounts[1] == 1 && counts->accounts[2] == 1);
+
+        // Changing a vote moves it between options
+        env (vote (bob, 1, 1));
+        auto const third = closeLedger (env, ledgers);
+        tally.update (third, fetch);
+        expect (same (tally.counts (1, third->info ().seq),
+            recount (*third, 1, 2)));
+
+        // Only the ledger the tally is at is known for an open proposal
+        expect (!tally.counts (1, second->info ().seq));
+        expect (!tally.counts (2, third->info ().seq));
+
+        // An older ledger does not move the tally back
+        tally.update (first, fetch);
+        expect (tally.ledgerSeq () == third->info ().seq);
+    }
+
+    void
+    testClosedBetween ()
+    {
+        testcase ("closed between updates");
+
+        using namespace jtx;
+        Env env (*this, makeConfig ());
+        std::map<std::uint32_t, std::shared_ptr<Ledger const>> ledgers;
+        auto const fetch = [&ledgers](std::uint32_t seq)
+        {
+            auto const iter = ledgers.find (seq);
+            return iter == ledgers.end () ? nullptr : iter->second;
+        };
+
+        Account const alice ("alice");
+        env.fund (XRP (10000), alice);
+        env (create (3, env.open ()->info ().parentCloseTime + 100000));
+        auto const start = closeLedger (env, ledgers);
+
+        std::vector<std::pair<std::uint32_t, ProposalTally::Counts>> saved;
+        ProposalTally tally (beast::Journal (),
+            [&saved](std::uint32_t proposal, ProposalTally::Counts const& c)
+            {
+                saved.emplace_back (proposal, c);
+            });
+        tally.update (start, fetch);
+
+        env (vote (alice, 1, 3));
+        closeLedger (env, ledgers);
+        env (close (1));
+        auto const closedOn = closeLedger (env, ledgers);
+        env (pay (master (), alice, XRP (10)));
+        closeLedger (env, ledgers);
+        auto const last = closeLedger (env, ledgers);
+
+        // The tally skips to the last ledger, but passes through the one
+        // the proposal closed on.
+        tally.update (last, fetch);
+        expect (tally.ledgerSeq () == last->info ().seq);
+        auto const counts = tally.counts (1, closedOn->info ().seq);
+        expect (same (counts, recount (*closedOn, 1, 3)));
+        expect (counts && counts->accounts[3] == 1);
+
+        if (expect (saved.size () == 1))
+        {
+            expect (saved[0].first == 1);
+            expect (same (saved[0].second, recount (*closedOn, 1, 3)));
+        }
+    }
+
+    void
+    testMissingLedger ()
+    {
+        testcase ("missing ledger");
+
+        using namespace jtx;
+        Env env (*this, makeConfig ());
+        std::map<std::uint32_t, std::shared_ptr<Ledger const>> ledgers;
+
+        env (create (2, env.open ()->info ().parentCloseTime + 100000));
+        auto const start = closeLedger (env, ledgers);
+        env (close (1));
+        auto const closedOn = closeLedger (env, ledgers);
+        auto const last = closeLedger (env, ledgers);
+
+        // Without the ledgers in between the closure can not be seen, but
+        // the tally still reaches the last ledger.
+        std::size_t saved = 0;
+        ProposalTally tally (beast::Journal (),
+            [&saved](std::uint32_t, ProposalTally::Counts const&)
+            {
+                ++saved;
+            });
+        tally.update (start, nullptr);
+        tally.update (last, nullptr);
+        expect (tally.ledgerSeq () == last->info ().seq);
+        expect (!tally.counts (1, closedOn->info ().seq));
+        expect (saved == 0);
+    }
+
+    void
+    testReadDuringUpdate ()
+    {
+        testcase ("read during update");
+
+        using namespace jtx;
+        Env env (*this, makeConfig ());
+        std::map<std::uint32_t, std::shared_ptr<Ledger const>> ledgers;
+
+        env (create (2, env.open ()->info ().parentCloseTime + 100000));
+        auto const start = closeLedger (env, ledgers);
+        closeLedger (env, ledgers);
+        closeLedger (env, ledgers);
+        auto const last = closeLedger (env, ledgers);
+
+        ProposalTally tally (beast::Journal (), nullptr);
+        tally.update (start, nullptr);
+
+        // Fetching runs while the next state is built, readers still see
+        // the ledger the tally was at.
+        std::size_t fetched = 0;
+        tally.update (last, [&](std::uint32_t seq)
+        {
+            ++fetched;
+            expect (tally.ledgerSeq () == start->info ().seq);
+            expect (same (tally.counts (1, start->info ().seq),
+                recount (*start, 1, 2)));
+            auto const iter = ledgers.find (seq);
+            return iter == ledgers.end () ? nullptr : iter->second;
+        });
+        expect (fetched == 2);
+        expect (tally.ledgerSeq () == last->info ().seq);
+        expect (same (tally.counts (1, last->info ().seq),
+            recount (*last, 1, 2)));
+    }
+
+    void
+    run ()
+    {
+        testCounts ();
+        testClosedBetween ();
+        testMissingLedger ();
+        testReadDuringUpdate ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(ProposalTally,app,ripple);
+
+} // test
+} // ripple
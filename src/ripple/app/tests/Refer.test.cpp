@@ -1,4 +1,6 @@
 #include <BeastConfig.h>
+#include <ripple/ledger/ApplyViewImpl.h>
+#include <ripple/ledger/View.h>
 #include <ripple/protocol/JsonFields.h>
 #include <ripple/test/jtx.h>
 
@@ -66,9 +68,166 @@ struct Refer_test : public beast::unit_test::suite
                           gw.id (), USD.currency)));
     }
 
+    void testPages ()
+    {
+        using namespace jtx;
+        auto const alice = Account ("alice");
+
+        Env env (*this);
+        env.fund (XRP (100000), alice);
+
+        // More references than fit on the root and one more page.
+        std::size_t const count = 70;
+        std::vector<Account> refs;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            refs.emplace_back ("ref" + std::to_string (i));
+            env (active (alice, refs.back (), alice, XRP (100)));
+        }
+        env (active (alice, refs.front (), alice, XRP (100)),
+             ter (tefCREATED));
+
+        auto const root = env.le (keylet::refer (alice.id ()));
+        expect (root &&
+                root->getFieldArray (sfReferences).size () == 32 &&
+                root->getFieldU64 (sfIndexPrevious) == 2);
+
+        auto const last = env.le (keylet::refer (root->key (), 2));
+        expect (last &&
+                last->getFieldArray (sfReferences).size () == count - 64 &&
+                last->getFieldH256 (sfRootIndex) == root->key () &&
+                ! last->isFieldPresent (sfIndexNext));
+
+        std::vector<AccountID> found;
+        forEachReference (*env.open (), alice.id (),
+            [&](AccountID const& id) { found.push_back (id); });
+        expect (found.size () == count);
+        for (std::size_t i = 0; i < found.size () && i < count; ++i)
+        {
+            expect (found[i] == refs[i].id ());
+            auto const sle = env.le (refs[i]);
+            expect (sle && sle->getAccountID (sfReferee) == alice.id ());
+        }
+    }
+
+    // Gives an account the dividend of a ledger, recording it on its
+    // referee's list the way Dividend does.
+    static void
+    applyDividend (ApplyView& view, AccountID const& id,
+        std::uint32_t divLedgerSeq, std::uint64_t divVSprd)
+    {
+        auto const sle = view.peek (keylet::account (id));
+        sle->setFieldU32 (sfDividendLedger, divLedgerSeq);
+        sle->setFieldU64 (sfDividendVSprd, divVSprd);
+        view.update (sle);
+        if (sle->isFieldPresent (sfReferee))
+            updateReferMaxChild (view,
+                sle->getAccountID (sfReferee), divLedgerSeq, divVSprd);
+    }
+
+    // Whether a reference is the max child, by reading every sibling
+    // the way shareFeeWithReferee did without the record.
+    static bool
+    isMaxChildByWalk (ReadView const& view, AccountID const& referee,
+        AccountID const& id, std::uint32_t divLedgerSeq)
+    {
+        auto const vSprd = view.read (
+            keylet::account (id))->getFieldU64 (sfDividendVSprd);
+        bool isMaxChild = true;
+        forEachReference (view, referee,
+            [&](AccountID const& child)
+            {
+                if (child == id)
+                    return;
+                auto const sle = view.read (keylet::account (child));
+                if (sle &&
+                    sle->isFieldPresent (sfDividendLedger) &&
+                    sle->getFieldU32 (sfDividendLedger) == divLedgerSeq &&
+                    sle->isFieldPresent (sfDividendVSprd) &&
+                    sle->getFieldU64 (sfDividendVSprd) > vSprd)
+                {
+                    isMaxChild = false;
+                }
+            });
+        return isMaxChild;
+    }
+
+    // The record and the walk agree on the max child of every reference
+    // which got the dividend.
+    void
+    expectMaxChild (ReadView const& view, AccountID const& referee,
+        std::vector<AccountID> const& refs, std::uint32_t divLedgerSeq)
+    {
+        auto const recorded = referMaxChild (view, referee, divLedgerSeq);
+        for (auto const& id : refs)
+        {
+            auto const sle = view.read (keylet::account (id));
+            if (! sle->isFieldPresent (sfDividendLedger) ||
+                sle->getFieldU32 (sfDividendLedger) != divLedgerSeq)
+                continue;
+            expect ((sle->getFieldU64 (sfDividendVSprd) >= recorded) ==
+                isMaxChildByWalk (view, referee, id, divLedgerSeq));
+        }
+    }
+
+    void testMaxChild ()
+    {
+        using namespace jtx;
+        auto const alice = Account ("alice");
+        auto const dave = Account ("dave");
+
+        Env env (*this);
+        env.fund (XRP (100000), alice, dave);
+
+        // Enough references for several pages
+        std::vector<AccountID> refs;
+        for (std::size_t i = 0; i < 70; ++i)
+        {
+            Account const ref ("ref" + std::to_string (i));
+            env (active (alice, ref, alice, XRP (100)));
+            refs.push_back (ref.id ());
+        }
+
+        ApplyViewImpl view (&*env.open (), tapENABLE_TESTING);
+        auto const j = env.app ().journal ("View");
+        expect (referMaxChild (view, alice.id (), 100) == 0);
+
+        // Each reference gets the dividend in turn, some with equal vSprd
+        std::uint64_t max = 0;
+        for (std::size_t i = 0; i < refs.size (); ++i)
+        {
+            std::uint64_t const vSprd = 1000 + (i * 7919) % 500;
+            applyDividend (view, refs[i], 100, vSprd);
+            max = std::max (max, vSprd);
+            expect (referMaxChild (view, alice.id (), 100) == max);
+            if (i % 10 == 0)
+                expectMaxChild (view, alice.id (), refs, 100);
+        }
+        expectMaxChild (view, alice.id (), refs, 100);
+
+        // A reference listed after it got the dividend brings it along
+        applyDividend (view, dave.id (), 100, max + 1);
+        expect (addRefer (view, alice.id (), dave.id (), true, j) ==
+            tesSUCCESS);
+        refs.push_back (dave.id ());
+        expect (referMaxChild (view, alice.id (), 100) == max + 1);
+        expectMaxChild (view, alice.id (), refs, 100);
+
+        // The next dividend starts over, older ones are not recorded
+        applyDividend (view, refs[3], 200, 10);
+        expect (referMaxChild (view, alice.id (), 100) == 0);
+        expect (referMaxChild (view, alice.id (), 200) == 10);
+        applyDividend (view, refs[4], 200, 5);
+        updateReferMaxChild (view, alice.id (), 100, 1000000);
+        expect (referMaxChild (view, alice.id (), 200) == 10);
+        expectMaxChild (view, alice.id (), refs, 200);
+    }
+
     void run () override
     {
         testActive ();
+        testPages ();
+        testMaxChild ();
     }
 };
 
@@ -0,0 +1,159 @@
+//------------------------------------------------------------------------------
+/*
+  This file is part of rippled: https://github.com/ripple/rippled
+  Copyright (c) 2012-2015 Ripple Labs Inc.
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose  with  or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+  MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+#include <BeastConfig.h>
+#include <ripple/app/ledger/StateDiffStream.h>
+#include <ripple/protocol/Indexes.h>
+#include <ripple/test/jtx.h>
+#include <beast/unit_test/suite.h>
+#include <algorithm>
+
+namespace ripple {
+namespace test {
+
+class StateDiffStream_test : public beast::unit_test::suite
+{
+    static
+    std::shared_ptr<Ledger const>
+    closed (jtx::Env& env)
+    {
+        return std::dynamic_pointer_cast<Ledger const> (env.closed ());
+    }
+
+    static
+    std::vector<StateDiff>
+    diff (Ledger const& before, Ledger const& after)
+    {
+        std::vector<StateDiff> diffs;
+        visitStateDiffs (before.stateMap (), after.stateMap (),
+            [&diffs](StateDiff const& d)
+            {
+                diffs.push_back (d);
+            });
+        return diffs;
+    }
+
+    static
+    StateDiff const*
+    find (std::vector<StateDiff> const& diffs, uint256 const& key)
+    {
+        for (auto const& d : diffs)
+            if (d.key == key)
+                return &d;
+        return nullptr;
+    }
+
+public:
+    void
+    testDiffs ()
+    {
+        testcase ("diffs");
+
+        using namespace jtx;
+        Env env (*this);
+        Account const alice ("alice");
+        Account const bob ("bob");
+        env.fund (XRP (10000), alice);
+        env.close ();
+        auto const first = closed (env);
+
+        env.fund (XRP (10000), bob);
+        env (pay (alice, bob, XRP (10)));
+        env.close ();
+        auto const second = closed (env);
+        if (! expect (first && second))
+            return;
+
+        auto const diffs = diff (*first, *second);
+        expect (std::is_sorted (diffs.begin (), diffs.end (),
+            [](StateDiff const& a, StateDiff const& b)
+            {
+                return a.key < b.key;
+            }));
+
+        // Bob was created and Alice changed
+        auto const created = find (diffs, keylet::account (bob.id ()).key);
+        expect (created && ! created->before && created->after);
+        auto const changed = find (diffs, keylet::account (alice.id ()).key);
+        expect (changed && changed->before && changed->after &&
+            changed->before->getFieldAmount (sfBalance) !=
+                changed->after->getFieldAmount (sfBalance));
+
+        // Going back swaps the sides
+        auto const back = diff (*second, *first);
+        expect (back.size () == diffs.size ());
+        for (std::size_t i = 0; i < std::min (back.size (), diffs.size ()); ++i)
+        {
+            expect (back[i].key == diffs[i].key);
+            expect (!back[i].before == !diffs[i].after);
+            expect (!back[i].after == !diffs[i].before);
+        }
+
+        expect (diff (*second, *second).empty ());
+    }
+
+    void
+    testStream ()
+    {
+        testcase ("stream");
+
+        using namespace jtx;
+        Env env (*this);
+        env.fund (XRP (10000), "alice");
+        env.close ();
+        auto const first = closed (env);
+        env.fund (XRP (10000), "bob");
+        env.close ();
+        auto const second = closed (env);
+        env.fund (XRP (10000), "carol");
+        env.close ();
+        auto const third = closed (env);
+
+        StateDiffStream stream {beast::Journal ()};
+        std::vector<LedgerStateDiff> seen;
+        stream.publish (first);
+
+        auto connection = stream.subscribe (
+            [&seen](LedgerStateDiff const& changes)
+            {
+                seen.push_back (changes);
+            });
+        stream.publish (second);
+        if (! expect (seen.size () == 1))
+            return;
+        expect (seen[0].before == first);
+        expect (seen[0].after == second);
+        expect (seen[0].diffs.size () == diff (*first, *second).size ());
+
+        connection.disconnect ();
+        stream.publish (third);
+        expect (seen.size () == 1);
+    }
+
+    void
+    run ()
+    {
+        testDiffs ();
+        testStream ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(StateDiffStream,app,ripple);
+
+} // test
+} // ripple
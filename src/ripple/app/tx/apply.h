@@ -27,6 +27,7 @@
 #include <beast/utility/Journal.h>
 #include <memory>
 #include <utility>
+#include <vector>
 
 namespace ripple {
 
@@ -80,6 +81,18 @@ void
 forceValidity(HashRouter& router, uint256 const& txid,
     Validity validity);
 
+/** Verifies the ring signatures of the RingWithdraw transactions in a batch.
+
+    The withdrawals are checked together against the given view and the
+    results are cached in the HashRouter, where RingWithdraw finds them
+    when the transactions are applied. Withdrawals that cannot be decoded
+    are left for the transactor.
+*/
+void
+preverifyRingWithdraws(Application& app, ReadView const& view,
+    std::vector<std::shared_ptr<STTx const>> const& txns,
+        beast::Journal j);
+
 /** Apply a transaction to a ReadView.
 
     Throws:
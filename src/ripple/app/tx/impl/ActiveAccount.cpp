@@ -1,6 +1,7 @@
 #include <BeastConfig.h>
 #include <ripple/app/tx/impl/ActiveAccount.h>
 #include <ripple/basics/Log.h>
+#include <ripple/protocol/Feature.h>
 #include <ripple/protocol/Indexes.h>
 #include <ripple/protocol/TxFlags.h>
 
@@ -346,7 +347,12 @@ ActiveAccount::doApply ()
     }
 
     if (terResult == tesSUCCESS)
-        terResult = addRefer (view (), srcAccountID, dstAccountID, ctx_.app.journal ("View"));
+    {
+        bool const paged = (view ().flags () & tapENABLE_TESTING) ||
+            view ().rules ().enabled (featureReferPages,
+                ctx_.app.config ().features);
+        terResult = addRefer (view (), srcAccountID, dstAccountID, paged, ctx_.app.journal ("View"));
+    }
 
     std::string strToken;
     std::string strHuman;
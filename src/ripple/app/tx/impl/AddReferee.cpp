@@ -1,6 +1,7 @@
 #include <BeastConfig.h>
 #include <ripple/app/tx/impl/AddReferee.h>
 #include <ripple/basics/Log.h>
+#include <ripple/protocol/Feature.h>
 #include <ripple/protocol/Indexes.h>
 #include <ripple/protocol/TxFlags.h>
 
@@ -46,7 +47,11 @@ AddReferee::doApply ()
     AccountID const refereeID (ctx_.tx.getAccountID (sfDestination));
     AccountID const referenceID (account_);
 
-    return addRefer (view (), refereeID, referenceID, ctx_.app.journal ("View"));
+    bool const paged = (view ().flags () & tapENABLE_TESTING) ||
+        view ().rules ().enabled (featureReferPages,
+            ctx_.app.config ().features);
+
+    return addRefer (view (), refereeID, referenceID, paged, ctx_.app.journal ("View"));
 }
 
 }  // ripple
@@ -3,6 +3,8 @@
 #include <ripple/app/misc/DividendMaster.h>
 #include <ripple/basics/Log.h>
 #include <ripple/core/ConfigSections.h>
+#include <ripple/ledger/View.h>
+#include <ripple/protocol/Feature.h>
 #include <ripple/protocol/Indexes.h>
 #include <ripple/protocol/TxFlags.h>
 
@@ -203,6 +205,15 @@ TER Dividend::startCalc ()
     dividendObject->setFieldU64 (sfDividendVSprd, tx.getFieldU64 (sfDividendVSprd));
     dividendObject->setFieldH256 (sfDividendMarker, uint256 (0));
     dividendObject->setFieldH256 (sfDividendHash, tx.getFieldH256 (sfDividendHash));
+
+    // Reference lists keep their max child only for dividends started
+    // with the amendment, so fee sharing never sees a partial record.
+    if ((view ().flags () & tapENABLE_TESTING) ||
+        view ().rules ().enabled (featureReferMaxChild,
+            ctx_.app.config ().features))
+        dividendObject->setFlag (lsfReferMaxChild);
+    else
+        dividendObject->clearFlag (lsfReferMaxChild);
     view ().update (dividendObject);
     
     auto& dm = ctx_.app.getDividendMaster ();
@@ -347,6 +358,15 @@ TER Dividend::applyTx ()
             {
                 std::uint64_t divVSpd = tx.getFieldU64 (sfDividendVSprd);
                 sleAccoutModified->setFieldU64 (sfDividendVSprd, divVSpd);
+
+                auto const sleDivObj = view ().read (keylet::dividend ());
+                if (sleDivObj && sleDivObj->isFlag (lsfReferMaxChild) &&
+                    sleAccoutModified->isFieldPresent (sfReferee))
+                {
+                    updateReferMaxChild (view (),
+                        sleAccoutModified->getAccountID (sfReferee),
+                        divLedgerSeq, divVSpd);
+                }
             }
 
             if (tx.isFieldPresent (sfDividendTSprd))
@@ -25,6 +25,7 @@
 #include <ripple/basics/Log.h>
 #include <ripple/protocol/Indexes.h>
 #include <ripple/crypto/AltBn128.h>
+#include <ripple/protocol/Feature.h>
 
 
 namespace ripple {
@@ -166,7 +167,9 @@ RingCancel::doApply()
     STArray publicKeys = ringSle->getFieldArray(sfPublicKeys);
     std::string msg = toBase58(dest);
     JLOG(j_.info) << "Message:" << msg;
-    if(!altbn128::ringVerify(msg, c0, keyImage, signatures, publicKeys, j_)){
+    bool const strict = view().rules().enabled(featureRingStrictPoints,
+        ctx_.app.config().features);
+    if(!altbn128::ringVerify(msg, c0, keyImage, signatures, publicKeys, strict, j_)){
         JLOG(j_.info) << "Signatures verify unsuccessful.";
         return tefBAD_SIGNATURE;
     }
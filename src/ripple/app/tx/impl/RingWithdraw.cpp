@@ -21,13 +21,164 @@
 #include <ripple/app/tx/impl/RingWithdraw.h>
 #include <ripple/app/tx/impl/RingDeposit.h>
 #include <ripple/app/main/Application.h>
+#include <ripple/app/misc/HashRouter.h>
 #include <ripple/app/misc/NetworkOPs.h>
+#include <ripple/app/tx/apply.h>
+#include <ripple/basics/UnorderedContainers.h>
 #include <ripple/protocol/Indexes.h>
 #include <ripple/crypto/AltBn128.h>
+#include <ripple/protocol/Feature.h>
+#include <mutex>
 
 
 namespace ripple {
 
+// HashRouter flags for ring signature checks. They are set on
+// sha512Half(txid, ring hash, strict) rather than on the transaction id.
+#define SF_RINGSIGBAD   SF_PRIVATE1    // Ring signature is bad
+#define SF_RINGSIGGOOD  SF_PRIVATE2    // Ring signature is good
+
+namespace {
+
+/*  Decoded public keys of closed rings, keyed by ring hash.
+
+    The ring hash commits to the keys and is only set when the ring
+    closes. Deposits and cancels only change open rings, whose hash is
+    still zero, so a cached entry never goes stale.
+*/
+class RingKeysCache
+{
+public:
+    std::shared_ptr<altbn128::RingKeys const>
+    get (SLE const& ring)
+    {
+        auto const ringHash = ring.getFieldH256 (sfRingHash);
+        {
+            std::lock_guard<std::mutex> lock (mutex_);
+            auto const iter = keys_.find (ringHash);
+            if (iter != keys_.end ())
+                return iter->second;
+        }
+
+        // Decoding throws for keys off the curve, just like ringVerify
+        auto keys = std::make_shared<altbn128::RingKeys const> (
+            ring.getFieldArray (sfPublicKeys));
+
+        std::lock_guard<std::mutex> lock (mutex_);
+        if (keys_.size () >= maxRings)
+            keys_.clear ();
+        keys_.emplace (ringHash, keys);
+        return keys;
+    }
+
+private:
+    static std::size_t const maxRings = 256;
+
+    std::mutex mutex_;
+    hash_map<uint256, std::shared_ptr<altbn128::RingKeys const>> keys_;
+};
+
+RingKeysCache&
+ringKeysCache ()
+{
+    static RingKeysCache cache;
+    return cache;
+}
+
+uint256
+ringCheckKey (STTx const& tx, uint256 const& ringHash, bool strict)
+{
+    return sha512Half (tx.getTransactionID (), ringHash,
+        static_cast<std::uint8_t> (strict));
+}
+
+// Whether signatures with a step point at infinity are rejected
+bool
+strictRingPoints (Application& app, ReadView const& view)
+{
+    return view.rules ().enabled (featureRingStrictPoints,
+        app.config ().features);
+}
+
+altbn128::RingSignature
+makeRingSignature (STTx const& tx, SLE const& ring, bool strict)
+{
+    auto const ringHash = ring.getFieldH256 (sfRingHash);
+    return altbn128::RingSignature (
+        to_string (ringHash) + toBase58 (tx.getAccountID (sfAccount)),
+        tx.getFieldH256 (sfDigest),
+        tx.getFieldV256 (sfKeyImage),
+        tx.getFieldV256 (sfSignatures),
+        ringKeysCache ().get (ring), strict);
+}
+
+// Verifies a withdrawal against a closed ring, remembering the result.
+bool
+checkRingSignature (HashRouter& router, STTx const& tx, SLE const& ring,
+    bool strict)
+{
+    auto const key = ringCheckKey (tx, ring.getFieldH256 (sfRingHash), strict);
+    auto const flags = router.getFlags (key);
+    if (flags & SF_RINGSIGBAD)
+        return false;
+    if (flags & SF_RINGSIGGOOD)
+        return true;
+
+    std::vector<altbn128::RingSignature> sigs;
+    sigs.push_back (makeRingSignature (tx, ring, strict));
+    bool const good = altbn128::ringVerifyBatch (sigs).front ();
+    router.setFlags (key, good ? SF_RINGSIGGOOD : SF_RINGSIGBAD);
+    return good;
+}
+
+}
+
+void
+preverifyRingWithdraws (Application& app, ReadView const& view,
+    std::vector<std::shared_ptr<STTx const>> const& txns,
+        beast::Journal j)
+{
+    auto& router = app.getHashRouter ();
+    bool const strict = strictRingPoints (app, view);
+
+    std::vector<altbn128::RingSignature> sigs;
+    std::vector<uint256> keys;
+    for (auto const& tx : txns)
+    {
+        if (tx->getTxnType () != ttRING_WITHDRAW)
+            continue;
+
+        try
+        {
+            auto const amount = tx->getFieldAmount (sfAmount);
+            auto const ring = view.read (keylet::ring (amount.mantissa (),
+                amount.issue (), tx->getFieldU32 (sfRingIndex)));
+            if (!ring || ring->getFieldH256 (sfRingHash).isZero ())
+                continue;
+
+            auto const key = ringCheckKey (*tx, ring->getFieldH256 (sfRingHash), strict);
+            if (router.getFlags (key) & (SF_RINGSIGGOOD | SF_RINGSIGBAD))
+                continue;
+
+            sigs.push_back (makeRingSignature (*tx, *ring, strict));
+            keys.push_back (key);
+        }
+        catch (std::exception const&)
+        {
+            // The transactor runs into the same problem and reports it
+        }
+    }
+
+    if (sigs.empty ())
+        return;
+
+    auto const results = altbn128::ringVerifyBatch (sigs);
+    for (std::size_t i = 0; i < keys.size (); ++i)
+        router.setFlags (keys[i], results[i] ? SF_RINGSIGGOOD : SF_RINGSIGBAD);
+
+    JLOG (j.debug) << "Preverified " << sigs.size () << " ring withdrawals";
+}
+
 TER
 RingWithdraw::preflight (PreflightContext const& ctx)
 {
@@ -57,9 +208,7 @@ RingWithdraw::doApply()
     AccountID dest = account_;
     STAmount amount = ctx_.tx.getFieldAmount(sfAmount);
     uint32_t ringIndex = ctx_.tx.getFieldU32(sfRingIndex);
-    uint256 c0 = ctx_.tx.getFieldH256(sfDigest);
     STVector256 keyImage = ctx_.tx.getFieldV256(sfKeyImage);
-    STVector256 signatures = ctx_.tx.getFieldV256(sfSignatures);
 
     auto ringSle = view().peek(keylet::ring(amount.mantissa(), amount.issue(), ringIndex));
 
@@ -93,10 +242,9 @@ RingWithdraw::doApply()
     if (std::find(accounts.begin(), accounts.end(), acctHash)!=accounts.end())
         return tefRING_REDUNDANT;
     
-    STArray publicKeys = ringSle->getFieldArray(sfPublicKeys);
-    std::string msg = to_string(ringHash) + toBase58(dest);
-    JLOG(j_.info) << "Message:" << msg;
-    if(!altbn128::ringVerify(msg, c0, keyImage, signatures, publicKeys, j_))
+    JLOG(j_.info) << "Message:" << to_string(ringHash) + toBase58(dest);
+    if(!checkRingSignature(ctx_.app.getHashRouter(), ctx_.tx, *ringSle,
+        strictRingPoints(ctx_.app, view())))
     {
         JLOG(j_.info) << "Signatures verify unsuccessful.";
         return tefBAD_SIGNATURE;
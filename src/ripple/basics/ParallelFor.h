@@ -0,0 +1,233 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2016 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_BASICS_PARALLELFOR_H_INCLUDED
+#define RIPPLE_BASICS_PARALLELFOR_H_INCLUDED
+
+#include <beast/module/core/thread/Workers.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ripple {
+
+/** Number of threads to use for CPU bound parallel work. */
+inline
+std::size_t
+parallelThreads ()
+{
+    return std::max<std::size_t> (1, std::thread::hardware_concurrency ());
+}
+
+/** Call f(i) for every i in [0, n) using up to `threads` threads.
+
+    The calling thread takes part in the work and indices are handed out
+    one at a time, so f may be called concurrently and in any order. The
+    first exception thrown by f is rethrown once every worker is done.
+*/
+template <class Function>
+void
+parallel_for (std::size_t n, std::size_t threads, Function&& f)
+{
+    threads = std::min (threads, n);
+    if (threads <= 1)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            f (i);
+        return;
+    }
+
+    std::atomic<std::size_t> next (0);
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    auto work = [&]()
+    {
+        try
+        {
+            for (auto i = next++; i < n; i = next++)
+                f (i);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock (errorMutex);
+            if (!error)
+                error = std::current_exception ();
+            // Let the other workers run out of indices.
+            next = n;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve (threads - 1);
+    for (std::size_t i = 1; i < threads; ++i)
+        workers.emplace_back (work);
+    work ();
+    for (auto& worker : workers)
+        worker.join ();
+
+    if (error)
+        std::rethrow_exception (error);
+}
+
+/** Threads kept to run parallel_for on.
+
+    Starting threads costs more than a short parallel section saves, so
+    work on hot paths, like flushing a ledger, runs on threads which
+    outlive the call. The calling thread takes part as well, so a pool
+    of n threads runs a section on up to n + 1.
+*/
+class ParallelPool
+    : private beast::Workers::Callback
+{
+public:
+    explicit
+    ParallelPool (std::size_t threads,
+            std::string const& name = "Parallel")
+        : threads_ (threads)
+        , workers_ (*this, name, static_cast<int> (threads))
+    {
+    }
+
+    /** Returns the most threads a section runs on, the caller included. */
+    std::size_t
+    size () const
+    {
+        return threads_ + 1;
+    }
+
+    /** Call f(i) for every i in [0, n) using up to `threads` threads.
+
+        Behaves as the free parallel_for. Helpers which are only picked
+        up once every index is taken return without calling f.
+    */
+    template <class Function>
+    void
+    parallel_for (std::size_t n, std::size_t threads, Function&& f)
+    {
+        threads = std::min ({threads, size (), n});
+        if (threads <= 1)
+        {
+            for (std::size_t i = 0; i < n; ++i)
+                f (i);
+            return;
+        }
+
+        auto const section = std::make_shared<Section> (n,
+            [&f](std::size_t i) { f (i); });
+        {
+            std::lock_guard<std::mutex> lock (mutex_);
+            for (std::size_t i = 1; i < threads; ++i)
+            {
+                tasks_.emplace_back ([section]()
+                {
+                    {
+                        std::lock_guard<std::mutex> lock (section->mutex);
+                        // f may be gone once the caller is done
+                        if (section->done)
+                            return;
+                        ++section->active;
+                    }
+                    section->work ();
+                    std::lock_guard<std::mutex> lock (section->mutex);
+                    if (--section->active == 0)
+                        section->cond.notify_all ();
+                });
+            }
+        }
+        for (std::size_t i = 1; i < threads; ++i)
+            workers_.addTask ();
+
+        section->work ();
+
+        std::unique_lock<std::mutex> lock (section->mutex);
+        section->done = true;
+        section->cond.wait (lock, [&]{ return section->active == 0; });
+        if (section->error)
+            std::rethrow_exception (section->error);
+    }
+
+private:
+    struct Section
+    {
+        std::size_t const n;
+        std::function<void (std::size_t)> const f;
+        std::atomic<std::size_t> next {0};
+        std::mutex mutex;
+        std::condition_variable cond;
+        bool done = false;
+        int active = 0;
+        std::exception_ptr error;
+
+        Section (std::size_t n_, std::function<void (std::size_t)> f_)
+            : n (n_)
+            , f (std::move (f_))
+        {
+        }
+
+        void
+        work ()
+        {
+            try
+            {
+                for (auto i = next++; i < n; i = next++)
+                    f (i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock (mutex);
+                if (!error)
+                    error = std::current_exception ();
+                // Let the other workers run out of indices.
+                next = n;
+            }
+        }
+    };
+
+    void
+    processTask () override
+    {
+        std::function<void ()> task;
+        {
+            std::lock_guard<std::mutex> lock (mutex_);
+            task = std::move (tasks_.front ());
+            tasks_.pop_front ();
+        }
+        task ();
+    }
+
+    std::size_t const threads_;
+    std::mutex mutex_;
+    std::deque<std::function<void ()>> tasks_;
+    // Last, so its threads stop before the tasks go away
+    beast::Workers workers_;
+};
+
+} // ripple
+
+#endif
@@ -0,0 +1,137 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/basics/ParallelFor.h>
+#include <beast/unit_test/suite.h>
+#include <stdexcept>
+
+namespace ripple {
+
+class ParallelFor_test : public beast::unit_test::suite
+{
+    // Returns whether every index is visited exactly once
+    template <class ParallelFor>
+    static
+    bool
+    visitsOnce (ParallelFor&& parallelFor, std::size_t n)
+    {
+        std::vector<std::atomic<int>> visits (n);
+        for (auto& v : visits)
+            v = 0;
+        parallelFor (n, [&](std::size_t i) { ++visits[i]; });
+        bool once = true;
+        for (auto const& v : visits)
+            once = once && v == 1;
+        return once;
+    }
+
+    template <class ParallelFor>
+    void
+    testThrow (ParallelFor&& parallelFor)
+    {
+        std::atomic<int> calls (0);
+        try
+        {
+            parallelFor (1000, [&](std::size_t i)
+            {
+                ++calls;
+                if (i == 10)
+                    throw std::runtime_error ("index 10");
+            });
+            fail ("no exception");
+        }
+        catch (std::runtime_error const& e)
+        {
+            expect (std::string (e.what ()) == "index 10");
+        }
+        expect (calls < 1000, "stopped early");
+    }
+
+public:
+    void
+    testFree ()
+    {
+        testcase ("parallel_for");
+
+        auto const parallelFor = [](std::size_t n, auto&& f)
+        {
+            parallel_for (n, 4, f);
+        };
+        for (std::size_t n : {0, 1, 3, 1000})
+            expect (visitsOnce (parallelFor, n), "every index once");
+        testThrow (parallelFor);
+    }
+
+    void
+    testPool ()
+    {
+        testcase ("ParallelPool");
+
+        ParallelPool pool (3, "ParallelFor_test");
+        expect (pool.size () == 4);
+
+        // More threads than the pool has are clamped
+        auto const parallelFor = [&pool](std::size_t n, auto&& f)
+        {
+            pool.parallel_for (n, 16, f);
+        };
+        for (std::size_t n : {0, 1, 3, 1000})
+            expect (visitsOnce (parallelFor, n), "every index once");
+        testThrow (parallelFor);
+
+        // The threads are reused by many short sections
+        bool reused = true;
+        for (int i = 0; i < 1000; ++i)
+            reused = visitsOnce (parallelFor, 8) && reused;
+        expect (reused, "every index once when reused");
+
+        // Sections from several threads at once share the pool
+        std::atomic<bool> shared (true);
+        std::vector<std::thread> callers;
+        for (int i = 0; i < 4; ++i)
+            callers.emplace_back ([&]()
+            {
+                for (int j = 0; j < 100; ++j)
+                    if (! visitsOnce (parallelFor, 64))
+                        shared = false;
+            });
+        for (auto& caller : callers)
+            caller.join ();
+        expect (shared.load (), "every index once when shared");
+
+        ParallelPool none (0);
+        expect (none.size () == 1);
+        expect (visitsOnce ([&none](std::size_t n, auto&& f)
+            {
+                none.parallel_for (n, 4, f);
+            }, 100), "every index once without threads");
+    }
+
+    void
+    run ()
+    {
+        testFree ();
+        testPool ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(ParallelFor,basics,ripple);
+
+}
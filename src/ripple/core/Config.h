@@ -249,6 +249,7 @@ public:
     // Node storage configuration
     std::uint32_t                      LEDGER_HISTORY = 256;
     std::uint32_t                      FETCH_DEPTH = 1000000000;
+    std::size_t                        FLUSH_THRESHOLD = 4096;         // Modified nodes to flush a map on several threads, 0 never
     int                         NODE_SIZE = 0;
 
     bool                        SSL_VERIFY = true;
@@ -58,7 +58,9 @@ enum JobType
     jtWRITE,         // Write out hashed objects
     jtACCEPT,        // Accept a consensus ledger
     jtPROPOSAL_t,    // A proposal from a trusted source
+    jtDIVIDEND_IDX,  // Maintain dividend account index
     jtDIVIDEND,      // Process dividend
+    jtPROPOSAL_TALLY,// Maintain proposal vote tally
     jtSWEEP,         // Sweep for stale structures
     jtNETOP_CLUSTER, // NetworkOPs cluster peer report
     jtNETOP_TIMER,   // NetworkOPs net timer processing
@@ -126,10 +126,18 @@ public:
         add (jtPROPOSAL_t,    "trustedProposal",
             maxLimit, false,  false, 100,   500);
         
+        // Maintain dividend account index
+        add (jtDIVIDEND_IDX,  "dividendIndex",
+            1,        false,  false, 0,     0);
+
         // Process dividend
         add (jtDIVIDEND,      "dividend",
             1,        false,  false, 0,     0);
 
+        // Maintain proposal vote tally
+        add (jtPROPOSAL_TALLY, "proposalTally",
+            1,        false,  false, 0,     0);
+
         // Sweep for stale structures
         add (jtSWEEP,         "sweep",
             maxLimit, true,   false, 0,     0);
@@ -480,6 +480,9 @@ void Config::loadFromString (std::string const& fileContents)
             FETCH_DEPTH = 10;
     }
 
+    if (getSingleSection (secConfig, SECTION_FLUSH_THRESHOLD, strTemp, j_))
+        FLUSH_THRESHOLD     = beast::lexicalCastThrow <std::size_t> (strTemp);
+
     if (getSingleSection (secConfig, SECTION_PATH_SEARCH_OLD, strTemp, j_))
         PATH_SEARCH_OLD     = beast::lexicalCastThrow <int> (strTemp);
     if (getSingleSection (secConfig, SECTION_PATH_SEARCH, strTemp, j_))
@@ -5,10 +5,13 @@
 #include <beast/utility/Journal.h>
 #include <ripple/basics/base_uint.h>
 #include <ripple/basics/Log.h>
+#include <ripple/crypto/impl/Bn254.h>
 #include <ripple/crypto/impl/openssl.h>
 #include <ripple/protocol/digest.h>
 #include <ripple/protocol/STArray.h>
 #include <ripple/protocol/STVector256.h>
+#include <memory>
+#include <vector>
 
 namespace ripple
 {
@@ -58,10 +61,60 @@ std::tuple<uint256, std::vector<uint256>, STVector256> ringSign(
     int index,
     uint256 privateKey);
 
+/*
+   rejectInfinity fails signatures with a step point at infinity. Without
+   it such a point is hashed as an empty encoding, as the OpenSSL based
+   verifier did.
+*/
 bool
 ringVerify(std::string msg,
     uint256 c0, STVector256 keyImage,
-    STVector256 sig, STArray publicKeys, beast::Journal j);
+    STVector256 sig, STArray publicKeys,
+    bool rejectInfinity, beast::Journal j);
+
+/*
+   A ring's public keys decoded for verification. Decoding checks every key
+   is on the curve (throws otherwise) and derives the hash point h that all
+   signatures over the ring share, so a ring can be decoded once and reused.
+*/
+struct RingKeys
+{
+    explicit RingKeys(STArray const& publicKeys);
+
+    std::vector<native::G1> points;
+    native::G1 h;
+    // "0x" followed by the lower case hex of the keys
+    std::string hex;
+};
+
+/*
+   A ring signature decoded for verification. Throws if the key image is
+   not on the curve.
+*/
+struct RingSignature
+{
+    RingSignature(std::string const& message, uint256 const& c0,
+        STVector256 const& keyImage, STVector256 const& sig,
+        std::shared_ptr<RingKeys const> keys, bool rejectInfinity);
+
+    uint256 c0;
+    std::vector<uint256> sig;
+    native::G1 image;
+    // The hash input shared by every step: keys, key image and message
+    std::string prefix;
+    std::shared_ptr<RingKeys const> keys;
+    bool wellFormed;
+    // See ringVerify
+    bool rejectInfinity;
+};
+
+/*
+   Verifies several ring signatures together. Each step of a ring signature
+   hashes the points of the previous one, so the signatures are walked in
+   lockstep and the points of a step share a single field inversion.
+*/
+std::vector<bool>
+ringVerifyBatch(std::vector<RingSignature> const& sigs);
 
 } // altbn128
 } // ripple
@@ -1,4 +1,5 @@
 #include <ripple/crypto/AltBn128.h>
+#include <ripple/crypto/impl/Bn254.h>
 #include <ripple/protocol/Serializer.h>
 
 namespace ripple{
@@ -88,24 +89,9 @@ void evalCurve(bignum const& x, bignum& y, bignum& beta, bn_ctx& ctx){
 }
 
 ec_point scalarToPoint(uint256 x_){
-    bignum x(x_), y, beta;
-    bn_ctx ctx;
-    BN_mod(x.get(), x.get(), N.get(), ctx.get());
-
-    while (true) {
-        evalCurve(x, y, beta, ctx);
-
-        if (onCurveBeta(beta, y, ctx)) {
-            bignum tmp;
-            BN_sqr(tmp.get(), x.get(), ctx.get());
-            BN_mod_add(tmp.get(), tmp.get(), bnZero.get(), P.get(), ctx.get());
-            BN_mul(tmp.get(), tmp.get(), x.get(), ctx.get());
-            BN_mod_add(tmp.get(), tmp.get(), bnThree.get(), P.get(), ctx.get());
-            return set_coordinates(altbn128::group(), x, y);
-        }
-
-        BN_mod_add(x.get(), x.get(), bnOne.get(), N.get(), ctx.get());
-    }
+    uint256 x, y;
+    native::scalarToPoint(x_, x, y);
+    return set_coordinates(altbn128::group(), bignum(x), bignum(y));
 }
 
 uint256
@@ -358,134 +344,167 @@ std::tuple<uint256, std::vector<uint256>, STVector256> ringSign(
     return std::move(std::make_tuple(c0, s, yTilde));
 }
 
-bool
-ringVerify(std::string msg,
-    uint256 c0, STVector256 keyImage,
-    STVector256 sig, STArray publicKeys, beast::Journal j)
+// Appends the lower case hex form of the bytes
+static
+void
+appendHex(std::string& s, void const* data, std::size_t size)
 {
+    static char const digits[] = "0123456789abcdef";
+    auto const p = static_cast<std::uint8_t const*>(data);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        s.push_back(digits[p[i] >> 4]);
+        s.push_back(digits[p[i] & 0xf]);
+    }
+}
+
+static
+void
+appendHex(std::string& s, uint256 const& x)
+{
+    appendHex(s, x.data(), x.size());
+}
 
-    using namespace openssl;
-    bignum bn_c0(c0);
-    bignum bn_c(c0);
-    std::string hexPrefix = "0x";
-    //step 1
+// Points are rejected the same way set_coordinates rejects them
+static
+native::G1
+toPoint(uint256 const& x, uint256 const& y)
+{
+    native::G1 pt;
+    if (!native::G1::fromAffine(x, y, pt))
+        Throw<std::runtime_error> ("ringVerify: point is not on curve");
+    return pt;
+}
+
+RingKeys::RingKeys(STArray const& publicKeys)
+{
     Serializer s;
-    for(auto const pk : publicKeys){
-        STVector256 keyPair = pk.getFieldV256(sfPublicKeyPair);
+    points.reserve(publicKeys.size());
+    for(auto const& pk : publicKeys){
+        STVector256 const& keyPair = pk.getFieldV256(sfPublicKeyPair);
         s.add256(keyPair[0]);
         s.add256(keyPair[1]);
+        points.push_back(toPoint(keyPair[0], keyPair[1]));
     }
-    std::string str_pks = hexPrefix + s.getHex();
-    uint256 h = sha256_s(str_pks);
-    JLOG(j.debug) << "str_pks:" << str_pks;
-    JLOG(j.debug) << "sha256(pks):" << h;
-    
-    //mod n
-    ec_point pt_h = scalarToPoint(h);
-    bignum hx,hy;
-    bn_ctx bc;
-    EC_POINT_get_affine_coordinates_GFp(altbn128::group(), pt_h.get(), hx.get(), hy.get(), bc.get());
-
-    char *ch1 = BN_bn2hex(hx.get());
-    char *ch2 = BN_bn2hex(hy.get());
-    JLOG(j.debug) << "hx:" << ch1 << ",hy:" << ch2;
-    OPENSSL_free(ch1);
-    OPENSSL_free(ch2);
-    // step 2
-    char* z1, *z2;
-    Serializer s2;
-    for(auto const pk : publicKeys){
-        STVector256 keyPair = pk.getFieldV256(sfPublicKeyPair);
-        s2.add256(keyPair[0]);
-        s2.add256(keyPair[1]);
+
+    // h = h2(sha256(pks)), hashed over the upper case hex as ringSign does
+    uint256 hx, hy;
+    native::scalarToPoint(sha256_s("0x" + s.getHex()), hx, hy);
+    h = toPoint(hx, hy);
+
+    hex.reserve(2 + 2 * s.size());
+    hex = "0x";
+    appendHex(hex, s.data(), s.size());
+}
+
+RingSignature::RingSignature(std::string const& message, uint256 const& c0_,
+    STVector256 const& keyImage, STVector256 const& sig_,
+    std::shared_ptr<RingKeys const> keys_, bool rejectInfinity_)
+    : c0(c0_)
+    , sig(sig_.begin(), sig_.end())
+    , keys(std::move(keys_))
+    , wellFormed(false)
+    , rejectInfinity(rejectInfinity_)
+{
+    if (keys->points.empty() || sig.size() < keys->points.size() ||
+            keyImage.size() < 2)
+        return;
+
+    image = toPoint(keyImage[0], keyImage[1]);
+
+    prefix.reserve(keys->hex.size() + 128 + 2 * message.size());
+    prefix = keys->hex;
+    appendHex(prefix, keyImage[0]);
+    appendHex(prefix, keyImage[1]);
+    appendHex(prefix, message.data(), message.size());
+    wellFormed = true;
+}
+
+std::vector<bool>
+ringVerifyBatch(std::vector<RingSignature> const& sigs)
+{
+    using native::G1;
+
+    //   c[i+1] = h1(pks, keyImage, msg, z1, z2) where
+    //   z1 = G * s[i] + pk[i] * c[i] and z2 = h * s[i] + keyImage * c[i].
+    // The hash input is the lower case hex of everything, points included.
+    std::vector<uint256> c(sigs.size());
+    std::vector<bool> active(sigs.size());
+    std::size_t steps = 0;
+    for (std::size_t k = 0; k < sigs.size(); ++k)
+    {
+        c[k] = sigs[k].c0;
+        active[k] = sigs[k].wellFormed;
+        if (active[k])
+            steps = std::max(steps, sigs[k].keys->points.size());
     }
-    s2.add256(keyImage[0]);
-    s2.add256(keyImage[1]);
-    s2.addRaw(msg.data(), msg.size());
-    for(int i=0; i<publicKeys.size(); i++){
-        bignum bn_sig(sig[i]);
-        uint256 pkx = publicKeys[i].getFieldV256(sfPublicKeyPair)[0];
-        uint256 pky = publicKeys[i].getFieldV256(sfPublicKeyPair)[1];
-        ec_point pt_pk = set_coordinates(altbn128::group(), bignum(pkx), bignum(pky));
-        // TODOcheck point on curve
-        ec_point m1 = multiply(altbn128::group(), bn_sig, bc); // G * s
-char *char_m1 = EC_POINT_point2hex(altbn128::group(), m1.get(), (point_conversion_form_t)4, bc.get());
-JLOG(j.debug) << "m1=G * sig[i] result:" << char_m1;
-OPENSSL_free(char_m1);
-
-        ec_point m2 = multiply2(altbn128::group(), pt_pk, bn_c, bc); // pk * c
-char *char_pk = EC_POINT_point2hex(altbn128::group(), pt_pk.get(), (point_conversion_form_t)4, bc.get());
-JLOG(j.debug) << "pk:" << char_pk;
-OPENSSL_free(char_pk);
-ch1 = BN_bn2hex(bn_c.get());
-JLOG(j.debug) << "c:" << ch1;
-OPENSSL_free(ch1);
-char *char_m2 = EC_POINT_point2hex(altbn128::group(), m2.get(), (point_conversion_form_t)4, bc.get());
-JLOG(j.debug) << "m2=pk * c result:" << char_m2;
-OPENSSL_free(char_m2);
-
-        ec_point p1 = add(altbn128::group(), m1, m2, bc);
-        char *char_p1 = EC_POINT_point2hex(altbn128::group(), p1.get(), (point_conversion_form_t)4, bc.get());
-JLOG(j.debug) << "p1=m1 + m2 result:" << char_p1;
-//OPENSSL_free(char_p1);
-
-        ec_point m3 = multiply2(altbn128::group(), pt_h, bn_sig, bc); // h * s
-char *char_m3 = EC_POINT_point2hex(altbn128::group(), m3.get(), (point_conversion_form_t)4, bc.get());
-JLOG(j.debug) << "m3=h * sig result:" << char_m3;
-OPENSSL_free(char_m3);
-
-        //conver img to point
-        ec_point pt_img = set_coordinates(altbn128::group(), bignum(keyImage[0]), bignum(keyImage[1]));
-        ec_point m4 = multiply2(altbn128::group(), pt_img, bn_c, bc); // key * c
-char *char_m4 = EC_POINT_point2hex(altbn128::group(), m4.get(), (point_conversion_form_t)4, bc.get());
-JLOG(j.debug) << "m4=keyimg * c result:" << char_m4;
-OPENSSL_free(char_m4);
-
-        ec_point p2 = add(altbn128::group(), m3, m4, bc);
-        char *char_p2 = EC_POINT_point2hex(altbn128::group(), p2.get(), (point_conversion_form_t)4, bc.get());
-JLOG(j.debug) << "p2=m3 + m4 result:" << char_p2;
-//OPENSSL_free(char_p2);
-        // char ?
-        z1 = char_p1+2; //jump compress type
-        z2 = char_p2+2;
-
-        if(i < publicKeys.size() -1){
-            Serializer s3;
-            s3.addRaw(z1, strlen(z1));
-            s3.addRaw(z2, strlen(z2));
-            sha256_hasher hasher2;
-            std::string str_s3 = hexPrefix + s2.getHex() + s3.getString();
-            boost::to_lower(str_s3);
-            uint256 u256_hash_ret = sha256_s(str_s3);
-    JLOG(j.debug) << "str_s2:" << s2.getHex();
-    JLOG(j.debug) << "str_s3:" << str_s3;
-    JLOG(j.debug) << "sha256(s3):" << u256_hash_ret;
-
-            //mod
-            bignum bn_hash(u256_hash_ret);
-            BN_mod(bn_c.get(), bn_hash.get(), N.get(), bc.get());
-    ch1 = BN_bn2hex(bn_c.get());
-    JLOG(j.debug) << "c:" << ch1;
-    OPENSSL_free(ch1);
+
+    std::vector<G1> points;
+    std::vector<std::size_t> owners;
+    std::vector<uint256> xs, ys;
+    std::string buf;
+    for (std::size_t i = 0; i < steps; ++i)
+    {
+        points.clear();
+        owners.clear();
+        for (std::size_t k = 0; k < sigs.size(); ++k)
+        {
+            auto const& rs = sigs[k];
+            if (!active[k] || i >= rs.keys->points.size())
+                continue;
+            points.push_back(G1::mulGenerator(rs.sig[i]) +
+                rs.keys->points[i] * c[k]);
+            points.push_back(G1::mulAdd(rs.keys->h, rs.sig[i], rs.image, c[k]));
+            owners.push_back(k);
+        }
+
+        G1::toAffine(points, xs, ys);
+
+        for (std::size_t j = 0; j < owners.size(); ++j)
+        {
+            auto const k = owners[j];
+            bool const inf1 = points[2 * j].isInfinity();
+            bool const inf2 = points[2 * j + 1].isInfinity();
+            if ((inf1 || inf2) && sigs[k].rejectInfinity)
+            {
+                active[k] = false;
+                continue;
+            }
+            // OpenSSL encoded a point at infinity as "00", of which the
+            // verifier hashed nothing after skipping the form prefix.
+            buf = sigs[k].prefix;
+            if (!inf1)
+            {
+                appendHex(buf, xs[2 * j]);
+                appendHex(buf, ys[2 * j]);
+            }
+            if (!inf2)
+            {
+                appendHex(buf, xs[2 * j + 1]);
+                appendHex(buf, ys[2 * j + 1]);
+            }
+            c[k] = native::reduceScalar(sha256_s(buf));
         }
     }
-    if(z1 == nullptr || z2 == nullptr){
-        return false;
-    }
-    Serializer s4;
-    s4.addRaw(z1, strlen(z1));
-    s4.addRaw(z2, strlen(z2));
-    std::string str_s4 = hexPrefix + s2.getHex() + s4.getString();
-    boost::to_lower(str_s4);
-    uint256 u256_c = sha256_s(str_s4);
-    //mod
-    bignum bn_hash_2(u256_c);
-    BN_mod(bn_c.get(), bn_hash_2.get(), N.get(), bc.get());
-
-    char* ch_c = BN_bn2hex(bn_c.get());
-    JLOG(j.debug) << "c0:" << c0 << ",verify:" << ch_c;
-    OPENSSL_free(ch_c);
-    return BN_cmp(bn_c0.get(), bn_c.get()) == 0;
+
+    std::vector<bool> result(sigs.size());
+    for (std::size_t k = 0; k < sigs.size(); ++k)
+        result[k] = active[k] && c[k] == sigs[k].c0;
+    return result;
+}
+
+bool
+ringVerify(std::string msg,
+    uint256 c0, STVector256 keyImage,
+    STVector256 sig, STArray publicKeys,
+    bool rejectInfinity, beast::Journal j)
+{
+    std::vector<RingSignature> sigs;
+    sigs.emplace_back(msg, c0, keyImage, sig,
+        std::make_shared<RingKeys const>(publicKeys), rejectInfinity);
+    bool const result = ringVerifyBatch(sigs).front();
+    JLOG(j.debug) << "c0:" << c0 << ",verify:" << result;
+    return result;
 }
 
 } //openssl
@@ -0,0 +1,665 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/crypto/impl/Bn254.h>
+
+namespace ripple {
+namespace altbn128 {
+namespace native {
+
+namespace {
+
+using limbs = Fp::limbs_type;
+
+// All constants are little endian 64-bit limbs.
+
+// Field order P
+limbs const fieldP {{
+    0x3c208c16d87cfd47, 0x97816a916871ca8d,
+    0xb85045b68181585d, 0x30644e72e131a029 }};
+
+// Group order N
+limbs const groupN {{
+    0x43e1f593f0000001, 0x2833e84879b97091,
+    0xb85045b68181585d, 0x30644e72e131a029 }};
+
+// R mod P, with R = 2^256; this is 1 in Montgomery form
+limbs const montOne {{
+    0xd35d438dc58f0d9d, 0x0a78eb28f5c70b3d,
+    0x666ea36f7879462c, 0x0e0a77c19a07df2f }};
+
+// R^2 mod P
+limbs const montR2 {{
+    0xf32cfc5b538afa89, 0xb5e71911d44501fb,
+    0x47ab1eff0a417ff6, 0x06d89f71cab8351f }};
+
+// -P^-1 mod 2^64
+std::uint64_t const montInv = 0x87d20782e4866389;
+
+// (P + 1) / 4, since P = 3 mod 4 this gives square roots
+limbs const sqrtExp {{
+    0x4f082305b61f3f52, 0x65e05aa45a1c72a3,
+    0x6e14116da0605617, 0x0c19139cb84c680a }};
+
+// P - 2, for inversion by Fermat's little theorem
+limbs const invExp {{
+    0x3c208c16d87cfd45, 0x97816a916871ca8d,
+    0xb85045b68181585d, 0x30644e72e131a029 }};
+
+// Returns a + b + carry, leaving the carry out in carry
+inline
+std::uint64_t
+addc (std::uint64_t a, std::uint64_t b, std::uint64_t& carry)
+{
+    std::uint64_t const t = a + carry;
+    std::uint64_t c = t < carry;
+    std::uint64_t const r = t + b;
+    c += r < b;
+    carry = c;
+    return r;
+}
+
+// Returns a - b - borrow, leaving the borrow out in borrow
+inline
+std::uint64_t
+subb (std::uint64_t a, std::uint64_t b, std::uint64_t& borrow)
+{
+    std::uint64_t const t = a - b;
+    std::uint64_t c = a < b;
+    std::uint64_t const r = t - borrow;
+    c += t < borrow;
+    borrow = c;
+    return r;
+}
+
+// Returns the low word of a + b * c + carry, leaving the high word in carry
+inline
+std::uint64_t
+mac (std::uint64_t a, std::uint64_t b, std::uint64_t c, std::uint64_t& carry)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 const t =
+        static_cast<unsigned __int128> (b) * c + a + carry;
+    carry = static_cast<std::uint64_t> (t >> 64);
+    return static_cast<std::uint64_t> (t);
+#else
+    std::uint64_t const bl = b & 0xffffffff;
+    std::uint64_t const bh = b >> 32;
+    std::uint64_t const cl = c & 0xffffffff;
+    std::uint64_t const ch = c >> 32;
+    std::uint64_t const ll = bl * cl;
+    std::uint64_t const lh = bl * ch;
+    std::uint64_t const hl = bh * cl;
+    std::uint64_t const mid =
+        (ll >> 32) + (lh & 0xffffffff) + (hl & 0xffffffff);
+    std::uint64_t lo = (ll & 0xffffffff) | (mid << 32);
+    std::uint64_t hi = bh * ch + (lh >> 32) + (hl >> 32) + (mid >> 32);
+    lo += a;
+    hi += lo < a;
+    lo += carry;
+    hi += lo < carry;
+    carry = hi;
+    return lo;
+#endif
+}
+
+inline
+bool
+geq (limbs const& a, limbs const& b)
+{
+    for (int i = 3; i >= 0; --i)
+    {
+        if (a[i] != b[i])
+            return a[i] > b[i];
+    }
+    return true;
+}
+
+// Returns a - b and whether it borrowed
+inline
+limbs
+sub (limbs const& a, limbs const& b, std::uint64_t& borrow)
+{
+    limbs r;
+    borrow = 0;
+    for (int i = 0; i < 4; ++i)
+        r[i] = subb (a[i], b[i], borrow);
+    return r;
+}
+
+inline
+limbs
+sub (limbs const& a, limbs const& b)
+{
+    std::uint64_t borrow;
+    return sub (a, b, borrow);
+}
+
+// Reduces any 256-bit value, at most a handful of subtractions
+inline
+limbs
+reduce (limbs x, limbs const& m)
+{
+    while (geq (x, m))
+        x = sub (x, m);
+    return x;
+}
+
+limbs
+toLimbs (uint256 const& x)
+{
+    limbs r;
+    auto const p = x.data ();
+    for (int i = 0; i < 4; ++i)
+    {
+        std::uint64_t v = 0;
+        for (int j = 0; j < 8; ++j)
+            v = (v << 8) | p[(3 - i) * 8 + j];
+        r[i] = v;
+    }
+    return r;
+}
+
+uint256
+fromLimbs (limbs const& x)
+{
+    uint256 r;
+    auto const p = r.data ();
+    for (int i = 0; i < 4; ++i)
+    {
+        std::uint64_t v = x[i];
+        for (int j = 7; j >= 0; --j)
+        {
+            p[(3 - i) * 8 + j] = static_cast<std::uint8_t> (v);
+            v >>= 8;
+        }
+    }
+    return r;
+}
+
+// Four bit window w of a little endian scalar
+inline
+int
+nibble (limbs const& k, int w)
+{
+    return static_cast<int> ((k[w / 16] >> (4 * (w % 16))) & 0xf);
+}
+
+} // (anon)
+
+//------------------------------------------------------------------------------
+
+Fp
+Fp::fromUint256 (uint256 const& x)
+{
+    return Fp (reduce (toLimbs (x), fieldP)) * Fp (montR2);
+}
+
+Fp const&
+Fp::one ()
+{
+    static Fp const v (montOne);
+    return v;
+}
+
+uint256
+Fp::toUint256 () const
+{
+    // Multiplying by a plain 1 leaves Montgomery form
+    return fromLimbs ((*this * Fp (limbs {{ 1, 0, 0, 0 }})).v_);
+}
+
+bool
+Fp::isZero () const
+{
+    return (v_[0] | v_[1] | v_[2] | v_[3]) == 0;
+}
+
+Fp
+Fp::squared () const
+{
+    return *this * *this;
+}
+
+Fp
+Fp::pow (limbs_type const& e) const
+{
+    Fp r = one ();
+    for (int i = 255; i >= 0; --i)
+    {
+        r = r.squared ();
+        if ((e[i / 64] >> (i % 64)) & 1)
+            r = r * *this;
+    }
+    return r;
+}
+
+Fp
+Fp::inverse () const
+{
+    return pow (invExp);
+}
+
+Fp
+operator+ (Fp const& a, Fp const& b)
+{
+    // Both are below P < 2^254, so the sum cannot carry out
+    limbs r;
+    std::uint64_t carry = 0;
+    for (int i = 0; i < 4; ++i)
+        r[i] = addc (a.v_[i], b.v_[i], carry);
+    if (geq (r, fieldP))
+        r = sub (r, fieldP);
+    return Fp (r);
+}
+
+Fp
+operator- (Fp const& a, Fp const& b)
+{
+    std::uint64_t borrow;
+    limbs r = sub (a.v_, b.v_, borrow);
+    if (borrow)
+    {
+        std::uint64_t carry = 0;
+        for (int i = 0; i < 4; ++i)
+            r[i] = addc (r[i], fieldP[i], carry);
+    }
+    return Fp (r);
+}
+
+Fp
+operator* (Fp const& a, Fp const& b)
+{
+    // Coarsely integrated operand scanning Montgomery multiplication
+    limbs t {{ 0, 0, 0, 0 }};
+    std::uint64_t t4 = 0;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        std::uint64_t carry = 0;
+        for (int j = 0; j < 4; ++j)
+            t[j] = mac (t[j], a.v_[j], b.v_[i], carry);
+        std::uint64_t t5 = 0;
+        t4 = addc (t4, carry, t5);
+
+        std::uint64_t const m = t[0] * montInv;
+        carry = 0;
+        mac (t[0], m, fieldP[0], carry);
+        for (int j = 1; j < 4; ++j)
+            t[j - 1] = mac (t[j], m, fieldP[j], carry);
+        std::uint64_t c = 0;
+        t[3] = addc (t4, carry, c);
+        t4 = t5 + c;
+    }
+
+    if (t4 != 0 || geq (t, fieldP))
+        t = sub (t, fieldP);
+    return Fp (t);
+}
+
+//------------------------------------------------------------------------------
+
+// Multiples d * 16^w * G for every window w and digit d, in affine form.
+// With these, G * k is at most 64 mixed additions and no doublings.
+class GeneratorTable
+{
+public:
+    static int const windows = 64;
+    static int const digits = 15;
+
+    struct Entry
+    {
+        Fp x;
+        Fp y;
+    };
+
+    GeneratorTable ()
+        : entries_ (windows * digits)
+    {
+        std::vector<G1> points;
+        points.reserve (entries_.size ());
+
+        G1 base = G1::generator ();
+        for (int w = 0; w < windows; ++w)
+        {
+            G1 acc = base;
+            for (int d = 1; d <= digits; ++d)
+            {
+                points.push_back (acc);
+                acc = acc + base;
+            }
+            for (int i = 0; i < 4; ++i)
+                base = base.doubled ();
+        }
+
+        // Convert to affine with a single inversion (Montgomery's trick)
+        std::vector<Fp> prefix (points.size ());
+        Fp acc = Fp::one ();
+        for (std::size_t i = 0; i < points.size (); ++i)
+        {
+            prefix[i] = acc;
+            acc = acc * points[i].z_;
+        }
+        Fp inv = acc.inverse ();
+        for (std::size_t i = points.size (); i-- > 0;)
+        {
+            Fp const zi = inv * prefix[i];
+            inv = inv * points[i].z_;
+            Fp const zi2 = zi.squared ();
+            entries_[i].x = points[i].x_ * zi2;
+            entries_[i].y = points[i].y_ * zi2 * zi;
+        }
+    }
+
+    Entry const&
+    get (int w, int d) const
+    {
+        return entries_[w * digits + d - 1];
+    }
+
+private:
+    std::vector<Entry> entries_;
+};
+
+static
+GeneratorTable const&
+generatorTable ()
+{
+    static GeneratorTable const table;
+    return table;
+}
+
+G1 const&
+G1::generator ()
+{
+    static G1 const g = []
+    {
+        G1 p;
+        G1::fromAffine (uint256 (1), uint256 (2), p);
+        return p;
+    }();
+    return g;
+}
+
+bool
+G1::fromAffine (uint256 const& x, uint256 const& y, G1& out)
+{
+    static Fp const b = Fp::fromUint256 (uint256 (3));
+
+    Fp const fx = Fp::fromUint256 (x);
+    Fp const fy = Fp::fromUint256 (y);
+    if (fy.squared () != fx.squared () * fx + b)
+        return false;
+
+    out.x_ = fx;
+    out.y_ = fy;
+    out.z_ = Fp::one ();
+    return true;
+}
+
+bool
+G1::toAffine (uint256& x, uint256& y) const
+{
+    if (isInfinity ())
+        return false;
+
+    Fp const zi = z_.inverse ();
+    Fp const zi2 = zi.squared ();
+    x = (x_ * zi2).toUint256 ();
+    y = (y_ * zi2 * zi).toUint256 ();
+    return true;
+}
+
+void
+G1::toAffine (std::vector<G1> const& points,
+    std::vector<uint256>& x, std::vector<uint256>& y)
+{
+    x.assign (points.size (), uint256 ());
+    y.assign (points.size (), uint256 ());
+
+    // Montgomery's trick, skipping the points at infinity
+    std::vector<Fp> prefix (points.size ());
+    Fp acc = Fp::one ();
+    for (std::size_t i = 0; i < points.size (); ++i)
+    {
+        prefix[i] = acc;
+        if (! points[i].isInfinity ())
+            acc = acc * points[i].z_;
+    }
+    Fp inv = acc.inverse ();
+    for (std::size_t i = points.size (); i-- > 0;)
+    {
+        if (points[i].isInfinity ())
+            continue;
+        Fp const zi = inv * prefix[i];
+        inv = inv * points[i].z_;
+        Fp const zi2 = zi.squared ();
+        x[i] = (points[i].x_ * zi2).toUint256 ();
+        y[i] = (points[i].y_ * zi2 * zi).toUint256 ();
+    }
+}
+
+G1
+G1::doubled () const
+{
+    // dbl-2009-l, for curves with a = 0
+    if (isInfinity ())
+        return *this;
+
+    Fp const a = x_.squared ();
+    Fp const b = y_.squared ();
+    Fp const c = b.squared ();
+    Fp d = (x_ + b).squared () - a - c;
+    d = d + d;
+    Fp const e = a + a + a;
+    Fp c8 = c + c;
+    c8 = c8 + c8;
+    c8 = c8 + c8;
+
+    G1 r;
+    r.x_ = e.squared () - d - d;
+    r.y_ = e * (d - r.x_) - c8;
+    r.z_ = y_ * z_;
+    r.z_ = r.z_ + r.z_;
+    return r;
+}
+
+G1
+G1::addAffine (Fp const& x, Fp const& y) const
+{
+    // madd-2007-bl
+    if (isInfinity ())
+    {
+        G1 r;
+        r.x_ = x;
+        r.y_ = y;
+        r.z_ = Fp::one ();
+        return r;
+    }
+
+    Fp const z1z1 = z_.squared ();
+    Fp const h = x * z1z1 - x_;
+    Fp rr = y * z_ * z1z1 - y_;
+    if (h.isZero ())
+    {
+        if (rr.isZero ())
+            return doubled ();
+        return G1 ();
+    }
+
+    Fp const hh = h.squared ();
+    Fp i = hh + hh;
+    i = i + i;
+    Fp const j = h * i;
+    rr = rr + rr;
+    Fp const v = x_ * i;
+    Fp const yj = y_ * j;
+
+    G1 r;
+    r.x_ = rr.squared () - j - v - v;
+    r.y_ = rr * (v - r.x_) - yj - yj;
+    r.z_ = (z_ + h).squared () - z1z1 - hh;
+    return r;
+}
+
+G1
+operator+ (G1 const& a, G1 const& b)
+{
+    // add-2007-bl
+    if (a.isInfinity ())
+        return b;
+    if (b.isInfinity ())
+        return a;
+
+    Fp const z1z1 = a.z_.squared ();
+    Fp const z2z2 = b.z_.squared ();
+    Fp const u1 = a.x_ * z2z2;
+    Fp const u2 = b.x_ * z1z1;
+    Fp const s1 = a.y_ * b.z_ * z2z2;
+    Fp const s2 = b.y_ * a.z_ * z1z1;
+    Fp const h = u2 - u1;
+    Fp rr = s2 - s1;
+    if (h.isZero ())
+    {
+        if (rr.isZero ())
+            return a.doubled ();
+        return G1 ();
+    }
+
+    Fp i = h + h;
+    i = i.squared ();
+    Fp const j = h * i;
+    rr = rr + rr;
+    Fp const v = u1 * i;
+    Fp const sj = s1 * j;
+
+    G1 r;
+    r.x_ = rr.squared () - j - v - v;
+    r.y_ = rr * (v - r.x_) - sj - sj;
+    r.z_ = ((a.z_ + b.z_).squared () - z1z1 - z2z2) * h;
+    return r;
+}
+
+// Small multiples 0..15 of a point for four bit windows
+static
+std::array<G1, 16>
+windowTable (G1 const& p)
+{
+    std::array<G1, 16> t;
+    t[1] = p;
+    for (int i = 2; i < 16; ++i)
+        t[i] = (i & 1) ? t[i - 1] + p : t[i / 2].doubled ();
+    return t;
+}
+
+G1
+G1::operator* (uint256 const& k) const
+{
+    auto const table = windowTable (*this);
+    auto const e = toLimbs (k);
+
+    G1 r;
+    for (int w = 63; w >= 0; --w)
+    {
+        for (int i = 0; i < 4; ++i)
+            r = r.doubled ();
+        if (auto const d = nibble (e, w))
+            r = r + table[d];
+    }
+    return r;
+}
+
+G1
+G1::mulGenerator (uint256 const& k)
+{
+    auto const& table = generatorTable ();
+    auto const e = toLimbs (k);
+
+    G1 r;
+    for (int w = 0; w < GeneratorTable::windows; ++w)
+    {
+        if (auto const d = nibble (e, w))
+        {
+            auto const& entry = table.get (w, d);
+            r = r.addAffine (entry.x, entry.y);
+        }
+    }
+    return r;
+}
+
+G1
+G1::mulAdd (G1 const& a, uint256 const& ka, G1 const& b, uint256 const& kb)
+{
+    auto const ta = windowTable (a);
+    auto const tb = windowTable (b);
+    auto const ea = toLimbs (ka);
+    auto const eb = toLimbs (kb);
+
+    G1 r;
+    for (int w = 63; w >= 0; --w)
+    {
+        for (int i = 0; i < 4; ++i)
+            r = r.doubled ();
+        if (auto const d = nibble (ea, w))
+            r = r + ta[d];
+        if (auto const d = nibble (eb, w))
+            r = r + tb[d];
+    }
+    return r;
+}
+
+//------------------------------------------------------------------------------
+
+uint256
+reduceScalar (uint256 const& x)
+{
+    return fromLimbs (reduce (toLimbs (x), groupN));
+}
+
+void
+scalarToPoint (uint256 const& x, uint256& px, uint256& py)
+{
+    static Fp const b = Fp::fromUint256 (uint256 (3));
+
+    // Try x, x + 1, ... (mod N) until x^3 + 3 is a square
+    auto k = reduce (toLimbs (x), groupN);
+    while (true)
+    {
+        Fp const fx = Fp::fromUint256 (fromLimbs (k));
+        Fp const beta = fx.squared () * fx + b;
+        Fp const y = beta.pow (sqrtExp);
+        if (y.squared () == beta)
+        {
+            px = fx.toUint256 ();
+            py = y.toUint256 ();
+            return;
+        }
+
+        std::uint64_t carry = 1;
+        for (int i = 0; i < 4; ++i)
+            k[i] = addc (k[i], 0, carry);
+        if (k == groupN)
+            k = limbs {{ 0, 0, 0, 0 }};
+    }
+}
+
+} // native
+} // altbn128
+} // ripple
@@ -0,0 +1,206 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_CRYPTO_BN254_H_INCLUDED
+#define RIPPLE_CRYPTO_BN254_H_INCLUDED
+
+#include <ripple/basics/base_uint.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace ripple {
+namespace altbn128 {
+
+/*  Fixed width arithmetic for the alt_bn128 (BN254) base field and G1.
+
+    The OpenSSL EC_GROUP built in AltBn128.cpp is generic: every operation
+    goes through BIGNUM allocations and a BN_CTX.  The ring signature
+    verifier performs several hundred point operations per transaction, so
+    it uses these types instead.  Field elements are four 64-bit limbs in
+    Montgomery form, points are kept in Jacobian coordinates and multiples
+    of the generator come from a precomputed table.
+
+    Nothing here is constant time; it is meant for verifying public data.
+*/
+namespace native {
+
+/** An element of the base field, modulo P, in Montgomery form. */
+class Fp
+{
+public:
+    using limbs_type = std::array<std::uint64_t, 4>;
+
+    /** Zero. */
+    Fp ()
+        : v_ {{ 0, 0, 0, 0 }}
+    {
+    }
+
+    /** Converts a big endian integer, reducing it modulo P. */
+    static
+    Fp
+    fromUint256 (uint256 const& x);
+
+    static
+    Fp const&
+    one ();
+
+    /** Returns the canonical big endian value. */
+    uint256
+    toUint256 () const;
+
+    bool
+    isZero () const;
+
+    Fp
+    squared () const;
+
+    /** Returns this ^ e, where e is a plain little endian integer. */
+    Fp
+    pow (limbs_type const& e) const;
+
+    /** Returns the multiplicative inverse. The inverse of zero is zero. */
+    Fp
+    inverse () const;
+
+    friend Fp operator+ (Fp const& a, Fp const& b);
+    friend Fp operator- (Fp const& a, Fp const& b);
+    friend Fp operator* (Fp const& a, Fp const& b);
+
+    friend
+    bool
+    operator== (Fp const& a, Fp const& b)
+    {
+        return a.v_ == b.v_;
+    }
+
+    friend
+    bool
+    operator!= (Fp const& a, Fp const& b)
+    {
+        return a.v_ != b.v_;
+    }
+
+private:
+    explicit
+    Fp (limbs_type const& v)
+        : v_ (v)
+    {
+    }
+
+    limbs_type v_;
+};
+
+/** A point of G1 in Jacobian coordinates (X/Z^2, Y/Z^3).
+
+    The point at infinity is represented by Z == 0.
+*/
+class G1
+{
+public:
+    /** The point at infinity. */
+    G1 ()
+        : x_ (Fp::one ())
+        , y_ (Fp::one ())
+    {
+    }
+
+    static
+    G1 const&
+    generator ();
+
+    /** Builds a point from affine coordinates.
+
+        The coordinates are reduced modulo P first, like
+        EC_POINT_set_affine_coordinates_GFp does.
+
+        @return false if the point is not on the curve.
+    */
+    static
+    bool
+    fromAffine (uint256 const& x, uint256 const& y, G1& out);
+
+    /** Returns the affine coordinates.
+
+        @return false for the point at infinity.
+    */
+    bool
+    toAffine (uint256& x, uint256& y) const;
+
+    /** Converts many points with a single field inversion.
+
+        The point at infinity comes back as (0, 0), which is not on the
+        curve.
+    */
+    static
+    void
+    toAffine (std::vector<G1> const& points,
+        std::vector<uint256>& x, std::vector<uint256>& y);
+
+    bool
+    isInfinity () const
+    {
+        return z_.isZero ();
+    }
+
+    G1
+    doubled () const;
+
+    /** Adds a point given in affine coordinates. */
+    G1
+    addAffine (Fp const& x, Fp const& y) const;
+
+    friend G1 operator+ (G1 const& a, G1 const& b);
+
+    /** Returns this * k for a 256-bit scalar k. */
+    G1
+    operator* (uint256 const& k) const;
+
+    /** Returns G * k using the precomputed generator table. */
+    static
+    G1
+    mulGenerator (uint256 const& k);
+
+    /** Returns a * ka + b * kb, sharing the doublings between both. */
+    static
+    G1
+    mulAdd (G1 const& a, uint256 const& ka, G1 const& b, uint256 const& kb);
+
+private:
+    friend class GeneratorTable;
+
+    Fp x_;
+    Fp y_;
+    Fp z_;
+};
+
+/** Returns x modulo the group order N. */
+uint256
+reduceScalar (uint256 const& x);
+
+/** Maps a scalar to a curve point the way altbn128::scalarToPoint does. */
+void
+scalarToPoint (uint256 const& x, uint256& px, uint256& py);
+
+} // native
+} // altbn128
+} // ripple
+
+#endif
@@ -8,7 +8,9 @@
 #include <ripple/protocol/Indexes.h>
 #include <ripple/crypto/impl/openssl.h>
 #include <ripple/crypto/AltBn128.h>
+#include <ripple/crypto/impl/Bn254.h>
 #include <ripple/protocol/Serializer.h>
+#include <chrono>
 
 namespace ripple {
 
@@ -16,6 +18,130 @@ namespace ripple {
     using bn_ctx = openssl::bn_ctx;
     using ec_point = openssl::ec_point;
     using namespace altbn128;
+
+namespace {
+
+// The ring verification as it was written against OpenSSL, kept as a
+// reference for the native implementation.
+ec_point
+opensslScalarToPoint(uint256 const& x_)
+{
+    bignum x(x_), y, beta;
+    bn_ctx ctx;
+    BN_mod(x.get(), x.get(), N.get(), ctx.get());
+    while (true) {
+        evalCurve(x, y, beta, ctx);
+        if (onCurveBeta(beta, y, ctx))
+            return set_coordinates(altbn128::group(), x, y);
+        BN_mod_add(x.get(), x.get(), bnOne.get(), N.get(), ctx.get());
+    }
+}
+
+bool
+opensslRingVerify(std::string const& msg, uint256 const& c0,
+    STVector256 const& keyImage, STVector256 const& sig,
+    STArray const& publicKeys)
+{
+    auto const g = altbn128::group();
+    bn_ctx ctx;
+
+    Serializer s;
+    for (auto const& pk : publicKeys) {
+        auto const& keyPair = pk.getFieldV256(sfPublicKeyPair);
+        s.add256(keyPair[0]);
+        s.add256(keyPair[1]);
+    }
+    ec_point const h = opensslScalarToPoint(sha256_s("0x" + s.getHex()));
+    ec_point const img = set_coordinates(g, bignum(keyImage[0]), bignum(keyImage[1]));
+
+    s.add256(keyImage[0]);
+    s.add256(keyImage[1]);
+    s.addRaw(msg.data(), msg.size());
+    std::string const prefix = "0x" + s.getHex();
+
+    bignum c(c0);
+    for (std::size_t i = 0; i < publicKeys.size(); ++i) {
+        auto const& keyPair = publicKeys[i].getFieldV256(sfPublicKeyPair);
+        ec_point const pk = set_coordinates(g, bignum(keyPair[0]), bignum(keyPair[1]));
+        bignum const si(sig[i]);
+        ec_point const z1 = add(g, multiply(g, si, ctx), multiply2(g, pk, c, ctx), ctx);
+        ec_point const z2 = add(g, multiply2(g, h, si, ctx), multiply2(g, img, c, ctx), ctx);
+
+        std::string str = prefix;
+        for (auto const z : {&z1, &z2}) {
+            char* hex = EC_POINT_point2hex(g, z->get(), POINT_CONVERSION_UNCOMPRESSED, ctx.get());
+            str += hex + 2;
+            OPENSSL_free(hex);
+        }
+        boost::to_lower(str);
+        bignum hash(sha256_s(str));
+        BN_mod(c.get(), hash.get(), N.get(), ctx.get());
+    }
+    return uint256_from_bignum_clear(c) == c0;
+}
+
+std::pair<uint256, uint256>
+affine(ec_point const& pt)
+{
+    bn_ctx ctx;
+    bignum x, y;
+    EC_POINT_get_affine_coordinates_GFp(altbn128::group(), pt.get(), x.get(), y.get(), ctx.get());
+    return std::make_pair(uint256_from_bignum_clear(x), uint256_from_bignum_clear(y));
+}
+
+uint256
+randomScalar()
+{
+    bignum r = bignum::rand(256);
+    return uint256_from_bignum_clear(r);
+}
+
+// Public keys G * sk for each secret
+STArray
+makeRing(std::vector<uint256> const& secrets)
+{
+    bn_ctx ctx;
+    STArray publicKeys;
+    for (auto const& sk : secrets) {
+        auto const pt = affine(multiply(altbn128::group(), bignum(sk), ctx));
+        STVector256 pk;
+        pk.push_back(pt.first);
+        pk.push_back(pt.second);
+        publicKeys.push_back(STObject(sfRingHolder));
+        publicKeys.back().setFieldV256(sfPublicKeyPair, pk);
+    }
+    return publicKeys;
+}
+
+struct RingSig
+{
+    std::string message;
+    uint256 c0;
+    STVector256 keyImage;
+    STVector256 sig;
+    STArray publicKeys;
+};
+
+RingSig
+makeRingSig(std::size_t keyCount, std::string const& message)
+{
+    std::vector<uint256> secrets;
+    for (std::size_t i = 0; i < keyCount; ++i)
+        secrets.push_back(native::reduceScalar(randomScalar()));
+
+    RingSig r;
+    r.message = message;
+    r.publicKeys = makeRing(secrets);
+    int const index = static_cast<int>(keyCount / 2);
+    auto sig = altbn128::ringSign(message, r.publicKeys, index, secrets[index]);
+    r.c0 = std::get<0>(sig);
+    for (auto const& sn : std::get<1>(sig))
+        r.sig.push_back(sn);
+    r.keyImage = std::get<2>(sig);
+    return r;
+}
+
+} // (anon)
     
 class Ring_test : public beast::unit_test::suite
 {
@@ -174,7 +300,7 @@ public:
         obj2.setFieldV256(sfPublicKeyPair, pk1);
 
         std::string msg = "test";
-        expect(altbn128::ringVerify(msg, c0, keyImage, sig, publicKeys, beast::Journal{}), "verfiy...");
+        expect(altbn128::ringVerify(msg, c0, keyImage, sig, publicKeys, true, beast::Journal{}), "verfiy...");
     }
 
     void test_sign()
@@ -302,7 +428,7 @@ public:
         log << "yTilde: x=" << BN_bn2hex(yTilde0BN.get());
         log << "yTilde: y=" << BN_bn2hex(yTilde1BN.get());
 
-        expect(altbn128::ringVerify(message, c0, yTilde, sigVector, publicKeys, beast::Journal{}), "ring sign ...");
+        expect(altbn128::ringVerify(message, c0, yTilde, sigVector, publicKeys, true, beast::Journal{}), "ring sign ...");
     }
 
     void test_ecdsa(){
@@ -329,6 +455,126 @@ public:
         // if verify ok, refund ringdeposit to account
     }
 
+    void test_native()
+    {
+        testcase ("native arithmetic");
+        bn_ctx ctx;
+        using native::G1;
+
+        for (int i = 0; i < 16; ++i) {
+            uint256 const k = randomScalar();
+            uint256 const k2 = randomScalar();
+
+            auto const expected = affine(multiply(altbn128::group(), bignum(k), ctx));
+            uint256 x, y;
+            expect(G1::mulGenerator(k).toAffine(x, y), "G * k is infinity");
+            expect(std::make_pair(x, y) == expected, "G * k mismatch");
+            expect((G1::generator() * k).toAffine(x, y), "G * k is infinity");
+            expect(std::make_pair(x, y) == expected, "G * k window mismatch");
+
+            G1 p;
+            expect(G1::fromAffine(expected.first, expected.second, p), "point not on curve");
+            ec_point const pt = set_coordinates(altbn128::group(), bignum(expected.first), bignum(expected.second));
+            auto const expected2 = affine(add(altbn128::group(),
+                multiply2(altbn128::group(), pt, bignum(k2), ctx),
+                multiply(altbn128::group(), bignum(k2), ctx), ctx));
+            expect(G1::mulAdd(p, k2, G1::generator(), k2).toAffine(x, y), "mulAdd is infinity");
+            expect(std::make_pair(x, y) == expected2, "mulAdd mismatch");
+
+            native::scalarToPoint(k, x, y);
+            expect(std::make_pair(x, y) == affine(opensslScalarToPoint(k)), "scalarToPoint mismatch");
+        }
+
+        G1 p;
+        expect(!G1::fromAffine(uint256(1), uint256(3), p), "accepted a point off the curve");
+    }
+
+    void test_native_verify()
+    {
+        testcase ("native ring verify");
+        for (std::size_t keyCount : {1, 2, 5}) {
+            auto const r = makeRingSig(keyCount, "Ring transaction");
+            expect(altbn128::ringVerify(r.message, r.c0, r.keyImage, r.sig, r.publicKeys, true, beast::Journal{}), "native verify failed");
+            expect(opensslRingVerify(r.message, r.c0, r.keyImage, r.sig, r.publicKeys), "reference verify failed");
+            expect(!altbn128::ringVerify("Ring transactioN", r.c0, r.keyImage, r.sig, r.publicKeys, true, beast::Journal{}), "native verify accepted a forgery");
+            expect(!opensslRingVerify("Ring transactioN", r.c0, r.keyImage, r.sig, r.publicKeys), "reference verify accepted a forgery");
+        }
+    }
+
+    void test_batch_verify()
+    {
+        testcase ("batch ring verify");
+        std::vector<RingSignature> sigs;
+        std::vector<bool> expected;
+        for (std::size_t keyCount : {3, 1, 4, 2}) {
+            auto const r = makeRingSig(keyCount, "Ring transaction");
+            auto const keys = std::make_shared<RingKeys const>(r.publicKeys);
+            sigs.emplace_back(r.message, r.c0, r.keyImage, r.sig, keys, true);
+            expected.push_back(true);
+            // A second signature over the same decoded ring, for another message
+            sigs.emplace_back("Ring transactioN", r.c0, r.keyImage, r.sig, keys, true);
+            expected.push_back(false);
+        }
+        expect(ringVerifyBatch(sigs) == expected, "batch verify mismatch");
+
+        auto const r = makeRingSig(2, "Ring transaction");
+        STVector256 image;
+        image.push_back(uint256(1));
+        image.push_back(uint256(3));
+        try {
+            RingSignature const bad(r.message, r.c0, image, r.sig,
+                std::make_shared<RingKeys const>(r.publicKeys), true);
+            fail("accepted a key image off the curve");
+        } catch (std::runtime_error const&) {
+            pass();
+        }
+    }
+
+    void test_infinity_verify()
+    {
+        testcase ("ring verify with a point at infinity");
+        using native::G1;
+        bn_ctx ctx;
+
+        // The signer at index 1 picks s1 = -c1 * sk, so both of its step
+        // points are at infinity and c0 is the hash of the prefix alone.
+        std::vector<uint256> secrets{native::reduceScalar(randomScalar()),
+            native::reduceScalar(randomScalar())};
+        auto const publicKeys = makeRing(secrets);
+        auto const keys = std::make_shared<RingKeys const>(publicKeys);
+        std::string const message = "Ring transaction";
+
+        G1 const image = keys->h * secrets[1];
+        uint256 ix, iy;
+        expect(image.toAffine(ix, iy), "key image is infinity");
+        STVector256 keyImage;
+        keyImage.push_back(ix);
+        keyImage.push_back(iy);
+
+        STVector256 sig;
+        sig.push_back(native::reduceScalar(randomScalar()));
+        sig.push_back(uint256());
+        auto const prefix = RingSignature(message, uint256(), keyImage, sig,
+            keys, true).prefix;
+        uint256 const c0 = native::reduceScalar(sha256_s(prefix));
+
+        uint256 x1, y1, x2, y2;
+        expect((G1::mulGenerator(sig[0]) + keys->points[0] * c0).toAffine(x1, y1), "z1 is infinity");
+        expect(G1::mulAdd(keys->h, sig[0], image, c0).toAffine(x2, y2), "z2 is infinity");
+        std::string str = prefix + to_string(x1) + to_string(y1) + to_string(x2) + to_string(y2);
+        boost::to_lower(str);
+        uint256 const c1 = native::reduceScalar(sha256_s(str));
+
+        bignum s1;
+        BN_mod_mul(s1.get(), bignum(c1).get(), bignum(secrets[1]).get(), N.get(), ctx.get());
+        BN_mod_sub(s1.get(), N.get(), s1.get(), N.get(), ctx.get());
+        sig[1] = uint256_from_bignum_clear(s1);
+
+        expect(opensslRingVerify(message, c0, keyImage, sig, publicKeys), "reference verify failed");
+        expect(altbn128::ringVerify(message, c0, keyImage, sig, publicKeys, false, beast::Journal{}), "verify without the amendment failed");
+        expect(!altbn128::ringVerify(message, c0, keyImage, sig, publicKeys, true, beast::Journal{}), "verify with the amendment accepted a point at infinity");
+    }
+
     void run() override
     {
         test_hash_value();
@@ -341,9 +587,100 @@ public:
         test_verify();
         test_sign();
         test_ecdsa();
+        test_native();
+        test_native_verify();
+        test_batch_verify();
+        test_infinity_verify();
     }
 };
 
 BEAST_DEFINE_TESTSUITE(Ring, ripple_data, ripple);
 
+// Times ring signature verification with the native arithmetic against the
+// OpenSSL path it replaced.
+class RingBench_test : public beast::unit_test::suite
+{
+    using clock_type = std::chrono::steady_clock;
+
+    template <class F>
+    std::chrono::microseconds
+    timeIt(int iterations, F&& f)
+    {
+        auto const start = clock_type::now();
+        for (int i = 0; i < iterations; ++i)
+            f();
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            (clock_type::now() - start) / iterations);
+    }
+
+    void
+    benchPoints(int iterations)
+    {
+        testcase ("point arithmetic");
+        bn_ctx ctx;
+        uint256 const k = randomScalar();
+        bignum const bk(k);
+        ec_point const pt = multiply(altbn128::group(), bignum(randomScalar()), ctx);
+        auto const xy = affine(pt);
+        native::G1 p;
+        native::G1::fromAffine(xy.first, xy.second, p);
+
+        log << "G * k    openssl " << timeIt(iterations, [&]{ multiply(altbn128::group(), bk, ctx); }).count() <<
+            "us, native " << timeIt(iterations, [&]{ native::G1::mulGenerator(k); }).count() << "us";
+        log << "P * k    openssl " << timeIt(iterations, [&]{ multiply2(altbn128::group(), pt, bk, ctx); }).count() <<
+            "us, native " << timeIt(iterations, [&]{ p * k; }).count() << "us";
+        log << "h2(k)    openssl " << timeIt(iterations, [&]{ opensslScalarToPoint(k); }).count() <<
+            "us, native " << timeIt(iterations, [&]{ uint256 x, y; native::scalarToPoint(k, x, y); }).count() << "us";
+        pass();
+    }
+
+    void
+    benchVerify(std::size_t keyCount, int iterations)
+    {
+        testcase ("verify " + std::to_string(keyCount) + " keys");
+        auto const r = makeRingSig(keyCount, "Ring transaction");
+        bool ok = true;
+        auto const ossl = timeIt(iterations, [&]{
+            ok = opensslRingVerify(r.message, r.c0, r.keyImage, r.sig, r.publicKeys) && ok; });
+        auto const nat = timeIt(iterations, [&]{
+            ok = altbn128::ringVerify(r.message, r.c0, r.keyImage, r.sig, r.publicKeys, true, beast::Journal{}) && ok; });
+        expect(ok, "verify failed");
+        log << keyCount << " keys: openssl " << ossl.count() << "us, native " << nat.count() << "us";
+    }
+
+    void
+    benchBatch(std::size_t count, std::size_t keyCount, int iterations)
+    {
+        testcase ("batch of " + std::to_string(count));
+        std::vector<RingSignature> sigs;
+        for (std::size_t i = 0; i < count; ++i) {
+            auto const r = makeRingSig(keyCount, "Ring transaction");
+            sigs.emplace_back(r.message, r.c0, r.keyImage, r.sig,
+                std::make_shared<RingKeys const>(r.publicKeys), true);
+        }
+        bool ok = true;
+        auto const single = timeIt(iterations, [&]{
+            for (auto const& rs : sigs)
+                ok = ringVerifyBatch({rs}).front() && ok; });
+        auto const batch = timeIt(iterations, [&]{
+            for (auto const r : ringVerifyBatch(sigs))
+                ok = r && ok; });
+        expect(ok, "verify failed");
+        log << count << " x " << keyCount << " keys: one by one " << single.count() <<
+            "us, batched " << batch.count() << "us";
+    }
+
+public:
+    void run() override
+    {
+        benchPoints(200);
+        benchVerify(2, 50);
+        benchVerify(8, 20);
+        benchVerify(32, 5);
+        benchBatch(16, 8, 5);
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(RingBench, ripple_data, ripple);
+
 } // ripple
@@ -140,9 +140,13 @@ public:
 
         The ledger contents are analyzed for rules
         and amendments and extracted to the object.
+
+        @param presets Features enabled by configuration,
+                       these count as enabled in every call.
     */
-    explicit
-    Rules (DigestAwareReadView const& ledger);
+    Rules (DigestAwareReadView const& ledger,
+        std::unordered_set<uint256,
+            beast::uhash<>> const& presets);
 
     /** Returns `true` if a feature is enabled. */
     bool
@@ -285,10 +285,37 @@ offerDelete (ApplyView& view,
     std::shared_ptr<SLE> const& sle,
         beast::Journal j);
 
+/** Add a reference to the reference list of a referee.
+
+    @param paged Append to the last page of a paged list instead of
+                 rewriting a single capped list.
+*/
 TER
 addRefer (ApplyView& view,
     AccountID const& refereeID, AccountID const& referenceID,
-        beast::Journal j);
+        bool paged, beast::Journal j);
+
+/** Iterate all references of a referee, across all list pages. */
+void
+forEachReference (ReadView const& view, AccountID const& refereeID,
+    std::function<void (AccountID const&)> f);
+
+/** Record a dividend vSprd of a reference on its referee's list.
+
+    The root of the list keeps the largest vSprd among the references
+    for the latest dividend ledger. It is updated as each reference gets
+    the dividend and as a reference is added.
+*/
+void
+updateReferMaxChild (ApplyView& view, AccountID const& refereeID,
+    std::uint32_t divLedgerSeq, std::uint64_t divVSprd);
+
+/** The largest vSprd among the references of a referee for a dividend
+    ledger, as recorded by updateReferMaxChild. Zero if none was recorded.
+*/
+std::uint64_t
+referMaxChild (ReadView const& view, AccountID const& refereeID,
+    std::uint32_t divLedgerSeq);
 
 TER
 shareFeeWithReferee (ApplyView& view,
@@ -24,6 +24,7 @@
 #include <ripple/ledger/RawView.h>
 #include <ripple/ledger/ReadView.h>
 #include <ripple/ledger/TxMeta.h>
+#include <ripple/ledger/detail/ItemTable.h>
 #include <ripple/protocol/TER.h>
 #include <ripple/protocol/XRPAmount.h>
 #include <beast/utility/Journal.h>
@@ -47,7 +48,7 @@ private:
         modify,
     };
 
-    using items_t = std::map<key_type,
+    using items_t = ItemTable<
         std::pair<Action, std::shared_ptr<SLE>>>;
 
     items_t items_;
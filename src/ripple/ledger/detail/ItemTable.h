@@ -0,0 +1,253 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_LEDGER_ITEMTABLE_H_INCLUDED
+#define RIPPLE_LEDGER_ITEMTABLE_H_INCLUDED
+
+#include <ripple/basics/base_uint.h>
+#include <ripple/basics/UnorderedContainers.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace ripple {
+namespace detail {
+
+/** Keyed storage for the buffered changes of a state table.
+
+    Point lookups go through a hash table. Ordered access, which only
+    succ() and sles iteration need, goes through a vector of pointers
+    to the entries sorted by key. Newly inserted entries are kept aside
+    and merged into the vector the next time ordered access is needed,
+    so a run of inserts costs one sort instead of a tree rebalance each.
+
+    Entries never move once inserted, so the pointers handed out stay
+    valid until the entry is erased. Ordered access may be called from
+    several threads at once on a table nobody is modifying.
+*/
+template <class Item, class Allocator =
+    std::allocator<std::pair<uint256 const, Item>>>
+class ItemTable
+{
+public:
+    using key_type = uint256;
+
+private:
+    using map_type = hardened_hash_map<key_type, Item,
+        hardened_hash<strong_hash>, std::equal_to<key_type>,
+            Allocator>;
+
+public:
+    using value_type = typename map_type::value_type;
+    using sorted_type = std::vector<value_type const*>;
+    using const_iterator = typename sorted_type::const_iterator;
+
+    ItemTable() = default;
+
+    ItemTable (ItemTable const& other)
+        : map_ (other.map_)
+    {
+        auto const& sorted = other.sorted();
+        sorted_.reserve (sorted.size());
+        for (auto const e : sorted)
+            sorted_.push_back (&*map_.find (e->first));
+    }
+
+    ItemTable (ItemTable&& other)
+        : map_ (std::move (other.map_))
+        , sorted_ (std::move (other.sorted_))
+        , pending_ (std::move (other.pending_))
+        , merged_ (other.merged_.load())
+    {
+        other.map_.clear();
+        other.sorted_.clear();
+        other.pending_.clear();
+        other.merged_ = true;
+    }
+
+    ItemTable& operator= (ItemTable const&) = delete;
+    ItemTable& operator= (ItemTable&&) = delete;
+
+    std::size_t
+    size() const
+    {
+        return map_.size();
+    }
+
+    bool
+    empty() const
+    {
+        return map_.empty();
+    }
+
+    /** Iterate the entries in no particular order. */
+    /** @{ */
+    typename map_type::const_iterator
+    begin() const
+    {
+        return map_.begin();
+    }
+
+    typename map_type::const_iterator
+    end() const
+    {
+        return map_.end();
+    }
+    /** @} */
+
+    /** Return the entry for a key, or nullptr. */
+    /** @{ */
+    value_type*
+    find (key_type const& key)
+    {
+        auto const iter = map_.find (key);
+        if (iter == map_.end())
+            return nullptr;
+        return &*iter;
+    }
+
+    value_type const*
+    find (key_type const& key) const
+    {
+        auto const iter = map_.find (key);
+        if (iter == map_.end())
+            return nullptr;
+        return &*iter;
+    }
+    /** @} */
+
+    /** Construct an entry if the key is not present.
+
+        @return The entry for the key, and whether it was inserted.
+    */
+    template <class... Args>
+    std::pair<value_type*, bool>
+    emplace (key_type const& key, Args&&... args)
+    {
+        auto iter = map_.find (key);
+        if (iter != map_.end())
+            return { &*iter, false };
+        iter = map_.emplace (std::piecewise_construct,
+            std::forward_as_tuple (key),
+                std::forward_as_tuple (
+                    std::forward<Args>(args)...)).first;
+        pending_.push_back (&*iter);
+        merged_.store (false, std::memory_order_relaxed);
+        return { &*iter, true };
+    }
+
+    /** Remove an entry previously returned by find or emplace. */
+    void
+    erase (value_type const* e)
+    {
+        auto const iter = std::lower_bound (
+            sorted_.begin(), sorted_.end(), e->first, Less{});
+        if (iter != sorted_.end() && *iter == e)
+        {
+            sorted_.erase (iter);
+        }
+        else
+        {
+            // Recent inserts are the likeliest to be undone
+            auto const it = std::find (
+                pending_.rbegin(), pending_.rend(), e);
+            assert (it != pending_.rend());
+            pending_.erase (std::next (it).base());
+            if (pending_.empty())
+                merged_.store (true, std::memory_order_relaxed);
+        }
+        map_.erase (map_.find (e->first));
+    }
+
+    /** Return every entry, sorted by key. */
+    sorted_type const&
+    sorted() const
+    {
+        merge();
+        return sorted_;
+    }
+
+    /** Return the first sorted entry with a key above the given key. */
+    const_iterator
+    upper_bound (key_type const& key) const
+    {
+        auto const& sorted = this->sorted();
+        return std::upper_bound (
+            sorted.begin(), sorted.end(), key, Less{});
+    }
+
+private:
+    struct Less
+    {
+        bool
+        operator() (value_type const* lhs, value_type const* rhs) const
+        {
+            return lhs->first < rhs->first;
+        }
+
+        bool
+        operator() (value_type const* lhs, key_type const& rhs) const
+        {
+            return lhs->first < rhs;
+        }
+
+        bool
+        operator() (key_type const& lhs, value_type const* rhs) const
+        {
+            return lhs < rhs->first;
+        }
+    };
+
+    void
+    merge() const
+    {
+        if (merged_.load (std::memory_order_acquire))
+            return;
+        std::lock_guard<std::mutex> lock (mutex_);
+        if (merged_.load (std::memory_order_relaxed))
+            return;
+        std::sort (pending_.begin(), pending_.end(), Less{});
+        auto const mid = sorted_.size();
+        sorted_.insert (sorted_.end(),
+            pending_.begin(), pending_.end());
+        // Skip the merge when everything new sorts last
+        if (mid > 0 && mid < sorted_.size() &&
+                Less{}(sorted_[mid], sorted_[mid - 1]))
+            std::inplace_merge (sorted_.begin(),
+                sorted_.begin() + mid, sorted_.end(), Less{});
+        pending_.clear();
+        merged_.store (true, std::memory_order_release);
+    }
+
+    map_type map_;
+    mutable sorted_type sorted_;
+    mutable sorted_type pending_;
+    mutable std::atomic<bool> merged_ {true};
+    mutable std::mutex mutex_;
+};
+
+} // detail
+} // ripple
+
+#endif
@@ -34,6 +34,7 @@ ApplyStateTable::apply (RawView& to) const
     to.rawCreateXRP(dropsCreated_);
     to.rawCreateVBC(dropsVBCCreated_);
     to.rawDestroyXRP(dropsDestroyed_);
+    // Order is irrelevant here, so skip sorting the keys
     for (auto const& item : items_)
     {
         auto const& sle =
@@ -82,8 +83,9 @@ ApplyStateTable::visit (ReadView const& to,
         std::shared_ptr <SLE const> const& before,
         std::shared_ptr <SLE const> const& after)> const& func)
 {
-    for (auto& item : items_)
+    for (auto const e : items_.sorted())
     {
+        auto const& item = *e;
         switch (item.second.first)
         {
         case Action::erase:
@@ -128,8 +130,9 @@ ApplyStateTable::apply (OpenView& to,
         if (!feeShareTakers_.empty ())
             meta.setFeeShareTakers(feeShareTakers_);
         Mods newMod;
-        for (auto& item : items_)
+        for (auto const e : items_.sorted())
         {
+            auto const& item = *e;
             SField const* type;
             switch (item.second.first)
             {
@@ -267,7 +270,7 @@ ApplyStateTable::exists (ReadView const& base,
     Keylet const& k) const
 {
     auto const iter = items_.find(k.key);
-    if (iter == items_.end())
+    if (! iter)
         return base.exists(k);
     auto const& item = iter->second;
     auto const& sle = item.second;
@@ -292,7 +295,7 @@ ApplyStateTable::succ (ReadView const& base,
             boost::optional<key_type>
 {
     boost::optional<key_type> next = key;
-    items_t::const_iterator iter;
+    items_t::value_type const* item;
     // Find base successor that is
     // not also deleted in our list
     do
@@ -300,19 +303,20 @@ ApplyStateTable::succ (ReadView const& base,
         next = base.succ(*next, last);
         if (! next)
             break;
-        iter = items_.find(*next);
+        item = items_.find(*next);
     }
-    while (iter != items_.end() &&
-        iter->second.first == Action::erase);
+    while (item &&
+        item->second.first == Action::erase);
     // Find non-deleted successor in our list
-    for (iter = items_.upper_bound(key);
-        iter != items_.end (); ++iter)
+    auto const end = items_.sorted().end();
+    for (auto iter = items_.upper_bound(key);
+        iter != end; ++iter)
     {
-        if (iter->second.first != Action::erase)
+        if ((*iter)->second.first != Action::erase)
         {
             // Found both, return the lower key
-            if (! next || next > iter->first)
-                next = iter->first;
+            if (! next || next > (*iter)->first)
+                next = (*iter)->first;
             break;
         }
     }
@@ -328,7 +332,7 @@ ApplyStateTable::read (ReadView const& base,
     Keylet const& k) const
 {
     auto const iter = items_.find(k.key);
-    if (iter == items_.end())
+    if (! iter)
         return base.read(k);
     auto const& item = iter->second;
     auto const& sle = item.second;
@@ -350,21 +354,15 @@ std::shared_ptr<SLE>
 ApplyStateTable::peek (ReadView const& base,
     Keylet const& k)
 {
-    auto iter = items_.lower_bound(k.key);
-    if (iter == items_.end() ||
-        iter->first != k.key)
+    auto const iter = items_.find(k.key);
+    if (! iter)
     {
         auto const sle = base.read(k);
         if (! sle)
             return nullptr;
         // Make our own copy
-        using namespace std;
-        iter = items_.emplace_hint (iter,
-            piecewise_construct,
-                forward_as_tuple(sle->key()),
-                    forward_as_tuple(Action::cache,
-                        make_shared<SLE>(*sle)));
-        return iter->second.second;
+        return items_.emplace(sle->key(), Action::cache,
+            std::make_shared<SLE>(*sle)).first->second.second;
     }
     auto const& item = iter->second;
     auto const& sle = item.second;
@@ -389,7 +387,7 @@ ApplyStateTable::erase(
 {
     auto const iter =
         items_.find(sle->key());
-    if (iter == items_.end())
+    if (! iter)
         LogicError("ApplyStateTable::erase: missing key");
     auto& item = iter->second;
     if (item.second != sle)
@@ -413,11 +411,8 @@ void
 ApplyStateTable::rawErase (ReadView const& base,
     std::shared_ptr<SLE> const& sle)
 {
-    using namespace std;
     auto const result = items_.emplace(
-        piecewise_construct,
-            forward_as_tuple(sle->key()),
-                forward_as_tuple(Action::erase, sle));
+        sle->key(), Action::erase, sle);
     if (result.second)
         return;
     auto& item = result.first->second;
@@ -442,15 +437,11 @@ ApplyStateTable::insert (ReadView const& base,
     std::shared_ptr<SLE> const& sle)
 {
     auto const iter =
-        items_.lower_bound(sle->key());
-    if (iter == items_.end() ||
-        iter->first != sle->key())
+        items_.find(sle->key());
+    if (! iter)
     {
-        using namespace std;
-        items_.emplace_hint(iter,
-            piecewise_construct,
-                forward_as_tuple(sle->key()),
-                    forward_as_tuple(Action::insert, sle));
+        items_.emplace(sle->key(),
+            Action::insert, sle);
         return;
     }
     auto& item = iter->second;
@@ -474,14 +465,11 @@ ApplyStateTable::replace (ReadView const& base,
     std::shared_ptr<SLE> const& sle)
 {
     auto const iter =
-        items_.lower_bound(sle->key());
-    if (iter == items_.end() ||
-        iter->first != sle->key())
+        items_.find(sle->key());
+    if (! iter)
     {
-        using namespace std;
-        items_.emplace_hint(iter, piecewise_construct,
-            forward_as_tuple(sle->key()),
-                forward_as_tuple(Action::modify, sle));
+        items_.emplace(sle->key(),
+            Action::modify, sle);
         return;
     }
     auto& item = iter->second;
@@ -505,7 +493,7 @@ ApplyStateTable::update (ReadView const& base,
 {
     auto const iter =
         items_.find(sle->key());
-    if (iter == items_.end())
+    if (! iter)
         LogicError("ApplyStateTable::update: missing key");
     auto& item = iter->second;
     if (item.second != sle)
@@ -574,7 +562,7 @@ ApplyStateTable::getForMod (ReadView const& base,
     }
     {
         auto iter = items_.find (key);
-        if (iter != items_.end ())
+        if (iter)
         {
             auto const& item = iter->second;
             if (item.first == Action::erase)
@@ -51,7 +51,7 @@ public:
             sle0_ = *iter0_;
         if (iter1_ != end1)
         {
-            sle1_ = iter1_->second.second;
+            sle1_ = (*iter1_)->second.second;
             skip ();
         }
     }
@@ -133,13 +133,13 @@ private:
         if (iter1_ == end1_)
             sle1_ = nullptr;
         else
-            sle1_ = iter1_->second.second;
+            sle1_ = (*iter1_)->second.second;
     }
     
     void skip()
     {
         while (iter1_ != end1_ &&
-            iter1_->second.first == Action::erase &&
+            (*iter1_)->second.first == Action::erase &&
                sle0_->key() == sle1_->key())
         {
             inc1();
@@ -160,6 +160,7 @@ RawStateTable::apply (RawView& to) const
     to.rawCreateXRP(dropsCreated_);
     to.rawCreateVBC(dropsVBCCreated_);
     to.rawDestroyXRP(dropsDestroyed_);
+    // Order is irrelevant here, so skip sorting the keys
     for (auto const& elem : items_)
     {
         auto const& item = elem.second;
@@ -184,7 +185,7 @@ RawStateTable::exists (ReadView const& base,
 {
     assert(k.key.isNonZero());
     auto const iter = items_.find(k.key);
-    if (iter == items_.end())
+    if (! iter)
         return base.exists(k);
     auto const& item = iter->second;
     if (item.first == Action::erase)
@@ -205,7 +206,7 @@ RawStateTable::succ (ReadView const& base,
             boost::optional<key_type>
 {
     boost::optional<key_type> next = key;
-    items_t::const_iterator iter;
+    items_t::value_type const* item;
     // Find base successor that is
     // not also deleted in our list
     do
@@ -213,19 +214,20 @@ RawStateTable::succ (ReadView const& base,
         next = base.succ(*next, last);
         if (! next)
             break;
-        iter = items_.find(*next);
+        item = items_.find(*next);
     }
-    while (iter != items_.end() &&
-        iter->second.first == Action::erase);
+    while (item &&
+        item->second.first == Action::erase);
     // Find non-deleted successor in our list
-    for (iter = items_.upper_bound(key);
-        iter != items_.end (); ++iter)
+    auto const end = items_.sorted().end();
+    for (auto iter = items_.upper_bound(key);
+        iter != end; ++iter)
     {
-        if (iter->second.first != Action::erase)
+        if ((*iter)->second.first != Action::erase)
         {
             // Found both, return the lower key
-            if (! next || next > iter->first)
-                next = iter->first;
+            if (! next || next > (*iter)->first)
+                next = (*iter)->first;
             break;
         }
     }
@@ -242,10 +244,7 @@ RawStateTable::erase(
 {
     // The base invariant is checked during apply
     auto const result = items_.emplace(
-        std::piecewise_construct,
-            std::forward_as_tuple(sle->key()),
-                std::forward_as_tuple(
-                    Action::erase, sle));
+        sle->key(), Action::erase, sle);
     if (result.second)
         return;
     auto& item = result.first->second;
@@ -269,10 +268,7 @@ RawStateTable::insert(
     std::shared_ptr<SLE> const& sle)
 {
     auto const result = items_.emplace(
-        std::piecewise_construct,
-            std::forward_as_tuple(sle->key()),
-                std::forward_as_tuple(
-                    Action::insert, sle));
+        sle->key(), Action::insert, sle);
     if (result.second)
         return;
     auto& item = result.first->second;
@@ -296,10 +292,7 @@ RawStateTable::replace(
     std::shared_ptr<SLE> const& sle)
 {
     auto const result = items_.emplace(
-        std::piecewise_construct,
-            std::forward_as_tuple(sle->key()),
-                std::forward_as_tuple(
-                    Action::replace, sle));
+        sle->key(), Action::replace, sle);
     if (result.second)
         return;
     auto& item = result.first->second;
@@ -321,7 +314,7 @@ RawStateTable::read (ReadView const& base,
 {
     auto const iter =
         items_.find(k.key);
-    if (iter == items_.end())
+    if (! iter)
         return base.read(k);
     auto const& item = iter->second;
     if (item.first == Action::erase)
@@ -343,16 +336,18 @@ RawStateTable::destroyXRP(XRPAmount const& fee)
 std::unique_ptr<ReadView::sles_type::iter_base>
 RawStateTable::slesBegin (ReadView const& base) const
 {
+    auto const& sorted = items_.sorted();
     return std::make_unique<sles_iter_impl>(
-        items_.begin(), items_.end(),
+        sorted.begin(), sorted.end(),
             base.sles.begin(), base.sles.end());
 }
 
 std::unique_ptr<ReadView::sles_type::iter_base>
 RawStateTable::slesEnd (ReadView const& base) const
 {
+    auto const& sorted = items_.sorted();
     return std::make_unique<sles_iter_impl>(
-        items_.end(), items_.end(),
+        sorted.end(), sorted.end(),
             base.sles.end(), base.sles.end());
 }
 
@@ -360,7 +355,7 @@ std::unique_ptr<ReadView::sles_type::iter_base>
 RawStateTable::slesUpperBound (ReadView const& base, uint256 const& key) const
 {
     return std::make_unique<sles_iter_impl>(
-            items_.upper_bound(key), items_.end(),
+            items_.upper_bound(key), items_.sorted().end(),
                 base.sles.upper_bound(key), base.sles.end());
 }
 
@@ -28,10 +28,15 @@ class Rules::Impl
 private:
     std::unordered_set<uint256,
         hardened_hash<>> set_;
+    std::unordered_set<uint256,
+        beast::uhash<>> presets_;
     boost::optional<uint256> digest_;
 
 public:
-    Impl (DigestAwareReadView const& ledger)
+    Impl (DigestAwareReadView const& ledger,
+        std::unordered_set<uint256,
+            beast::uhash<>> const& presets)
+        : presets_ (presets)
     {
         auto const k = keylet::amendments();
         digest_ = ledger.digest(k.key);
@@ -52,7 +57,8 @@ public:
     bool
     enabled (uint256 const& feature) const
     {
-        return set_.count(feature) > 0;
+        return set_.count(feature) > 0 ||
+            presets_.count(feature) > 0;
     }
 
     bool
@@ -80,8 +86,10 @@ public:
 
 //------------------------------------------------------------------------------
 
-Rules::Rules (DigestAwareReadView const& ledger)
-    : impl_(std::make_shared<Impl>(ledger))
+Rules::Rules (DigestAwareReadView const& ledger,
+        std::unordered_set<uint256,
+            beast::uhash<>> const& presets)
+    : impl_(std::make_shared<Impl>(ledger, presets))
 {
 }
 
@@ -24,10 +24,12 @@
 #include <ripple/basics/contract.h>
 #include <ripple/basics/Log.h>
 #include <ripple/basics/StringUtilities.h>
+#include <ripple/protocol/Feature.h>
 #include <ripple/protocol/st.h>
 #include <ripple/protocol/Quality.h>
 #include <boost/algorithm/string.hpp>
 #include <cassert>
+#include <limits>
 
 namespace ripple {
 
@@ -39,6 +41,18 @@ namespace ripple {
 #define DIR_NODE_MAX  32
 #endif
 
+/** Maximum number of entries in a reference list page
+    A change would be protocol-breaking.
+*/
+#ifndef REFER_NODE_MAX
+#define REFER_NODE_MAX  32
+#endif
+
+/** Maximum number of entries in an unpaged reference list */
+#ifndef REFER_LIST_MAX
+#define REFER_LIST_MAX  1024
+#endif
+
 //------------------------------------------------------------------------------
 //
 // Observers
@@ -1169,10 +1183,73 @@ offerDelete (ApplyView& view,
         terResult2 : terResult;
 }
 
+// Append a reference to the last page of a paged reference list.
+// Full pages, including an oversized legacy root, are left untouched.
+static
+TER
+addReferToPage (ApplyView& view, SLE::pointer const& sleRoot,
+    AccountID const& refereeID, AccountID const& referenceID,
+        beast::Journal j)
+{
+    if (! sleRoot->isFieldPresent (sfAccount))
+    {
+        sleRoot->setAccountID (sfAccount, refereeID);
+        view.update (sleRoot);
+    }
+
+    auto const rootIndex = sleRoot->key ();
+    std::uint64_t page = sleRoot->isFieldPresent (sfIndexPrevious) ?
+        sleRoot->getFieldU64 (sfIndexPrevious) : 0;
+
+    auto sleNode = page ? view.peek (keylet::refer (rootIndex, page)) : sleRoot;
+    if (! sleNode)
+    {
+        JLOG (j.fatal) << "Missing reference page " << page << " of " << refereeID;
+        return tefBAD_LEDGER;
+    }
+
+    STArray references (sfReferences);
+    if (sleNode->isFieldPresent (sfReferences))
+        references = sleNode->getFieldArray (sfReferences);
+
+    if (references.size () >= REFER_NODE_MAX)
+    {
+        if (! ++page)
+            return tecDIR_FULL;
+
+        // Link a new last page.
+        sleNode->setFieldU64 (sfIndexNext, page);
+        view.update (sleNode);
+
+        sleRoot->setFieldU64 (sfIndexPrevious, page);
+        view.update (sleRoot);
+
+        sleNode = std::make_shared<SLE> (keylet::refer (rootIndex, page));
+        sleNode->setAccountID (sfAccount, refereeID);
+        sleNode->setFieldH256 (sfRootIndex, rootIndex);
+        if (page > 1)
+            sleNode->setFieldU64 (sfIndexPrevious, page - 1);
+        view.insert (sleNode);
+
+        references = STArray (sfReferences);
+    }
+    else
+    {
+        view.update (sleNode);
+    }
+
+    references.push_back (STObject (sfReferenceHolder));
+    references.back ().setAccountID (sfReference, referenceID);
+    sleNode->setFieldArray (sfReferences, references);
+
+    JLOG (j.trace) << "Reference " << referenceID << " added to page " << page << " of " << refereeID;
+    return tesSUCCESS;
+}
+
 TER
 addRefer (ApplyView& view,
     AccountID const& refereeID, AccountID const& referenceID,
-    beast::Journal j)
+    bool paged, beast::Journal j)
 {
     if (refereeID == referenceID)
         return temDST_IS_SRC;
@@ -1219,6 +1296,18 @@ addRefer (ApplyView& view,
 
         return tefREFEREE_EXIST;
     }
+    else if (paged && sleRefereeRefer)
+    {
+        // A reference is in a list exactly when its sfReferee is set, which
+        // was checked above, so the pages need no membership scan.
+        TER const result = addReferToPage (
+            view, sleRefereeRefer, refereeID, referenceID, j);
+        if (result != tesSUCCESS)
+            return result;
+
+        sleReference->setAccountID (sfReferee, refereeID);
+        view.update (sleReference);
+    }
     else
     {
         // set references for referee
@@ -1228,7 +1317,7 @@ addRefer (ApplyView& view,
             if (sleRefereeRefer->isFieldPresent (sfReferences))
             {
                 references = sleRefereeRefer->getFieldArray (sfReferences);
-                if (references.size () > 1024)
+                if (references.size () > REFER_LIST_MAX)
                 {
                     JLOG (j.warning) << "Too many references for " << refereeID << " " << references.size ();
                     return tecDIR_FULL;
@@ -1260,10 +1349,78 @@ addRefer (ApplyView& view,
         sleReference->setAccountID (sfReferee, refereeID);
         view.update (sleReference);
     }
-    
+
+    // A reference may bring the dividend it got before it was listed.
+    if (((view.flags () & tapENABLE_TESTING) ||
+            view.rules ().enabled (featureReferMaxChild, {})) &&
+        sleReference->isFieldPresent (sfDividendLedger) &&
+        sleReference->isFieldPresent (sfDividendVSprd))
+    {
+        updateReferMaxChild (view, refereeID,
+            sleReference->getFieldU32 (sfDividendLedger),
+            sleReference->getFieldU64 (sfDividendVSprd));
+    }
+
     return tesSUCCESS;
 }
 
+void
+forEachReference (ReadView const& view, AccountID const& refereeID,
+    std::function<void (AccountID const&)> f)
+{
+    auto const sleRoot = view.read (keylet::refer (refereeID));
+    auto sleNode = sleRoot;
+    while (sleNode)
+    {
+        if (sleNode->isFieldPresent (sfReferences))
+        {
+            for (auto const& reference : sleNode->getFieldArray (sfReferences))
+                f (reference.getAccountID (sfReference));
+        }
+
+        if (! sleNode->isFieldPresent (sfIndexNext))
+            break;
+        sleNode = view.read (keylet::refer (
+            sleRoot->key (), sleNode->getFieldU64 (sfIndexNext)));
+    }
+}
+
+void
+updateReferMaxChild (ApplyView& view, AccountID const& refereeID,
+    std::uint32_t divLedgerSeq, std::uint64_t divVSprd)
+{
+    auto const sleRoot = view.peek (keylet::refer (refereeID));
+    if (! sleRoot)
+        return;
+
+    if (sleRoot->isFieldPresent (sfDividendLedger))
+    {
+        auto const recorded = sleRoot->getFieldU32 (sfDividendLedger);
+        // A reference added with the dividend of an older ledger
+        if (recorded > divLedgerSeq)
+            return;
+        if (recorded == divLedgerSeq &&
+            sleRoot->getFieldU64 (sfDividendVSprd) >= divVSprd)
+            return;
+    }
+
+    sleRoot->setFieldU32 (sfDividendLedger, divLedgerSeq);
+    sleRoot->setFieldU64 (sfDividendVSprd, divVSprd);
+    view.update (sleRoot);
+}
+
+std::uint64_t
+referMaxChild (ReadView const& view, AccountID const& refereeID,
+    std::uint32_t divLedgerSeq)
+{
+    auto const sleRoot = view.read (keylet::refer (refereeID));
+    if (! sleRoot ||
+        ! sleRoot->isFieldPresent (sfDividendLedger) ||
+        sleRoot->getFieldU32 (sfDividendLedger) != divLedgerSeq)
+        return 0;
+    return sleRoot->getFieldU64 (sfDividendVSprd);
+}
+
 TER
 shareFeeWithReferee (ApplyView& view,
     AccountID const& uSenderID, AccountID const& uIssuerID, const STAmount& saAmount,
@@ -1318,26 +1475,35 @@ shareFeeWithReferee (ApplyView& view,
 
             if (sleCurrent->isFieldPresent (sfReferee))
             {
+                // The max child of the parent does not get a share.
                 auto const parent = sleCurrent->getAccountID (sfReferee);
-                auto const sleReferences = view.read (keylet::refer (parent));
-                if (sleReferences)
+                if (view.exists (keylet::refer (parent)))
                 {
-                    bool isMaxChild = true;;
-                    for (auto const& child : sleReferences->getFieldArray(sfReferences))
+                    bool isMaxChild = true;
+                    if (sleDivObj->isFlag (lsfReferMaxChild))
                     {
-                        auto const childId = child.getAccountID(sfReference);
-                        if (childId == currentAccountID)
-                            continue;
-                        auto const sleChild = view.read (keylet::account (childId));
-                        if (sleChild &&
-                            sleChild->isFieldPresent (sfDividendLedger) &&
-                            sleChild->getFieldU32 (sfDividendLedger) == divLedgerSeq &&
-                            sleChild->isFieldPresent (sfDividendVSprd) &&
-                            sleChild->getFieldU64 (sfDividendVSprd) > divVSpd)
-                        {
-                            isMaxChild = false;
-                            break;
-                        }
+                        // The list keeps its max child for dividends
+                        // applied under ReferMaxChild.
+                        isMaxChild = divVSpd >=
+                            referMaxChild (view, parent, divLedgerSeq);
+                    }
+                    else
+                    {
+                        forEachReference (view, parent,
+                            [&](AccountID const& child)
+                            {
+                                if (! isMaxChild || child == currentAccountID)
+                                    return;
+                                auto const sleChild = view.read (keylet::account (child));
+                                if (sleChild &&
+                                    sleChild->isFieldPresent (sfDividendLedger) &&
+                                    sleChild->getFieldU32 (sfDividendLedger) == divLedgerSeq &&
+                                    sleChild->isFieldPresent (sfDividendVSprd) &&
+                                    sleChild->getFieldU64 (sfDividendVSprd) > divVSpd)
+                                {
+                                    isMaxChild = false;
+                                }
+                            });
                     }
                     if (isMaxChild)
                     {
@@ -1469,6 +1635,25 @@ assetReleased (ApplyView& view,
     return std::make_tuple(released, bIsReleaseFinished);
 }
 
+// True if the asset of a line between the two accounts had its release
+// schedule cleared, which releases everything regardless of time.
+static
+bool
+assetScheduleCleared (ReadView const& view,
+    AccountID const& uSrcAccountID,
+    AccountID const& uDstAccountID,
+    Currency const& currency)
+{
+    for (auto const& issuer : {uSrcAccountID, uDstAccountID})
+    {
+        auto const sleAsset = view.read (keylet::asset (issuer, currency));
+        if (sleAsset && sleAsset->isFieldPresent (sfReleaseSchedule) &&
+            sleAsset->getFieldArray (sfReleaseSchedule).empty ())
+            return true;
+    }
+    return false;
+}
+
 TER
 assetRelease (ApplyView& view,
     AccountID const& uSrcAccountID,
@@ -1484,6 +1669,25 @@ assetRelease (ApplyView& view,
     uint256 assetStateIndex = getQualityIndex(baseIndex);
     uint256 assetStateEnd = getQualityNext(assetStateIndex);
     uint256 assetStateIndexZero = assetStateIndex;
+    std::uint32_t const now = view.info ().parentCloseTime;
+
+    // The line records the earliest next release time of its asset states,
+    // so lines with nothing to release skip the asset state scan. The view's
+    // rules already hold the [features] presets from the config.
+    bool const useCursor = (view.flags () & tapENABLE_TESTING) ||
+        view.rules ().enabled (featureAssetReleaseCursor, {});
+    if (useCursor &&
+        sleRippleState->isFieldPresent (sfNextReleaseTime) &&
+        sleRippleState->isFieldPresent (sfReserve) &&
+        now < sleRippleState->getFieldU32 (sfNextReleaseTime) &&
+        ! assetScheduleCleared (view, uSrcAccountID, uDstAccountID, currency))
+    {
+        JLOG(j.trace) << "no asset release between " << uSrcAccountID << '/' << uDstAccountID
+                      << " before " << sleRippleState->getFieldU32 (sfNextReleaseTime);
+        return terResult;
+    }
+    // Earliest next release among the remaining states, 0 if unknown.
+    std::uint32_t nextRelease = std::numeric_limits<std::uint32_t>::max ();
 
     JLOG(j.trace) << "checking asset between " << uSrcAccountID << '/' << uDstAccountID << " current balance:" << saBalance << " reserved:" << sleRippleState->getFieldAmount (sfReserve);
 
@@ -1525,7 +1729,7 @@ assetRelease (ApplyView& view,
         bool bIsReleaseFinished = false;
         // Make sure next release time is up.
         uint32 nextReleaseTime = sleAssetState->getFieldU32(sfNextReleaseTime);
-        if (nextReleaseTime > view.info ().parentCloseTime)
+        if (nextReleaseTime > now)
             released = delivered;
         else
             std::tie (released, bIsReleaseFinished) = assetReleased (view, amount, assetStateIndex, sleAssetState, j);
@@ -1538,6 +1742,17 @@ assetRelease (ApplyView& view,
             JLOG(j.info) << "asset amount:" << amount << ",delivered:" << delivered << ",releasing left amount:" << released;
         }
 
+        if (! bIsReleaseFinished)
+        {
+            auto const stateNext = sleAssetState->getFieldU32 (sfNextReleaseTime);
+            nextRelease = (stateNext > now) ? std::min (nextRelease, stateNext) : 0;
+        }
+        else if (released <= delivered)
+        {
+            // Finished but kept, evaluate it again next time.
+            nextRelease = 0;
+        }
+
         bool bIssuerHigh = amount.getIssuer() > owner;
 
         // update reserve
@@ -1651,6 +1866,24 @@ assetRelease (ApplyView& view,
         view.update (sleRippleState);
     }
 
+    if (useCursor && terResult == tesSUCCESS)
+    {
+        if (nextRelease == 0)
+        {
+            if (sleRippleState->isFieldPresent (sfNextReleaseTime))
+            {
+                sleRippleState->makeFieldAbsent (sfNextReleaseTime);
+                view.update (sleRippleState);
+            }
+        }
+        else if (!sleRippleState->isFieldPresent (sfNextReleaseTime) ||
+                 sleRippleState->getFieldU32 (sfNextReleaseTime) != nextRelease)
+        {
+            sleRippleState->setFieldU32 (sfNextReleaseTime, nextRelease);
+            view.update (sleRippleState);
+        }
+    }
+
     JLOG(j.trace) << "final balance:" << saBalance << " reserved:" << saReserve;
 
     return terResult;
@@ -1760,9 +1993,17 @@ issueAsset (ApplyView& view,
                 if (tesSUCCESS == terResult)
                     sleRippleState = view.peek (keylet::line (uIndex));
             }
-            // Move released amount to TrustLine
+            // Move released amount to TrustLine, the new or topped up state
+            // invalidates the line's release cursor.
             if (tesSUCCESS == terResult)
+            {
+                if (sleRippleState && sleRippleState->isFieldPresent (sfNextReleaseTime))
+                {
+                    sleRippleState->makeFieldAbsent (sfNextReleaseTime);
+                    view.update (sleRippleState);
+                }
                 assetRelease (view, uSenderID, uReceiverID, currency, sleRippleState, j);
+            }
             return {true, terResult};
         }
     }
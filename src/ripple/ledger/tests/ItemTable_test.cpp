@@ -0,0 +1,136 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/ledger/detail/ItemTable.h>
+#include <ripple/basics/qalloc.h>
+#include <beast/unit_test/suite.h>
+#include <map>
+#include <random>
+
+namespace ripple {
+namespace test {
+
+class ItemTable_test : public beast::unit_test::suite
+{
+    using Table = detail::ItemTable<int,
+        qalloc_type<std::pair<uint256 const, int>, false>>;
+
+    // Checks the table against a reference map
+    void
+    check (Table const& t, std::map<uint256, int> const& m)
+    {
+        expect (t.size() == m.size());
+        auto const& sorted = t.sorted();
+        if (! expect (sorted.size() == m.size()))
+            return;
+        auto iter = m.begin();
+        for (auto const e : sorted)
+        {
+            if (! expect (e->first == iter->first &&
+                    e->second == iter->second))
+                return;
+            expect (t.find (e->first) == e);
+            ++iter;
+        }
+    }
+
+    void
+    testRandom()
+    {
+        testcase ("random");
+
+        std::mt19937 gen;
+        std::uniform_int_distribution<int> dist (0, 511);
+        Table t;
+        std::map<uint256, int> m;
+        for (int i = 0; i < 4000; ++i)
+        {
+            uint256 const key (dist (gen));
+            auto const e = t.find (key);
+            expect ((e != nullptr) == (m.count (key) != 0));
+            if (e && gen() % 2 == 0)
+            {
+                t.erase (e);
+                m.erase (key);
+            }
+            else
+            {
+                auto const result = t.emplace (key, i);
+                expect (result.second == (e == nullptr));
+                result.first->second = i;
+                m[key] = i;
+            }
+            if (gen() % 64 == 0)
+                check (t, m);
+        }
+        check (t, m);
+
+        for (int i = 0; i < 100; ++i)
+        {
+            uint256 const key (dist (gen));
+            auto const iter = t.upper_bound (key);
+            auto const ref = m.upper_bound (key);
+            if (ref == m.end())
+                expect (iter == t.sorted().end());
+            else
+                expect (iter != t.sorted().end() &&
+                    (*iter)->first == ref->first);
+        }
+    }
+
+    void
+    testCopy()
+    {
+        testcase ("copy");
+
+        Table t;
+        std::map<uint256, int> m;
+        for (int i = 0; i < 100; ++i)
+        {
+            t.emplace (uint256 (100 - i), i);
+            m.emplace (uint256 (100 - i), i);
+        }
+        t.sorted();
+        t.emplace (uint256 (1000), 1000);
+        m.emplace (uint256 (1000), 1000);
+
+        Table c (t);
+        check (c, m);
+        c.erase (c.find (uint256 (50)));
+        expect (t.find (uint256 (50)) != nullptr);
+        check (t, m);
+
+        Table moved (std::move (t));
+        check (moved, m);
+        expect (t.empty() && t.sorted().empty());
+    }
+
+    void
+    run()
+    {
+        testRandom();
+        testCopy();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(ItemTable,ledger,ripple);
+
+} // test
+} // ripple
@@ -21,6 +21,7 @@
 #define RIPPLE_NODESTORE_BACKEND_H_INCLUDED
 
 #include <ripple/nodestore/Types.h>
+#include <set>
 
 namespace ripple {
 namespace NodeStore {
@@ -70,17 +71,39 @@ public:
     bool
     canFetchBatch() = 0;
 
-    /** Fetch a batch synchronously. */
+    /** Fetch a batch synchronously.
+        @return The object of each key, null where it was not found.
+    */
     virtual
     std::vector<std::shared_ptr<NodeObject>>
     fetchBatch (std::size_t n, void const* const* keys) = 0;
 
-    /** Fetch a batch synchronously. */
+    /** Fetch a batch synchronously.
+        @return The objects found and the hashes which were not.
+    */
     virtual
     std::pair<std::vector<std::shared_ptr<NodeObject>>, std::set<uint256>>
     fetchBatch (const std::set<uint256>& hashes)
     {
-        return std::make_pair (std::vector<std::shared_ptr<NodeObject>> (), hashes);
+        std::vector<void const*> keys;
+        keys.reserve (hashes.size ());
+        for (auto const& hash : hashes)
+            keys.push_back (hash.data ());
+
+        auto found = fetchBatch (keys.size (), keys.data ());
+
+        std::vector<std::shared_ptr<NodeObject>> objects;
+        std::set<uint256> hashesNotFound;
+        auto object = found.begin ();
+        for (auto const& hash : hashes)
+        {
+            if (*object)
+                objects.push_back (std::move (*object));
+            else
+                hashesNotFound.insert (hashesNotFound.end (), hash);
+            ++object;
+        }
+        return std::make_pair (std::move (objects), std::move (hashesNotFound));
     }
 
     virtual
@@ -109,6 +109,13 @@ public:
                         Blob&& data,
                         uint256 const& hash) = 0;
 
+    /** Store a batch of objects in one write to the backend.
+
+        This may be called concurrently. The objects are in the cache
+        when this returns.
+    */
+    virtual void storeBatch (Batch const& batch) = 0;
+
     /** Visit every object in the database
         This is usually called during import.
 
@@ -29,8 +29,11 @@
 #include <ripple/nodestore/impl/DecodedBlob.h>
 #include <ripple/nodestore/impl/EncodedBlob.h>
 #include <beast/threads/Thread.h>
+#include <algorithm>
 #include <atomic>
 #include <memory>
+#include <mutex>
+#include <numeric>
 #include <boost/format.hpp>
 
 #include <ripple/thrift/HBaseConn.h>
@@ -52,8 +55,15 @@ private:
     static constexpr auto s_tableName =     SYSTEM_NAMESPACE ":NodeStore";
     static constexpr auto s_columnFamily =  "d:";
     static constexpr auto s_columnName =    "d:v";
-    
-    HBaseConnFactory m_hbaseFactory;
+
+    // Attempts of a fetch before it is given up.
+    static constexpr int s_fetchAttempts =  3;
+
+    HBaseConnPool m_pool;
+
+    // Start keys of the table regions, used to partition batch fetches.
+    std::mutex m_regionMutex;
+    std::vector<std::string> m_regionStarts;
 
 public:
     HbaseBackend (int keyBytes, Section const& keyValues,
@@ -63,7 +73,7 @@ public:
         , m_keyBytes (keyBytes)
         , m_scheduler (scheduler)
         , m_batch (*this, scheduler)
-        , m_hbaseFactory (keyValues, journal)
+        , m_pool (keyValues, journal)
     {
         using namespace apache::thrift;
         using namespace apache::hadoop::hbase::thrift;
@@ -81,7 +91,7 @@ public:
             columns.back ().blockCacheEnabled = true;
             columns.back ().bloomFilterType = "ROW";
 //            columns.back ().timeToLive = 3 * 24 * 3600;
-            getConnection ()->m_client->createTable (table, columns);
+            m_pool.acquire ().client ().createTable (table, columns);
         }
         catch (const apache::hadoop::hbase::thrift::AlreadyExists& ae)
         {
@@ -91,6 +101,8 @@ public:
         {
             throw std::runtime_error (std::string ("Unable to open/create Hbase: ") + te.what ());
         }
+
+        loadRegions ();
     }
 
     ~HbaseBackend ()
@@ -109,16 +121,6 @@ public:
         return "hbase";
     }
 
-    HBaseConn* getConnection ()
-    {
-        return m_hbaseFactory.getConnection ();
-    }
-
-    void releaseConnection ()
-    {
-        m_hbaseFactory.release ();
-    }
-
     //--------------------------------------------------------------------------
 
     Status
@@ -126,80 +128,56 @@ public:
     {
         using namespace apache::thrift;
         using namespace apache::hadoop::hbase::thrift;
-        
+
         pObject->reset ();
 
         Status status (ok);
-        for (;;)
+        std::string const row = to_string (uint256::fromVoid (key));
+        for (int attempt = 0; attempt < s_fetchAttempts; ++attempt)
         {
-        try
-        {
-            std::vector<TRowResult> rowResult;
-            std::map<Text, Text> attributes;
-            std::string row = to_string (uint256::fromVoid (key));
-            getConnection ()->m_client->getRow (rowResult, s_tableName, row, attributes);
-            if (rowResult.empty ())
-            {
-                status = notFound;
-            }
-            else if (rowResult.size () != 1)
-            {
-                status = dataCorrupt;
-                if (m_journal.error)
-                    m_journal.error << rowResult.size () << " objects found for NodeObject #" << row;
-            }
-            else
+            HBaseConnPool::Lease lease;
+            try
             {
-                auto& columns = rowResult.front ().columns;
-                if (columns.find (s_columnName) == columns.end ())
+                lease = m_pool.acquire ();
+                std::vector<TRowResult> rowResult;
+                std::map<Text, Text> attributes;
+                lease.client ().getRowWithColumns (rowResult, s_tableName, row, {s_columnName}, attributes);
+                if (rowResult.empty ())
                 {
                     status = notFound;
+                }
+                else if (rowResult.size () != 1)
+                {
+                    status = dataCorrupt;
                     if (m_journal.error)
-                        m_journal.error << "row found but column not found for NodeObject #" << row;
+                        m_journal.error << rowResult.size () << " objects found for NodeObject #" << row;
                 }
                 else
                 {
-                    auto& data = columns[s_columnName].value;
-                    DecodedBlob decoded (key, data.data (), data.size ());
-
-                    if (decoded.wasOk ())
-                    {
-                        *pObject = decoded.createObject ();
-                    }
-                    else
-                    {
-                        // Decoding failed, probably corrupted!
-                        //
-                        status = dataCorrupt;
-                    }
+                    status = decode (key, rowResult.front (), *pObject);
                 }
+                return status;
             }
-            break;
-        }
-        catch (TApplicationException& tae)
-        {
-            if (tae.getType () == TApplicationException::MISSING_RESULT)
-                status = notFound;
-            else
+            catch (TApplicationException& tae)
             {
+                if (tae.getType () == TApplicationException::MISSING_RESULT)
+                    return notFound;
                 status = Status (customCode + tae.getType ());
-                m_journal.error << tae.what () << "(TApplicationException) getting NodeObject #" << uint256::fromVoid (key);
+                m_journal.error << tae.what () << "(TApplicationException) getting NodeObject #" << row;
+                return status;
             }
-        }
-        catch (const transport::TTransportException& tte)
-        {
-            status = tte.getType () == transport::TTransportException::CORRUPTED_DATA ? dataCorrupt : Status (customCode + tte.getType ());
-            m_journal.error << tte.what () << "(TTransportException) getting NodeObject #" << uint256::fromVoid (key);
-            releaseConnection ();
-            std::this_thread::sleep_for (std::chrono::seconds (1));
-        }
-        catch (const TException& te)
-        {
-            status = Status (customCode);
-            m_journal.error << te.what () << " getting NodeObject #" << uint256::fromVoid (key);
-            releaseConnection ();
-            std::this_thread::sleep_for (std::chrono::seconds (1));
-        }
+            catch (const transport::TTransportException& tte)
+            {
+                status = tte.getType () == transport::TTransportException::CORRUPTED_DATA ? dataCorrupt : Status (customCode + tte.getType ());
+                m_journal.error << tte.what () << "(TTransportException) getting NodeObject #" << row;
+            }
+            catch (const std::exception& e)
+            {
+                status = Status (customCode);
+                m_journal.error << e.what () << " getting NodeObject #" << row;
+            }
+            // the next attempt gets another connection
+            lease.fail ();
         }
         return status;
     }
@@ -209,84 +187,48 @@ public:
     std::vector<std::shared_ptr<NodeObject>>
     fetchBatch (std::size_t n, void const* const* keys) override
     {
-        throw std::runtime_error("pure virtual called");
-        return {};
+        // Sorted keys go to fewer regions per part.
+        std::vector<std::size_t> order (n);
+        std::iota (order.begin (), order.end (), 0);
+        std::sort (order.begin (), order.end (), [keys](std::size_t a, std::size_t b)
+        {
+            return uint256::fromVoid (keys[a]) < uint256::fromVoid (keys[b]);
+        });
+
+        std::vector<uint256> sorted;
+        sorted.reserve (n);
+        for (auto i : order)
+            sorted.push_back (uint256::fromVoid (keys[i]));
+
+        auto found = fetchSorted (sorted);
+        std::vector<std::shared_ptr<NodeObject>> objects (n);
+        for (std::size_t i = 0; i < n; ++i)
+            objects[order[i]] = std::move (found[i]);
+        return objects;
     }
-    
+
     uint32_t
     fetchBatchLimit ()
     {
-        return m_hbaseFactory.getSetup ().fetchBatchLimit;
+        return m_pool.getSetup ().fetchBatchLimit;
     }
 
     std::pair<std::vector<std::shared_ptr<NodeObject>>, std::set<uint256>>
     fetchBatch (const std::set<uint256>& hashes)
     {
-        using namespace apache::thrift;
-        using namespace apache::hadoop::hbase::thrift;
-        
-        std::vector<std::shared_ptr<NodeObject>> objects;
-        std::set<uint256> hashesNotFound (hashes);
-
-        std::vector<TRowResult> rowResults;
-        std::map<Text, Text> attributes;
-        std::vector<std::string> rows;
-        for (auto& hash : hashes)
-            rows.emplace_back (to_string (hash));
+        std::vector<uint256> const sorted (hashes.begin (), hashes.end ());
+        auto found = fetchSorted (sorted);
 
-        for (int i = 0; i < 3; ++i)
+        std::vector<std::shared_ptr<NodeObject>> objects;
+        std::set<uint256> hashesNotFound;
+        for (std::size_t i = 0; i < sorted.size (); ++i)
         {
-            try
-            {
-                getConnection ()->m_client->getRows (rowResults, s_tableName, rows, attributes);
-                for (auto& row : rowResults)
-                {
-                    auto& columns = row.columns;
-                    if (columns.find (s_columnName) == columns.end ())
-                    {
-                        if (m_journal.error)
-                            m_journal.error << "row found but column not found for NodeObject #" << row.row;
-                    }
-                    else
-                    {
-                        auto& data = columns[s_columnName].value;
-                        uint256 key = from_hex_text<uint256> (row.row);
-                        DecodedBlob decoded (key.data (), data.data (), data.size ());
-
-                        if (decoded.wasOk ())
-                        {
-                            objects.emplace_back (decoded.createObject ());
-                            hashesNotFound.erase (objects.back ()->getHash ());
-                        }
-                        else
-                        {
-                            // Decoding failed, probably corrupted!
-                            //
-                            if (m_journal.fatal)
-                                m_journal.fatal << "Corrupt NodeObject #" << row.row;
-                        }
-                    }
-                }
-                break;
-            }
-            catch (TApplicationException& tae)
-            {
-                m_journal.error << tae.what () << "(TApplicationException) getting " << hashes.size () << " NodeObjects, code " << tae.getType ();
-            }
-            catch (const transport::TTransportException& tte)
-            {
-                m_journal.error << tte.what () << "(TTransportException) getting " << hashes.size () << " NodeObjects, code " << tte.getType ();
-                releaseConnection ();
-                std::this_thread::sleep_for (std::chrono::seconds (1));
-            }
-            catch (const TException& te)
-            {
-                m_journal.error << te.what () << " getting " << hashes.size () << " NodeObjects";
-                releaseConnection ();
-                std::this_thread::sleep_for (std::chrono::seconds (1));
-            }
+            if (found[i])
+                objects.push_back (std::move (found[i]));
+            else
+                hashesNotFound.insert (hashesNotFound.end (), sorted[i]);
         }
-        return std::make_pair (objects, hashesNotFound);
+        return std::make_pair (std::move (objects), std::move (hashesNotFound));
     }
 
     void
@@ -323,16 +265,18 @@ public:
         //for (int i = 0; i < 3; i++)
         for (;;)
         {
+            HBaseConnPool::Lease lease;
             try
             {
+                lease = m_pool.acquire ();
                 std::map<Text, Text> attributes;
-                getConnection ()->m_client->mutateRows (s_tableName, rowBatches, attributes);
+                lease.client ().mutateRows (s_tableName, rowBatches, attributes);
                 return;
             }
-            catch (const TException& te)
+            catch (const std::exception& e)
             {
-                m_journal.error << "storeBatch failed: " << te.what ();
-                releaseConnection ();
+                m_journal.error << "storeBatch failed: " << e.what ();
+                lease.fail ();
                 std::this_thread::sleep_for (std::chrono::seconds (1));
             }
         }
@@ -350,13 +294,14 @@ public:
 
         std::map<Text, Text> attributes;
 
-        auto scanner = getConnection ()->m_client->scannerOpenWithScan(s_tableName, scan, attributes);
+        auto lease = m_pool.acquire ();
+        auto scanner = lease.client ().scannerOpenWithScan(s_tableName, scan, attributes);
         
         std::vector<TRowResult> rowList;
 
         for (;;)
         {
-            getConnection ()->m_client->scannerGetList (rowList, scanner, 100);
+            lease.client ().scannerGetList (rowList, scanner, 100);
             if (rowList.empty ())
                 break;
             
@@ -371,32 +316,13 @@ public:
                     continue;
                 }
 
-                auto& columns = row.columns;
-                if (columns.find (s_columnName) == columns.end ())
-                {
-                    if (m_journal.fatal)
-                        m_journal.fatal << "column not found for NodeObject #" << row.row;
-                    continue;
-                }
-
-                auto& data = columns[s_columnName].value;
                 uint256 key = from_hex_text<uint256> (row.row);
-                DecodedBlob decoded (key.data (),
-                                     data.data (),
-                                     data.size ());
-
-                if (decoded.wasOk ())
-                {
-                    f (decoded.createObject ());
-                }
-                else
-                {
-                    // Uh oh, corrupted data!
-                    if (m_journal.fatal)
-                        m_journal.fatal << "Corrupt NodeObject #" << row.row;
-                }
+                std::shared_ptr<NodeObject> object;
+                if (decode (key.data (), row, object) == ok)
+                    f (object);
             }
         }
+        lease.client ().scannerClose (scanner);
     }
 
     int
@@ -423,6 +349,187 @@ public:
     verify() override
     {
     }
+
+private:
+    Status
+    decode (void const* key, apache::hadoop::hbase::thrift::TRowResult& row,
+        std::shared_ptr<NodeObject>& object)
+    {
+        auto& columns = row.columns;
+        auto const column = columns.find (s_columnName);
+        if (column == columns.end ())
+        {
+            if (m_journal.error)
+                m_journal.error << "row found but column not found for NodeObject #" << row.row;
+            return notFound;
+        }
+
+        auto& data = column->second.value;
+        DecodedBlob decoded (key, data.data (), data.size ());
+        if (!decoded.wasOk ())
+        {
+            // Decoding failed, probably corrupted!
+            //
+            if (m_journal.fatal)
+                m_journal.fatal << "Corrupt NodeObject #" << row.row;
+            return dataCorrupt;
+        }
+
+        object = decoded.createObject ();
+        return ok;
+    }
+
+    void
+    loadRegions ()
+    {
+        using namespace apache::hadoop::hbase::thrift;
+
+        try
+        {
+            std::vector<TRegionInfo> regions;
+            m_pool.acquire ().client ().getTableRegions (regions, s_tableName);
+
+            std::vector<std::string> starts;
+            for (auto const& region : regions)
+            {
+                if (!region.startKey.empty ())
+                    starts.push_back (region.startKey);
+            }
+            std::sort (starts.begin (), starts.end ());
+
+            std::lock_guard<std::mutex> lock (m_regionMutex);
+            m_regionStarts = std::move (starts);
+        }
+        catch (const std::exception& e)
+        {
+            m_journal.warning << "Unable to get regions of " << s_tableName << ": " << e.what ();
+        }
+    }
+
+    /** Fetch sorted keys, spreading them over the free connections.
+
+        Each connection is sent its part before any reply is read, so the
+        parts are served by the region servers at the same time.
+
+        @return The object of each key, null if not found.
+    */
+    std::vector<std::shared_ptr<NodeObject>>
+    fetchSorted (std::vector<uint256> const& keys)
+    {
+        using namespace apache::thrift;
+        using namespace apache::hadoop::hbase::thrift;
+
+        std::vector<std::shared_ptr<NodeObject>> objects (keys.size ());
+
+        std::vector<std::size_t> pending (keys.size ());
+        std::iota (pending.begin (), pending.end (), 0);
+        for (int attempt = 0; !pending.empty () && attempt < s_fetchAttempts; ++attempt)
+        {
+            std::vector<HBaseConnPool::Lease> leases;
+            try
+            {
+                leases.push_back (m_pool.acquire ());
+            }
+            catch (const std::exception& e)
+            {
+                m_journal.error << e.what () << " getting " << pending.size () << " NodeObjects";
+                continue;
+            }
+            // Only take connections that are free, waiting for more while
+            // holding one could deadlock with another batch.
+            while (leases.size () < m_pool.size ())
+            {
+                try
+                {
+                    auto lease = m_pool.tryAcquire ();
+                    if (!lease)
+                        break;
+                    leases.push_back (std::move (lease));
+                }
+                catch (const std::exception&)
+                {
+                    break;
+                }
+            }
+
+            std::vector<std::string> rows;
+            rows.reserve (pending.size ());
+            for (auto i : pending)
+                rows.push_back (to_string (keys[i]));
+
+            std::vector<std::size_t> ends;
+            {
+                std::lock_guard<std::mutex> lock (m_regionMutex);
+                ends = partitionRows (rows, m_regionStarts, leases.size ());
+            }
+
+            std::map<Text, Text> attributes;
+            std::vector<Text> const columns {s_columnName};
+            std::vector<bool> sent (ends.size (), false);
+            for (std::size_t part = 0, begin = 0; part < ends.size (); begin = ends[part++])
+            {
+                try
+                {
+                    leases[part].client ().send_getRowsWithColumns (s_tableName,
+                        std::vector<Text> (rows.begin () + begin, rows.begin () + ends[part]),
+                        columns, attributes);
+                    sent[part] = true;
+                }
+                catch (const std::exception& e)
+                {
+                    m_journal.error << e.what () << " sending " << (ends[part] - begin) << " NodeObject requests";
+                    leases[part].fail ();
+                }
+            }
+
+            std::vector<std::size_t> failed;
+            for (std::size_t part = 0, begin = 0; part < ends.size (); begin = ends[part++])
+            {
+                try
+                {
+                    if (!sent[part])
+                        throw std::runtime_error ("not sent");
+
+                    std::vector<TRowResult> rowResults;
+                    leases[part].client ().recv_getRowsWithColumns (rowResults);
+
+                    // Both are sorted, so results are matched in one pass.
+                    std::size_t i = begin;
+                    for (auto& row : rowResults)
+                    {
+                        while (i < ends[part] && rows[i] < row.row)
+                            ++i;
+                        if (i == ends[part] || rows[i] != row.row)
+                            continue;
+                        auto const index = pending[i];
+                        decode (keys[index].data (), row, objects[index]);
+                    }
+                }
+                catch (const std::exception& e)
+                {
+                    if (sent[part])
+                    {
+                        m_journal.error << e.what () << " getting " << (ends[part] - begin) << " NodeObjects";
+                        leases[part].fail ();
+                    }
+                    for (auto i = begin; i < ends[part]; ++i)
+                        failed.push_back (pending[i]);
+                }
+            }
+
+            if (!failed.empty ())
+            {
+                // Regions may have moved or split.
+                leases.clear ();
+                loadRegions ();
+            }
+            pending = std::move (failed);
+        }
+
+        if (!pending.empty ())
+            m_journal.error << "gave up getting " << pending.size () << " NodeObjects";
+        return objects;
+    }
 };
 
 //------------------------------------------------------------------------------
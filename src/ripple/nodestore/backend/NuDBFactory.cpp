@@ -149,14 +149,21 @@ public:
     bool
     canFetchBatch() override
     {
+        // NuDB has no multi-get, grouping reads only serializes them.
         return false;
     }
 
     std::vector<std::shared_ptr<NodeObject>>
     fetchBatch (std::size_t n, void const* const* keys) override
     {
-        Throw<std::runtime_error> ("pure virtual called");
-        return {};
+        std::vector<std::shared_ptr<NodeObject>> objects (n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            if (fetch (keys[i], &objects[i]) == dataCorrupt)
+                journal_.fatal <<
+                    "Corrupt NodeObject #" << uint256::fromVoid (keys[i]);
+        }
+        return objects;
     }
 
     void
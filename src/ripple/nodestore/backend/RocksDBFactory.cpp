@@ -31,8 +31,11 @@
 #include <ripple/nodestore/impl/DecodedBlob.h>
 #include <ripple/nodestore/impl/EncodedBlob.h>
 #include <beast/threads/Thread.h>
+#include <algorithm>
 #include <atomic>
+#include <cstring>
 #include <memory>
+#include <numeric>
 
 namespace ripple {
 namespace NodeStore {
@@ -99,6 +102,8 @@ public:
     BatchWriter m_batch;
     std::string m_name;
     std::unique_ptr <rocksdb::DB> m_db;
+    bool m_fetchBatch = false;
+    std::uint32_t m_fetchBatchMax = 256;
 
     RocksDBBackend (int keyBytes, Section const& keyValues,
         Scheduler& scheduler, beast::Journal journal, RocksDBEnv* env)
@@ -111,6 +116,9 @@ public:
         if (! get_if_exists(keyValues, "path", m_name))
             Throw<std::runtime_error> ("Missing path in RocksDBFactory backend");
 
+        m_fetchBatch = get<int> (keyValues, "fetch_batch", 0) != 0;
+        m_fetchBatchMax = std::max (get<int> (keyValues, "fetch_batch_max", 256), 1);
+
         rocksdb::Options options;
         rocksdb::BlockBasedTableOptions table_options;
         options.create_if_missing = true;
@@ -258,14 +266,55 @@ public:
     bool
     canFetchBatch() override
     {
-        return false;
+        return m_fetchBatch;
+    }
+
+    uint32_t
+    fetchBatchLimit () override
+    {
+        return m_fetchBatchMax;
     }
 
     std::vector<std::shared_ptr<NodeObject>>
     fetchBatch (std::size_t n, void const* const* keys) override
     {
-        Throw<std::runtime_error> ("pure virtual called");
-        return {};
+        // In key order the lookups walk each table's blocks forward.
+        std::vector<std::size_t> order (n);
+        std::iota (order.begin (), order.end (), 0);
+        std::sort (order.begin (), order.end (),
+            [this, keys](std::size_t a, std::size_t b)
+            {
+                return std::memcmp (keys[a], keys[b], m_keyBytes) < 0;
+            });
+
+        std::vector<rocksdb::Slice> slices;
+        slices.reserve (n);
+        for (auto i : order)
+            slices.emplace_back (static_cast <char const*> (keys[i]), m_keyBytes);
+
+        rocksdb::ReadOptions const options;
+        std::vector<std::string> values;
+        auto const statuses = m_db->MultiGet (options, slices, &values);
+
+        std::vector<std::shared_ptr<NodeObject>> objects (n);
+        for (std::size_t j = 0; j < n; ++j)
+        {
+            auto const i = order[j];
+            if (statuses[j].ok ())
+            {
+                DecodedBlob decoded (keys[i], values[j].data (), values[j].size ());
+
+                if (decoded.wasOk ())
+                    objects[i] = decoded.createObject ();
+                else
+                    m_journal.fatal << "Corrupt NodeObject #" << uint256::fromVoid (keys[i]);
+            }
+            else if (!statuses[j].IsNotFound ())
+            {
+                m_journal.error << statuses[j].ToString ();
+            }
+        }
+        return objects;
     }
 
     void
@@ -236,6 +236,10 @@ public:
         std::vector<std::shared_ptr<NodeObject>> objects;
         std::set<uint256> hashesNotFound;
         std::tie (objects, hashesNotFound) = m_backend->fetchBatch (hashes);
+        m_fetchTotalCount += hashes.size ();
+        m_fetchHitCount += objects.size ();
+        for (auto const& obj : objects)
+            m_fetchSize += obj->getData ().size ();
         std::chrono::milliseconds const elapsed =
             std::chrono::duration_cast<std::chrono::milliseconds> (
                 std::chrono::steady_clock::now () - before) /
@@ -397,6 +401,34 @@ public:
         m_negCache.erase (hash);
     }
 
+    void storeBatch (Batch const& batch) override
+    {
+        storeBatchInternal (batch, *m_backend.get());
+    }
+
+    void storeBatchInternal (Batch const& batch, Backend& backend)
+    {
+        if (batch.empty ())
+            return;
+
+        std::uint32_t size = 0;
+        for (auto object : batch)
+        {
+            #if RIPPLE_VERIFY_NODEOBJECT_KEYS
+            assert (object->getHash () ==
+                sha512Hash (makeSlice (object->getData ())));
+            #endif
+
+            m_cache.canonicalize (object->getHash (), object, true);
+            m_negCache.erase (object->getHash ());
+            size += object->getData ().size ();
+        }
+
+        backend.storeBatch (batch);
+        m_storeCount += batch.size ();
+        m_storeSize += size;
+    }
+
     //------------------------------------------------------------------------------
 
     float getCacheHitRate () override
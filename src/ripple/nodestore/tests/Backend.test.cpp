@@ -42,6 +42,8 @@ public:
         beast::UnitTestUtilities::TempDirectory path ("node_db");
         params.set ("type", type);
         params.set ("path", path.getFullPathName ().toStdString ());
+        // Batched reads are off unless configured
+        params.set ("fetch_batch", "1");
 
         // Create a batch
         Batch batch;
@@ -71,6 +73,11 @@ public:
                 fetchCopyOfBatch (*backend, &copy, batch);
                 expect (areBatchesEqual (batch, copy), "Should be equal");
             }
+
+            // NuDB reads one key at a time whatever the config says
+            if (type == "nudb")
+                expect (! backend->canFetchBatch (), "Should not batch reads");
+            testFetchBatch (*backend, batch, seedValue);
         }
 
         {
@@ -88,6 +95,59 @@ public:
         }
     }
 
+    // Read a batch in one call, with keys that are not there, and check
+    // it against reading each key on its own
+    void testFetchBatch (Backend& backend, Batch const& batch,
+                         std::int64_t const seedValue)
+    {
+        Batch absent;
+        createPredictableBatch (absent, 16, seedValue + 1);
+
+        std::vector<void const*> keys;
+        for (auto const& object : batch)
+            keys.push_back (object->getHash ().data ());
+        for (std::size_t i = 0; i < absent.size (); ++i)
+            keys.insert (keys.begin () + (i * keys.size ()) / absent.size (),
+                absent[i]->getHash ().data ());
+        keys.push_back (absent.front ()->getHash ().data ());
+
+        auto const found = backend.fetchBatch (keys.size (), keys.data ());
+        expect (found.size () == keys.size (), "Should have every key");
+        if (found.size () != keys.size ())
+            return;
+
+        Batch copy;
+        std::size_t missing = 0;
+        for (std::size_t i = 0; i < keys.size (); ++i)
+        {
+            std::shared_ptr<NodeObject> object;
+            Status const status = backend.fetch (keys[i], &object);
+            expect (status == ok || status == notFound, "Should fetch");
+            expect ((object == nullptr) == (found[i] == nullptr),
+                "Should match fetch");
+            if (! object || ! found[i])
+            {
+                ++missing;
+                continue;
+            }
+            expect (isSame (object, found[i]), "Should match fetch");
+            copy.push_back (found[i]);
+        }
+        expect (missing == absent.size () + 1, "Should be missing");
+        expect (areBatchesEqual (batch, copy), "Should be equal");
+
+        std::set<uint256> hashes;
+        for (auto const& object : batch)
+            hashes.insert (object->getHash ());
+        std::set<uint256> notFound;
+        for (auto const& object : absent)
+            notFound.insert (object->getHash ());
+        hashes.insert (notFound.begin (), notFound.end ());
+        auto const result = backend.fetchBatch (hashes);
+        expect (result.first.size () == batch.size (), "Should find the batch");
+        expect (result.second == notFound, "Should not find the missing keys");
+    }
+
     //--------------------------------------------------------------------------
 
     void run ()
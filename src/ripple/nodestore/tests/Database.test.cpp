@@ -130,6 +130,16 @@ public:
                 fetchCopyOfBatch (*db, &copy, batch);
                 expect (areBatchesEqual (batch, copy), "Should be equal");
             }
+
+            {
+                // Write another batch in one call and read it back
+                Batch more;
+                createPredictableBatch (more, numObjectsToTest, seedValue + 1);
+                db->storeBatch (more);
+                Batch copy;
+                fetchCopyOfBatch (*db, &copy, more);
+                expect (areBatchesEqual (more, copy), "Should be equal");
+            }
         }
 
         if (testPersistence)
@@ -142,7 +142,10 @@ public:
     enum
     {
         // percent of fetches for missing nodes
-        missingNodePercent = 20
+        missingNodePercent = 20,
+
+        // keys per fetchBatch call
+        batchSize = 256
     };
 
     std::size_t const default_repeat = 3;
@@ -383,6 +386,88 @@ public:
         backend->close();
     }
 
+    // Fetch existing keys, batchSize at a time
+    void
+    do_fetch_batch (Section const& config, Params const& params)
+    {
+        beast::Journal journal;
+        DummyScheduler scheduler;
+        Section batchConfig (config);
+        batchConfig.set ("fetch_batch", "1");
+        auto backend = make_Backend (batchConfig, scheduler, journal);
+        expect (backend != nullptr);
+
+        class Body
+        {
+        private:
+            suite& suite_;
+            Backend& backend_;
+            Sequence seq1_;
+            beast::xor_shift_engine gen_;
+            std::uniform_int_distribution<std::size_t> dist_;
+
+        public:
+            Body (std::size_t id, suite& s,
+                    Params const& params, Backend& backend)
+                : suite_(s)
+                , backend_ (backend)
+                , seq1_ (1)
+                , gen_ (id + 1)
+                , dist_ (0, params.items - 1)
+            {
+            }
+
+            void
+            operator()(std::size_t i)
+            {
+                try
+                {
+                    Batch batch;
+                    std::vector<void const*> keys;
+                    for (std::size_t j = 0; j < batchSize; ++j)
+                    {
+                        batch.push_back (seq1_.obj(dist_(gen_)));
+                        keys.push_back (batch.back()->getHash().data());
+                    }
+
+                    if (backend_.canFetchBatch())
+                    {
+                        auto const result =
+                            backend_.fetchBatch(keys.size(), keys.data());
+                        for (std::size_t j = 0; j < batchSize; ++j)
+                            suite_.expect (result[j] &&
+                                isSame(result[j], batch[j]));
+                        return;
+                    }
+
+                    for (auto const& obj : batch)
+                    {
+                        std::shared_ptr<NodeObject> result;
+                        backend_.fetch(obj->getHash().data(), &result);
+                        suite_.expect (result && isSame(result, obj));
+                    }
+                }
+                catch(std::exception const& e)
+                {
+                    suite_.fail(e.what());
+                }
+            }
+        };
+        try
+        {
+            parallel_for_id<Body>(params.items / batchSize, params.threads,
+                std::ref(*this), std::ref(params), std::ref(*backend));
+        }
+        catch (std::exception const&)
+        {
+        #if NODESTORE_TIMING_DO_VERIFY
+            backend->verify();
+        #endif
+            Throw();
+        }
+        backend->close();
+    }
+
     // Perform lookups of non-existent keys
     void
     do_missing (Section const& config, Params const& params)
@@ -721,6 +806,7 @@ public:
             {
                  { "Insert",    &Timing_test::do_insert }
                 ,{ "Fetch",     &Timing_test::do_fetch }
+                ,{ "Batch",     &Timing_test::do_fetch_batch }
                 ,{ "Missing",   &Timing_test::do_missing }
                 ,{ "Mixed",     &Timing_test::do_mixed }
                 ,{ "Work",      &Timing_test::do_work }
@@ -24,9 +24,11 @@
 #include <boost/asio/buffer.hpp>
 #include <boost/asio/buffers_iterator.hpp>
 #include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <iterator>
 #include <memory>
+#include <mutex>
 #include <type_traits>
 
 namespace ripple {
@@ -54,15 +56,53 @@ public:
     */
     static size_t const kHeaderBytes = 6;
 
+    /** Set in the header's type field when the body is LZ4 compressed.
+
+        A compressed body starts with the uncompressed size as four
+        big-endian bytes. Only peers that negotiated compression during
+        the handshake are sent compressed messages.
+    */
+    static int const kCompressedBit = 0x8000;
+
+    /** Number of bytes holding the uncompressed size of a compressed body. */
+    static size_t const kCompressedSizeBytes = 4;
+
     Message (::google::protobuf::Message const& message, int type);
 
-    /** Retrieve the packed message data. */
+    /** Retrieve the packed message data.
+
+        @param compressed `true` to get the compressed form, if compress()
+                          produced one that is smaller than the original.
+    */
     std::vector <uint8_t> const&
-    getBuffer () const
+    getBuffer (bool compressed = false) const
     {
+        if (compressed && ! mCompressed.empty ())
+            return mCompressed;
         return mBuffer;
     }
 
+    /** Get the protocol message type */
+    int
+    getMessageType () const
+    {
+        return mType;
+    }
+
+    /** Returns `true` if the message is worth compressing. */
+    bool
+    compressible () const;
+
+    /** Build the compressed form of the message.
+
+        Messages are shared between peers, so only the first call does
+        any work and the others wait for it to finish.
+
+        @return The time this call spent compressing.
+    */
+    std::chrono::microseconds
+    compress ();
+
     /** Get the traffic category */
     int
     getCategory () const
@@ -150,12 +190,16 @@ private:
             BufferSequence, Value>::end (buffers);
     }
 
-        // Encodes the size and type into a header at the beginning of buf
+    // Encodes the size and type into a header at the beginning of buf
     //
-    void encodeHeader (unsigned size, int type);
+    static void encodeHeader (std::vector <uint8_t>& buf,
+        unsigned size, int type);
 
     std::vector <uint8_t> mBuffer;
+    std::vector <uint8_t> mCompressed;
+    std::once_flag mCompressOnce;
 
+    int mType;
     int mCategory;
 };
 
@@ -71,6 +71,7 @@ public:
         bool expire = false;
         beast::IP::Address public_ip;
         int ipLimit = 0;
+        bool compression = true;
     };
 
     using PeerSequence = std::vector <Peer::ptr>;
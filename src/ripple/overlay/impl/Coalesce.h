@@ -0,0 +1,72 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_OVERLAY_COALESCE_H_INCLUDED
+#define RIPPLE_OVERLAY_COALESCE_H_INCLUDED
+
+#include <ripple/overlay/Message.h>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace ripple {
+
+/** Gathers messages from the front of a send queue into one write.
+
+    The first message is always taken, whatever its size. The ones
+    behind it are taken while the total stays within limit. When more
+    than one is taken their frames are copied into buffer, in queue
+    order, so the SSL stream writes them as one record.
+
+    @return The number of messages taken and their total size.
+*/
+template <class FwdIter>
+std::pair <std::size_t, std::size_t>
+coalesce (FwdIter first, FwdIter last, bool compressed,
+    std::size_t limit, std::vector <std::uint8_t>& buffer)
+{
+    std::size_t count = 0;
+    std::size_t bytes = 0;
+    auto end = first;
+    for (; end != last; ++end)
+    {
+        auto const size = (*end)->getBuffer (compressed).size ();
+        if (count > 0 && bytes + size > limit)
+            break;
+        bytes += size;
+        ++count;
+    }
+
+    if (count > 1)
+    {
+        buffer.clear ();
+        buffer.reserve (bytes);
+        for (; first != end; ++first)
+        {
+            auto const& b = (*first)->getBuffer (compressed);
+            buffer.insert (buffer.end (), b.begin (), b.end ());
+        }
+    }
+    return { count, bytes };
+}
+
+} // ripple
+
+#endif
@@ -218,7 +218,7 @@ ConnectAttempt::onHandshake (error_code ec)
 
     beast::http::message req = makeRequest(
         ! overlay_.peerFinder().config().peerPrivate,
-            remote_endpoint_.address());
+            overlay_.setup().compression, remote_endpoint_.address());
     auto const hello = buildHello (
         sharedValue,
         overlay_.setup().public_ip,
@@ -331,7 +331,7 @@ ConnectAttempt::onShutdown (error_code ec)
 //--------------------------------------------------------------------------
 
 beast::http::message
-ConnectAttempt::makeRequest (bool crawl,
+ConnectAttempt::makeRequest (bool crawl, bool compression,
     boost::asio::ip::address const& remote_address)
 {
     beast::http::message m;
@@ -344,6 +344,8 @@ ConnectAttempt::makeRequest (bool crawl,
     m.headers.append ("Connection", "Upgrade");
     m.headers.append ("Connect-As", "Peer");
     m.headers.append ("Crawl", crawl ? "public" : "private");
+    if (compression)
+        m.headers.append ("X-Compression", "lz4");
     return m;
 }
 
@@ -102,7 +102,7 @@ private:
 
     static
     beast::http::message
-    makeRequest (bool crawl,
+    makeRequest (bool crawl, bool compression,
         boost::asio::ip::address const& remote_address);
 
     template <class Streambuf>
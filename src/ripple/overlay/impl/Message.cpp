@@ -20,11 +20,14 @@
 #include <BeastConfig.h>
 #include <ripple/overlay/Message.h>
 #include <ripple/overlay/impl/TrafficCount.h>
+#include <ripple/overlay/impl/Tuning.h>
+#include <lz4/lib/lz4.h>
 #include <cstdint>
 
 namespace ripple {
 
 Message::Message (::google::protobuf::Message const& message, int type)
+    : mType (type)
 {
     unsigned const messageBytes = message.ByteSize ();
 
@@ -32,7 +35,7 @@ Message::Message (::google::protobuf::Message const& message, int type)
 
     mBuffer.resize (kHeaderBytes + messageBytes);
 
-    encodeHeader (messageBytes, type);
+    encodeHeader (mBuffer, messageBytes, type);
 
     if (messageBytes != 0)
     {
@@ -43,6 +46,63 @@ Message::Message (::google::protobuf::Message const& message, int type)
         (message, type, false));
 }
 
+bool Message::compressible () const
+{
+    // Only the bulky replies and transaction floods are worth the time
+    if (mType != protocol::mtTRANSACTION &&
+            mType != protocol::mtLEDGER_DATA &&
+            mType != protocol::mtGET_OBJECTS)
+        return false;
+
+    return mBuffer.size () >= kHeaderBytes + Tuning::compressThreshold;
+}
+
+std::chrono::microseconds Message::compress ()
+{
+    using namespace std::chrono;
+
+    microseconds elapsed {0};
+
+    if (! compressible ())
+        return elapsed;
+
+    std::call_once (mCompressOnce, [&]
+    {
+        auto const start = steady_clock::now ();
+
+        int const inSize = mBuffer.size () - kHeaderBytes;
+        int const outMax = LZ4_compressBound (inSize);
+        std::vector <uint8_t> out (
+            kHeaderBytes + kCompressedSizeBytes + outMax);
+
+        auto const outSize = LZ4_compress_default (
+            reinterpret_cast <char const*> (&mBuffer [kHeaderBytes]),
+            reinterpret_cast <char*> (
+                &out [kHeaderBytes + kCompressedSizeBytes]),
+            inSize, outMax);
+
+        // Keep the original when compression does not pay for itself
+        if (outSize > 0 &&
+            kCompressedSizeBytes + outSize < static_cast <unsigned> (inSize))
+        {
+            out.resize (kHeaderBytes + kCompressedSizeBytes + outSize);
+            encodeHeader (out, kCompressedSizeBytes + outSize,
+                mType | kCompressedBit);
+            auto const p = &out [kHeaderBytes];
+            p[0] = static_cast<std::uint8_t> ((inSize >> 24) & 0xFF);
+            p[1] = static_cast<std::uint8_t> ((inSize >> 16) & 0xFF);
+            p[2] = static_cast<std::uint8_t> ((inSize >> 8) & 0xFF);
+            p[3] = static_cast<std::uint8_t> (inSize & 0xFF);
+            mCompressed = std::move (out);
+        }
+
+        elapsed = duration_cast <microseconds> (
+            steady_clock::now () - start);
+    });
+
+    return elapsed;
+}
+
 bool Message::operator== (Message const& other) const
 {
     return mBuffer == other.mBuffer;
@@ -81,15 +141,16 @@ int Message::getType (std::vector<uint8_t> const& buf)
     return ret;
 }
 
-void Message::encodeHeader (unsigned size, int type)
+void Message::encodeHeader (std::vector <uint8_t>& buf,
+    unsigned size, int type)
 {
-    assert (mBuffer.size () >= Message::kHeaderBytes);
-    mBuffer[0] = static_cast<std::uint8_t> ((size >> 24) & 0xFF);
-    mBuffer[1] = static_cast<std::uint8_t> ((size >> 16) & 0xFF);
-    mBuffer[2] = static_cast<std::uint8_t> ((size >> 8) & 0xFF);
-    mBuffer[3] = static_cast<std::uint8_t> (size & 0xFF);
-    mBuffer[4] = static_cast<std::uint8_t> ((type >> 8) & 0xFF);
-    mBuffer[5] = static_cast<std::uint8_t> (type & 0xFF);
+    assert (buf.size () >= Message::kHeaderBytes);
+    buf[0] = static_cast<std::uint8_t> ((size >> 24) & 0xFF);
+    buf[1] = static_cast<std::uint8_t> ((size >> 16) & 0xFF);
+    buf[2] = static_cast<std::uint8_t> ((size >> 8) & 0xFF);
+    buf[3] = static_cast<std::uint8_t> (size & 0xFF);
+    buf[4] = static_cast<std::uint8_t> ((type >> 8) & 0xFF);
+    buf[5] = static_cast<std::uint8_t> (type & 0xFF);
 }
 
 }
@@ -300,6 +300,15 @@ OverlayImpl::isPeerUpgrade(beast::http::message const& request)
     return true;
 }
 
+bool
+OverlayImpl::offersCompression (beast::http::message const& m)
+{
+    auto const iter = m.headers.find("X-Compression");
+    if (iter == m.headers.end())
+        return false;
+    return beast::ci_equal(iter->second, "lz4");
+}
+
 std::string
 OverlayImpl::makePrefix (std::uint32_t id)
 {
@@ -616,6 +625,54 @@ OverlayImpl::onWrite (beast::PropertyStream::Map& stream)
             beast::lexicalCast<std::string>
                 (i.second.messagesOut.load());
     }
+
+    {
+        auto const writes = m_traffic.getWrites();
+        auto const n = writes.writes.load();
+        beast::PropertyStream::Map item ("writes", stream);
+        item["writes"] =
+            beast::lexicalCast<std::string> (n);
+        item["messages_per_write"] = beast::lexicalCast<std::string> (
+            n ? static_cast<double>(writes.messages.load()) / n : 0.0);
+        item["bytes_per_write"] = beast::lexicalCast<std::string> (
+            n ? static_cast<double>(writes.bytes.load()) / n : 0.0);
+    }
+
+    // Ratios are uncompressed bytes over bytes on the wire
+    auto const ratio = [](unsigned long raw, unsigned long bytes)
+    {
+        return beast::lexicalCast<std::string>(bytes ?
+            static_cast<double>(raw) / bytes : 0.0);
+    };
+
+    beast::PropertyStream::Set compression ("compression", stream);
+    for (auto& i : m_traffic.getCompression())
+    {
+        beast::PropertyStream::Map item (compression);
+        item["type"] = i.first;
+        item["messages_in"] =
+            beast::lexicalCast<std::string>
+                (i.second.messagesIn.load());
+        item["bytes_in"] =
+            beast::lexicalCast<std::string>
+                (i.second.bytesIn.load());
+        item["ratio_in"] = ratio (
+            i.second.rawBytesIn.load(), i.second.bytesIn.load());
+        item["decompress_us"] =
+            beast::lexicalCast<std::string>
+                (i.second.microsIn.load());
+        item["messages_out"] =
+            beast::lexicalCast<std::string>
+                (i.second.messagesOut.load());
+        item["bytes_out"] =
+            beast::lexicalCast<std::string>
+                (i.second.bytesOut.load());
+        item["ratio_out"] = ratio (
+            i.second.rawBytesOut.load(), i.second.bytesOut.load());
+        item["compress_us"] =
+            beast::lexicalCast<std::string>
+                (i.second.microsOut.load());
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -748,6 +805,25 @@ OverlayImpl::reportTraffic (
     m_traffic.addCount (cat, isInbound, number);
 }
 
+void
+OverlayImpl::reportWrite (
+    std::size_t messages,
+    std::size_t bytes)
+{
+    m_traffic.addWrite (messages, bytes);
+}
+
+void
+OverlayImpl::reportCompression (
+    int type,
+    bool isInbound,
+    std::size_t rawBytes,
+    std::size_t bytes,
+    std::chrono::microseconds elapsed)
+{
+    m_traffic.addCompressed (type, isInbound, rawBytes, bytes, elapsed);
+}
+
 std::size_t
 OverlayImpl::selectPeers (PeerSet& set, std::size_t limit,
     std::function<bool(std::shared_ptr<Peer> const&)> score)
@@ -1060,6 +1136,7 @@ setup_Overlay (BasicConfig const& config)
     auto const& section = config.section("overlay");
     setup.context = make_SSLContext();
     setup.expire = get<bool>(section, "expire", false);
+    setup.compression = get<bool>(section, "compression", true);
 
     set (setup.ipLimit, "ip_limit", section);
     if (setup.ipLimit < 0)
@@ -265,6 +265,11 @@ public:
     bool
     isPeerUpgrade (beast::http::message const& request);
 
+    /** Returns `true` if the handshake message offers LZ4 compression. */
+    static
+    bool
+    offersCompression (beast::http::message const& m);
+
     static
     std::string
     makePrefix (std::uint32_t id);
@@ -275,6 +280,19 @@ public:
         bool isInbound,
         int bytes);
 
+    void
+    reportWrite (
+        std::size_t messages,
+        std::size_t bytes);
+
+    void
+    reportCompression (
+        int type,
+        bool isInbound,
+        std::size_t rawBytes,
+        std::size_t bytes,
+        std::chrono::microseconds elapsed);
+
 private:
     std::shared_ptr<HTTP::Writer>
     makeRedirectResponse (PeerFinder::Slot::ptr const& slot,
@@ -20,6 +20,7 @@
 #include <BeastConfig.h>
 #include <ripple/overlay/impl/TMHello.h>
 #include <ripple/overlay/impl/PeerImp.h>
+#include <ripple/overlay/impl/Coalesce.h>
 #include <ripple/overlay/impl/Tuning.h>
 #include <ripple/app/ledger/InboundLedgers.h>
 #include <ripple/app/ledger/LedgerMaster.h>
@@ -52,6 +53,7 @@
 #include <functional>
 #include <memory>
 #include <sstream>
+#include <tuple>
 
 namespace ripple {
 
@@ -87,6 +89,8 @@ PeerImp::PeerImp (Application& app, id_t id, endpoint_type remote_endpoint,
     , fee_ (Resource::feeLightPeer)
     , slot_ (slot)
     , http_message_(std::move(request))
+    , compression_(overlay_.setup().compression &&
+        OverlayImpl::offersCompression(http_message_))
 {
 }
 
@@ -197,9 +201,16 @@ PeerImp::send (Message::pointer const& m)
     if(detaching_)
         return;
 
+    if (compression_ && m->compressible())
+    {
+        auto const elapsed = m->compress();
+        overlay_.reportCompression (m->getMessageType(), false,
+            m->getBuffer().size(), m->getBuffer(true).size(), elapsed);
+    }
+
     overlay_.reportTraffic (
         static_cast<TrafficCount::category>(m->getCategory()),
-        false, static_cast<int>(m->getBuffer().size()));
+        false, static_cast<int>(m->getBuffer(compression_).size()));
 
     auto sendq_size = send_queue_.size();
 
@@ -211,16 +222,12 @@ PeerImp::send (Message::pointer const& m)
         large_sendq_ = 0;
     }
 
-    send_queue_.push(m);
+    send_queue_.push_back(m);
 
     if(sendq_size != 0)
         return;
 
-    boost::asio::async_write (stream_, boost::asio::buffer(
-        send_queue_.front()->getBuffer()), strand_.wrap(std::bind(
-            &PeerImp::onWriteMessage, shared_from_this(),
-                beast::asio::placeholders::error,
-                    beast::asio::placeholders::bytes_transferred)));
+    sendQueued();
 }
 
 void
@@ -665,6 +672,8 @@ PeerImp::makeResponse (bool crawl,
     resp.headers.append("Connect-AS", "Peer");
     resp.headers.append("Server", BuildInfo::getFullVersionString());
     resp.headers.append ("Crawl", crawl ? "public" : "private");
+    if (overlay_.setup().compression && OverlayImpl::offersCompression(req))
+        resp.headers.append ("X-Compression", "lz4");
     protocol::TMHello hello = buildHello(sharedValue,
         overlay_.setup().public_ip, remote, app_);
     appendHello(resp, hello);
@@ -769,12 +778,61 @@ PeerImp::onReadMessage (error_code ec, std::size_t bytes_transferred)
         read_buffer_.consume (bytes_consumed);
     }
     // Timeout on writes only
-    stream_.async_read_some (read_buffer_.prepare (Tuning::readBufferBytes),
+    stream_.async_read_some (read_buffer_.prepare (readSize()),
         strand_.wrap (std::bind (&PeerImp::onReadMessage,
             shared_from_this(), beast::asio::placeholders::error,
                 beast::asio::placeholders::bytes_transferred)));
 }
 
+void
+PeerImp::sendQueued()
+{
+    assert(strand_.running_in_this_thread());
+    assert(! send_queue_.empty());
+    assert(sending_ == 0);
+
+    // Gather the small messages waiting behind the first one, so that
+    // they go out in one TLS record and one system call.
+    std::size_t bytes;
+    std::tie (sending_, bytes) = coalesce (send_queue_.begin(),
+        send_queue_.end(), compression_, Tuning::sendCoalesceBytes,
+            send_buffer_);
+
+    boost::asio::const_buffer buffer;
+    if (sending_ == 1)
+    {
+        auto const& b = send_queue_.front()->getBuffer(compression_);
+        buffer = boost::asio::const_buffer(b.data(), b.size());
+    }
+    else
+    {
+        buffer = boost::asio::const_buffer(
+            send_buffer_.data(), send_buffer_.size());
+    }
+
+    overlay_.reportWrite (sending_, bytes);
+
+    // Timeout on writes only
+    boost::asio::async_write (stream_, boost::asio::const_buffers_1(buffer),
+        strand_.wrap(std::bind(&PeerImp::onWriteMessage, shared_from_this(),
+            beast::asio::placeholders::error,
+                beast::asio::placeholders::bytes_transferred)));
+}
+
+std::size_t
+PeerImp::readSize() const
+{
+    // Once the header of a message is in, read as much of the rest as
+    // the buffer allows so large replies don't arrive in small pieces.
+    auto const buffered = read_buffer_.size();
+    if (buffered < Message::kHeaderBytes)
+        return Tuning::readBufferBytes;
+    auto const needed = Message::kHeaderBytes +
+        Message::size(read_buffer_.data()) - buffered;
+    return std::max<std::size_t> (Tuning::readBufferBytes,
+        std::min<std::size_t> (needed, Tuning::readBufferMaxBytes));
+}
+
 void
 PeerImp::onWriteMessage (error_code ec, std::size_t bytes_transferred)
 {
@@ -792,17 +850,12 @@ PeerImp::onWriteMessage (error_code ec, std::size_t bytes_transferred)
             "onWriteMessage";
     }
 
-    assert(! send_queue_.empty());
-    send_queue_.pop();
+    assert(sending_ > 0 && send_queue_.size() >= sending_);
+    send_queue_.erase(send_queue_.begin(),
+        send_queue_.begin() + sending_);
+    sending_ = 0;
     if (! send_queue_.empty())
-    {
-        // Timeout on writes only
-        return boost::asio::async_write (stream_, boost::asio::buffer(
-            send_queue_.front()->getBuffer()), strand_.wrap(std::bind(
-                &PeerImp::onWriteMessage, shared_from_this(),
-                    beast::asio::placeholders::error,
-                        beast::asio::placeholders::bytes_transferred)));
-    }
+        return sendQueued();
 
     if (gracefulClose_)
     {
@@ -827,6 +880,13 @@ PeerImp::onMessageUnknown (std::uint16_t type)
     return ec;
 }
 
+void
+PeerImp::onMessageDecompressed (int type, std::size_t rawBytes,
+    std::size_t bytes, std::chrono::microseconds elapsed)
+{
+    overlay_.reportCompression (type, true, rawBytes, bytes, elapsed);
+}
+
 PeerImp::error_code
 PeerImp::onMessageBegin (std::uint16_t type,
     std::shared_ptr <::google::protobuf::Message> const& m,
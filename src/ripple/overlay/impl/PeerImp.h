@@ -44,7 +44,6 @@
 #include <beast/utility/WrappedSink.h>
 #include <cstdint>
 #include <deque>
-#include <queue>
 
 namespace ripple {
 
@@ -154,9 +153,15 @@ private:
     PeerFinder::Slot::ptr slot_;
     beast::asio::streambuf read_buffer_;
     beast::http::message http_message_;
+    // Send LZ4 compressed messages, negotiated in the handshake
+    bool const compression_;
     beast::http::body http_body_;
     beast::asio::streambuf write_buffer_;
-    std::queue<Message::pointer> send_queue_;
+    std::deque<Message::pointer> send_queue_;
+    // Messages at the front of send_queue_ in the current write
+    std::size_t sending_ = 0;
+    // Small messages copied together for the current write
+    std::vector<std::uint8_t> send_buffer_;
     bool gracefulClose_ = false;
     int large_sendq_ = 0;
     int no_ping_ = 0;
@@ -379,6 +384,14 @@ private:
     void
     onReadMessage (error_code ec, std::size_t bytes_transferred);
 
+    // How many bytes to ask for in the next read
+    std::size_t
+    readSize() const;
+
+    // Writes the messages at the front of the send queue
+    void
+    sendQueued();
+
     // Called when protocol messages bytes are sent
     void
     onWriteMessage (error_code ec, std::size_t bytes_transferred);
@@ -401,6 +414,10 @@ public:
     error_code
     onMessageUnknown (std::uint16_t type);
 
+    void
+    onMessageDecompressed (int type, std::size_t rawBytes,
+        std::size_t bytes, std::chrono::microseconds elapsed);
+
     error_code
     onMessageBegin (std::uint16_t type,
         std::shared_ptr <::google::protobuf::Message> const& m,
@@ -505,6 +522,8 @@ PeerImp::PeerImp (Application& app, std::unique_ptr<beast::asio::ssl_bundle>&& s
     , fee_ (Resource::feeLightPeer)
     , slot_ (std::move(slot))
     , http_message_(std::move(response))
+    , compression_(overlay_.setup().compression &&
+        OverlayImpl::offersCompression(http_message_))
 {
     read_buffer_.commit (boost::asio::buffer_copy(read_buffer_.prepare(
         boost::asio::buffer_size(buffers)), buffers));
@@ -22,11 +22,14 @@
 
 #include "ripple.pb.h"
 #include <ripple/overlay/Message.h>
+#include <ripple/overlay/impl/Tuning.h>
 #include <ripple/overlay/impl/ZeroCopyStream.h>
+#include <lz4/lib/lz4.h>
 #include <boost/asio/buffer.hpp>
 #include <boost/asio/buffers_iterator.hpp>
 #include <boost/system/error_code.hpp>
 #include <cassert>
+#include <chrono>
 #include <cstdint>
 #include <memory>
 #include <type_traits>
@@ -70,16 +73,18 @@ std::enable_if_t<std::is_base_of<
     ::google::protobuf::Message, T>::value,
         boost::system::error_code>
 invoke (int type, Buffers const& buffers,
-    Handler& handler)
+    std::size_t size, Handler& handler)
 {
+    // Parse straight out of the receive buffers, stopping at the end of
+    // this message since the buffers may hold the start of the next one.
     ZeroCopyInputStream<Buffers> stream(buffers);
     stream.Skip(Message::kHeaderBytes);
     auto const m (std::make_shared<T>());
-    if (! m->ParseFromZeroCopyStream(&stream))
+    if (! m->ParseFromBoundedZeroCopyStream(&stream,
+            static_cast<int>(Message::size(buffers))))
         return boost::system::errc::make_error_code(
             boost::system::errc::invalid_argument);
-    auto ec = handler.onMessageBegin (type, m,
-       Message::kHeaderBytes + Message::size (buffers));
+    auto ec = handler.onMessageBegin (type, m, size);
     if (! ec)
     {
         handler.onMessage (m);
@@ -88,6 +93,81 @@ invoke (int type, Buffers const& buffers,
     return ec;
 }
 
+template <class Buffers, class Handler>
+boost::system::error_code
+dispatch (int type, Buffers const& buffers,
+    std::size_t size, Handler& handler)
+{
+    boost::system::error_code ec;
+    switch (type)
+    {
+    case protocol::mtHELLO:         ec = invoke<protocol::TMHello> (type, buffers, size, handler); break;
+    case protocol::mtMANIFESTS:     ec = invoke<protocol::TMManifests> (type, buffers, size, handler); break;
+    case protocol::mtPING:          ec = invoke<protocol::TMPing> (type, buffers, size, handler); break;
+    case protocol::mtCLUSTER:       ec = invoke<protocol::TMCluster> (type, buffers, size, handler); break;
+    case protocol::mtGET_PEERS:     ec = invoke<protocol::TMGetPeers> (type, buffers, size, handler); break;
+    case protocol::mtPEERS:         ec = invoke<protocol::TMPeers> (type, buffers, size, handler); break;
+    case protocol::mtENDPOINTS:     ec = invoke<protocol::TMEndpoints> (type, buffers, size, handler); break;
+    case protocol::mtTRANSACTION:   ec = invoke<protocol::TMTransaction> (type, buffers, size, handler); break;
+    case protocol::mtGET_LEDGER:    ec = invoke<protocol::TMGetLedger> (type, buffers, size, handler); break;
+    case protocol::mtLEDGER_DATA:   ec = invoke<protocol::TMLedgerData> (type, buffers, size, handler); break;
+    case protocol::mtPROPOSE_LEDGER:ec = invoke<protocol::TMProposeSet> (type, buffers, size, handler); break;
+    case protocol::mtSTATUS_CHANGE: ec = invoke<protocol::TMStatusChange> (type, buffers, size, handler); break;
+    case protocol::mtHAVE_SET:      ec = invoke<protocol::TMHaveTransactionSet> (type, buffers, size, handler); break;
+    case protocol::mtVALIDATION:    ec = invoke<protocol::TMValidation> (type, buffers, size, handler); break;
+    case protocol::mtGET_OBJECTS:   ec = invoke<protocol::TMGetObjectByHash> (type, buffers, size, handler); break;
+    default:
+        ec = handler.onMessageUnknown (type);
+        break;
+    }
+    return ec;
+}
+
+/** Inflate a compressed message of `size` bytes.
+
+    On success `out` holds the uncompressed message, with a header
+    describing it as if it had been sent uncompressed.
+*/
+template <class Buffers>
+boost::system::error_code
+decompress (int type, Buffers const& buffers,
+    std::size_t size, std::vector<std::uint8_t>& out)
+{
+    auto const invalid = boost::system::errc::make_error_code(
+        boost::system::errc::invalid_argument);
+    auto const offset =
+        Message::kHeaderBytes + Message::kCompressedSizeBytes;
+    if (size <= offset)
+        return invalid;
+
+    std::vector<std::uint8_t> in (size);
+    boost::asio::buffer_copy (boost::asio::buffer(in), buffers);
+
+    std::size_t n;
+    n  = std::size_t{in[Message::kHeaderBytes    ]} << 24;
+    n += std::size_t{in[Message::kHeaderBytes + 1]} << 16;
+    n += std::size_t{in[Message::kHeaderBytes + 2]} <<  8;
+    n += std::size_t{in[Message::kHeaderBytes + 3]};
+    if (n == 0 || n > Tuning::maxDecompressedBytes)
+        return invalid;
+
+    out.resize (Message::kHeaderBytes + n);
+    auto const result = LZ4_decompress_safe (
+        reinterpret_cast<char const*>(&in[offset]),
+        reinterpret_cast<char*>(&out[Message::kHeaderBytes]),
+        static_cast<int>(size - offset), static_cast<int>(n));
+    if (result < 0 || static_cast<std::size_t>(result) != n)
+        return invalid;
+
+    out[0] = static_cast<std::uint8_t>((n >> 24) & 0xFF);
+    out[1] = static_cast<std::uint8_t>((n >> 16) & 0xFF);
+    out[2] = static_cast<std::uint8_t>((n >>  8) & 0xFF);
+    out[3] = static_cast<std::uint8_t>( n        & 0xFF);
+    out[4] = static_cast<std::uint8_t>((type >>  8) & 0xFF);
+    out[5] = static_cast<std::uint8_t>( type        & 0xFF);
+    return {};
+}
+
 }
 
 /** Calls the handler for up to one protocol message in the passed buffers.
@@ -95,6 +175,9 @@ invoke (int type, Buffers const& buffers,
     If there is insufficient data to produce a complete protocol
     message, zero is returned for the number of bytes consumed.
 
+    Compressed messages are inflated first, and reported to the
+    handler's onMessageDecompressed before the usual callbacks.
+
     @return The number of bytes consumed, or the error code if any.
 */
 template <class Buffers, class Handler>
@@ -111,26 +194,23 @@ invokeProtocolMessage (Buffers const& buffers, Handler& handler)
     if (boost::asio::buffer_size(buffers) < size)
         return result;
 
-    switch (type)
+    if (type & Message::kCompressedBit)
     {
-    case protocol::mtHELLO:         ec = detail::invoke<protocol::TMHello> (type, buffers, handler); break;
-    case protocol::mtMANIFESTS:     ec = detail::invoke<protocol::TMManifests> (type, buffers, handler); break;
-    case protocol::mtPING:          ec = detail::invoke<protocol::TMPing> (type, buffers, handler); break;
-    case protocol::mtCLUSTER:       ec = detail::invoke<protocol::TMCluster> (type, buffers, handler); break;
-    case protocol::mtGET_PEERS:     ec = detail::invoke<protocol::TMGetPeers> (type, buffers, handler); break;
-    case protocol::mtPEERS:         ec = detail::invoke<protocol::TMPeers> (type, buffers, handler); break;
-    case protocol::mtENDPOINTS:     ec = detail::invoke<protocol::TMEndpoints> (type, buffers, handler); break;
-    case protocol::mtTRANSACTION:   ec = detail::invoke<protocol::TMTransaction> (type, buffers, handler); break;
-    case protocol::mtGET_LEDGER:    ec = detail::invoke<protocol::TMGetLedger> (type, buffers, handler); break;
-    case protocol::mtLEDGER_DATA:   ec = detail::invoke<protocol::TMLedgerData> (type, buffers, handler); break;
-    case protocol::mtPROPOSE_LEDGER:ec = detail::invoke<protocol::TMProposeSet> (type, buffers, handler); break;
-    case protocol::mtSTATUS_CHANGE: ec = detail::invoke<protocol::TMStatusChange> (type, buffers, handler); break;
-    case protocol::mtHAVE_SET:      ec = detail::invoke<protocol::TMHaveTransactionSet> (type, buffers, handler); break;
-    case protocol::mtVALIDATION:    ec = detail::invoke<protocol::TMValidation> (type, buffers, handler); break;
-    case protocol::mtGET_OBJECTS:   ec = detail::invoke<protocol::TMGetObjectByHash> (type, buffers, handler); break;
-    default:
-        ec = handler.onMessageUnknown (type);
-        break;
+        using namespace std::chrono;
+        auto const start = steady_clock::now();
+        auto const uncompressedType = type & ~Message::kCompressedBit;
+        std::vector<std::uint8_t> inflated;
+        ec = detail::decompress (uncompressedType, buffers, size, inflated);
+        if (ec)
+            return result;
+        handler.onMessageDecompressed (uncompressedType, inflated.size(),
+            size, duration_cast<microseconds>(steady_clock::now() - start));
+        ec = detail::dispatch (uncompressedType, boost::asio::const_buffers_1(
+            inflated.data(), inflated.size()), size, handler);
+    }
+    else
+    {
+        ec = detail::dispatch (type, buffers, size, handler);
     }
     if (! ec)
         result.first = size;
@@ -19,6 +19,7 @@
 
 #include <BeastConfig.h>
 #include <ripple/overlay/impl/TrafficCount.h>
+#include <ripple/overlay/impl/ProtocolMessage.h>
 
 namespace ripple {
 
@@ -53,6 +54,22 @@ const char* TrafficCount::getName (category c)
     }
 }
 
+std::map <std::string, TrafficCount::CompressionStats>
+TrafficCount::getCompression () const
+{
+    std::map <std::string, CompressionStats> ret;
+
+    for (auto& i : compression_)
+    {
+        if (i.second)
+            ret.emplace (std::piecewise_construct,
+                std::forward_as_tuple (protocolMessageName (i.first)),
+                std::forward_as_tuple (i.second));
+    }
+
+    return ret;
+}
+
 TrafficCount::category TrafficCount::categorize (
     ::google::protobuf::Message const& message,
     int type, bool inbound)
@@ -23,6 +23,7 @@
 #include "ripple.pb.h"
 
 #include <atomic>
+#include <chrono>
 #include <map>
 
 namespace ripple {
@@ -61,6 +62,66 @@ public:
     };
 
 
+    /** Compression of one protocol message type.
+
+        Bytes are whole messages, header included, counted on each send
+        or receive. The time is spent compressing or decompressing; a
+        broadcast message is compressed once for all the peers it goes to.
+    */
+    class CompressionStats
+    {
+        public:
+
+        count_t bytesIn;        // as received
+        count_t rawBytesIn;     // after decompressing
+        count_t microsIn;
+        count_t messagesIn;
+        count_t bytesOut;       // as sent
+        count_t rawBytesOut;    // before compressing
+        count_t microsOut;
+        count_t messagesOut;
+
+        CompressionStats() : bytesIn(0), rawBytesIn(0), microsIn(0),
+            messagesIn(0), bytesOut(0), rawBytesOut(0), microsOut(0),
+            messagesOut(0)
+        { ; }
+
+        CompressionStats(const CompressionStats& cs)
+            : bytesIn (cs.bytesIn.load())
+            , rawBytesIn (cs.rawBytesIn.load())
+            , microsIn (cs.microsIn.load())
+            , messagesIn (cs.messagesIn.load())
+            , bytesOut (cs.bytesOut.load())
+            , rawBytesOut (cs.rawBytesOut.load())
+            , microsOut (cs.microsOut.load())
+            , messagesOut (cs.messagesOut.load())
+        { ; }
+
+        operator bool () const
+        {
+            return messagesIn || messagesOut;
+        }
+    };
+
+    /** Writes to peers, each carrying one or more queued messages. */
+    class WriteStats
+    {
+        public:
+
+        count_t writes;
+        count_t messages;
+        count_t bytes;
+
+        WriteStats() : writes(0), messages(0), bytes(0)
+        { ; }
+
+        WriteStats(const WriteStats& ws)
+            : writes (ws.writes.load())
+            , messages (ws.messages.load())
+            , bytes (ws.bytes.load())
+        { ; }
+    };
+
     enum class category
     {
         CT_base,           // basic peer overhead, must be first
@@ -95,6 +156,42 @@ public:
         }
     }
 
+    void addCompressed (int type, bool inbound, std::size_t rawBytes,
+        std::size_t bytes, std::chrono::microseconds elapsed)
+    {
+        auto const iter = compression_.find (type);
+        if (iter == compression_.end ())
+            return;
+        auto& stats = iter->second;
+        if (inbound)
+        {
+            stats.bytesIn += bytes;
+            stats.rawBytesIn += rawBytes;
+            stats.microsIn += elapsed.count ();
+            ++stats.messagesIn;
+        }
+        else
+        {
+            stats.bytesOut += bytes;
+            stats.rawBytesOut += rawBytes;
+            stats.microsOut += elapsed.count ();
+            ++stats.messagesOut;
+        }
+    }
+
+    void addWrite (std::size_t messages, std::size_t bytes)
+    {
+        ++writes_.writes;
+        writes_.messages += messages;
+        writes_.bytes += bytes;
+    }
+
+    WriteStats
+    getWrites () const
+    {
+        return writes_;
+    }
+
     TrafficCount()
     {
         for (category i = category::CT_base;
@@ -103,6 +200,14 @@ public:
         {
             counts_[i];
         }
+
+        // Populated up front so the counters can be updated without a lock
+        for (int i = protocol::MessageType_MIN;
+            i <= protocol::MessageType_MAX; ++i)
+        {
+            if (protocol::MessageType_IsValid (i))
+                compression_[i];
+        }
     }
 
     std::map <std::string, TrafficStats>
@@ -121,9 +226,15 @@ public:
         return ret;
     }
 
+    /** Returns the compression stats of each message type that has any. */
+    std::map <std::string, CompressionStats>
+    getCompression () const;
+
     protected:
 
     std::map <category, TrafficStats> counts_;
+    std::map <int, CompressionStats> compression_;
+    WriteStats writes_;
 };
 
 }
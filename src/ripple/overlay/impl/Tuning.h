@@ -30,6 +30,9 @@ enum
     /** Size of buffer used to read from the socket. */
     readBufferBytes     = 4096,
 
+    /** Largest buffer used to read the rest of a partly received message */
+    readBufferMaxBytes  = 64 * 1024,
+
     /** How long a server can remain insane before we
         disconnected it (if outbound) */
     maxInsaneTime       =   60,
@@ -71,6 +74,16 @@ enum
 
     /** How many messages we consider reasonable sustained on a send queue */
     targetSendQueue     =   16,
+
+    /** Most bytes of queued messages gathered into one write, which
+        is the largest TLS record */
+    sendCoalesceBytes   = 16 * 1024,
+
+    /** Smallest message body we try to compress for a peer */
+    compressThreshold   = 1024,
+
+    /** Largest decompressed message body we accept from a peer */
+    maxDecompressedBytes = 64 * 1024 * 1024,
 };
 
 } // Tuning
@@ -0,0 +1,147 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/overlay/Message.h>
+#include <ripple/overlay/impl/ProtocolMessage.h>
+#include <beast/unit_test/suite.h>
+
+namespace ripple {
+
+class ProtocolMessage_test : public beast::unit_test::suite
+{
+private:
+    // Keeps the messages handed over by invokeProtocolMessage
+    struct Handler
+    {
+        std::vector <std::shared_ptr <::google::protobuf::Message>> messages;
+
+        boost::system::error_code
+        onMessageUnknown (std::uint16_t)
+        {
+            return boost::system::errc::make_error_code(
+                boost::system::errc::invalid_argument);
+        }
+
+        void
+        onMessageDecompressed (int, std::size_t,
+            std::size_t, std::chrono::microseconds)
+        {
+        }
+
+        boost::system::error_code
+        onMessageBegin (std::uint16_t,
+            std::shared_ptr <::google::protobuf::Message> const& m,
+                std::size_t)
+        {
+            messages.push_back (m);
+            return {};
+        }
+
+        template <class T>
+        void
+        onMessage (std::shared_ptr <T> const&)
+        {
+        }
+
+        void
+        onMessageEnd (std::uint16_t,
+            std::shared_ptr <::google::protobuf::Message> const&)
+        {
+        }
+    };
+
+    static
+    protocol::TMTransaction
+    makeTx (std::size_t size, char c)
+    {
+        protocol::TMTransaction tm;
+        tm.set_rawtransaction (std::string (size, c));
+        tm.set_status (protocol::tsNEW);
+        return tm;
+    }
+
+public:
+    void
+    testBackToBack ()
+    {
+        testcase ("back to back");
+
+        auto const first = makeTx (100, 'a');
+        auto const second = makeTx (50, 'b');
+        auto wire = Message (first, protocol::mtTRANSACTION).getBuffer ();
+        auto const next = Message (second, protocol::mtTRANSACTION).getBuffer ();
+        wire.insert (wire.end (), next.begin (), next.end ());
+
+        // Split the bytes over several buffers, as a streambuf holds them
+        std::vector <boost::asio::const_buffer> buffers;
+        for (std::size_t i = 0; i < wire.size (); i += 7)
+            buffers.emplace_back (&wire[i], std::min<std::size_t> (7, wire.size () - i));
+
+        Handler h;
+        std::size_t offset = 0;
+        while (offset < wire.size ())
+        {
+            auto const result = invokeProtocolMessage (
+                boost::asio::const_buffers_1 (
+                    &wire[offset], wire.size () - offset), h);
+            if (! expect (! result.second && result.first > 0))
+                return;
+            offset += result.first;
+        }
+        expect (h.messages.size () == 2);
+
+        auto const result = invokeProtocolMessage (buffers, h);
+        expect (! result.second);
+        expect (result.first == wire.size () - next.size ());
+        if (! expect (h.messages.size () == 3))
+            return;
+        expect (h.messages[0]->SerializeAsString () == first.SerializeAsString ());
+        expect (h.messages[1]->SerializeAsString () == second.SerializeAsString ());
+        expect (h.messages[2]->SerializeAsString () == first.SerializeAsString ());
+    }
+
+    void
+    testPartial ()
+    {
+        testcase ("partial");
+
+        auto const wire = Message (makeTx (100, 'a'),
+            protocol::mtTRANSACTION).getBuffer ();
+        Handler h;
+        for (std::size_t n : {0, 3, 6, 50})
+        {
+            auto const result = invokeProtocolMessage (
+                boost::asio::const_buffers_1 (wire.data (), n), h);
+            expect (result.first == 0 && ! result.second);
+        }
+        expect (h.messages.empty ());
+    }
+
+    void
+    run ()
+    {
+        testBackToBack ();
+        testPartial ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(ProtocolMessage,overlay,ripple);
+
+}
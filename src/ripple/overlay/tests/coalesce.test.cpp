@@ -0,0 +1,209 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/overlay/Message.h>
+#include <ripple/overlay/impl/Coalesce.h>
+#include <ripple/overlay/impl/Tuning.h>
+#include <beast/unit_test/suite.h>
+#include <deque>
+
+namespace ripple {
+
+class coalesce_test : public beast::unit_test::suite
+{
+private:
+    // A message numbered by seq, carrying about size bytes of data
+    static
+    Message::pointer
+    makeMessage (std::uint32_t seq, std::size_t size)
+    {
+        protocol::TMGetObjectByHash m;
+        m.set_type (protocol::TMGetObjectByHash::otSTATE_NODE);
+        m.set_query (false);
+        m.set_seq (seq);
+        auto const o = m.add_objects ();
+        o->set_hash (std::string (32, static_cast<char>(seq)));
+        o->set_data (std::string (size, 'x'));
+        return std::make_shared<Message> (m, protocol::mtGET_OBJECTS);
+    }
+
+    // Drains the queue the way PeerImp's writer does, one write at a
+    // time, and checks every write against the limit.
+    std::vector <std::uint8_t>
+    drain (std::deque <Message::pointer> queue, bool compressed,
+        std::size_t& writes)
+    {
+        std::vector <std::uint8_t> out;
+        std::vector <std::uint8_t> buffer;
+        writes = 0;
+        while (! queue.empty ())
+        {
+            std::size_t count, bytes;
+            std::tie (count, bytes) = coalesce (queue.begin (), queue.end (),
+                compressed, Tuning::sendCoalesceBytes, buffer);
+            if (! expect (count > 0 && count <= queue.size ()))
+                break;
+
+            auto const& b = count == 1 ?
+                queue.front ()->getBuffer (compressed) : buffer;
+            expect (b.size () == bytes);
+            // Only a message on its own may go over the limit
+            if (count > 1)
+                expect (bytes <= Tuning::sendCoalesceBytes);
+            out.insert (out.end (), b.begin (), b.end ());
+            queue.erase (queue.begin (), queue.begin () + count);
+            ++writes;
+        }
+        return out;
+    }
+
+    // The frames of every message, back to back in queue order
+    static
+    std::vector <std::uint8_t>
+    frames (std::deque <Message::pointer> const& queue, bool compressed)
+    {
+        std::vector <std::uint8_t> out;
+        for (auto const& m : queue)
+        {
+            auto const& b = m->getBuffer (compressed);
+            out.insert (out.end (), b.begin (), b.end ());
+        }
+        return out;
+    }
+
+    // The sequence numbers of the messages found in a byte stream
+    static
+    std::vector <std::uint32_t>
+    sequences (std::vector <std::uint8_t> const& stream)
+    {
+        std::vector <std::uint32_t> seqs;
+        std::size_t pos = 0;
+        while (pos + Message::kHeaderBytes <= stream.size ())
+        {
+            auto const length = Message::size (
+                stream.begin () + pos, stream.end ());
+            protocol::TMGetObjectByHash m;
+            if (pos + Message::kHeaderBytes + length > stream.size () ||
+                ! m.ParseFromArray (&stream[pos + Message::kHeaderBytes],
+                    length))
+                break;
+            seqs.push_back (m.seq ());
+            pos += Message::kHeaderBytes + length;
+        }
+        if (pos != stream.size ())
+            seqs.clear ();
+        return seqs;
+    }
+
+public:
+    void
+    testSmall ()
+    {
+        testcase ("small messages");
+
+        std::deque <Message::pointer> queue;
+        std::vector <std::uint32_t> expected;
+        for (std::uint32_t i = 0; i < 500; ++i)
+        {
+            queue.push_back (makeMessage (i, 10 + (i * 37) % 300));
+            expected.push_back (i);
+        }
+
+        std::size_t writes;
+        auto const out = drain (queue, false, writes);
+        expect (out == frames (queue, false));
+        expect (sequences (out) == expected);
+        // Far fewer writes than messages, but more than one
+        expect (writes > 1 && writes < queue.size () / 10);
+
+        std::vector <std::uint8_t> buffer;
+        auto const single = coalesce (queue.begin (), queue.begin () + 1,
+            false, Tuning::sendCoalesceBytes, buffer);
+        expect (single.first == 1);
+        expect (single.second == queue.front ()->getBuffer ().size ());
+    }
+
+    void
+    testLarge ()
+    {
+        testcase ("large messages");
+
+        // Large messages go out on their own, the small ones between
+        // them are still gathered.
+        std::deque <Message::pointer> queue;
+        std::vector <std::uint32_t> expected;
+        std::uint32_t seq = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            expected.push_back (seq);
+            queue.push_back (makeMessage (seq++,
+                Tuning::sendCoalesceBytes + 100));
+            for (int j = 0; j < 3; ++j)
+            {
+                expected.push_back (seq);
+                queue.push_back (makeMessage (seq++, 100));
+            }
+        }
+
+        std::vector <std::uint8_t> buffer;
+        auto const first = coalesce (queue.begin (), queue.end (), false,
+            Tuning::sendCoalesceBytes, buffer);
+        expect (first.first == 1);
+        expect (first.second > Tuning::sendCoalesceBytes);
+
+        std::size_t writes;
+        auto const out = drain (queue, false, writes);
+        expect (out == frames (queue, false));
+        expect (sequences (out) == expected);
+        expect (writes == 8);
+    }
+
+    void
+    testCompressed ()
+    {
+        testcase ("compressed");
+
+        std::deque <Message::pointer> queue;
+        for (std::uint32_t i = 0; i < 20; ++i)
+        {
+            queue.push_back (makeMessage (i,
+                i % 2 ? 100 : Tuning::compressThreshold * 4));
+            queue.back ()->compress ();
+        }
+
+        // The compressed frames are the ones gathered
+        std::size_t writes;
+        auto const out = drain (queue, true, writes);
+        expect (out == frames (queue, true));
+        expect (out.size () < frames (queue, false).size ());
+    }
+
+    void
+    run ()
+    {
+        testSmall ();
+        testLarge ();
+        testCompressed ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(coalesce,overlay,ripple);
+
+}
@@ -0,0 +1,265 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/overlay/Message.h>
+#include <ripple/overlay/impl/ProtocolMessage.h>
+#include <ripple/overlay/impl/TrafficCount.h>
+#include <ripple/overlay/impl/Tuning.h>
+#include <beast/unit_test/suite.h>
+
+namespace ripple {
+
+class compression_test : public beast::unit_test::suite
+{
+private:
+    // Records what invokeProtocolMessage hands over
+    struct Handler
+    {
+        int type = 0;
+        std::size_t size = 0;
+        std::size_t rawBytes = 0;
+        bool decompressed = false;
+        std::shared_ptr <::google::protobuf::Message> message;
+
+        boost::system::error_code
+        onMessageUnknown (std::uint16_t)
+        {
+            return boost::system::errc::make_error_code(
+                boost::system::errc::invalid_argument);
+        }
+
+        void
+        onMessageDecompressed (int, std::size_t raw,
+            std::size_t, std::chrono::microseconds)
+        {
+            decompressed = true;
+            rawBytes = raw;
+        }
+
+        boost::system::error_code
+        onMessageBegin (std::uint16_t t,
+            std::shared_ptr <::google::protobuf::Message> const& m,
+                std::size_t n)
+        {
+            type = t;
+            message = m;
+            size = n;
+            return {};
+        }
+
+        template <class T>
+        void
+        onMessage (std::shared_ptr <T> const&)
+        {
+        }
+
+        void
+        onMessageEnd (std::uint16_t,
+            std::shared_ptr <::google::protobuf::Message> const&)
+        {
+        }
+    };
+
+    // A reply with many similar objects, as ledger node replies are
+    static
+    protocol::TMGetObjectByHash
+    makeObjects (int count)
+    {
+        protocol::TMGetObjectByHash m;
+        m.set_type (protocol::TMGetObjectByHash::otSTATE_NODE);
+        m.set_query (false);
+        m.set_seq (1234);
+        for (int i = 0; i < count; ++i)
+        {
+            auto const o = m.add_objects ();
+            o->set_hash (std::string (32, static_cast<char>(i)));
+            o->set_data (std::string (100, 'x') + std::to_string (i));
+        }
+        return m;
+    }
+
+    template <class Buffer>
+    std::pair <std::size_t, boost::system::error_code>
+    invoke (Buffer const& buffer, Handler& h)
+    {
+        return invokeProtocolMessage (boost::asio::const_buffers_1 (
+            buffer.data (), buffer.size ()), h);
+    }
+
+public:
+    void
+    testRoundTrip ()
+    {
+        testcase ("round trip");
+
+        auto const tm = makeObjects (100);
+        Message m (tm, protocol::mtGET_OBJECTS);
+        expect (m.compressible ());
+        m.compress ();
+
+        auto const& plain = m.getBuffer ();
+        auto const& packed = m.getBuffer (true);
+        expect (packed.size () < plain.size ());
+        expect (Message::getType (packed) ==
+            (protocol::mtGET_OBJECTS | Message::kCompressedBit));
+        expect (Message::getLength (packed) ==
+            packed.size () - Message::kHeaderBytes);
+
+        // Compressing again keeps the same buffer
+        expect (m.compress ().count () == 0);
+        expect (&m.getBuffer (true) == &packed);
+
+        Handler h;
+        auto const result = invoke (packed, h);
+        expect (! result.second);
+        expect (result.first == packed.size ());
+        expect (h.decompressed);
+        expect (h.rawBytes == plain.size ());
+        expect (h.type == protocol::mtGET_OBJECTS);
+        // Traffic is counted as received on the wire
+        expect (h.size == packed.size ());
+        expect (h.message &&
+            h.message->SerializeAsString () == tm.SerializeAsString ());
+    }
+
+    void
+    testSkipped ()
+    {
+        testcase ("not compressed");
+
+        // Below the threshold
+        {
+            auto const tm = makeObjects (2);
+            Message m (tm, protocol::mtGET_OBJECTS);
+            expect (m.getBuffer ().size () <
+                Message::kHeaderBytes + Tuning::compressThreshold);
+            expect (! m.compressible ());
+            m.compress ();
+            expect (&m.getBuffer (true) == &m.getBuffer ());
+        }
+
+        // Not a compressed type
+        {
+            protocol::TMManifests tm;
+            for (int i = 0; i < 100; ++i)
+                tm.add_list ()->set_stobject (std::string (100, 'x'));
+            Message m (tm, protocol::mtMANIFESTS);
+            expect (! m.compressible ());
+        }
+
+        // Data which does not shrink is sent as is
+        {
+            protocol::TMTransaction tm;
+            std::string data;
+            std::uint32_t x = 12345;
+            for (int i = 0; i < 4096; ++i)
+            {
+                x = x * 1103515245 + 12345;
+                data.push_back (static_cast<char>(x >> 16));
+            }
+            tm.set_rawtransaction (data);
+            tm.set_status (protocol::tsNEW);
+            Message m (tm, protocol::mtTRANSACTION);
+            expect (m.compressible ());
+            m.compress ();
+            expect (&m.getBuffer (true) == &m.getBuffer ());
+
+            Handler h;
+            auto const result = invoke (m.getBuffer (), h);
+            expect (! result.second);
+            expect (! h.decompressed);
+            expect (h.type == protocol::mtTRANSACTION);
+        }
+    }
+
+    void
+    testCorrupt ()
+    {
+        testcase ("corrupt");
+
+        Message m (makeObjects (100), protocol::mtGET_OBJECTS);
+        m.compress ();
+
+        // Truncated compressed data
+        {
+            auto packed = m.getBuffer (true);
+            packed.resize (packed.size () - 10);
+            auto const n = packed.size () - Message::kHeaderBytes;
+            packed[2] = static_cast<std::uint8_t>((n >> 8) & 0xFF);
+            packed[3] = static_cast<std::uint8_t>(n & 0xFF);
+            Handler h;
+            expect (invoke (packed, h).second);
+            expect (! h.message);
+        }
+
+        // Claims to inflate beyond the limit
+        {
+            auto packed = m.getBuffer (true);
+            packed[Message::kHeaderBytes] = 0xFF;
+            Handler h;
+            expect (invoke (packed, h).second);
+            expect (! h.message);
+        }
+    }
+
+    void
+    testStats ()
+    {
+        testcase ("stats");
+
+        TrafficCount traffic;
+        expect (traffic.getCompression ().empty ());
+
+        traffic.addCompressed (protocol::mtLEDGER_DATA, false, 4000, 1000,
+            std::chrono::microseconds (30));
+        traffic.addCompressed (protocol::mtLEDGER_DATA, true, 900, 300,
+            std::chrono::microseconds (5));
+        // Invalid types are ignored
+        traffic.addCompressed (0x7fff, true, 900, 300,
+            std::chrono::microseconds (5));
+
+        auto const stats = traffic.getCompression ();
+        expect (stats.size () == 1);
+        auto const iter = stats.find ("ledger_data");
+        if (! expect (iter != stats.end ()))
+            return;
+        expect (iter->second.messagesOut == 1);
+        expect (iter->second.rawBytesOut == 4000);
+        expect (iter->second.bytesOut == 1000);
+        expect (iter->second.microsOut == 30);
+        expect (iter->second.messagesIn == 1);
+        expect (iter->second.rawBytesIn == 900);
+        expect (iter->second.bytesIn == 300);
+        expect (iter->second.microsIn == 5);
+    }
+
+    void
+    run ()
+    {
+        testRoundTrip ();
+        testSkipped ();
+        testCorrupt ();
+        testStats ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(compression,overlay,ripple);
+
+}
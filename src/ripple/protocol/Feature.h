@@ -38,6 +38,10 @@ extern uint256 const featureMultiSign;
 extern uint256 const featureSusPay;
 extern uint256 const featureTrustSetAuth;
 extern uint256 const featureFeeEscalation;
+extern uint256 const featureReferPages;
+extern uint256 const featureAssetReleaseCursor;
+extern uint256 const featureRingStrictPoints;
+extern uint256 const featureReferMaxChild;
 
 } // ripple
 
@@ -230,6 +230,9 @@ struct refer_t
     {
         return { ltREFER, key };
     }
+
+    /** A page of the reference list with the given root. */
+    Keylet operator()(uint256 const& root, std::uint64_t page) const;
 };
 static refer_t const refer {};
 
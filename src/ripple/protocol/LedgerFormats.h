@@ -164,6 +164,9 @@ enum LedgerSpecificFlags
     lsfHighNoRipple     = 0x00200000,
     lsfLowFreeze        = 0x00400000,   // True, low side has set freeze flag
     lsfHighFreeze       = 0x00800000,   // True, high side has set freeze flag
+
+    // ltDIVIDEND
+    lsfReferMaxChild    = 0x00010000,   // True, if reference lists keep their max child for this dividend.
 };
 
 //------------------------------------------------------------------------------
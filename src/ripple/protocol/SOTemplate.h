@@ -22,6 +22,7 @@
 
 #include <ripple/protocol/SField.h>
 #include <boost/range.hpp>
+#include <cassert>
 #include <memory>
 
 namespace ripple {
@@ -93,7 +94,14 @@ public:
     void push_back (SOElement const& r);
 
     /** Retrieve the position of a named field. */
-    int getIndex (SField const&) const;
+    int getIndex (SField const& f) const
+    {
+        // The mapping table should be large enough for any possible field
+        //
+        assert (f.getNum () < mIndex.size ());
+
+        return mIndex[f.getNum ()];
+    }
 
     SOE_Flags
     style(SField const& sf) const
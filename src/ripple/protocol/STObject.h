@@ -26,6 +26,7 @@
 #include <ripple/protocol/STPathSet.h>
 #include <ripple/protocol/STVector256.h>
 #include <ripple/protocol/SOTemplate.h>
+#include <ripple/protocol/impl/FieldIndex.h>
 #include <ripple/protocol/impl/STVar.h>
 #include <boost/iterator/transform_iterator.hpp>
 #include <boost/optional.hpp>
@@ -66,6 +67,34 @@ struct template_field_error : std::logic_error
 
 //------------------------------------------------------------------------------
 
+namespace detail {
+
+// The serialized type of a leaf field class, or STI_UNKNOWN for classes
+// which can have subclasses.
+template <class T>
+struct STypeOf
+    : std::integral_constant<SerializedTypeID, STI_UNKNOWN> { };
+
+template <SerializedTypeID id>
+using STypeIs = std::integral_constant<SerializedTypeID, id>;
+
+template <> struct STypeOf<STInteger<std::uint8_t>>  : STypeIs<STI_UINT8> { };
+template <> struct STypeOf<STInteger<std::uint16_t>> : STypeIs<STI_UINT16> { };
+template <> struct STypeOf<STInteger<std::uint32_t>> : STypeIs<STI_UINT32> { };
+template <> struct STypeOf<STInteger<std::uint64_t>> : STypeIs<STI_UINT64> { };
+template <> struct STypeOf<STBitString<128>>         : STypeIs<STI_HASH128> { };
+template <> struct STypeOf<STBitString<160>>         : STypeIs<STI_HASH160> { };
+template <> struct STypeOf<STBitString<256>>         : STypeIs<STI_HASH256> { };
+template <> struct STypeOf<STAmount>                 : STypeIs<STI_AMOUNT> { };
+template <> struct STypeOf<STAccount>                : STypeIs<STI_ACCOUNT> { };
+template <> struct STypeOf<STBlob>                   : STypeIs<STI_VL> { };
+template <> struct STypeOf<STPathSet>                : STypeIs<STI_PATHSET> { };
+template <> struct STypeOf<STVector256>              : STypeIs<STI_VECTOR256> { };
+
+} // detail
+
+//------------------------------------------------------------------------------
+
 class STObject
     : public STBase
     , public CountedObject <STObject>
@@ -294,6 +323,11 @@ private:
     list_type v_;
     SOTemplate const* mType;
 
+    // Positions of the fields by number, only kept for larger free objects.
+    // Deserialized objects are indexed once setTypeFromSField finds they
+    // have no template.
+    detail::FieldIndex index_;
+
 public:
     using iterator = boost::transform_iterator<
         Transform, STObject::list_type::const_iterator>;
@@ -406,7 +440,12 @@ public:
     emplace_back(Args&&... args)
     {
         v_.emplace_back(std::forward<Args>(args)...);
-        return v_.size() - 1;
+        auto const n = v_.size() - 1;
+        if (! index_.empty())
+            index_.insert (v_.back()->getFName().getNum(), n);
+        else if (v_.size() == detail::FieldIndex::threshold)
+            reindex();
+        return n;
     }
 
     int getCount () const
@@ -536,11 +575,16 @@ public:
         if (! rf)
             Throw<std::runtime_error> ("Field not found");
 
-        if (rf->getSType () == STI_NOTPRESENT)
+        SerializedTypeID id = rf->getSType ();
+
+        if (id == STI_NOTPRESENT)
+        {
             rf = makeFieldPresent (field);
+            id = rf->getSType ();
+        }
 
         using Bits = STBitString<160>;
-        if (auto cf = dynamic_cast<Bits*> (rf))
+        if (auto cf = fieldCast<Bits> (rf, id))
             cf->setValue (v);
         else
             Throw<std::runtime_error> ("Wrong field type");
@@ -566,6 +610,33 @@ public:
 private:
     void add (Serializer & s, bool withSigningFields) const;
 
+    // Rebuild index_ after the positions of the fields changed
+    void reindex ();
+
+    // The field as a T, or null if it holds another type. Comparing the
+    // serialized type, which callers mostly have already, costs less than
+    // a dynamic_cast.
+    template <class T>
+    static
+    T const*
+    fieldCast (STBase const* b, SerializedTypeID id)
+    {
+        if (detail::STypeOf<T>::value == STI_UNKNOWN)
+            return dynamic_cast<T const*> (b);
+        if (id != detail::STypeOf<T>::value)
+            return nullptr;
+        return static_cast<T const*> (b);
+    }
+
+    template <class T>
+    static
+    T*
+    fieldCast (STBase* b, SerializedTypeID id)
+    {
+        return const_cast<T*> (
+            fieldCast<T> (static_cast<STBase const*> (b), id));
+    }
+
     // Sort the entries in an STObject into the order that they will be
     // serialized.  Note: they are not sorted into pointer value order, they
     // are sorted by SField::fieldCode.
@@ -602,7 +673,7 @@ private:
         if (id == STI_NOTPRESENT)
             return V (); // optional field not present
 
-        const T* cf = dynamic_cast<const T*> (rf);
+        const T* cf = fieldCast<T> (rf, id);
 
         if (! cf)
             Throw<std::runtime_error> ("Wrong field type");
@@ -628,7 +699,7 @@ private:
         if (id == STI_NOTPRESENT)
             return empty; // optional field not present
 
-        const T* cf = dynamic_cast<const T*> (rf);
+        const T* cf = fieldCast<T> (rf, id);
 
         if (! cf)
             Throw<std::runtime_error> ("Wrong field type");
@@ -647,10 +718,15 @@ private:
         if (! rf)
             Throw<std::runtime_error> ("Field not found");
 
-        if (rf->getSType () == STI_NOTPRESENT)
+        SerializedTypeID id = rf->getSType ();
+
+        if (id == STI_NOTPRESENT)
+        {
             rf = makeFieldPresent (field);
+            id = rf->getSType ();
+        }
 
-        T* cf = dynamic_cast<T*> (rf);
+        T* cf = fieldCast<T> (rf, id);
 
         if (! cf)
             Throw<std::runtime_error> ("Wrong field type");
@@ -667,10 +743,15 @@ private:
         if (! rf)
             Throw<std::runtime_error> ("Field not found");
 
-        if (rf->getSType () == STI_NOTPRESENT)
+        SerializedTypeID id = rf->getSType ();
+
+        if (id == STI_NOTPRESENT)
+        {
             rf = makeFieldPresent (field);
+            id = rf->getSType ();
+        }
 
-        T* cf = dynamic_cast<T*> (rf);
+        T* cf = fieldCast<T> (rf, id);
 
         if (! cf)
             Throw<std::runtime_error> ("Wrong field type");
@@ -687,10 +768,15 @@ private:
         if (! rf)
             Throw<std::runtime_error> ("Field not found");
 
-        if (rf->getSType () == STI_NOTPRESENT)
+        SerializedTypeID id = rf->getSType ();
+
+        if (id == STI_NOTPRESENT)
+        {
             rf = makeFieldPresent (field);
+            id = rf->getSType ();
+        }
 
-        T* cf = dynamic_cast<T*> (rf);
+        T* cf = fieldCast<T> (rf, id);
 
         if (! cf)
             Throw<std::runtime_error> ("Wrong field type");
@@ -737,8 +823,10 @@ inline
 T const*
 STObject::Proxy<T>::find() const
 {
-    return dynamic_cast<T const*>(
-        st_->peekAtPField(*f_));
+    auto const b = st_->peekAtPField(*f_);
+    if (! b)
+        return nullptr;
+    return fieldCast<T>(b, b->getSType());
 }
 
 template <class T>
@@ -752,13 +840,13 @@ STObject::Proxy<T>::assign(U&& u)
         st_->makeFieldAbsent(*f_);
         return;
     }
-    T* t;
+    STBase* b;
     if (style_ == SOE_INVALID)
-        t = dynamic_cast<T*>(
-            st_->getPField(*f_, true));
+        b = st_->getPField(*f_, true);
     else
-        t = dynamic_cast<T*>(
-            st_->makeFieldPresent(*f_));
+        b = st_->makeFieldPresent(*f_);
+    assert(b);
+    T* t = fieldCast<T>(b, b->getSType());
     assert(t);
     *t = std::forward<U>(u);
 }
@@ -913,7 +1001,7 @@ STObject::operator[](TypedField<T> const& f) const
         // with no template
         Throw<missing_field_error> (f);
     auto const u =
-        dynamic_cast<T const*>(b);
+        fieldCast<T>(b, b->getSType());
     if (! u)
     {
         assert(mType);
@@ -939,7 +1027,7 @@ STObject::operator[](OptionaledField<T> const& of) const
     if (! b)
         return boost::none;
     auto const u =
-        dynamic_cast<T const*>(b);
+        fieldCast<T>(b, b->getSType());
     if (! u)
     {
         assert(mType);
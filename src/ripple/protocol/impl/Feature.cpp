@@ -49,5 +49,9 @@ uint256 const featureMultiSign = feature("MultiSign");
 uint256 const featureSusPay = feature("SusPay");
 uint256 const featureTrustSetAuth = feature("TrustSetAuth");
 uint256 const featureFeeEscalation = feature("FeeEscalation");
+uint256 const featureReferPages = feature("ReferPages");
+uint256 const featureAssetReleaseCursor = feature("AssetReleaseCursor");
+uint256 const featureRingStrictPoints = feature("RingStrictPoints");
+uint256 const featureReferMaxChild = feature("ReferMaxChild");
 
 } // ripple
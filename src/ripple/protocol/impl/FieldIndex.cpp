@@ -0,0 +1,124 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/protocol/impl/FieldIndex.h>
+#include <algorithm>
+
+namespace ripple {
+namespace detail {
+
+FieldIndex::FieldIndex (FieldIndex const& other)
+    : mask_ (other.mask_)
+    , size_ (other.size_)
+{
+    if (other.slots_)
+    {
+        slots_.reset (new std::uint32_t[mask_ + 1]);
+        std::copy (other.slots_.get(),
+            other.slots_.get() + mask_ + 1, slots_.get());
+    }
+}
+
+FieldIndex::FieldIndex (FieldIndex&& other)
+    : slots_ (std::move (other.slots_))
+    , mask_ (other.mask_)
+    , size_ (other.size_)
+{
+    other.clear();
+}
+
+FieldIndex&
+FieldIndex::operator= (FieldIndex const& other)
+{
+    if (this != &other)
+        *this = FieldIndex (other);
+    return *this;
+}
+
+FieldIndex&
+FieldIndex::operator= (FieldIndex&& other)
+{
+    slots_ = std::move (other.slots_);
+    mask_ = other.mask_;
+    size_ = other.size_;
+    other.clear();
+    return *this;
+}
+
+void
+FieldIndex::clear()
+{
+    slots_.reset();
+    mask_ = 0;
+    size_ = 0;
+}
+
+void
+FieldIndex::grow (std::size_t n)
+{
+    std::uint32_t capacity = 2 * threshold;
+    while (capacity < 2 * n)
+        capacity *= 2;
+
+    auto old = std::move (slots_);
+    auto const oldCapacity = old ? mask_ + 1 : 0;
+
+    slots_.reset (new std::uint32_t[capacity]);
+    std::fill (slots_.get(), slots_.get() + capacity, 0);
+    mask_ = capacity - 1;
+
+    for (std::uint32_t i = 0; i < oldCapacity; ++i)
+    {
+        auto const e = old[i];
+        if (e == 0)
+            continue;
+        auto j = home ((e >> 16) - 1);
+        while (slots_[j] != 0)
+            j = (j + 1) & mask_;
+        slots_[j] = e;
+    }
+}
+
+bool
+FieldIndex::insert (int num, std::size_t pos)
+{
+    if (num < 0 || num >= 0xffff || pos > 0xffff)
+    {
+        clear();
+        return false;
+    }
+
+    if (2 * (size_ + 1) > mask_ + 1)
+        grow (size_ + 1);
+
+    auto const key = static_cast<std::uint32_t>(num + 1) << 16;
+    auto i = home (num);
+    for (; slots_[i] != 0; i = (i + 1) & mask_)
+    {
+        if ((slots_[i] & 0xffff0000) == key)
+            return true;
+    }
+    slots_[i] = key | static_cast<std::uint32_t>(pos);
+    ++size_;
+    return true;
+}
+
+} // detail
+} // ripple
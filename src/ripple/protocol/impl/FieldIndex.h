@@ -0,0 +1,95 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_PROTOCOL_FIELDINDEX_H_INCLUDED
+#define RIPPLE_PROTOCOL_FIELDINDEX_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace ripple {
+namespace detail {
+
+// Positions of the fields of a free STObject, by field number.
+//
+// An open addressed table with linear probing, kept at most half full.
+// Each slot holds the field number plus one in the upper half and the
+// position in the lower half, so zero marks an empty slot.
+class FieldIndex
+{
+private:
+    std::unique_ptr<std::uint32_t[]> slots_;
+    std::uint32_t mask_ = 0;
+    std::uint32_t size_ = 0;
+
+    std::uint32_t
+    home (int num) const
+    {
+        return (static_cast<std::uint32_t>(num) * 2654435761u) & mask_;
+    }
+
+    void
+    grow (std::size_t n);
+
+public:
+    // Objects with fewer fields are scanned instead
+    static std::size_t constexpr threshold = 8;
+
+    FieldIndex() = default;
+    FieldIndex (FieldIndex const& other);
+    FieldIndex (FieldIndex&& other);
+    FieldIndex& operator= (FieldIndex const& other);
+    FieldIndex& operator= (FieldIndex&& other);
+
+    bool
+    empty() const
+    {
+        return size_ == 0;
+    }
+
+    void
+    clear();
+
+    // The position of a field, or -1 if it isn't in the object
+    int
+    find (int num) const
+    {
+        auto const key = static_cast<std::uint32_t>(num + 1) << 16;
+        for (auto i = home (num);; i = (i + 1) & mask_)
+        {
+            auto const e = slots_[i];
+            if (e == 0)
+                return -1;
+            if ((e & 0xffff0000) == key)
+                return e & 0xffff;
+        }
+    }
+
+    // Add a field at a position. An object may hold a field more than
+    // once, in which case the first position is kept. Returns false if
+    // the position can't be indexed, which leaves the index empty.
+    bool
+    insert (int num, std::size_t pos);
+};
+
+} // detail
+} // ripple
+
+#endif
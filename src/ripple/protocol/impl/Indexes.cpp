@@ -395,6 +395,19 @@ Keylet refer_t::operator()(AccountID const& id) const
         getReferIndex(id) };
 }
 
+Keylet refer_t::operator()(uint256 const& root,
+    std::uint64_t page) const
+{
+    if (page == 0)
+        return { ltREFER, root };
+
+    return { ltREFER,
+        sha512Half(
+            std::uint16_t(spaceRefer),
+            root,
+            std::uint64_t(page)) };
+}
+
 Keylet asset_t::operator()(AccountID const& id,
         Currency const& currency) const
 {
@@ -111,6 +111,7 @@ LedgerFormats::LedgerFormats ()
             << SOElement (sfHighNode,            SOE_OPTIONAL)
             << SOElement (sfHighQualityIn,       SOE_OPTIONAL)
             << SOElement (sfHighQualityOut,      SOE_OPTIONAL)
+            << SOElement (sfNextReleaseTime,     SOE_OPTIONAL)
             ;
 
     add ("SuspendedPayment", ltSUSPAY) <<
@@ -170,6 +171,11 @@ LedgerFormats::LedgerFormats ()
     add("Refer", ltREFER)
             << SOElement (sfAccount,             SOE_OPTIONAL)
             << SOElement (sfReferences,          SOE_OPTIONAL)
+            << SOElement (sfRootIndex,           SOE_OPTIONAL)
+            << SOElement (sfIndexNext,           SOE_OPTIONAL)
+            << SOElement (sfIndexPrevious,       SOE_OPTIONAL)
+            << SOElement (sfDividendLedger,      SOE_OPTIONAL)  // for the root, the max child's dividend
+            << SOElement (sfDividendVSprd,       SOE_OPTIONAL)  // for the root, the max child's vSprd
             ;
 
     // All fields are SOE_REQUIRED because there is always a
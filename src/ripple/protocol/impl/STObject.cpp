@@ -40,6 +40,7 @@ STObject::STObject(STObject&& other)
     : STBase(other.getFName())
     , v_(std::move(other.v_))
     , mType(other.mType)
+    , index_(std::move(other.index_))
 {
 }
 
@@ -80,6 +81,7 @@ STObject::operator= (STObject&& other)
     setFName(other.getFName());
     mType = other.mType;
     v_ = std::move(other.v_);
+    index_ = std::move(other.index_);
     return *this;
 }
 
@@ -88,6 +90,7 @@ void STObject::set (const SOTemplate& type)
     v_.clear();
     v_.reserve(type.size());
     mType = &type;
+    index_.clear();
 
     for (auto const& elem : type.all())
     {
@@ -147,6 +150,7 @@ bool STObject::setType (const SOTemplate& type)
     // Swap the template matching data in for the old data,
     // freeing any leftover junk
     v_.swap(v);
+    index_.clear();
     return valid;
 }
 
@@ -161,6 +165,11 @@ STObject::setTypeFromSField (SField const& sField)
     {
         ret = setType (*elements) ? typeIsSet : typeSetFail;
     }
+    else
+    {
+        // The object stays free, so index it for lookups
+        reindex ();
+    }
     return ret;
 }
 
@@ -192,6 +201,7 @@ bool STObject::set (SerialIter& sit, int depth)
     bool reachedEndOfObject = false;
 
     v_.clear();
+    index_.clear();
 
     // Consume data in the pipe until we run out or reach the end
     //
@@ -332,11 +342,28 @@ uint256 STObject::getSigningHash (std::uint32_t prefix) const
     return s.getSHA512Half ();
 }
 
+void STObject::reindex ()
+{
+    index_.clear ();
+
+    if (isFree () && v_.size () >= detail::FieldIndex::threshold)
+    {
+        for (std::size_t i = 0; i < v_.size (); ++i)
+        {
+            if (! index_.insert (v_[i]->getFName ().getNum (), i))
+                break;
+        }
+    }
+}
+
 int STObject::getFieldIndex (SField const& field) const
 {
     if (mType != nullptr)
         return mType->getIndex (field);
 
+    if (! index_.empty ())
+        return index_.find (field.getNum ());
+
     int i = 0;
     for (auto const& elem : v_)
     {
@@ -420,7 +447,8 @@ STArray& STObject::peekFieldArray (SField const& field)
 
 bool STObject::setFlag (std::uint32_t f)
 {
-    STUInt32* t = dynamic_cast<STUInt32*> (getPField (sfFlags, true));
+    STBase* rf = getPField (sfFlags, true);
+    STUInt32* t = rf ? fieldCast<STUInt32> (rf, rf->getSType ()) : nullptr;
 
     if (!t)
         return false;
@@ -431,7 +459,8 @@ bool STObject::setFlag (std::uint32_t f)
 
 bool STObject::clearFlag (std::uint32_t f)
 {
-    STUInt32* t = dynamic_cast<STUInt32*> (getPField (sfFlags));
+    STBase* rf = getPField (sfFlags);
+    STUInt32* t = rf ? fieldCast<STUInt32> (rf, rf->getSType ()) : nullptr;
 
     if (!t)
         return false;
@@ -447,7 +476,8 @@ bool STObject::isFlag (std::uint32_t f) const
 
 std::uint32_t STObject::getFlags (void) const
 {
-    const STUInt32* t = dynamic_cast<const STUInt32*> (peekAtPField (sfFlags));
+    const STBase* rf = peekAtPField (sfFlags);
+    const STUInt32* t = rf ? fieldCast<STUInt32> (rf, rf->getSType ()) : nullptr;
 
     if (!t)
         return 0;
@@ -506,6 +536,8 @@ bool STObject::delField (SField const& field)
 void STObject::delField (int index)
 {
     v_.erase (v_.begin () + index);
+    if (! index_.empty ())
+        reindex ();
 }
 
 std::string STObject::getFieldString (SField const& field) const
@@ -608,7 +640,7 @@ STObject::set (std::unique_ptr<STBase> v)
         if (! isFree())
             Throw<std::runtime_error> (
                 "missing field in templated STObject");
-        v_.emplace_back(std::move(*v));
+        emplace_back(std::move(*v));
     }
 }
 
@@ -24,6 +24,7 @@
 #include <ripple/json/json_reader.h>
 #include <ripple/json/to_string.h>
 #include <beast/unit_test/suite.h>
+#include <chrono>
 #include <memory>
 #include <type_traits>
 
@@ -474,11 +475,67 @@ public:
         }
     }
 
+    // Free objects with many fields are looked up through an index
+    void
+    testFreeIndex()
+    {
+        testcase ("free index");
+
+        std::vector<SF_U32 const*> const fields {
+            &sfFlags, &sfSourceTag, &sfSequence, &sfLedgerSequence,
+            &sfCloseTime, &sfExpiration, &sfTransferRate, &sfOwnerCount,
+            &sfDestinationTag, &sfQualityIn, &sfQualityOut,
+            &sfOfferSequence };
+
+        auto const check = [&](STObject const& st, std::size_t skip)
+        {
+            for (std::size_t i = 0; i < fields.size(); ++i)
+            {
+                if (i == skip)
+                    expect (! st.isFieldPresent (*fields[i]));
+                else
+                    expect (st.getFieldU32 (*fields[i]) == i + 1);
+            }
+            expect (! st.isFieldPresent (sfBondAmount));
+            expect (st.getFieldIndex (sfBondAmount) == -1);
+        };
+
+        STObject st (sfGeneric);
+        for (std::size_t i = 0; i < fields.size(); ++i)
+            st.setFieldU32 (*fields[i], i + 1);
+        expect (st.getCount () == static_cast<int> (fields.size()));
+        check (st, fields.size());
+
+        // Copies and moves keep the index
+        STObject copy (st);
+        check (copy, fields.size());
+        STObject moved (std::move (copy));
+        check (moved, fields.size());
+
+        // Deleting a field moves the ones after it
+        expect (st.delField (sfLedgerSequence));
+        check (st, 3);
+        expect (st.getFieldIndex (sfOfferSequence) ==
+            static_cast<int> (fields.size()) - 2);
+        st.setFieldU32 (sfLedgerSequence, 4);
+        check (st, fields.size());
+
+        // A deserialized free object is indexed too
+        Serializer s;
+        st.add (s);
+        SerialIter sit (s.slice());
+        STObject parsed (sit, sfGeneric);
+        expect (parsed.setTypeFromSField (sfGeneric) == STObject::noTemplate);
+        check (parsed, fields.size());
+        expect (parsed == st);
+    }
+
     void
     run()
     {
         testFields();
         testSerialization();
+        testFreeIndex();
         testParseJSONArray();
         testParseJSONArrayWithInvalidChildrenObjects();
     }
@@ -486,4 +543,130 @@ public:
 
 BEAST_DEFINE_TESTSUITE(STObject,protocol,ripple);
 
+//------------------------------------------------------------------------------
+
+// Times the field getters on common ledger entries, as templated SLEs and
+// as free objects holding the same fields like metadata does
+class STObjectBench_test : public beast::unit_test::suite
+{
+    static
+    std::shared_ptr<SLE>
+    accountRoot ()
+    {
+        auto sle = std::make_shared<SLE> (ltACCOUNT_ROOT, uint256 (1));
+        sle->setAccountID (sfAccount, AccountID (2));
+        sle->setFieldU32 (sfSequence, 10);
+        sle->setFieldAmount (sfBalance, STAmount (1000000));
+        sle->setFieldU32 (sfOwnerCount, 3);
+        sle->setAccountID (sfReferee, AccountID (3));
+        sle->setFieldU32 (sfReferenceHeight, 2);
+        sle->setFieldU32 (sfDividendLedger, 100);
+        sle->setFieldU32 (sfTransferRate, 1005000000);
+        return sle;
+    }
+
+    static
+    std::shared_ptr<SLE>
+    rippleState ()
+    {
+        Issue const usd {Currency (1), AccountID (4)};
+        auto sle = std::make_shared<SLE> (ltRIPPLE_STATE, uint256 (2));
+        sle->setFieldAmount (sfBalance, STAmount (usd, 50));
+        sle->setFieldAmount (sfLowLimit, STAmount (usd, 100));
+        sle->setFieldAmount (sfHighLimit, STAmount (usd, 0));
+        sle->setFieldU32 (sfFlags, lsfLowReserve);
+        sle->setFieldU64 (sfLowNode, 0);
+        sle->setFieldU64 (sfHighNode, 0);
+        return sle;
+    }
+
+    static
+    std::shared_ptr<SLE>
+    offer ()
+    {
+        Issue const usd {Currency (1), AccountID (4)};
+        auto sle = std::make_shared<SLE> (ltOFFER, uint256 (3));
+        sle->setAccountID (sfAccount, AccountID (2));
+        sle->setFieldU32 (sfSequence, 7);
+        sle->setFieldAmount (sfTakerPays, STAmount (usd, 10));
+        sle->setFieldAmount (sfTakerGets, STAmount (5000000));
+        sle->setFieldH256 (sfBookDirectory, uint256 (5));
+        return sle;
+    }
+
+    // The same fields without a template
+    static
+    STObject
+    withoutTemplate (STObject const& object)
+    {
+        STObject st (sfFinalFields);
+        for (auto const& field : object)
+            st.emplace_back (field);
+        return st;
+    }
+
+    template <class F>
+    void
+    time (char const* name, STObject const& st, int lookups, F const& f)
+    {
+        using namespace std::chrono;
+        int const iterations = 200000;
+        std::uint64_t sink = 0;
+        auto const start = steady_clock::now ();
+        for (int i = 0; i < iterations; ++i)
+            sink += f (st);
+        auto const elapsed = duration_cast<nanoseconds> (
+            steady_clock::now () - start).count ();
+        expect (sink != 0);
+        log << "    " << name << (st.isFree () ? " (free): " : ": ") <<
+            (elapsed / (iterations * lookups)) << " ns per lookup";
+    }
+
+public:
+    void
+    run()
+    {
+        auto const ar = [](STObject const& st) -> std::uint64_t
+        {
+            return st.getFieldU32 (sfSequence) +
+                st.getFieldAmount (sfBalance).mantissa () +
+                st.getFieldU32 (sfOwnerCount) +
+                st.isFieldPresent (sfReferee) +
+                st.getFieldU32 (sfDividendLedger) +
+                st.getAccountID (sfAccount).isZero ();
+        };
+        auto const rs = [](STObject const& st) -> std::uint64_t
+        {
+            return st.getFieldAmount (sfBalance).mantissa () +
+                st.getFieldAmount (sfLowLimit).mantissa () +
+                st.getFieldAmount (sfHighLimit).mantissa () +
+                st.getFieldU32 (sfFlags) +
+                st.isFieldPresent (sfLowQualityIn) +
+                st.getFieldU64 (sfLowNode);
+        };
+        auto const of = [](STObject const& st) -> std::uint64_t
+        {
+            return st.getFieldAmount (sfTakerPays).mantissa () +
+                st.getFieldAmount (sfTakerGets).mantissa () +
+                st.getFieldU32 (sfExpiration) +
+                st.getFieldH256 (sfBookDirectory).isZero () +
+                st.getFieldU32 (sfSequence) +
+                st[sfAccount].isZero ();
+        };
+
+        auto const a = accountRoot ();
+        auto const r = rippleState ();
+        auto const o = offer ();
+        time ("AccountRoot", *a, 6, ar);
+        time ("AccountRoot", withoutTemplate (*a), 6, ar);
+        time ("RippleState", *r, 6, rs);
+        time ("RippleState", withoutTemplate (*r), 6, rs);
+        time ("Offer", *o, 6, of);
+        time ("Offer", withoutTemplate (*o), 6, of);
+        pass ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(STObjectBench,protocol,ripple);
+
 } // ripple
@@ -22,6 +22,7 @@
 #include <ripple/app/main/Application.h>
 #include <ripple/json/json_value.h>
 #include <ripple/ledger/ReadView.h>
+#include <ripple/ledger/View.h>
 #include <ripple/protocol/ErrorCodes.h>
 #include <ripple/protocol/Indexes.h>
 #include <ripple/protocol/JsonFields.h>
@@ -73,13 +74,21 @@ Json::Value doAccountInfo (RPC::Context& context)
         RPC::injectSLE(jvAccepted, *sleAccepted);
 
         // See if there's a References for this account.
-        auto const referList = ledger->read (keylet::refer(accountID));
-
-        if (referList)
+        if (ledger->exists (keylet::refer(accountID)))
         {
-            // Return multi-signing information if there are multi-signers.
+            // Collect the references from all pages of the list.
             static const Json::StaticString referencesName("References");
-            jvAccepted[referencesName] = referList->getJson (0)["References"];
+            Json::Value& references =
+                (jvAccepted[referencesName] = Json::arrayValue);
+            forEachReference (*ledger, accountID,
+                [&](AccountID const& reference)
+                {
+                    Json::Value& holder =
+                        references.append (Json::objectValue);
+                    holder[sfReferenceHolder.getJsonName ()]
+                        [sfReference.getJsonName ()] =
+                            context.app.accountIDCache ().toBase58 (reference);
+                });
         }
 
         // See if there's a SignerEntries for this account.
@@ -15,22 +15,15 @@ Json::Value doDividendObject (RPC::Context& context)
         }
         auto time = time_value.asUInt();
 
-        std::string sql =
-        boost::str (boost::format (
-                                   "SELECT * FROM Ledgers WHERE ClosingTime <= %u ORDER BY LedgerSeq desc LIMIT 1")
-                    % time);
+        // the close time index covers every ledger in the ledger database
+        auto const ledgerSeq =
+            context.ledgerMaster.getLedgerSeqBeforeCloseTime (time);
+        if (ledgerSeq)
         {
-            auto db = context.app.getLedgerDB ().checkoutDb ();
-            boost::optional<std::uint64_t> ledgerSeq64;
-            *db << sql, soci::into (ledgerSeq64);
-            if (db->got_data ())
-            {
-                uint32_t ledgerSeq =
-                    rangeCheckedCast<std::uint32_t> (ledgerSeq64.value_or (0));
-                //CARL should we find a seq more pricisely?
-                Ledger::pointer ledger = context.ledgerMaster.getLedgerBySeq (ledgerSeq);
+            //CARL should we find a seq more pricisely?
+            Ledger::pointer ledger = context.ledgerMaster.getLedgerBySeq (*ledgerSeq);
+            if (ledger)
                 dividendSLE = ledger->read (keylet::dividend ());
-            }
         }
     }
     else //no time param specified, query from the lastet closed ledger
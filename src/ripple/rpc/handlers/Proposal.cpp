@@ -19,6 +19,8 @@
 
 #include <BeastConfig.h>
 #include <ripple/app/misc/NetworkOPs.h>
+#include <ripple/app/misc/ProposalTally.h>
+#include <ripple/basics/ParallelFor.h>
 #include <ripple/json/json_value.h>
 #include <ripple/protocol/JsonFields.h>
 #include <ripple/rpc/Context.h>
@@ -33,6 +35,64 @@
 
 namespace ripple {
 
+static void fillVotes (Json::Value& ret, ProposalTally::Counts const& counts) {
+    Json::Value& statisticVal(ret["votes"] = Json::objectValue);
+    statisticVal["ledger"] = counts.ledgerSeq;
+    Json::Value& accountsVote(statisticVal["account"] = Json::arrayValue);
+    Json::Value& vbcVote(statisticVal["vbc"] = Json::arrayValue);
+    for (int i = 0; i < counts.accounts.size(); i++) {
+        accountsVote.append(static_cast<Json::Int>(counts.accounts[i]));
+        vbcVote.append(std::to_string(counts.vbc[i]));
+    }
+}
+
+// Count the votes on a proposal by walking every account of a ledger.
+static ProposalTally::Counts countVotes (Ledger const& ledger, uint32_t proposalIndex, uint8_t options) {
+    // one sum per part of the state map, merged at the end
+    std::vector<ProposalTally::Counts> parts(SHAMap::visitParts);
+    for (auto& part : parts) {
+        part.accounts.assign(options + 1, 0); // 0-not vote
+        part.vbc.assign(options + 1, 0);      // 0-not vote
+    }
+    ledger.visitStateItemsParallel([&](std::size_t part, SLE::ref sle) {
+        if (sle->getType () != ltACCOUNT_ROOT) {
+            return;
+        }
+        auto& accounts = parts[part].accounts;
+        auto& vbcs = parts[part].vbc;
+        const STAmount vbc = sle->getFieldAmount(sfBalanceVBC);
+        uint8_t optionVote = 0;
+        if (sle->isFieldPresent(sfProposalVotes)) {
+            const STArray &votes = sle->getFieldArray(sfProposalVotes);
+            for (const auto &vote : votes) {
+                if (vote.getFieldU32(sfProposalIndex) == proposalIndex) {
+                    // this account vote this proposal
+                    optionVote = vote.getFieldU8(sfProposalVote);
+                    break;
+                }
+            }
+        }
+        if (optionVote > options) {
+            // not an option of this proposal
+            optionVote = 0;
+        }
+        accounts[optionVote] += 1;
+        vbcs[optionVote] += vbc.mantissa();
+    }, parallelThreads());
+
+    ProposalTally::Counts counts;
+    counts.ledgerSeq = ledger.info().seq;
+    counts.accounts.assign(options + 1, 0);
+    counts.vbc.assign(options + 1, 0);
+    for (auto const& part : parts) {
+        for (int i = 0; i <= options; i++) {
+            counts.accounts[i] += part.accounts[i];
+            counts.vbc[i] += part.vbc[i];
+        }
+    }
+    return counts;
+}
+
 Json::Value doProposalInfo (RPC::Context& context) {
     Json::Value ret (Json::objectValue);
 
@@ -66,7 +126,16 @@ Json::Value doProposalInfo (RPC::Context& context) {
         ret["appendix"] = strHex(appendix.data(), appendix.size());
     }
 
+    // votes kept by the tally, as of the close ledger or the last
+    // validated one while the proposal is open
+    auto& tally = context.app.getProposalTally();
+    boost::optional<ProposalTally::Counts> counts = tally.counts(proposalIndex,
+        ret.isMember("close_on_ledger") ? ret["close_on_ledger"].asUInt() : tally.ledgerSeq());
+
     if (context.app.getVoteCountingDB().getType() == DatabaseCon::Type::None) {
+        if (counts) {
+            fillVotes(ret, *counts);
+        }
         return ret;
     }
 
@@ -79,7 +148,9 @@ Json::Value doProposalInfo (RPC::Context& context) {
 
     *db << "SELECT Ledger, Statistic, Timestamp FROM VoteCounting WHERE Proposal=:proposalIndex ORDER BY Ledger DESC LIMIT 1", 
         soci::use(proposalIndex), soci::into(lastLedgerSeq), soci::into(statistic), soci::into(timestamp);
-    if (db->got_data()) {
+    if (counts && (!db->got_data() || counts->ledgerSeq > lastLedgerSeq)) {
+        fillVotes(ret, *counts);
+    } else if (db->got_data()) {
         Json::Value& statisticVal(ret["votes"] = Json::objectValue);
         statisticVal["ledger"] = lastLedgerSeq;
         Json::Value& accountsVote(statisticVal["account"] = Json::arrayValue);
@@ -188,7 +259,7 @@ Json::Value doVoteCounting (RPC::Context& context) {
 
     auto db = context.app.getVoteCountingDB().checkoutDb();
     std::string sql;
-    uint64_t lastLedgerSeq;
+    uint64_t lastLedgerSeq = 0;
     std::string statistic;
     std::tm timestamp;
     // checking ifg we have done this calc
@@ -202,62 +273,34 @@ Json::Value doVoteCounting (RPC::Context& context) {
         }
     }
 
-    uint8_t options = proposalSle->getFieldU8(sfProposalOptions);
-    std::vector<uint64> accounts(options + 1, 0); // 0-not vote
-    std::vector<uint64> vbcs(options + 1, 0);     // 0-not vote
-
-    auto workingLedger = context.app.getLedgerMaster().getLedgerBySeq(ledgerSeq);
-    if (!workingLedger) {
-        return rpcError(rpcGENERAL);
+    auto& tally = context.app.getProposalTally();
+    if (closeLedgerSeq == 0 && tally.ledgerSeq() > lastLedgerSeq && tally.ledgerSeq() < ledgerSeq) {
+        // an open proposal is counted as of the last validated ledger
+        ledgerSeq = tally.ledgerSeq();
     }
-    // traverse all accounts
-    workingLedger->visitStateItems([&](SLE::ref sle) {
-        if (sle->getType () != ltACCOUNT_ROOT) {
-            return;
+    boost::optional<ProposalTally::Counts> counts = tally.counts(proposalIndex, ledgerSeq);
+    if (!counts && context.role != Role::ADMIN) {
+        // walking the whole state is left to administrators, others get
+        // an open proposal as of the ledger the tally is at
+        auto const tallySeq = tally.ledgerSeq();
+        if (closeLedgerSeq == 0 && tallySeq > lastLedgerSeq) {
+            counts = tally.counts(proposalIndex, tallySeq);
         }
-        const STAmount vbc = sle->getFieldAmount(sfBalanceVBC);
-        if (!sle->isFieldPresent(sfProposalVotes)) {
-            // this account vote nothing
-            accounts[0] += 1;
-            vbcs[0] += vbc.mantissa();
-            return;
-        }
-        const STArray &votes = sle->getFieldArray(sfProposalVotes);
-        bool found = false;
-        for (const auto &vote : votes) {
-            uint32_t index = vote.getFieldU32(sfProposalIndex);
-            uint8_t optionVote = vote.getFieldU8(sfProposalVote);
-            if (index == proposalIndex) {
-                // this account vote this proposal
-                accounts[optionVote] += 1;
-                vbcs[optionVote] += vbc.mantissa();
-                found = true;
-                break;
-            }
-        }
-        if (!found) {
-            accounts[0] += 1;
-            vbcs[0] += vbc.mantissa();
-        }
-    });
-
-    // format result into statistic string
-    std::stringstream ss;
-    for (int i = 0; i < accounts.size(); i++) {
-        ss << accounts[i];
-        if (i != accounts.size() - 1) {
-            ss << "|";
+        if (!counts) {
+            return rpcError(rpcNO_PERMISSION);
         }
+        ledgerSeq = counts->ledgerSeq;
     }
-    ss << ";";
-    for (int i = 0; i < vbcs.size(); i++) {
-        ss << vbcs[i];
-        if (i != vbcs.size() - 1) {
-            ss << "|";
+    if (!counts) {
+        // the tally does not cover this ledger, walk its whole state
+        auto workingLedger = context.app.getLedgerMaster().getLedgerBySeq(ledgerSeq);
+        if (!workingLedger) {
+            return rpcError(rpcGENERAL);
         }
+        counts = countVotes(*workingLedger, proposalIndex, proposalSle->getFieldU8(sfProposalOptions));
     }
-    
-    statistic = ss.str();
+
+    statistic = counts->statistic();
 
     *db << "INSERT INTO VoteCounting (Proposal, Ledger, Statistic) VALUES(:proposalIndex, :ledgerSeq, :statistic)", 
         soci::use(proposalIndex), soci::use(ledgerSeq), soci::use(statistic);
@@ -21,10 +21,12 @@
 #define RIPPLE_SHAMAP_FAMILY_H_INCLUDED
 
 #include <ripple/basics/Log.h>
+#include <ripple/basics/ParallelFor.h>
 #include <ripple/shamap/FullBelowCache.h>
 #include <ripple/shamap/TreeNodeCache.h>
 #include <ripple/nodestore/Database.h>
 #include <beast/utility/Journal.h>
+#include <chrono>
 #include <cstdint>
 
 namespace ripple {
@@ -69,6 +71,24 @@ public:
     virtual
     void
     missing_node (uint256 const& refHash) = 0;
+
+    /** Returns the fewest modified nodes for which a map is flushed on
+        several threads, or zero to always flush on the calling thread.
+    */
+    virtual
+    std::size_t
+    flushThreshold() const = 0;
+
+    /** Returns the threads large maps are flushed on. */
+    virtual
+    ParallelPool&
+    flushPool() = 0;
+
+    /** Called after a map is flushed to the node store. */
+    virtual
+    void
+    onFlush (int nodes, std::size_t threads,
+        std::chrono::microseconds elapsed) = 0;
 };
 
 } // ripple
@@ -150,6 +150,15 @@ public:
     bool addGiveItem (std::shared_ptr<SHAMapItem const> const&,
                       bool isTransaction, bool hasMeta);
 
+    /** Fill an empty map with many items at once.
+        The items are sorted by key and the tree is built and hashed
+        bottom-up, with the subtrees below the top levels spread over
+        up to `threads` threads.
+        @return false if the map is not empty or two items share a key.
+    */
+    bool addGiveItems (std::vector<std::shared_ptr<SHAMapItem const>> items,
+                       bool isTransaction, bool hasMeta, std::size_t threads = 1);
+
     /** Fetch an item given its key.
         This retrieves the item whose key matches.
         If the item does not exist, an empty pointer is returned.
@@ -176,6 +185,24 @@ public:
         visitLeaves(
             std::function<void(std::shared_ptr<SHAMapItem const> const&)> const&) const;
 
+    /** Number of parts visitLeavesParallel splits a map into. */
+    static std::size_t const visitParts = 256;
+
+    /** Visit every leaf using up to `threads` threads.
+
+        The tree is cut below its top two levels and the subtrees are
+        walked in parallel, each reading ahead the children of the inner
+        nodes it enters. The function gets the part, in [0, visitParts),
+        the leaf is in. It may be called concurrently, though never for
+        the same part, and parts are in key order so results can be kept
+        per part and merged afterwards.
+    */
+    void
+        visitLeavesParallel(
+            std::function<void(std::size_t part,
+                std::shared_ptr<SHAMapItem const> const&)> const&,
+            std::size_t threads) const;
+
     // comparison/sync functions
     void getMissingNodes (std::vector<SHAMapNodeID>& nodeIDs, std::vector<uint256>& hashes, int max,
                           SHAMapSyncFilter * filter);
@@ -187,11 +214,11 @@ public:
 
     bool getRootNode (Serializer & s, SHANodeFormat format) const;
     std::vector<uint256> getNeededHashes (int max, SHAMapSyncFilter * filter);
-    SHAMapAddNode addRootNode (SHAMapHash const& hash, Blob const& rootNode,
+    SHAMapAddNode addRootNode (SHAMapHash const& hash, Slice const& rootNode,
                                SHANodeFormat format, SHAMapSyncFilter * filter);
-    SHAMapAddNode addRootNode (Blob const& rootNode, SHANodeFormat format,
+    SHAMapAddNode addRootNode (Slice const& rootNode, SHANodeFormat format,
                                SHAMapSyncFilter * filter);
-    SHAMapAddNode addKnownNode (SHAMapNodeID const& nodeID, Blob const& rawNode,
+    SHAMapAddNode addKnownNode (SHAMapNodeID const& nodeID, Slice const& rawNode,
                                 SHAMapSyncFilter * filter);
 
     // status functions
@@ -206,13 +233,28 @@ public:
     bool compare (SHAMap const& otherMap,
                   Delta& differences, int maxCount) const;
 
+    /** Hash the modified nodes and write them to the node store.
+
+        When at least Family::flushThreshold nodes were modified, the
+        map is flushed on the threads of Family::flushPool.
+
+        @return The number of nodes flushed.
+    */
     int flushDirty (NodeObjectType t, std::uint32_t seq);
+
+    /** Flush the modified nodes using up to `threads` threads.
+
+        The subtrees below the top two levels are flushed in parallel on
+        Family::flushPool and each thread writes the nodes it flushed in
+        one batch.
+    */
+    int flushDirty (NodeObjectType t, std::uint32_t seq, std::size_t threads);
     void walkMap (std::vector<SHAMapMissingNode>& missingNodes, int maxMissing) const;
     bool deepCompare (SHAMap & other) const;
 
     using fetchPackEntry_t = std::pair <uint256, Blob>;
 
-    void visitDifferences(SHAMap* have, std::function<bool(SHAMapAbstractNode&)>) const;
+    void visitDifferences(SHAMap const* have, std::function<bool(SHAMapAbstractNode&)>) const;
 
     void getFetchPack (SHAMap * have, bool includeLeaves, int max,
         std::function<void (uint256 const&, const Blob&)>) const;
@@ -229,6 +271,12 @@ private:
 
     int unshare ();
 
+    /** Returns true if at least n nodes are waiting to be flushed */
+    bool dirtyAtLeast (std::size_t n) const;
+
+    /** Returns the number of threads to flush the map on */
+    std::size_t flushThreads () const;
+
      // tree node cache operations
     std::shared_ptr<SHAMapAbstractNode> getCache (SHAMapHash const& hash) const;
     void canonicalize (SHAMapHash const& hash, std::shared_ptr<SHAMapAbstractNode>&) const;
@@ -265,10 +313,11 @@ private:
         std::shared_ptr<Node>
         preFlushNode(std::shared_ptr<Node> node) const;
 
-    /** write and canonicalize modified node */
+    /** write and canonicalize modified node, into batch if given */
     std::shared_ptr<SHAMapAbstractNode>
         writeNode(NodeObjectType t, std::uint32_t seq,
-                  std::shared_ptr<SHAMapAbstractNode> node) const;
+                  std::shared_ptr<SHAMapAbstractNode> node,
+                  NodeStore::Batch* batch = nullptr) const;
 
     SHAMapTreeNode* firstBelow (SHAMapAbstractNode*, NodeStack& stack) const;
 
@@ -292,6 +341,12 @@ private:
     std::shared_ptr<SHAMapAbstractNode>
         descendNoStore (std::shared_ptr<SHAMapInnerNode> const&, int branch) const;
 
+    /** Start reading the children of node that are not resident */
+    void prefetchChildren (SHAMapInnerNode& node) const;
+
+    void visitSubtreeLeaves (std::shared_ptr<SHAMapInnerNode> node,
+        std::function<void(std::shared_ptr<SHAMapItem const> const&)> const&) const;
+
     /** If there is only one leaf below this node, get its contents */
     std::shared_ptr<SHAMapItem const> const& onlyBelow (SHAMapAbstractNode*) const;
 
@@ -300,10 +355,23 @@ private:
 
     SHAMapItem const* peekFirstItem(NodeStack& stack) const;
     SHAMapItem const* peekNextItem(uint256 const& id, NodeStack& stack) const;
+    using ItemIterator =
+        std::vector<std::shared_ptr<SHAMapItem const>>::const_iterator;
+    std::shared_ptr<SHAMapAbstractNode> buildSubTree (ItemIterator first,
+        ItemIterator last, SHAMapNodeID const& nodeID,
+            SHAMapTreeNode::TNType type) const;
+
     bool walkBranch (SHAMapAbstractNode* node,
                      std::shared_ptr<SHAMapItem const> const& otherMapItem,
                      bool isFirstMap, Delta & differences, int & maxCount) const;
-    int walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq);
+    int walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq,
+                     std::size_t threads);
+    int flushSubTree (std::shared_ptr<SHAMapInnerNode>& node, bool doWrite,
+                      NodeObjectType t, std::uint32_t seq,
+                      NodeStore::Batch* batch);
+    int flushParallel (std::shared_ptr<SHAMapInnerNode>& root, bool doWrite,
+                       NodeObjectType t, std::uint32_t seq,
+                       std::size_t threads);
 };
 
 inline
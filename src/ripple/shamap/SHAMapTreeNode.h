@@ -22,7 +22,9 @@
 
 #include <ripple/shamap/SHAMapItem.h>
 #include <ripple/shamap/SHAMapNodeID.h>
+#include <ripple/basics/Slice.h>
 #include <ripple/basics/TaggedCache.h>
+#include <beast/threads/SpinLock.h>
 #include <beast/utility/Journal.h>
 
 #include <cstdint>
@@ -122,7 +124,7 @@ public:
     virtual std::shared_ptr<SHAMapAbstractNode> clone(std::uint32_t seq) const = 0;
 
     static std::shared_ptr<SHAMapAbstractNode>
-        make(Blob const& rawNode, std::uint32_t seq, SHANodeFormat format,
+        make(Slice const& rawNode, std::uint32_t seq, SHANodeFormat format,
              SHAMapHash const& hash, bool hashValid, beast::Journal j);
 
     // debugging
@@ -131,16 +133,41 @@ public:
 #endif
 };
 
+/** An inner node, holding the hashes and children of up to 16 branches.
+
+    Most inner nodes have only a few branches, so slots are only kept for
+    the populated ones, packed in branch order and found by counting the
+    bits below the branch in mIsBranch. Nodes with many branches keep all
+    16 slots and index them directly.
+
+    The set of branches only changes while the node is mutable and owned
+    by one map. Once shared, only the child pointers change, when children
+    are canonicalized, and mLock guards them.
+*/
 class SHAMapInnerNode
     : public SHAMapAbstractNode
     , public CountedObject <SHAMapInnerNode>
 {
-    SHAMapHash                      mHashes[16];
-    std::shared_ptr<SHAMapAbstractNode> mChildren[16];
-    int                             mIsBranch = 0;
+    struct Slot
+    {
+        SHAMapHash                          hash;
+        std::shared_ptr<SHAMapAbstractNode> child;
+    };
+
+    std::unique_ptr<Slot[]>         mSlots;
+    std::uint16_t                   mIsBranch = 0;
+    std::uint8_t                    mCapacity = 0;
+    mutable beast::SpinLock         mLock;
     std::uint32_t                   mFullBelowGen = 0;
 
-    static std::mutex               childLock;
+    // Nodes with more branches than this use the dense layout
+    static int const                denseBranches = 12;
+
+    static int capacityFor (int branches);
+    int slotIndex (int m) const;
+    void setBranches (std::uint16_t branches);
+    void setHashes (SHAMapHash const (&hashes)[16]);
+
 public:
     static char const* getCountedObjectName () { return "SHAMapInnerNode"; }
     SHAMapInnerNode(std::uint32_t seq = 0);
@@ -151,6 +178,9 @@ public:
     int getBranchCount () const;
     SHAMapHash const& getChildHash (int m) const;
 
+    /** Returns the number of branch slots allocated. */
+    int getCapacity () const;
+
     void setChild(int m, std::shared_ptr<SHAMapAbstractNode> const& child);
     void shareChild (int m, std::shared_ptr<SHAMapAbstractNode> const& child);
     SHAMapAbstractNode* getChildPointer (int branch);
@@ -168,7 +198,7 @@ public:
     std::string getString (SHAMapNodeID const&) const override;
 
     friend std::shared_ptr<SHAMapAbstractNode>
-        SHAMapAbstractNode::make(Blob const& rawNode, std::uint32_t seq,
+        SHAMapAbstractNode::make(Slice const& rawNode, std::uint32_t seq,
              SHANodeFormat format, SHAMapHash const& hash, bool hashValid,
                  beast::Journal j);
 };
@@ -299,12 +329,37 @@ SHAMapInnerNode::isEmptyBranch (int m) const
     return (mIsBranch & (1 << m)) == 0;
 }
 
+inline
+int
+SHAMapInnerNode::slotIndex (int m) const
+{
+    assert (!isEmptyBranch (m));
+    if (mCapacity == 16)
+        return m;
+    // Count the populated branches below this one
+    unsigned v = mIsBranch & ((1u << m) - 1);
+    v = v - ((v >> 1) & 0x5555);
+    v = (v & 0x3333) + ((v >> 2) & 0x3333);
+    v = (v + (v >> 4)) & 0x0F0F;
+    return (v + (v >> 8)) & 0x1F;
+}
+
 inline
 SHAMapHash const&
 SHAMapInnerNode::getChildHash (int m) const
 {
+    static SHAMapHash const zero;
     assert ((m >= 0) && (m < 16) && (getType() == tnINNER));
-    return mHashes[m];
+    if (isEmptyBranch (m))
+        return zero;
+    return mSlots[slotIndex (m)].hash;
+}
+
+inline
+int
+SHAMapInnerNode::getCapacity () const
+{
+    return mCapacity;
 }
 
 inline
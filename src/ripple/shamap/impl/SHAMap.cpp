@@ -19,6 +19,7 @@
 
 #include <BeastConfig.h>
 #include <ripple/basics/contract.h>
+#include <ripple/basics/ParallelFor.h>
 #include <ripple/shamap/SHAMap.h>
 #include <beast/unit_test/suite.h>
 
@@ -176,7 +177,7 @@ SHAMap::fetchNodeFromDB (SHAMapHash const& hash) const
         {
             try
             {
-                node = SHAMapAbstractNode::make(obj->getData(),
+                node = SHAMapAbstractNode::make(makeSlice(obj->getData()),
                     0, snfPREFIX, hash, true, f_.journal());
                 if (node)
                     canonicalize (hash, node);
@@ -208,7 +209,7 @@ SHAMap::checkFilter(SHAMapHash const& hash, SHAMapNodeID const& id,
     if (filter->haveNode (id, hash.as_uint256(), nodeData))
     {
         node = SHAMapAbstractNode::make(
-            nodeData, 0, snfPREFIX, hash, true, f_.journal ());
+            makeSlice(nodeData), 0, snfPREFIX, hash, true, f_.journal ());
         if (node)
         {
             filter->gotNode (true, id, hash.as_uint256(), nodeData, node->getType ());
@@ -384,7 +385,7 @@ SHAMap::descendAsync (SHAMapInnerNode* parent, int branch,
                 return nullptr;
 
             ptr = SHAMapAbstractNode::make(
-                obj->getData(), 0, snfPREFIX, hash, true, f_.journal ());
+                makeSlice(obj->getData()), 0, snfPREFIX, hash, true, f_.journal ());
 
             if (ptr && backed_)
                 canonicalize (hash, ptr);
@@ -797,6 +798,135 @@ SHAMap::addGiveItem (std::shared_ptr<SHAMapItem const> const& item,
     return true;
 }
 
+std::shared_ptr<SHAMapAbstractNode>
+SHAMap::buildSubTree (ItemIterator first, ItemIterator last,
+    SHAMapNodeID const& nodeID, SHAMapTreeNode::TNType type) const
+{
+    assert (first != last);
+
+    if (std::next (first) == last)
+        return std::make_shared<SHAMapTreeNode> (*first, type, seq_);
+
+    // Items are sorted, so the ones on each branch are contiguous
+    auto node = std::make_shared<SHAMapInnerNode> (seq_);
+    while (first != last)
+    {
+        int const branch = nodeID.selectBranch ((*first)->key());
+        auto end = std::find_if (first, last,
+            [&](std::shared_ptr<SHAMapItem const> const& item)
+            {
+                return nodeID.selectBranch (item->key()) != branch;
+            });
+        node->setChild (branch, buildSubTree (first, end,
+            nodeID.getChildNodeID (branch), type));
+        first = end;
+    }
+    node->updateHashDeep ();
+    return node;
+}
+
+bool
+SHAMap::addGiveItems (std::vector<std::shared_ptr<SHAMapItem const>> items,
+                      bool isTransaction, bool hasMeta, std::size_t threads)
+{
+    SHAMapTreeNode::TNType type = !isTransaction ? SHAMapTreeNode::tnACCOUNT_STATE :
+        (hasMeta ? SHAMapTreeNode::tnTRANSACTION_MD : SHAMapTreeNode::tnTRANSACTION_NM);
+
+    assert (state_ != SHAMapState::Immutable);
+
+    if (!root_->isInner () ||
+        !static_cast<SHAMapInnerNode*>(root_.get())->isEmpty ())
+        return false;
+
+    if (items.empty ())
+        return true;
+
+    std::sort (items.begin (), items.end (),
+        [](std::shared_ptr<SHAMapItem const> const& a,
+           std::shared_ptr<SHAMapItem const> const& b)
+        {
+            return a->key() < b->key();
+        });
+
+    if (std::adjacent_find (items.begin (), items.end (),
+        [](std::shared_ptr<SHAMapItem const> const& a,
+           std::shared_ptr<SHAMapItem const> const& b)
+        {
+            return a->key() == b->key();
+        }) != items.end ())
+        return false;
+
+    // Split the items over the root's branches and, for the crowded
+    // ones, over their children too. Each piece is an independent
+    // subtree that can be built and hashed on its own.
+    struct SubTree
+    {
+        std::shared_ptr<SHAMapInnerNode> parent;
+        int branch;
+        SHAMapNodeID nodeID;
+        ItemIterator first;
+        ItemIterator last;
+        std::shared_ptr<SHAMapAbstractNode> node;
+    };
+
+    auto root = std::make_shared<SHAMapInnerNode> (seq_);
+    std::vector<std::shared_ptr<SHAMapInnerNode>> upper {root};
+    std::vector<SubTree> subTrees;
+
+    auto split = [&](std::shared_ptr<SHAMapInnerNode> const& parent,
+        SHAMapNodeID const& parentID, ItemIterator first, ItemIterator last)
+    {
+        while (first != last)
+        {
+            int const branch = parentID.selectBranch ((*first)->key());
+            auto end = std::find_if (first, last,
+                [&](std::shared_ptr<SHAMapItem const> const& item)
+                {
+                    return parentID.selectBranch (item->key()) != branch;
+                });
+            subTrees.push_back ({parent, branch,
+                parentID.getChildNodeID (branch), first, end, nullptr});
+            first = end;
+        }
+    };
+
+    split (root, SHAMapNodeID (), items.cbegin (), items.cend ());
+    if (threads > 1 && items.size () > 16 * threads)
+    {
+        auto top = std::move (subTrees);
+        subTrees.clear ();
+        for (auto const& subTree : top)
+        {
+            if (std::distance (subTree.first, subTree.last) < 2)
+            {
+                subTrees.push_back (subTree);
+                continue;
+            }
+            auto inner = std::make_shared<SHAMapInnerNode> (seq_);
+            upper.push_back (inner);
+            split (inner, subTree.nodeID, subTree.first, subTree.last);
+            root->setChild (subTree.branch, inner);
+        }
+    }
+
+    parallel_for (subTrees.size (), threads, [&](std::size_t i)
+    {
+        auto& subTree = subTrees[i];
+        subTree.node = buildSubTree (subTree.first, subTree.last,
+                                     subTree.nodeID, type);
+    });
+
+    for (auto const& subTree : subTrees)
+        subTree.parent->setChild (subTree.branch, subTree.node);
+
+    // Upper nodes were created parents first
+    for (auto iter = upper.rbegin (); iter != upper.rend (); ++iter)
+        (*iter)->updateHashDeep ();
+
+    root_ = std::move (root);
+    return true;
+}
+
 bool SHAMap::addItem (const SHAMapItem& i, bool isTransaction, bool hasMetaData)
 {
     return addGiveItem(std::make_shared<SHAMapItem const>(i), isTransaction, hasMetaData);
@@ -906,7 +1036,8 @@ bool SHAMap::fetchRoot (SHAMapHash const& hash, SHAMapSyncFilter* filter)
 // a mutable snapshot of a mutable SHAMap.
 std::shared_ptr<SHAMapAbstractNode>
 SHAMap::writeNode (
-    NodeObjectType t, std::uint32_t seq, std::shared_ptr<SHAMapAbstractNode> node) const
+    NodeObjectType t, std::uint32_t seq, std::shared_ptr<SHAMapAbstractNode> node,
+    NodeStore::Batch* batch) const
 {
     // Node is ours, so we can just make it shareable
     assert (node->getSeq() == seq_);
@@ -917,8 +1048,12 @@ SHAMap::writeNode (
 
     Serializer s;
     node->addRaw (s, snfPREFIX);
-    f_.db().store (t,
-        std::move (s.modData ()), node->getNodeHash ().as_uint256());
+    if (batch)
+        batch->push_back (NodeObject::createObject (t,
+            std::move (s.modData ()), node->getNodeHash ().as_uint256()));
+    else
+        f_.db().store (t,
+            std::move (s.modData ()), node->getNodeHash ().as_uint256());
     return node;
 }
 
@@ -944,24 +1079,75 @@ SHAMap::preFlushNode (std::shared_ptr<Node> node) const
 
 int SHAMap::unshare ()
 {
-    return walkSubTree (false, hotUNKNOWN, 0);
+    return walkSubTree (false, hotUNKNOWN, 0, flushThreads ());
 }
 
 /** Convert all modified nodes to shared nodes */
 // If requested, write them to the node store
 int SHAMap::flushDirty (NodeObjectType t, std::uint32_t seq)
 {
-    return walkSubTree (true, t, seq);
+    return flushDirty (t, seq, flushThreads ());
 }
 
-int
-SHAMap::walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq)
+int SHAMap::flushDirty (NodeObjectType t, std::uint32_t seq,
+                        std::size_t threads)
 {
-    int flushed = 0;
-    Serializer s;
+    using namespace std::chrono;
+    auto const start = steady_clock::now ();
+    auto const flushed = walkSubTree (true, t, seq, threads);
+    if (flushed != 0 && backed_)
+        f_.onFlush (flushed, threads, duration_cast<microseconds> (
+            steady_clock::now () - start));
+    return flushed;
+}
 
+bool
+SHAMap::dirtyAtLeast (std::size_t n) const
+{
+    if (!root_ || (root_->getSeq () == 0) || !root_->isInner ())
+        return false;
+
+    std::size_t count = 0;
+    std::vector<SHAMapInnerNode*> stack {
+        static_cast<SHAMapInnerNode*> (root_.get ())};
+    while (!stack.empty ())
+    {
+        auto const node = stack.back ();
+        stack.pop_back ();
+        if (++count >= n)
+            return true;
+
+        for (int branch = 0; branch < 16; ++branch)
+        {
+            if (node->isEmptyBranch (branch))
+                continue;
+            auto const child = node->getChildPointer (branch);
+            if (!child || (child->getSeq () == 0))
+                continue;
+            if (child->isInner ())
+                stack.push_back (static_cast<SHAMapInnerNode*> (child));
+            else if (++count >= n)
+                return true;
+        }
+    }
+    return false;
+}
+
+std::size_t
+SHAMap::flushThreads () const
+{
+    auto const threshold = f_.flushThreshold ();
+    if (threshold == 0 || !dirtyAtLeast (threshold))
+        return 1;
+    return f_.flushPool ().size ();
+}
+
+int
+SHAMap::walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq,
+                     std::size_t threads)
+{
     if (!root_ || (root_->getSeq() == 0))
-        return flushed;
+        return 0;
 
     if (root_->isLeaf())
     { // special case -- root_ is leaf
@@ -972,15 +1158,34 @@ SHAMap::walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq)
     }
     auto node = std::static_pointer_cast<SHAMapInnerNode>(root_);
     if (node->isEmpty())
-        return flushed;
+        return 0;
+
+    node = preFlushNode(std::move(node));
+
+    int const flushed = (threads > 1)
+        ? flushParallel (node, doWrite, t, seq, threads)
+        : flushSubTree (node, doWrite, t, seq, nullptr);
+
+    // Last inner node is the new root_
+    root_ = std::move (node);
+
+    return flushed;
+}
+
+// Flushes node, which must be ours, and the modified nodes below it.
+// On return node is the flushed node.
+int
+SHAMap::flushSubTree (std::shared_ptr<SHAMapInnerNode>& node, bool doWrite,
+                      NodeObjectType t, std::uint32_t seq,
+                      NodeStore::Batch* batch)
+{
+    int flushed = 0;
 
     // Stack of {parent,index,child} pointers representing
     // inner nodes we are in the process of flushing
     using StackEntry = std::pair <std::shared_ptr<SHAMapInnerNode>, int>;
     std::stack <StackEntry, std::vector<StackEntry>> stack;
 
-    node = preFlushNode(std::move(node));
-
     int pos = 0;
 
     // We can't flush an inner node until we flush its children
@@ -1024,7 +1229,7 @@ SHAMap::walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq)
                         child->updateHash();
 
                         if (doWrite && backed_)
-                            child = writeNode(t, seq, std::move(child));
+                            child = writeNode(t, seq, std::move(child), batch);
 
                         node->shareChild (branch, child);
                     }
@@ -1038,7 +1243,7 @@ SHAMap::walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq)
         // This inner node can now be shared
         if (doWrite && backed_)
             node = std::static_pointer_cast<SHAMapInnerNode>(writeNode(t, seq,
-                                                                       std::move(node)));
+                                                                       std::move(node), batch));
 
         ++flushed;
 
@@ -1058,8 +1263,111 @@ SHAMap::walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq)
         ++pos;
     }
 
-    // Last inner node is the new root_
-    root_ = std::move (node);
+    return flushed;
+}
+
+// Flushes the inner nodes two levels below root in parallel, then the two
+// levels above them. Each thread writes the nodes it flushed in one batch.
+int
+SHAMap::flushParallel (std::shared_ptr<SHAMapInnerNode>& root, bool doWrite,
+                       NodeObjectType t, std::uint32_t seq,
+                       std::size_t threads)
+{
+    bool const write = doWrite && backed_;
+    int flushed = 0;
+    NodeStore::Batch batch;
+
+    using Child = std::pair<int, std::shared_ptr<SHAMapInnerNode>>;
+
+    // Flushes the modified leaves directly below parent and returns the
+    // modified inner nodes, made ours
+    auto split = [&](std::shared_ptr<SHAMapInnerNode> const& parent)
+    {
+        std::vector<Child> inners;
+        for (int branch = 0; branch < 16; ++branch)
+        {
+            if (parent->isEmptyBranch (branch))
+                continue;
+            auto child = parent->getChild (branch);
+            if (!child || (child->getSeq () == 0))
+                continue;
+
+            child = preFlushNode (std::move (child));
+            if (child->isInner ())
+            {
+                inners.emplace_back (branch,
+                    std::static_pointer_cast<SHAMapInnerNode> (std::move (child)));
+            }
+            else
+            {
+                ++flushed;
+                child->updateHash ();
+                if (write)
+                    child = writeNode (t, seq, std::move (child), &batch);
+                parent->shareChild (branch, child);
+            }
+        }
+        return inners;
+    };
+
+    struct SubTree
+    {
+        std::shared_ptr<SHAMapInnerNode> parent;
+        int branch;
+        std::shared_ptr<SHAMapInnerNode> node;
+        int flushed;
+    };
+
+    auto upper = split (root);
+    std::vector<SubTree> subTrees;
+    for (auto const& inner : upper)
+    {
+        for (auto& below : split (inner.second))
+            subTrees.push_back ({inner.second, below.first,
+                std::move (below.second), 0});
+    }
+
+    // Each thread takes subtrees until there are none left. The pool's
+    // threads outlive the flush, so closing a ledger does not pay for
+    // starting them.
+    std::atomic<std::size_t> next (0);
+    f_.flushPool ().parallel_for (threads, threads, [&](std::size_t)
+    {
+        NodeStore::Batch ours;
+        for (auto i = next++; i < subTrees.size (); i = next++)
+        {
+            auto& subTree = subTrees[i];
+            subTree.flushed = flushSubTree (subTree.node, doWrite, t, seq,
+                write ? &ours : nullptr);
+        }
+        if (!ours.empty ())
+            f_.db().storeBatch (ours);
+    });
+
+    for (auto const& subTree : subTrees)
+    {
+        flushed += subTree.flushed;
+        subTree.parent->shareChild (subTree.branch, subTree.node);
+    }
+
+    for (auto& inner : upper)
+    {
+        inner.second->updateHashDeep ();
+        if (write)
+            inner.second = std::static_pointer_cast<SHAMapInnerNode> (
+                writeNode (t, seq, std::move (inner.second), &batch));
+        ++flushed;
+        root->shareChild (inner.first, inner.second);
+    }
+
+    root->updateHashDeep ();
+    if (write)
+        root = std::static_pointer_cast<SHAMapInnerNode> (
+            writeNode (t, seq, std::move (root), &batch));
+    ++flushed;
+
+    if (!batch.empty ())
+        f_.db().storeBatch (batch);
 
     return flushed;
 }
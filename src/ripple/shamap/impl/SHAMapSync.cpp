@@ -20,6 +20,8 @@
 #include <BeastConfig.h>
 #include <ripple/shamap/SHAMap.h>
 #include <ripple/nodestore/Database.h>
+#include <ripple/basics/ParallelFor.h>
+#include <array>
 #include <beast/unit_test/suite.h>
 
 namespace ripple {
@@ -110,6 +112,134 @@ void SHAMap::visitNodes(std::function<bool (SHAMapAbstractNode&)> const& functio
     }
 }
 
+void
+SHAMap::prefetchChildren (SHAMapInnerNode& node) const
+{
+    if (!backed_)
+        return;
+
+    std::shared_ptr<NodeObject> obj;
+    for (int branch = 0; branch < 16; ++branch)
+    {
+        if (node.isEmptyBranch (branch) || node.getChildPointer (branch))
+            continue;
+        auto const& hash = node.getChildHash (branch).as_uint256 ();
+        if (!f_.treecache ().fetch (hash))
+            f_.db ().asyncFetch (hash, obj);
+    }
+}
+
+void
+SHAMap::visitSubtreeLeaves (std::shared_ptr<SHAMapInnerNode> node,
+    std::function<void(std::shared_ptr<SHAMapItem const> const&)> const& function) const
+{
+    using StackEntry = std::pair <int, std::shared_ptr<SHAMapInnerNode>>;
+    std::stack <StackEntry, std::vector <StackEntry>> stack;
+
+    prefetchChildren (*node);
+    int pos = 0;
+
+    while (1)
+    {
+        while (pos < 16)
+        {
+            if (node->isEmptyBranch (pos))
+            {
+                ++pos;
+                continue;
+            }
+
+            std::shared_ptr<SHAMapAbstractNode> child = descendNoStore (node, pos);
+            ++pos;
+            if (child->isLeaf ())
+            {
+                function (static_cast<SHAMapTreeNode&>(*child).peekItem ());
+                continue;
+            }
+
+            // save next position to resume at
+            if (pos != 16)
+                stack.push (std::make_pair (pos, std::move (node)));
+
+            node = std::static_pointer_cast<SHAMapInnerNode>(child);
+            prefetchChildren (*node);
+            pos = 0;
+        }
+
+        if (stack.empty ())
+            break;
+
+        std::tie(pos, node) = stack.top ();
+        stack.pop ();
+    }
+}
+
+void
+SHAMap::visitLeavesParallel(
+    std::function<void(std::size_t part,
+        std::shared_ptr<SHAMapItem const> const&)> const& function,
+    std::size_t threads) const
+{
+    if (!root_)
+        return;
+
+    if (!root_->isInner ())
+    {
+        function (0, static_cast<SHAMapTreeNode&>(*root_).peekItem ());
+        return;
+    }
+
+    // Cut the tree below its top two levels. Leaves found up there are
+    // visited right away, the inner nodes are the parts walked in parallel.
+    auto const root = std::static_pointer_cast<SHAMapInnerNode>(root_);
+    std::array<std::shared_ptr<SHAMapInnerNode>, 16> top;
+    prefetchChildren (*root);
+    for (int i = 0; i < 16; ++i)
+    {
+        if (root->isEmptyBranch (i))
+            continue;
+        auto child = descendNoStore (root, i);
+        if (child->isLeaf ())
+            function (16 * i, static_cast<SHAMapTreeNode&>(*child).peekItem ());
+        else
+            top[i] = std::static_pointer_cast<SHAMapInnerNode>(child);
+    }
+
+    for (auto const& node : top)
+    {
+        if (node)
+            prefetchChildren (*node);
+    }
+
+    std::vector<std::pair<std::size_t, std::shared_ptr<SHAMapInnerNode>>> parts;
+    for (int i = 0; i < 16; ++i)
+    {
+        if (!top[i])
+            continue;
+        for (int j = 0; j < 16; ++j)
+        {
+            if (top[i]->isEmptyBranch (j))
+                continue;
+            auto child = descendNoStore (top[i], j);
+            if (child->isLeaf ())
+                function (16 * i + j, static_cast<SHAMapTreeNode&>(*child).peekItem ());
+            else
+                parts.emplace_back (16 * i + j,
+                    std::static_pointer_cast<SHAMapInnerNode>(child));
+        }
+    }
+
+    parallel_for (parts.size (), threads, [&](std::size_t i)
+    {
+        auto const part = parts[i].first;
+        visitSubtreeLeaves (parts[i].second,
+            [&function, part](std::shared_ptr<SHAMapItem const> const& item)
+            {
+                function (part, item);
+            });
+    });
+}
+
 /** Get a list of node IDs and hashes for nodes that are part of this SHAMap
     but not available locally.  The filter can hold alternate sources of
     nodes that are not permanently stored locally
@@ -432,7 +562,7 @@ bool SHAMap::getRootNode (Serializer& s, SHANodeFormat format) const
     return true;
 }
 
-SHAMapAddNode SHAMap::addRootNode (Blob const& rootNode,
+SHAMapAddNode SHAMap::addRootNode (Slice const& rootNode,
     SHANodeFormat format, SHAMapSyncFilter* filter)
 {
     // we already have a root_ node
@@ -472,7 +602,7 @@ SHAMapAddNode SHAMap::addRootNode (Blob const& rootNode,
     return SHAMapAddNode::useful ();
 }
 
-SHAMapAddNode SHAMap::addRootNode (SHAMapHash const& hash, Blob const& rootNode, SHANodeFormat format,
+SHAMapAddNode SHAMap::addRootNode (SHAMapHash const& hash, Slice const& rootNode, SHANodeFormat format,
                                    SHAMapSyncFilter* filter)
 {
     // we already have a root_ node
@@ -510,7 +640,7 @@ SHAMapAddNode SHAMap::addRootNode (SHAMapHash const& hash, Blob const& rootNode,
 }
 
 SHAMapAddNode
-SHAMap::addKnownNode (const SHAMapNodeID& node, Blob const& rawNode,
+SHAMap::addKnownNode (const SHAMapNodeID& node, Slice const& rawNode,
                       SHAMapSyncFilter* filter)
 {
     // return value: true=okay, false=error
@@ -756,7 +886,7 @@ void SHAMap::getFetchPack (SHAMap* have, bool includeLeaves, int max,
 }
 
 void
-SHAMap::visitDifferences(SHAMap* have,
+SHAMap::visitDifferences(SHAMap const* have,
                          std::function<bool (SHAMapAbstractNode&)> func) const
 {
     // Visit every node in this SHAMap that is not present
@@ -26,27 +26,130 @@
 #include <ripple/basics/StringUtilities.h>
 #include <ripple/protocol/HashPrefix.h>
 #include <beast/module/core/text/LexicalCast.h>
+#include <algorithm>
 #include <mutex>
 
 #include <openssl/sha.h>
 
 namespace ripple {
 
-std::mutex SHAMapInnerNode::childLock;
-
 SHAMapAbstractNode::~SHAMapAbstractNode() = default;
 
+int
+SHAMapInnerNode::capacityFor (int branches)
+{
+    if (branches > denseBranches)
+        return 16;
+    // Round up so a node can gain a branch without reallocating
+    return (branches + 1) & ~1;
+}
+
+// Changes which branches are present, keeping the slots of those which
+// remain. Slots of new branches are empty, as are unused slots.
+void
+SHAMapInnerNode::setBranches (std::uint16_t branches)
+{
+    if (branches == mIsBranch)
+        return;
+
+    // Adding or removing one branch, as setChild does, only moves the
+    // slots after it when the capacity stays the same.
+    std::uint16_t const changed = branches ^ mIsBranch;
+    if ((changed & (changed - 1)) == 0 && mCapacity != 0)
+    {
+        int m = 0;
+        while ((changed & (1 << m)) == 0)
+            ++m;
+        int count = 0;
+        for (int i = 0; i < 16; ++i)
+            if ((mIsBranch & (1 << i)) != 0)
+                ++count;
+        bool const adding = (branches & changed) != 0;
+        if (capacityFor (adding ? count + 1 : count - 1) == mCapacity)
+        {
+            if (adding)
+            {
+                mIsBranch = branches;
+                auto const index = slotIndex (m);
+                auto const slots = mSlots.get ();
+                if (mCapacity != 16)
+                    std::move_backward (slots + index, slots + count,
+                        slots + count + 1);
+                slots[index] = Slot{};
+            }
+            else
+            {
+                auto const index = slotIndex (m);
+                auto const slots = mSlots.get ();
+                if (mCapacity != 16)
+                {
+                    std::move (slots + index + 1, slots + count,
+                        slots + index);
+                    slots[count - 1] = Slot{};
+                }
+                else
+                {
+                    slots[index] = Slot{};
+                }
+                mIsBranch = branches;
+            }
+            return;
+        }
+    }
+
+    Slot tmp[16];
+    for (int i = 0; i < 16; ++i)
+        if ((mIsBranch & branches & (1 << i)) != 0)
+            tmp[i] = std::move (mSlots[slotIndex (i)]);
+
+    int count = 0;
+    for (int i = 0; i < 16; ++i)
+        if ((branches & (1 << i)) != 0)
+            ++count;
+    auto const capacity = capacityFor (count);
+    if (capacity != mCapacity)
+    {
+        mSlots.reset (capacity ? new Slot[capacity] : nullptr);
+        mCapacity = capacity;
+    }
+    else
+    {
+        for (int i = 0; i < mCapacity; ++i)
+            mSlots[i] = Slot{};
+    }
+
+    mIsBranch = branches;
+    for (int i = 0; i < 16; ++i)
+        if ((branches & (1 << i)) != 0)
+            mSlots[slotIndex (i)] = std::move (tmp[i]);
+}
+
+void
+SHAMapInnerNode::setHashes (SHAMapHash const (&hashes)[16])
+{
+    std::uint16_t branches = 0;
+    for (int i = 0; i < 16; ++i)
+        if (hashes[i].isNonZero ())
+            branches |= (1 << i);
+    setBranches (branches);
+    for (int i = 0; i < 16; ++i)
+        if (!isEmptyBranch (i))
+            mSlots[slotIndex (i)].hash = hashes[i];
+}
+
 std::shared_ptr<SHAMapAbstractNode>
 SHAMapInnerNode::clone(std::uint32_t seq) const
 {
     auto p = std::make_shared<SHAMapInnerNode>(seq);
     p->mHash = mHash;
-    p->mIsBranch = mIsBranch;
     p->mFullBelowGen = mFullBelowGen;
-    std::memcpy(p->mHashes, mHashes, sizeof(mHashes));
-    std::unique_lock <std::mutex> lock(childLock);
+    p->setBranches (mIsBranch);
+    std::lock_guard <beast::SpinLock> lock (mLock);
     for (int i = 0; i < 16; ++i)
-        p->mChildren[i] = mChildren[i];
+    {
+        if (!isEmptyBranch (i))
+            p->mSlots[p->slotIndex (i)] = mSlots[slotIndex (i)];
+    }
     return std::move(p);
 }
 
@@ -74,7 +177,7 @@ SHAMapTreeNode::SHAMapTreeNode (std::shared_ptr<SHAMapItem const> const& item,
 }
 
 std::shared_ptr<SHAMapAbstractNode>
-SHAMapAbstractNode::make(Blob const& rawNode, std::uint32_t seq, SHANodeFormat format,
+SHAMapAbstractNode::make(Slice const& rawNode, std::uint32_t seq, SHANodeFormat format,
                          SHAMapHash const& hash, bool hashValid, beast::Journal j)
 {
     if (format == snfWIRE)
@@ -83,7 +186,7 @@ SHAMapAbstractNode::make(Blob const& rawNode, std::uint32_t seq, SHANodeFormat f
             return {};
 
         Serializer s (rawNode.data(), rawNode.size() - 1);
-        int type = rawNode.back ();
+        int type = rawNode[rawNode.size () - 1];
         int len = s.getLength ();
 
         if ((type < 0) || (type > 4))
@@ -95,7 +198,7 @@ SHAMapAbstractNode::make(Blob const& rawNode, std::uint32_t seq, SHANodeFormat f
             auto item = std::make_shared<SHAMapItem const>(
                 sha512Half(HashPrefix::transactionID,
                     Slice(s.data(), s.size())),
-                        s.peekData());
+                        std::move(s));
             if (hashValid)
                 return std::make_shared<SHAMapTreeNode>(item, tnTRANSACTION_NM, seq, hash);
             return std::make_shared<SHAMapTreeNode>(item, tnTRANSACTION_NM, seq);
@@ -112,7 +215,7 @@ SHAMapAbstractNode::make(Blob const& rawNode, std::uint32_t seq, SHANodeFormat f
 
             if (u.isZero ()) Throw<std::runtime_error> ("invalid AS node");
 
-            auto item = std::make_shared<SHAMapItem const> (u, s.peekData ());
+            auto item = std::make_shared<SHAMapItem const> (u, std::move(s));
             if (hashValid)
                 return std::make_shared<SHAMapTreeNode>(item, tnACCOUNT_STATE, seq, hash);
             return std::make_shared<SHAMapTreeNode>(item, tnACCOUNT_STATE, seq);
@@ -124,13 +227,10 @@ SHAMapAbstractNode::make(Blob const& rawNode, std::uint32_t seq, SHANodeFormat f
                 Throw<std::runtime_error> ("invalid FI node");
 
             auto ret = std::make_shared<SHAMapInnerNode>(seq);
+            SHAMapHash hashes[16];
             for (int i = 0; i < 16; ++i)
-            {
-                s.get256 (ret->mHashes[i].as_uint256(), i * 32);
-
-                if (ret->mHashes[i].isNonZero ())
-                    ret->mIsBranch |= (1 << i);
-            }
+                s.get256 (hashes[i].as_uint256(), i * 32);
+            ret->setHashes (hashes);
             if (hashValid)
                 ret->mHash = hash;
             else
@@ -141,6 +241,7 @@ SHAMapAbstractNode::make(Blob const& rawNode, std::uint32_t seq, SHANodeFormat f
         {
             auto ret = std::make_shared<SHAMapInnerNode>(seq);
             // compressed inner
+            SHAMapHash hashes[16];
             for (int i = 0; i < (len / 33); ++i)
             {
                 int pos;
@@ -148,10 +249,9 @@ SHAMapAbstractNode::make(Blob const& rawNode, std::uint32_t seq, SHANodeFormat f
                     Throw<std::runtime_error> ("short CI node");
                 if ((pos < 0) || (pos >= 16))
                 Throw<std::runtime_error> ("invalid CI node");
-                s.get256 (ret->mHashes[pos].as_uint256(), i * 33);
-                if (ret->mHashes[pos].isNonZero ())
-                    ret->mIsBranch |= (1 << pos);
+                s.get256 (hashes[pos].as_uint256(), i * 33);
             }
+            ret->setHashes (hashes);
             if (hashValid)
                 ret->mHash = hash;
             else
@@ -171,7 +271,7 @@ SHAMapAbstractNode::make(Blob const& rawNode, std::uint32_t seq, SHANodeFormat f
             if (u.isZero ())
                 Throw<std::runtime_error> ("invalid TM node");
 
-            auto item = std::make_shared<SHAMapItem const> (u, s.peekData ());
+            auto item = std::make_shared<SHAMapItem const> (u, std::move(s));
             if (hashValid)
                 return std::make_shared<SHAMapTreeNode>(item, tnTRANSACTION_MD, seq, hash);
             return std::make_shared<SHAMapTreeNode>(item, tnTRANSACTION_MD, seq);
@@ -198,8 +298,7 @@ SHAMapAbstractNode::make(Blob const& rawNode, std::uint32_t seq, SHANodeFormat f
         if (prefix == HashPrefix::transactionID)
         {
             auto item = std::make_shared<SHAMapItem const>(
-                sha512Half(makeSlice(rawNode)),
-                    s.peekData ());
+                sha512Half(rawNode), std::move(s));
             if (hashValid)
                 return std::make_shared<SHAMapTreeNode>(item, tnTRANSACTION_NM, seq, hash);
             return std::make_shared<SHAMapTreeNode>(item, tnTRANSACTION_NM, seq);
@@ -219,7 +318,7 @@ SHAMapAbstractNode::make(Blob const& rawNode, std::uint32_t seq, SHANodeFormat f
                 Throw<std::runtime_error> ("invalid PLN node");
             }
 
-            auto item = std::make_shared<SHAMapItem const> (u, s.peekData ());
+            auto item = std::make_shared<SHAMapItem const> (u, std::move(s));
             if (hashValid)
                 return std::make_shared<SHAMapTreeNode>(item, tnACCOUNT_STATE, seq, hash);
             return std::make_shared<SHAMapTreeNode>(item, tnACCOUNT_STATE, seq);
@@ -229,13 +328,10 @@ SHAMapAbstractNode::make(Blob const& rawNode, std::uint32_t seq, SHANodeFormat f
             if (s.getLength () != 512)
                 Throw<std::runtime_error> ("invalid PIN node");
             auto ret = std::make_shared<SHAMapInnerNode>(seq);
+            SHAMapHash hashes[16];
             for (int i = 0; i < 16; ++i)
-            {
-                s.get256 (ret->mHashes[i].as_uint256(), i * 32);
-
-                if (ret->mHashes[i].isNonZero ())
-                    ret->mIsBranch |= (1 << i);
-            }
+                s.get256 (hashes[i].as_uint256(), i * 32);
+            ret->setHashes (hashes);
             if (hashValid)
                 ret->mHash = hash;
             else
@@ -251,7 +347,7 @@ SHAMapAbstractNode::make(Blob const& rawNode, std::uint32_t seq, SHANodeFormat f
             uint256 txID;
             s.get256 (txID, s.getLength () - 32);
             s.chop (32);
-            auto item = std::make_shared<SHAMapItem const> (txID, s.peekData ());
+            auto item = std::make_shared<SHAMapItem const> (txID, std::move(s));
             if (hashValid)
                 return std::make_shared<SHAMapTreeNode>(item, tnTRANSACTION_MD, seq, hash);
             return std::make_shared<SHAMapTreeNode>(item, tnTRANSACTION_MD, seq);
@@ -273,10 +369,12 @@ SHAMapInnerNode::updateHash()
     uint256 nh;
     if (mIsBranch != 0)
     {
-        // VFALCO This code assumes the layout of a base_uint
-        nh = sha512Half(HashPrefix::innerNode,
-            Slice(reinterpret_cast<unsigned char const*>(mHashes),
-                sizeof (mHashes)));
+        sha512_half_hasher h;
+        using beast::hash_append;
+        hash_append (h, HashPrefix::innerNode);
+        for (int i = 0; i < 16; ++i)
+            hash_append (h, getChildHash (i).as_uint256());
+        nh = static_cast<typename sha512_half_hasher::result_type>(h);
     }
     if (nh == mHash.as_uint256())
         return false;
@@ -287,10 +385,10 @@ SHAMapInnerNode::updateHash()
 void
 SHAMapInnerNode::updateHashDeep()
 {
-    for (auto pos = 0; pos < 16; ++pos)
+    for (int i = 0; i < mCapacity; ++i)
     {
-        if (mChildren[pos] != nullptr)
-            mHashes[pos] = mChildren[pos]->getNodeHash();
+        if (mSlots[i].child != nullptr)
+            mSlots[i].hash = mSlots[i].child->getNodeHash();
     }
     updateHash();
 }
@@ -347,7 +445,7 @@ SHAMapInnerNode::addRaw(Serializer& s, SHANodeFormat format) const
             s.add32 (HashPrefix::innerNode);
 
             for (int i = 0; i < 16; ++i)
-                s.add256 (mHashes[i].as_uint256());
+                s.add256 (getChildHash (i).as_uint256());
         }
         else
         {
@@ -357,7 +455,7 @@ SHAMapInnerNode::addRaw(Serializer& s, SHANodeFormat format) const
                 for (int i = 0; i < 16; ++i)
                     if (!isEmptyBranch (i))
                     {
-                        s.add256 (mHashes[i].as_uint256());
+                        s.add256 (getChildHash (i).as_uint256());
                         s.add8 (i);
                     }
 
@@ -366,7 +464,7 @@ SHAMapInnerNode::addRaw(Serializer& s, SHANodeFormat format) const
             else
             {
                 for (int i = 0; i < 16; ++i)
-                    s.add256 (mHashes[i].as_uint256());
+                    s.add256 (getChildHash (i).as_uint256());
 
                 s.add8 (2);
             }
@@ -494,7 +592,7 @@ SHAMapInnerNode::getString(const SHAMapNodeID & id) const
             ret += "\nb";
             ret += beast::lexicalCastThrow <std::string> (i);
             ret += " = ";
-            ret += to_string (mHashes[i]);
+            ret += to_string (getChildHash (i));
         }
     }
     return ret;
@@ -530,13 +628,17 @@ SHAMapInnerNode::setChild(int m, std::shared_ptr<SHAMapAbstractNode> const& chil
     assert (mType == tnINNER);
     assert (mSeq != 0);
     assert (child.get() != this);
-    mHashes[m].zero();
     mHash.zero();
     if (child)
-        mIsBranch |= (1 << m);
+        setBranches (mIsBranch | (1 << m));
     else
-        mIsBranch &= ~ (1 << m);
-    mChildren[m] = child;
+        setBranches (mIsBranch & ~ (1 << m));
+    if (child)
+    {
+        auto& slot = mSlots[slotIndex (m)];
+        slot.hash.zero();
+        slot.child = child;
+    }
 }
 
 // finished modifying, now make shareable
@@ -547,8 +649,9 @@ void SHAMapInnerNode::shareChild (int m, std::shared_ptr<SHAMapAbstractNode> con
     assert (mSeq != 0);
     assert (child);
     assert (child.get() != this);
+    assert (!isEmptyBranch (m));
 
-    mChildren[m] = child;
+    mSlots[slotIndex (m)].child = child;
 }
 
 SHAMapAbstractNode*
@@ -557,8 +660,10 @@ SHAMapInnerNode::getChildPointer (int branch)
     assert (branch >= 0 && branch < 16);
     assert (isInner());
 
-    std::unique_lock <std::mutex> lock (childLock);
-    return mChildren[branch].get ();
+    if (isEmptyBranch (branch))
+        return nullptr;
+    std::lock_guard <beast::SpinLock> lock (mLock);
+    return mSlots[slotIndex (branch)].child.get ();
 }
 
 std::shared_ptr<SHAMapAbstractNode>
@@ -567,8 +672,10 @@ SHAMapInnerNode::getChild (int branch)
     assert (branch >= 0 && branch < 16);
     assert (isInner());
 
-    std::unique_lock <std::mutex> lock (childLock);
-    return mChildren[branch];
+    if (isEmptyBranch (branch))
+        return {};
+    std::lock_guard <beast::SpinLock> lock (mLock);
+    return mSlots[slotIndex (branch)].child;
 }
 
 std::shared_ptr<SHAMapAbstractNode>
@@ -577,18 +684,19 @@ SHAMapInnerNode::canonicalizeChild(int branch, std::shared_ptr<SHAMapAbstractNod
     assert (branch >= 0 && branch < 16);
     assert (isInner());
     assert (node);
-    assert (node->getNodeHash() == mHashes[branch]);
+    assert (node->getNodeHash() == getChildHash (branch));
 
-    std::unique_lock <std::mutex> lock (childLock);
-    if (mChildren[branch])
+    auto& slot = mSlots[slotIndex (branch)];
+    std::lock_guard <beast::SpinLock> lock (mLock);
+    if (slot.child)
     {
         // There is already a node hooked up, return it
-        node = mChildren[branch];
+        node = slot.child;
     }
     else
     {
         // Hook this node up
-        mChildren[branch] = node;
+        slot.child = node;
     }
     return node;
 }
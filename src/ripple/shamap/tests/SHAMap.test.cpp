@@ -22,8 +22,11 @@
 #include <ripple/shamap/tests/common.h>
 #include <ripple/basics/Blob.h>
 #include <ripple/basics/StringUtilities.h>
+#include <ripple/protocol/digest.h>
 #include <beast/unit_test/suite.h>
 #include <beast/utility/Journal.h>
+#include <chrono>
+#include <numeric>
 
 namespace ripple {
 namespace tests {
@@ -133,10 +136,199 @@ public:
             }
             expect (map.getHash() == zero, "bad final empty map hash");
         }
+
+        testcase ("bulk load");
+        {
+            std::vector<std::shared_ptr<SHAMapItem const>> items;
+            SHAMap map (SHAMapType::FREE, f);
+            for (int i = 0; i < 5000; ++i)
+            {
+                Blob data = IntToVUC (i);
+                data.push_back (static_cast<unsigned char> (i >> 8));
+                auto item = std::make_shared<SHAMapItem const> (
+                    sha512Half (Slice (data.data (), data.size ())), data);
+                items.push_back (item);
+                map.addGiveItem (item, true, false);
+            }
+
+            for (std::size_t threads : {1, 4})
+            {
+                SHAMap bulk (SHAMapType::FREE, f);
+                expect (bulk.addGiveItems (items, true, false, threads), "no bulk add");
+                expect (bulk.getHash () == map.getHash (), "bad bulk map hash");
+                expect (!bulk.addGiveItems (items, true, false, threads), "bulk add to filled map");
+
+                auto iter = bulk.begin ();
+                for (auto const& item : map)
+                {
+                    unexpected (iter == bulk.end () || iter->key () != item.key (), "bad bulk traverse");
+                    ++iter;
+                }
+            }
+
+            SHAMap duplicate (SHAMapType::FREE, f);
+            items.push_back (items.front ());
+            expect (!duplicate.addGiveItems (items, true, false), "bulk add of duplicate key");
+        }
+
+        testcase ("parallel visit");
+        {
+            SHAMap map (SHAMapType::STATE, f);
+            for (int i = 0; i < 5000; ++i)
+            {
+                Blob data = IntToVUC (i);
+                data.push_back (static_cast<unsigned char> (i >> 8));
+                map.addItem (SHAMapItem (
+                    sha512Half (Slice (data.data (), data.size ())), data), false, false);
+            }
+            map.flushDirty (hotACCOUNT_NODE, 1);
+
+            // Read the map back from the node store.
+            f.treecache ().clear ();
+            SHAMap stored (SHAMapType::STATE, map.getHash ().as_uint256 (), f);
+            expect (stored.fetchRoot (map.getHash (), nullptr), "no stored root");
+
+            for (std::size_t threads : {1, 4})
+            {
+                std::vector<std::vector<uint256>> parts (SHAMap::visitParts);
+                stored.visitLeavesParallel (
+                    [&](std::size_t part, std::shared_ptr<SHAMapItem const> const& item)
+                    {
+                        parts[part].push_back (item->key ());
+                    }, threads);
+
+                auto iter = map.begin ();
+                bool good = true;
+                for (std::size_t part = 0; part < parts.size (); ++part)
+                {
+                    for (auto const& key : parts[part])
+                    {
+                        // A part holds the keys starting with its number.
+                        good = good && iter != map.end () && iter->key () == key &&
+                            *key.begin () == part;
+                        ++iter;
+                    }
+                }
+                expect (good && iter == map.end (), "bad parallel visit");
+            }
+
+            SHAMap empty (SHAMapType::STATE, f);
+            empty.visitLeavesParallel (
+                [&](std::size_t, std::shared_ptr<SHAMapItem const> const&)
+                {
+                    fail ("visited an empty map");
+                }, 4);
+        }
+
+        testcase ("parallel flush");
+        {
+            SHAMap map (SHAMapType::STATE, f);
+            std::vector<uint256> keys;
+            for (int i = 0; i < 5000; ++i)
+            {
+                Blob data = IntToVUC (i);
+                data.push_back (static_cast<unsigned char> (i >> 8));
+                keys.push_back (sha512Half (Slice (data.data (), data.size ())));
+                map.addItem (SHAMapItem (keys.back (), data), false, false);
+            }
+            auto const hash = map.getHash ();
+
+            for (std::size_t threads : {1, 4})
+            {
+                auto copy = map.snapShot (true);
+                expect (copy->flushDirty (hotACCOUNT_NODE, 2, threads) > 5000, "bad flush count");
+                expect (copy->getHash () == hash, "bad flushed hash");
+
+                // Change a few leaves and flush again
+                for (int i = 0; i < 100; ++i)
+                    copy->delItem (keys[i * 50]);
+                auto const changed = copy->getHash ();
+                expect (copy->flushDirty (hotACCOUNT_NODE, 3, threads) > 100, "bad reflush count");
+                expect (copy->getHash () == changed, "bad reflushed hash");
+
+                // Everything is in the node store
+                f.treecache ().clear ();
+                SHAMap stored (SHAMapType::STATE, changed.as_uint256 (), f);
+                expect (stored.fetchRoot (changed, nullptr), "no stored root");
+                std::size_t leaves = 0;
+                stored.visitLeaves ([&](std::shared_ptr<SHAMapItem const> const&) { ++leaves; });
+                expect (leaves == 4900, "bad stored leaves");
+            }
+
+            f.setFlushThreshold (1000);
+            auto copy = map.snapShot (true);
+            copy->flushDirty (hotACCOUNT_NODE, 2);
+            expect (copy->getHash () == hash, "bad threshold flush hash");
+            f.setFlushThreshold (0);
+        }
     }
 };
 
 BEAST_DEFINE_TESTSUITE(SHAMap,ripple_app,ripple);
 
+// Times walking the leaves of a map read from the node store on one thread
+// against visitLeavesParallel.
+class SHAMapVisitBench_test : public beast::unit_test::suite
+{
+    using clock_type = std::chrono::steady_clock;
+
+    // Returns the milliseconds f takes on a copy of map that has to be read
+    // back from the node store.
+    template <class F>
+    std::chrono::milliseconds
+    timeCold (TestFamily& f, SHAMap const& map, F&& visit)
+    {
+        f.treecache ().clear ();
+        SHAMap stored (SHAMapType::STATE, map.getHash ().as_uint256 (), f);
+        expect (stored.fetchRoot (map.getHash (), nullptr), "no stored root");
+
+        auto const start = clock_type::now ();
+        visit (stored);
+        return std::chrono::duration_cast<std::chrono::milliseconds> (
+            clock_type::now () - start);
+    }
+
+public:
+    void run ()
+    {
+        std::size_t const count = 500000;
+
+        beast::Journal const j;
+        TestFamily f (j);
+        SHAMap map (SHAMapType::STATE, f);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            Serializer s;
+            s.add64 (i);
+            s.add64 (i * 7919);
+            map.addItem (SHAMapItem (s.getSHA512Half (), s.peekData ()), false, false);
+        }
+        map.flushDirty (hotACCOUNT_NODE, 1);
+
+        testcase ("visit leaves");
+        std::size_t seen = 0;
+        log << count << " leaves, sequential " << timeCold (f, map, [&](SHAMap const& m)
+            {
+                m.visitLeaves ([&](std::shared_ptr<SHAMapItem const> const&) { ++seen; });
+            }).count () << "ms";
+        expect (seen == count);
+
+        for (std::size_t threads : {1, 2, 4, 8})
+        {
+            std::vector<std::size_t> parts (SHAMap::visitParts);
+            log << threads << " threads " << timeCold (f, map, [&](SHAMap const& m)
+                {
+                    m.visitLeavesParallel ([&](std::size_t part, std::shared_ptr<SHAMapItem const> const&)
+                    {
+                        ++parts[part];
+                    }, threads);
+                }).count () << "ms";
+            expect (std::accumulate (parts.begin (), parts.end (), std::size_t (0)) == count);
+        }
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(SHAMapVisitBench,ripple_app,ripple);
+
 } // tests
 } // ripple
@@ -0,0 +1,253 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012, 2013 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ripple/shamap/SHAMap.h>
+#include <ripple/shamap/SHAMapTreeNode.h>
+#include <ripple/shamap/tests/common.h>
+#include <ripple/basics/Slice.h>
+#include <ripple/protocol/Serializer.h>
+#include <beast/unit_test/suite.h>
+#include <beast/utility/Journal.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+namespace ripple {
+namespace tests {
+
+class SHAMapInnerNode_test : public beast::unit_test::suite
+{
+    static
+    std::shared_ptr<SHAMapTreeNode>
+    makeLeaf (int i)
+    {
+        Serializer s;
+        s.add64 (i);
+        s.add64 (i * 7919);
+        return std::make_shared<SHAMapTreeNode> (
+            std::make_shared<SHAMapItem const> (s.getSHA512Half (), s.peekData ()),
+                SHAMapTreeNode::tnACCOUNT_STATE, 1);
+    }
+
+    // Checks node against the children it should have
+    void
+    check (SHAMapInnerNode& node,
+        std::shared_ptr<SHAMapAbstractNode> const (&children)[16])
+    {
+        int count = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            expect (node.isEmptyBranch (i) == !children[i]);
+            expect (node.getChild (i) == children[i]);
+            if (children[i])
+            {
+                ++count;
+                expect (node.getChildHash (i) == children[i]->getNodeHash ());
+            }
+            else
+            {
+                expect (node.getChildHash (i).isZero ());
+            }
+        }
+        expect (node.getBranchCount () == count);
+        expect (node.getCapacity () >= count);
+        expect (count > 12 ? node.getCapacity () == 16 : node.getCapacity () <= 12);
+    }
+
+public:
+    void
+    testLayout ()
+    {
+        testcase ("layout");
+
+        std::shared_ptr<SHAMapAbstractNode> children[16];
+        SHAMapInnerNode node (1);
+        check (node, children);
+
+        // Fill out of order, through the sparse and dense layouts
+        for (int i : {7, 0, 15, 3, 9, 1, 14, 8, 2, 12, 4, 11, 5, 13, 6, 10})
+        {
+            children[i] = makeLeaf (i);
+            node.setChild (i, children[i]);
+            node.updateHashDeep ();
+            check (node, children);
+        }
+
+        // Replacing a child leaves the branches as they are
+        children[3] = makeLeaf (100);
+        node.setChild (3, children[3]);
+        node.updateHashDeep ();
+        check (node, children);
+
+        // And empty it again
+        for (int i : {4, 15, 0, 8, 1, 2, 9, 14, 3, 5, 11, 6, 13, 7, 12, 10})
+        {
+            children[i].reset ();
+            node.setChild (i, nullptr);
+            node.updateHashDeep ();
+            check (node, children);
+        }
+        expect (node.isEmpty ());
+
+        // Branches added and removed between others of a sparse node
+        for (int i : {2, 9, 5})
+        {
+            children[i] = makeLeaf (i);
+            node.setChild (i, children[i]);
+        }
+        node.updateHashDeep ();
+        children[5] = makeLeaf (105);
+        node.setChild (5, children[5]);
+        children[2].reset ();
+        node.setChild (2, nullptr);
+        children[0] = makeLeaf (0);
+        node.setChild (0, children[0]);
+        node.updateHashDeep ();
+        check (node, children);
+    }
+
+    void
+    testSerialize ()
+    {
+        testcase ("serialize");
+
+        beast::Journal const j;
+        for (int count : {1, 2, 5, 12, 13, 16})
+        {
+            std::shared_ptr<SHAMapAbstractNode> children[16];
+            SHAMapInnerNode node (1);
+            for (int i = 0; i < count; ++i)
+            {
+                auto const branch = (i * 7) % 16;
+                children[branch] = makeLeaf (i);
+                node.setChild (branch, children[branch]);
+            }
+            node.updateHashDeep ();
+
+            for (auto format : {snfPREFIX, snfWIRE})
+            {
+                Serializer s;
+                node.addRaw (s, format);
+                auto const copy = SHAMapAbstractNode::make (
+                    makeSlice (s.peekData ()), 1, format, {}, false, j);
+                if (! expect (copy && copy->isInner ()))
+                    continue;
+                expect (copy->getNodeHash () == node.getNodeHash ());
+                auto& inner = static_cast<SHAMapInnerNode&> (*copy);
+                expect (inner.getBranchCount () == count);
+                for (int i = 0; i < 16; ++i)
+                {
+                    expect (inner.getChildHash (i) == node.getChildHash (i));
+                    expect (! inner.getChildPointer (i));
+                }
+            }
+
+            auto const copy = std::static_pointer_cast<SHAMapInnerNode> (
+                node.clone (2));
+            check (*copy, children);
+            expect (copy->getNodeHash () == node.getNodeHash ());
+        }
+    }
+
+    void
+    run ()
+    {
+        testLayout ();
+        testSerialize ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(SHAMapInnerNode,ripple_app,ripple);
+
+// Reports the memory used by the inner nodes of a state map, against what
+// they used with a slot for every branch, and times lookups in the map.
+class SHAMapInnerNodeBench_test : public beast::unit_test::suite
+{
+    using clock_type = std::chrono::steady_clock;
+
+    static std::size_t const slotBytes =
+        sizeof (SHAMapHash) + sizeof (std::shared_ptr<SHAMapAbstractNode>);
+
+public:
+    void
+    run ()
+    {
+        beast::Journal const j;
+        TestFamily f (j);
+
+        for (std::size_t count : {10000, 100000, 1000000})
+        {
+            testcase (std::to_string (count) + " items");
+
+            SHAMap map (SHAMapType::STATE, f);
+            std::vector<uint256> keys;
+            keys.reserve (count);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                Serializer s;
+                s.add64 (i);
+                s.add64 (i * 7919);
+                keys.push_back (s.getSHA512Half ());
+                map.addItem (SHAMapItem (keys.back (), s.peekData ()), false, false);
+            }
+            map.getHash ();
+
+            std::size_t inners = 0;
+            std::size_t bytes = 0;
+            std::size_t branches[17] = {};
+            map.visitNodes ([&](SHAMapAbstractNode& node)
+                {
+                    if (node.isInner ())
+                    {
+                        auto const& inner = static_cast<SHAMapInnerNode&> (node);
+                        ++inners;
+                        ++branches[inner.getBranchCount ()];
+                        bytes += inner.getCapacity () * slotBytes;
+                    }
+                    return false;
+                });
+            auto const fixed = sizeof (SHAMapInnerNode);
+            log << inners << " inner nodes, " <<
+                (fixed + bytes / inners) << " bytes each, was " <<
+                (fixed + 16 * slotBytes);
+
+            std::string histogram = "branches:";
+            for (int i = 1; i <= 16; ++i)
+                histogram += " " + std::to_string (branches[i]);
+            log << histogram;
+
+            std::shuffle (keys.begin (), keys.end (), std::mt19937 (count));
+            auto const start = clock_type::now ();
+            std::size_t found = 0;
+            for (auto const& key : keys)
+                if (map.hasItem (key))
+                    ++found;
+            auto const elapsed = std::chrono::duration_cast<
+                std::chrono::nanoseconds> (clock_type::now () - start);
+            log << "lookup " << (elapsed.count () / count) << "ns";
+            expect (found == count);
+        }
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(SHAMapInnerNodeBench,ripple_app,ripple);
+
+} // tests
+} // ripple
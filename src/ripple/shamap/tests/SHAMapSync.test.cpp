@@ -129,7 +129,7 @@ public:
 
         unexpected (gotNodes.size () < 1, "NodeSize");
 
-        unexpected (!destination.addRootNode (*gotNodes.begin (), snfWIRE, nullptr).isGood(), "AddRootNode");
+        unexpected (!destination.addRootNode (makeSlice(*gotNodes.begin ()), snfWIRE, nullptr).isGood(), "AddRootNode");
 
         nodeIDs.clear ();
         gotNodes.clear ();
@@ -184,7 +184,7 @@ public:
                 bytes += rawNodeIterator->size ();
 #endif
 
-                if (!destination.addKnownNode (*nodeIDIterator, *rawNodeIterator, nullptr).isGood ())
+                if (!destination.addKnownNode (*nodeIDIterator, makeSlice(*rawNodeIterator), nullptr).isGood ())
                 {
                     fail ("AddKnownNode");
                 }
@@ -44,12 +44,15 @@ private:
     TreeNodeCache treecache_;
     FullBelowCache fullbelow_;
     std::unique_ptr<NodeStore::Database> db_;
+    std::size_t flushThreshold_ = 0;
+    ParallelPool flushPool_;
     beast::Journal j_;
 
 public:
     TestFamily (beast::Journal j)
         : treecache_ ("TreeNodeCache", 65536, 60, clock_, j)
         , fullbelow_ ("full_below", clock_)
+        , flushPool_ (3, "SHAMapFlush")
     {
         Section testSection;
         testSection.set("type", "memory");
@@ -117,6 +120,29 @@ public:
     {
         Throw<std::runtime_error> ("missing node");
     }
+
+    std::size_t
+    flushThreshold() const override
+    {
+        return flushThreshold_;
+    }
+
+    ParallelPool&
+    flushPool() override
+    {
+        return flushPool_;
+    }
+
+    void
+    setFlushThreshold (std::size_t threshold)
+    {
+        flushThreshold_ = threshold;
+    }
+
+    void
+    onFlush (int, std::size_t, std::chrono::microseconds) override
+    {
+    }
 };
 
 } // tests
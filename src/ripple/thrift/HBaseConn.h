@@ -4,6 +4,10 @@
 #if RIPPLE_THRIFT_AVAILABLE
 
 #include <boost/thread/tss.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include <ripple/unity/thrift.h>
@@ -28,10 +32,58 @@ public:
         int32_t connTimeout = 5000;
         int32_t sendTimeout = 5000;
         int32_t recvTimeout = 5000;
+        int32_t poolSize = 8;
     };
     
     std::unique_ptr<apache::hadoop::hbase::thrift::HbaseClient> m_client;
 
+    static Setup makeSetup (Section const& keyValues)
+    {
+        Setup setup;
+
+        setup.isCompactProtocol = get<std::string> (keyValues, "protocol").compare ("compact") == 0;
+
+        int port = get<int> (keyValues, "port", 9090);
+        if (port <= 0)
+            throw std::runtime_error ("Bad port in HbaseFactory backend");
+
+        std::string hosts = get<std::string> (keyValues, "host");
+        if (hosts.empty ())
+            throw std::runtime_error ("Missing host in HbaseFactory backend");
+
+        std::stringstream ss (hosts);
+        std::string host;
+        while (std::getline (ss, host, ','))
+        {
+            setup.hosts.push_back ({host, port});
+        }
+
+        if (keyValues.exists ("fetch_batch_max"))
+        {
+            setup.fetchBatchLimit = get<int> (keyValues, "fetch_batch_max");
+            if (setup.fetchBatchLimit <= 0)
+                throw std::runtime_error ("Bad fetch_batch_max in HbaseFactory backend");
+        }
+        
+        if (keyValues.exists ("conn_timeout"))
+            setup.connTimeout = get<int>(keyValues, "conn_timeout");
+
+        if (keyValues.exists ("send_timeout"))
+            setup.sendTimeout = get<int>(keyValues, "send_timeout");
+
+        if (keyValues.exists ("recv_timeout"))
+            setup.recvTimeout = get<int>(keyValues, "recv_timeout");
+
+        if (keyValues.exists ("pool_size"))
+        {
+            setup.poolSize = get<int> (keyValues, "pool_size");
+            if (setup.poolSize <= 0)
+                throw std::runtime_error ("Bad pool_size in HbaseFactory backend");
+        }
+
+        return setup;
+    }
+
     HBaseConn (Setup setup, beast::Journal journal)
         : m_journal (journal)
     {
@@ -122,40 +174,9 @@ class HBaseConnFactory
 {
 public:
     HBaseConnFactory (Section const& keyValues, beast::Journal journal)
-        : m_journal (journal)
+        : m_setup (HBaseConn::makeSetup (keyValues))
+        , m_journal (journal)
     {
-        m_setup.isCompactProtocol = get<std::string> (keyValues, "protocol").compare ("compact") == 0;
-
-        int port = get<int> (keyValues, "port", 9090);
-        if (port <= 0)
-            throw std::runtime_error ("Bad port in HbaseFactory backend");
-
-        std::string hosts = get<std::string> (keyValues, "host");
-        if (hosts.empty ())
-            throw std::runtime_error ("Missing host in HbaseFactory backend");
-
-        std::stringstream ss (hosts);
-        std::string host;
-        while (std::getline (ss, host, ','))
-        {
-            m_setup.hosts.push_back ({host, port});
-        }
-
-        if (keyValues.exists ("fetch_batch_max"))
-        {
-            m_setup.fetchBatchLimit = get<int> (keyValues, "fetch_batch_max");
-            if (m_setup.fetchBatchLimit <= 0)
-                throw std::runtime_error ("Bad fetch_batch_max in HbaseFactory backend");
-        }
-        
-        if (keyValues.exists ("conn_timeout"))
-            m_setup.connTimeout = get<int>(keyValues, "conn_timeout");
-
-        if (keyValues.exists ("send_timeout"))
-            m_setup.sendTimeout = get<int>(keyValues, "send_timeout");
-
-        if (keyValues.exists ("recv_timeout"))
-            m_setup.recvTimeout = get<int>(keyValues, "recv_timeout");
     }
 
     HBaseConn* getConnection ()
@@ -188,6 +209,217 @@ private:
     HBaseConn::Setup m_setup;
     beast::Journal m_journal;
 };
+
+/**
+ * A fixed number of connections shared by every thread.
+ *
+ * A connection is checked before it is handed out and reopened if the
+ * transport closed. A lease that saw an error is failed, which drops the
+ * connection so the next user gets a fresh one.
+ */
+class HBaseConnPool
+{
+public:
+    class Lease
+    {
+    public:
+        Lease () = default;
+
+        Lease (Lease&& other)
+            : m_pool (other.m_pool), m_conn (std::move (other.m_conn)), m_failed (other.m_failed)
+        {
+            other.m_pool = nullptr;
+        }
+
+        Lease& operator= (Lease&& other)
+        {
+            release ();
+            m_pool = other.m_pool;
+            m_conn = std::move (other.m_conn);
+            m_failed = other.m_failed;
+            other.m_pool = nullptr;
+            return *this;
+        }
+
+        ~Lease ()
+        {
+            release ();
+        }
+
+        explicit operator bool () const
+        {
+            return m_conn != nullptr;
+        }
+
+        apache::hadoop::hbase::thrift::HbaseClient& client ()
+        {
+            return m_conn->getClient ();
+        }
+
+        /** Do not reuse the connection, a request on it failed. */
+        void fail ()
+        {
+            m_failed = true;
+        }
+
+    private:
+        friend class HBaseConnPool;
+
+        Lease (HBaseConnPool& pool, std::unique_ptr<HBaseConn> conn)
+            : m_pool (&pool), m_conn (std::move (conn))
+        {
+        }
+
+        void release ()
+        {
+            if (m_pool)
+                m_pool->release (std::move (m_conn), m_failed);
+            m_pool = nullptr;
+        }
+
+        HBaseConnPool* m_pool = nullptr;
+        std::unique_ptr<HBaseConn> m_conn;
+        bool m_failed = false;
+    };
+
+    HBaseConnPool (Section const& keyValues, beast::Journal journal)
+        : m_setup (HBaseConn::makeSetup (keyValues))
+        , m_journal (journal)
+    {
+    }
+
+    /** Wait for a connection. */
+    Lease acquire ()
+    {
+        std::unique_lock<std::mutex> lock (m_mutex);
+        m_cond.wait (lock, [this]
+        {
+            return !m_idle.empty () || m_open < m_setup.poolSize;
+        });
+        return checkout (lock);
+    }
+
+    /** A connection if one is free now, otherwise an empty lease. */
+    Lease tryAcquire ()
+    {
+        std::unique_lock<std::mutex> lock (m_mutex);
+        if (m_idle.empty () && m_open >= m_setup.poolSize)
+            return Lease ();
+        return checkout (lock);
+    }
+
+    std::size_t size () const
+    {
+        return m_setup.poolSize;
+    }
+
+    const HBaseConn::Setup& getSetup ()
+    {
+        return m_setup;
+    }
+
+private:
+    Lease checkout (std::unique_lock<std::mutex>& lock)
+    {
+        std::unique_ptr<HBaseConn> conn;
+        if (!m_idle.empty ())
+        {
+            conn = std::move (m_idle.back ());
+            m_idle.pop_back ();
+        }
+        else
+        {
+            ++m_open;
+        }
+        lock.unlock ();
+
+        // Connecting may take a while, do it unlocked.
+        try
+        {
+            if (!conn)
+                conn = std::make_unique<HBaseConn> (m_setup, m_journal);
+            else if (!conn->isOpen ())
+                conn->open ();
+        }
+        catch (...)
+        {
+            release (nullptr, true);
+            throw;
+        }
+        return Lease (*this, std::move (conn));
+    }
+
+    void release (std::unique_ptr<HBaseConn> conn, bool failed)
+    {
+        {
+            std::lock_guard<std::mutex> lock (m_mutex);
+            if (conn && !failed)
+                m_idle.push_back (std::move (conn));
+            else
+                --m_open;
+        }
+        m_cond.notify_one ();
+        // a failed connection is closed here, outside the lock
+    }
+
+    HBaseConn::Setup const m_setup;
+    beast::Journal m_journal;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::vector<std::unique_ptr<HBaseConn>> m_idle;
+    int32_t m_open = 0;
+};
+
+/**
+ * Split sorted rows into at most `parts` contiguous ranges of similar size.
+ *
+ * A cut that falls within a quarter share of a region start is moved onto
+ * it, so that most ranges are served by a single region server.
+ *
+ * @param rows Sorted row keys.
+ * @param regionStarts Sorted start keys of the table regions, may be empty.
+ * @return The end index of each range.
+ */
+inline std::vector<std::size_t> partitionRows (
+    std::vector<std::string> const& rows,
+    std::vector<std::string> const& regionStarts,
+    std::size_t parts)
+{
+    std::vector<std::size_t> ends;
+    if (rows.empty ())
+        return ends;
+
+    parts = std::max<std::size_t> (std::min (parts, rows.size ()), 1);
+    std::size_t const slack = rows.size () / parts / 4;
+
+    // Index of the first row of each region.
+    std::vector<std::size_t> boundaries;
+    for (auto const& start : regionStarts)
+    {
+        std::size_t const i = std::lower_bound (rows.begin (), rows.end (), start) - rows.begin ();
+        if (i > 0 && i < rows.size () && (boundaries.empty () || boundaries.back () != i))
+            boundaries.push_back (i);
+    }
+
+    for (std::size_t part = 1; part < parts; ++part)
+    {
+        std::size_t const target = part * rows.size () / parts;
+        std::size_t cut = target;
+        auto const next = std::lower_bound (boundaries.begin (), boundaries.end (), target);
+        std::size_t best = slack + 1;
+        if (next != boundaries.end () && *next - target < best)
+        {
+            best = *next - target;
+            cut = *next;
+        }
+        if (next != boundaries.begin () && target - *std::prev (next) < best)
+            cut = *std::prev (next);
+        if (ends.empty () || cut > ends.back ())
+            ends.push_back (cut);
+    }
+    ends.push_back (rows.size ());
+    return ends;
+}
 }
 
 #endif
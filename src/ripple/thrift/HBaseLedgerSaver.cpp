@@ -1,410 +1,481 @@
+#include <ripple/thrift/HBaseLedgerSaver.h>
 #include <ripple/app/ledger/AcceptedLedger.h>
 #include <ripple/app/ledger/LedgerMaster.h>
 #include <ripple/app/ledger/TransactionMaster.h>
-#include <ripple/app/main/Application.h>
+#include <ripple/basics/StringUtilities.h>
 #include <ripple/core/ConfigSections.h>
 #include <ripple/thrift/HBaseConn.h>
+#include <boost/format.hpp>
 #include <boost/make_shared.hpp>
+#include <chrono>
 
 namespace ripple
 {
-class HBaseLedgerSaver : Application::SetupListener<HBaseLedgerSaver>
+namespace
 {
-private:
-    // Hbase table defines.
-    static constexpr auto s_tableLocks =    SYSTEM_NAMESPACE ":Locks";  // LedgerData
-    static constexpr auto s_tableLedgers =  SYSTEM_NAMESPACE ":Ledgers";// LedgerData
-    static constexpr auto s_tableTxs =      SYSTEM_NAMESPACE ":Txs";    // Raw & meta data
-    static constexpr auto s_tableTxIndex =  SYSTEM_NAMESPACE ":TxIdx";  // Indexes for Hash -> Ledger,TxnSeq
-
-    boost::format s_keyTxs = boost::format ("%X%u-%u-%u"); // Row Key format: [Hex(LedgerSeq%16)][LedgerSeq]-[TxnType]-[TxnSeq]
-
-    static constexpr auto s_columnFamily =          "d:";
-
-    static constexpr auto s_columnRaw =             "d:r";
-    static constexpr auto s_columnMeta =            "d:m";
-    
-    static constexpr auto s_columnValue =           "d:v";
-
-    static constexpr auto s_columnHash =            "d:h";
-    static constexpr auto s_columnClosingTime =     "d:ct";
-    static constexpr auto s_columnPrevHash =        "d:ph";
-    static constexpr auto s_columnAccountSetHash =  "d:ah";
-    static constexpr auto s_columnTransSetHash =    "d:th";
-    static constexpr auto s_columnVRP =             "d:vrp";
-    static constexpr auto s_columnVBC =             "d:vbc";
-
-public:
-    HBaseLedgerSaver (Application& app)
-        : m_app (app),
-          m_journal (app.journal ("HBaseLedgerSaver")),
-          m_hbaseFactory(app.config ().section (SECTION_TX_DB_HBASE), m_journal)
-    {
-        initTables ();
-    }
+    constexpr auto s_columnFamily =          "d:";
 
-    ~HBaseLedgerSaver ()
-    {
-    }
+    constexpr auto s_columnRaw =             "d:r";
+    constexpr auto s_columnMeta =            "d:m";
+
+    constexpr auto s_columnValue =           "d:v";
 
-    static bool onSetup (Application& app)
+    constexpr auto s_columnHash =            "d:h";
+    constexpr auto s_columnClosingTime =     "d:ct";
+    constexpr auto s_columnPrevHash =        "d:ph";
+    constexpr auto s_columnAccountSetHash =  "d:ah";
+    constexpr auto s_columnTransSetHash =    "d:th";
+    constexpr auto s_columnVRP =             "d:vrp";
+    constexpr auto s_columnVBC =             "d:vbc";
+
+    // Failed group commits retried once stopping, before giving up.
+    constexpr int s_stopRetries = 10;
+
+    void addMutation (std::vector<apache::hadoop::hbase::thrift::Mutation>& mutations,
+                      char const* column,
+                      std::string value)
     {
-        if (!app.config ().exists (SECTION_TX_DB_HBASE))
-            return true;
+        mutations.emplace_back ();
+        mutations.back ().column = column;
+        mutations.back ().value = std::move (value);
+    }
+}
 
-        try
-        {
-            // new HBaseLedgerSaver
-            static boost::shared_ptr<HBaseLedgerSaver> hbaseLedgerSaver = boost::make_shared<HBaseLedgerSaver> (app);
+char const* const HBaseLedgerSaver::tableLedgers =    SYSTEM_NAMESPACE ":Ledgers";    // LedgerData
+char const* const HBaseLedgerSaver::tableTxs =        SYSTEM_NAMESPACE ":Txs";        // Raw & meta data
+char const* const HBaseLedgerSaver::tableTxIndex =    SYSTEM_NAMESPACE ":TxIdx";      // Indexes for Hash -> Ledger,TxnSeq
+char const* const HBaseLedgerSaver::tableAccountTxs = SYSTEM_NAMESPACE ":AccountTxs"; // Indexes for Account -> Ledger,TxnSeq
 
-            // connect it to signal SaveValidated
-            typedef decltype(LedgerMaster::Signals::SaveValidated)::slot_type slot_type;
-            LedgerMaster::signals ().SaveValidated.connect (
-                slot_type (&HBaseLedgerSaver::onSaveValidatedLedger,
-                           hbaseLedgerSaver.get (), _1)
-                    .track (hbaseLedgerSaver));
+HBaseLedgerSaver::HBaseLedgerSaver (Application& app, Setup const& setup, Client client, beast::Journal journal)
+    : m_app (app),
+      m_setup (setup),
+      m_client (std::move (client)),
+      m_journal (journal)
+{
+    for (std::size_t i = 0; i < std::max<std::size_t> (m_setup.threads, 1); ++i)
+        m_threads.emplace_back (&HBaseLedgerSaver::prepareThread, this);
+    m_threads.emplace_back (&HBaseLedgerSaver::commitThread, this);
+}
 
-            JLOG (app.journal ("HBaseLedgerSaver").info) << "done";
-        }
-        catch (const std::exception& e)
-        {
-            JLOG (app.journal ("HBaseLedgerSaver").error) << e.what ();
-            return false;
-        }
+HBaseLedgerSaver::~HBaseLedgerSaver ()
+{
+    stop ();
+}
 
+bool HBaseLedgerSaver::onSetup (Application& app)
+{
+    if (!app.config ().exists (SECTION_TX_DB_HBASE))
         return true;
+
+    try
+    {
+        auto const& section = app.config ().section (SECTION_TX_DB_HBASE);
+        auto const journal = app.journal ("HBaseLedgerSaver");
+
+        Setup setup;
+        if (section.exists ("save_threads"))
+            setup.threads = std::max (get<int> (section, "save_threads"), 1);
+        if (section.exists ("save_queue"))
+            setup.maxPending = std::max (get<int> (section, "save_queue"), 1);
+        if (section.exists ("save_group"))
+            setup.maxGroup = std::max (get<int> (section, "save_group"), 1);
+
+        // Each thread gets its own connection.
+        auto factory = std::make_shared<HBaseConnFactory> (section, journal);
+        Client client = [factory]() -> apache::hadoop::hbase::thrift::HbaseIf&
+        {
+            return factory->getConnection ()->getClient ();
+        };
+
+        // new HBaseLedgerSaver
+        static boost::shared_ptr<HBaseLedgerSaver> hbaseLedgerSaver =
+            boost::make_shared<HBaseLedgerSaver> (app, setup, client, journal);
+        hbaseLedgerSaver->initTables ();
+
+        // connect it to signal SaveValidated
+        typedef decltype(LedgerMaster::Signals::SaveValidated)::slot_type slot_type;
+        auto const saver = hbaseLedgerSaver.get ();
+        LedgerMaster::signals ().SaveValidated.connect (
+            slot_type ([saver](std::shared_ptr<Ledger const> const& ledger)
+                       {
+                           return saver->save (ledger);
+                       })
+                .track (hbaseLedgerSaver));
+
+        // write what is pending before the application goes away
+        Application::signals ().Shutdown.connect (
+            [saver]() {
+                saver->stop ();
+            });
+
+        JLOG (journal.info) << "done";
+    }
+    catch (const std::exception& e)
+    {
+        JLOG (app.journal ("HBaseLedgerSaver").error) << e.what ();
+        return false;
     }
 
-private:
+    return true;
+}
 
-    class HBaseLock
+bool HBaseLedgerSaver::save (std::shared_ptr<Ledger const> const& ledger)
+{
+    std::unique_lock<std::mutex> lock (m_mutex);
+    m_doneCond.wait (lock, [this]
     {
-    private:
-        std::string m_rowKey;
-        HBaseLedgerSaver* m_ledgerSaver;
-        std::atomic<bool> m_locked;
-
-    public:
-        HBaseLock (const std::string& rowKey, HBaseLedgerSaver* ledgerSaver)
-            : m_rowKey (rowKey), m_ledgerSaver (ledgerSaver), m_locked (false)
-        {
-        }
-        ~HBaseLock ()
-        {
-            if (m_locked)
-                unlock ();
-        }
+        return m_stopping || m_pending < m_setup.maxPending;
+    });
+    if (m_stopping)
+    {
+        JLOG (m_journal.warning) << "stopped, not saving " << ledger->info ().seq;
+        return false;
+    }
 
-        void lock () noexcept
-        {
-            using namespace apache::thrift;
-            using namespace apache::hadoop::hbase::thrift;
-            Mutation mput;
-            mput.column = s_columnValue;
-            mput.value = "1";
-            std::map<Text, Text> attributes;
-            for (;;)
-            {
-                try
-                {
-                    if (m_ledgerSaver->getConnection ()->m_client->checkAndPut (
-                            s_tableLocks, m_rowKey, mput.column, "", mput, attributes))
-                    {
-                        m_locked = true;
-                        return;
-                    }
-                }
-                catch (const TException& te)
-                {
-                    JLOG (m_ledgerSaver->m_journal.error) << "get lock failed, " << te.what ();
-                }
-                JLOG (m_ledgerSaver->m_journal.debug) << "wait for lock";
-                std::this_thread::sleep_for (std::chrono::milliseconds (100));
-            }
-        }
+    ++m_pending;
+    m_queue.push_back (ledger);
+    m_queueCond.notify_one ();
+    JLOG (m_journal.debug) << "queued ledger " << ledger->info ().seq << ", " << m_pending << " pending";
+    return true;
+}
 
-        bool unlock () noexcept
-        {
-            using namespace apache::thrift;
-            using namespace apache::hadoop::hbase::thrift;
-            for (int i = 0; i < 2; i++)
-            {
-                try
-                {
-                    std::map<Text, Text> attributes;
-                    m_ledgerSaver->getConnection ()->m_client->deleteAllRow (
-                        s_tableLocks, m_rowKey, attributes);
-                    m_locked = false;
-                    return true;
-                }
-                catch (const TException& te)
-                {
-                    JLOG (m_ledgerSaver->m_journal.error) << "release lock failed, " << te.what ();
-                }
-            }
-            return false;
-        }
-    };
+void HBaseLedgerSaver::flush ()
+{
+    std::unique_lock<std::mutex> lock (m_mutex);
+    m_doneCond.wait (lock, [this] { return m_pending == 0; });
+}
 
-    bool onSaveValidatedLedger (std::shared_ptr<Ledger const> const& ledger)
+void HBaseLedgerSaver::stop ()
+{
     {
-        using namespace apache::thrift;
-        using namespace apache::hadoop::hbase::thrift;
+        std::lock_guard<std::mutex> lock (m_mutex);
+        if (m_stopping)
+            return;
+        m_stopping = true;
+    }
+    m_queueCond.notify_all ();
+    m_preparedCond.notify_all ();
+    m_doneCond.notify_all ();
 
-        auto const& ledgerSeq = ledger->info ().seq;
-        auto const ledgerSeqStr = to_string (ledgerSeq);
-        auto const ledgerHash = to_string (ledger->info ().hash);
+    for (auto& thread : m_threads)
+        thread.join ();
+    m_threads.clear ();
+}
 
-        JLOG (m_journal.info) << "saving ledger " << ledgerSeq;
+void HBaseLedgerSaver::done (std::size_t count)
+{
+    {
+        std::lock_guard<std::mutex> lock (m_mutex);
+        m_pending -= count;
+    }
+    m_doneCond.notify_all ();
+}
 
-        // Return if already in hbase. Will check again later if someone wrote it
-        // during we are proparing writing. So retry on exception loop is not needed.
-        try
-        {
-            if (isSaved (ledgerSeqStr, ledgerHash))
-                return true;
-        }
-        catch (const TException& te)
+void HBaseLedgerSaver::prepareThread ()
+{
+    for (;;)
+    {
+        std::shared_ptr<Ledger const> ledger;
         {
-            JLOG (m_journal.fatal) << ledgerSeq << " isSaved checking failed, " << te.what ();
+            std::unique_lock<std::mutex> lock (m_mutex);
+            m_queueCond.wait (lock, [this] { return m_stopping || !m_queue.empty (); });
+            // Queued ledgers are still written when stopping.
+            if (m_queue.empty ())
+                break;
+            ledger = std::move (m_queue.front ());
+            m_queue.pop_front ();
+            ++m_preparing;
         }
 
-        // get AcceptedLedger
-        AcceptedLedger::pointer aLedger;
         try
         {
-            aLedger = m_app.getAcceptedLedgerCache ().fetch (ledger->info ().hash);
-            if (!aLedger)
-            {
-                aLedger = std::make_shared<AcceptedLedger> (ledger, m_app.accountIDCache (), m_app.logs ());
-                m_app.getAcceptedLedgerCache ().canonicalize (ledger->info ().hash, aLedger);
-            }
+            auto prepared = prepare (ledger);
+
+            std::lock_guard<std::mutex> lock (m_mutex);
+            --m_preparing;
+            m_prepared.push_back (std::move (prepared));
+            m_preparedCond.notify_one ();
         }
-        catch (std::exception const&)
+        catch (std::exception const& e)
         {
-            JLOG (m_journal.warning) << "An accepted ledger was missing nodes";
-            return false;
+            JLOG (m_journal.warning) << "ledger " << ledger->info ().seq << " was missing nodes, " << e.what ();
+            {
+                std::lock_guard<std::mutex> lock (m_mutex);
+                --m_preparing;
+            }
+            m_preparedCond.notify_one ();
+            m_app.getLedgerMaster ().failedSave (ledger->info ().seq, ledger->info ().hash);
+            done (1);
         }
+    }
+}
 
-        std::unordered_map<std::string, std::vector<BatchMutation>> mutations;
-
-        prepareTxs (mutations, aLedger, ledgerSeq);
-
-        // mutations to table Ledgers
-        std::vector<Mutation> ledgerMutations;
-        ledgerMutations.push_back (Mutation ());
-        ledgerMutations.back ().column = s_columnHash;
-        ledgerMutations.back ().value.assign (ledgerHash);
-        ledgerMutations.push_back (Mutation ());
-        ledgerMutations.back ().column = s_columnPrevHash;
-        ledgerMutations.back ().value.assign (to_string (ledger->info ().parentHash));
-        ledgerMutations.push_back (Mutation ());
-        ledgerMutations.back ().column = s_columnAccountSetHash;
-        ledgerMutations.back ().value.assign (to_string (ledger->info().accountHash));
-        ledgerMutations.push_back (Mutation ());
-        ledgerMutations.back ().column = s_columnTransSetHash;
-        ledgerMutations.back ().value.assign (to_string (ledger->info().txHash));
-        ledgerMutations.push_back (Mutation ());
-        ledgerMutations.back ().column = s_columnClosingTime;
-        ledgerMutations.back ().value.assign (to_string (ledger->info ().closeTime));
-        ledgerMutations.push_back (Mutation ());
-        ledgerMutations.back ().column = s_columnVRP;
-        ledgerMutations.back ().value.assign (to_string (ledger->info ().drops));
-        ledgerMutations.push_back (Mutation ());
-        ledgerMutations.back ().column = s_columnVBC;
-        ledgerMutations.back ().value.assign (to_string (ledger->info ().dropsVBC));
-
-        for (;;)
+void HBaseLedgerSaver::commitThread ()
+{
+    int failures = 0;
+    std::vector<Prepared> group;
+    for (;;)
+    {
+        if (group.empty ())
         {
-            // get a lock to write this ledger
-            static boost::format rowKeyFormat ("ls-%u");
-            try
+            std::unique_lock<std::mutex> lock (m_mutex);
+            m_preparedCond.wait (lock, [this]
             {
-                HBaseLock hbaseLock (boost::str (boost::format (rowKeyFormat) % ledgerSeq), this);
-                hbaseLock.lock ();
-
-                // check again if already in hbase
-                if (isSaved (ledgerSeqStr, ledgerHash))
-                    return true;
-
-                for (auto const& mutation : mutations)
-                {
-                    std::map<Text, Text> attributes;
-                    getConnection ()->m_client->mutateRows (
-                        mutation.first, mutation.second, attributes);
-                }
-
-                std::map<Text, Text> attributes;
-                getConnection ()->m_client->mutateRow (
-                    s_tableLedgers, ledgerSeqStr, ledgerMutations, attributes);
-                JLOG (m_journal.info) << "done";
-                return true;
-            }
-            catch (const TException& te)
+                return !m_prepared.empty () ||
+                    (m_stopping && m_queue.empty () && m_preparing == 0);
+            });
+            if (m_prepared.empty ())
+                break;
+
+            // Everything prepared while the last group was written goes
+            // into this one.
+            while (!m_prepared.empty () && group.size () < m_setup.maxGroup)
             {
-                JLOG (m_journal.fatal) << ledgerSeq << " save failed, " << te.what ();
+                group.push_back (std::move (m_prepared.front ()));
+                m_prepared.pop_front ();
             }
-            std::this_thread::sleep_for (std::chrono::milliseconds (100));
         }
-        JLOG (m_journal.error) << "fail to save " << ledgerSeq;
-        return false;
-    }
 
-    bool isSaved (const std::string& ledgerSeqStr, const std::string& ledgerHash) noexcept(false)
-    {
-        using namespace apache::thrift;
-        using namespace apache::hadoop::hbase::thrift;
-
-        std::vector<TCell> cells;
-        std::map<Text, Text> attributes;
-
-        getConnection ()->m_client->get (
-            cells, s_tableLedgers, ledgerSeqStr, s_columnHash, attributes);
-
-        if (cells.empty ())
-            return false;
+        if (commit (group))
+        {
+            done (group.size ());
+            group.clear ();
+            failures = 0;
+            continue;
+        }
 
-        if (cells.size () == 1 && cells[0].value == ledgerHash)
+        bool stopping;
         {
-            // already in hbase
-            JLOG (m_journal.info) << "already saved";
-            return true;
+            std::lock_guard<std::mutex> lock (m_mutex);
+            stopping = m_stopping;
         }
-        else
+        if (stopping && ++failures >= s_stopRetries)
         {
-            JLOG (m_journal.fatal) << "mismatch hash " << cells[0].value << " got for " << ledgerSeqStr;
-            return false;
+            for (auto const& prepared : group)
+                JLOG (m_journal.error) << "fail to save " << prepared.seq;
+            done (group.size ());
+            group.clear ();
+            continue;
         }
+        std::this_thread::sleep_for (std::chrono::milliseconds (100));
     }
+}
 
-    void prepareTxs (std::unordered_map<std::string, std::vector<apache::hadoop::hbase::thrift::BatchMutation>>& mutations,
-                     AcceptedLedger::pointer aLedger,
-                     const LedgerIndex& ledgerSeq) noexcept
-    {
-        using namespace apache::thrift;
-        using namespace apache::hadoop::hbase::thrift;
-        // write txs
-        std::vector<BatchMutation>& txsBatches = mutations[s_tableTxs];
-        std::vector<BatchMutation>& txIndexBatches = mutations[s_tableTxIndex];
-        for (auto const& vt : aLedger->getMap ())
-        {
-            uint256 transactionID = vt.second->getTransactionID ();
-
-            m_app.getMasterTransaction ().inLedger (
-                transactionID, ledgerSeq);
-
-            std::string const rowKey (boost::str (
-                boost::format (s_keyTxs) % (ledgerSeq % 16) % ledgerSeq % vt.second->getTxnType () % vt.second->getTxnSeq ()));
+HBaseLedgerSaver::Prepared HBaseLedgerSaver::prepare (std::shared_ptr<Ledger const> const& ledger)
+{
+    using namespace apache::hadoop::hbase::thrift;
 
-            // mutations to table Txs
-            mutationTxs (txsBatches, rowKey, vt.second);
+    auto const ledgerSeq = ledger->info ().seq;
 
-            // mutations to table TxIndex
-            mutationTxIndex (txIndexBatches, rowKey, transactionID);
-        }
+    // get AcceptedLedger
+    auto aLedger = m_app.getAcceptedLedgerCache ().fetch (ledger->info ().hash);
+    if (!aLedger)
+    {
+        aLedger = std::make_shared<AcceptedLedger> (ledger, m_app.accountIDCache (), m_app.logs ());
+        m_app.getAcceptedLedgerCache ().canonicalize (ledger->info ().hash, aLedger);
     }
 
-    void mutationTxs (std::vector<apache::hadoop::hbase::thrift::BatchMutation>& txsBatches,
-                      std::string const& rowKey,
-                      AcceptedLedgerTx::pointer vt)
+    Prepared prepared;
+    prepared.seq = ledgerSeq;
+    prepared.hash = ledger->info ().hash;
+
+    auto& txsBatches = prepared.rows[tableTxs];
+    auto& txIndexBatches = prepared.rows[tableTxIndex];
+    auto& accountTxsBatches = prepared.rows[tableAccountTxs];
+    txsBatches.reserve (aLedger->getMap ().size ());
+    txIndexBatches.reserve (aLedger->getMap ().size ());
+    for (auto const& vt : aLedger->getMap ())
     {
-        using namespace apache::thrift;
-        using namespace apache::hadoop::hbase::thrift;
-        txsBatches.push_back (BatchMutation ());
-        txsBatches.back ().row = rowKey;
+        uint256 const transactionID = vt.second->getTransactionID ();
 
-        auto& mutations = txsBatches.back ().mutations;
+        m_app.getMasterTransaction ().inLedger (
+            transactionID, ledgerSeq);
 
-        mutations.push_back (Mutation ());
-        mutations.back ().column = s_columnRaw;
+        std::string const rowKey = txRowKey (ledgerSeq, vt.second->getTxnType (), vt.second->getTxnSeq ());
+
+        // mutations to table Txs
+        txsBatches.emplace_back ();
+        txsBatches.back ().row = rowKey;
         Serializer s;
-        vt->getTxn ()->add (s);
-        mutations.back ().value.assign (s.getString ());
+        vt.second->getTxn ()->add (s);
+        addMutation (txsBatches.back ().mutations, s_columnRaw, s.getString ());
+        addMutation (txsBatches.back ().mutations, s_columnMeta, vt.second->getRawMeta ());
 
-        mutations.push_back (Mutation ());
-        mutations.back ().column = s_columnMeta;
-        mutations.back ().value.assign (vt->getRawMeta ());
+        // mutations to table TxIndex
+        txIndexBatches.emplace_back ();
+        txIndexBatches.back ().row = to_string (transactionID);
+        addMutation (txIndexBatches.back ().mutations, s_columnValue, rowKey);
+
+        // mutations to table AccountTxs
+        for (auto const& account : vt.second->getAffected ())
+        {
+            accountTxsBatches.emplace_back ();
+            accountTxsBatches.back ().row = accountTxRowKey (account, ledgerSeq, vt.second->getTxnSeq ());
+            addMutation (accountTxsBatches.back ().mutations, s_columnValue, rowKey);
+        }
     }
 
-    void mutationTxIndex (std::vector<apache::hadoop::hbase::thrift::BatchMutation>& txIndexBatches,
-                          std::string const& rowKey,
-                          uint256 const& transactionID)
-    {
-        using namespace apache::thrift;
-        using namespace apache::hadoop::hbase::thrift;
-        txIndexBatches.push_back (BatchMutation ());
-        txIndexBatches.back ().row = to_string (transactionID);
+    // mutations to table Ledgers
+    auto& ledgerMutations = prepared.ledgerRow.mutations;
+    prepared.ledgerRow.row = to_string (ledgerSeq);
+    addMutation (ledgerMutations, s_columnHash, to_string (ledger->info ().hash));
+    addMutation (ledgerMutations, s_columnPrevHash, to_string (ledger->info ().parentHash));
+    addMutation (ledgerMutations, s_columnAccountSetHash, to_string (ledger->info ().accountHash));
+    addMutation (ledgerMutations, s_columnTransSetHash, to_string (ledger->info ().txHash));
+    addMutation (ledgerMutations, s_columnClosingTime, to_string (ledger->info ().closeTime));
+    addMutation (ledgerMutations, s_columnVRP, to_string (ledger->info ().drops));
+    addMutation (ledgerMutations, s_columnVBC, to_string (ledger->info ().dropsVBC));
+
+    return prepared;
+}
 
-        auto& mutations = txIndexBatches.back ().mutations;
+std::vector<bool> HBaseLedgerSaver::isStored (std::vector<Prepared> const& group)
+{
+    using namespace apache::hadoop::hbase::thrift;
 
-        mutations.push_back (Mutation ());
-        mutations.back ().column = s_columnValue;
-        mutations.back ().value.assign (rowKey);
-    }
+    std::vector<Text> rows;
+    rows.reserve (group.size ());
+    for (auto const& prepared : group)
+        rows.push_back (prepared.ledgerRow.row);
 
-private:
-    Application& m_app;
-    beast::Journal m_journal;
-    HBaseConnFactory m_hbaseFactory;
+    std::vector<TRowResult> results;
+    std::map<Text, Text> attributes;
+    m_client ().getRowsWithColumns (
+        results, tableLedgers, rows, {s_columnHash}, attributes);
 
-private:
-    HBaseConn* getConnection ()
+    std::map<Text, Text> savedHashes;
+    for (auto const& result : results)
     {
-        return m_hbaseFactory.getConnection ();
+        auto const column = result.columns.find (s_columnHash);
+        if (column != result.columns.end ())
+            savedHashes[result.row] = column->second.value;
     }
 
-    void initTables ()
+    std::vector<bool> stored;
+    stored.reserve (group.size ());
+    for (auto const& prepared : group)
     {
-        using namespace apache::thrift;
-        using namespace apache::hadoop::hbase::thrift;
-
-        std::vector<ColumnDescriptor> columns;
-        columns.push_back (ColumnDescriptor ());
-        columns.back ().name = s_columnFamily;
-        columns.back ().maxVersions = 1;
-        columns.back ().compression = "SNAPPY";
-        columns.back ().blockCacheEnabled = true;
-        columns.back ().bloomFilterType = "ROW";
-
-        // create table if not exists.
-        for (auto& tableName : {s_tableTxs, s_tableTxIndex, s_tableLedgers})
+        auto const hash = savedHashes.find (prepared.ledgerRow.row);
+        if (hash == savedHashes.end ())
         {
-            try
-            {
-                getConnection ()->m_client->createTable (tableName, columns);
-            }
-            catch (const AlreadyExists& ae)
-            {
-                JLOG (m_journal.debug) << "Table " << tableName << " exists, " << ae.message;
-            }
-            catch (const TException& te)
+            stored.push_back (false);
+        }
+        else if (hash->second == to_string (prepared.hash))
+        {
+            // already in hbase
+            JLOG (m_journal.info) << prepared.seq << " already saved";
+            stored.push_back (true);
+        }
+        else
+        {
+            // Some writer saved another ledger at this sequence. Which one
+            // is right can not be told from here, so the stored one is kept
+            // rather than mixing the transactions of both.
+            JLOG (m_journal.error) << "ledger " << prepared.seq << " stored with hash " << hash->second
+                                   << ", not overwriting with " << prepared.hash;
+            stored.push_back (true);
+        }
+    }
+    return stored;
+}
+
+bool HBaseLedgerSaver::commit (std::vector<Prepared> const& group)
+{
+    using namespace apache::thrift;
+    using namespace apache::hadoop::hbase::thrift;
+
+    try
+    {
+        // Another server may have written some of these.
+        auto const stored = isStored (group);
+
+        // The mutations are copied so the group can be retried as it is.
+        std::map<std::string, BatchMutations> rows;
+        BatchMutations ledgerRows;
+        for (std::size_t i = 0; i < group.size (); ++i)
+        {
+            if (stored[i])
+                continue;
+            for (auto const& table : group[i].rows)
             {
-                JLOG (m_journal.error) << "Create table " << tableName << " failed, " << te.what ();
-                throw std::runtime_error (te.what ());
+                auto& batches = rows[table.first];
+                batches.insert (batches.end (), table.second.begin (), table.second.end ());
             }
+            ledgerRows.push_back (group[i].ledgerRow);
         }
 
-        columns.clear ();
-        columns.push_back (ColumnDescriptor ());
-        columns.back ().name = s_columnFamily;
-        columns.back ().maxVersions = 1;
-        columns.back ().inMemory = true;
-        columns.back ().blockCacheEnabled = true;
-        columns.back ().timeToLive = 30;
+        // Puts are idempotent, so a retry after a partial write, or another
+        // server writing the same ledger, is harmless. The ledger rows go
+        // last so a ledger is only listed once its transactions are in.
+        std::map<Text, Text> attributes;
+        for (auto const& table : rows)
+        {
+            if (!table.second.empty ())
+                m_client ().mutateRows (table.first, table.second, attributes);
+        }
+        if (!ledgerRows.empty ())
+            m_client ().mutateRows (tableLedgers, ledgerRows, attributes);
+
+        JLOG (m_journal.info) << "saved " << ledgerRows.size () << " of " << group.size ()
+                              << " ledgers up to " << group.back ().seq;
+        return true;
+    }
+    catch (const TException& te)
+    {
+        JLOG (m_journal.fatal) << "save of " << group.size () << " ledgers up to "
+                               << group.back ().seq << " failed, " << te.what ();
+    }
+    return false;
+}
+
+std::string HBaseLedgerSaver::txRowKey (LedgerIndex ledgerSeq, TxType txnType, std::uint32_t txnSeq)
+{
+    // Row Key format: [Hex(LedgerSeq%16)][LedgerSeq]-[TxnType]-[TxnSeq]
+    return boost::str (boost::format ("%X%u-%u-%u") % (ledgerSeq % 16) % ledgerSeq % txnType % txnSeq);
+}
+
+std::string HBaseLedgerSaver::accountTxPrefix (AccountID const& account)
+{
+    return strHex (account.data (), account.size ());
+}
+
+std::string HBaseLedgerSaver::accountTxRowKey (AccountID const& account, LedgerIndex ledgerSeq, std::uint32_t txnSeq)
+{
+    // Inverted so an account's rows scan from its newest transaction.
+    return accountTxPrefix (account) +
+        boost::str (boost::format ("%08X%08X") % (0xFFFFFFFFu - ledgerSeq) % (0xFFFFFFFFu - txnSeq));
+}
+
+void HBaseLedgerSaver::initTables ()
+{
+    using namespace apache::thrift;
+    using namespace apache::hadoop::hbase::thrift;
+
+    std::vector<ColumnDescriptor> columns;
+    columns.push_back (ColumnDescriptor ());
+    columns.back ().name = s_columnFamily;
+    columns.back ().maxVersions = 1;
+    columns.back ().compression = "SNAPPY";
+    columns.back ().blockCacheEnabled = true;
+    columns.back ().bloomFilterType = "ROW";
+
+    // create table if not exists.
+    for (auto& tableName : {tableTxs, tableTxIndex, tableAccountTxs, tableLedgers})
+    {
         try
         {
-            getConnection ()->m_client->createTable (s_tableLocks, columns);
+            m_client ().createTable (tableName, columns);
         }
         catch (const AlreadyExists& ae)
         {
-            JLOG (m_journal.debug) << "Table " << s_tableLocks << " exists, " << ae.message;
+            JLOG (m_journal.debug) << "Table " << tableName << " exists, " << ae.message;
         }
         catch (const TException& te)
         {
-            JLOG (m_journal.error) << "Create table " << s_tableLocks << " failed, " << te.what ();
+            JLOG (m_journal.error) << "Create table " << tableName << " failed, " << te.what ();
             throw std::runtime_error (te.what ());
         }
     }
-};
+}
 
 }
@@ -0,0 +1,128 @@
+#ifndef RIPPLE_THRIFT_HBASELEDGERSAVER_H_INCLUDED
+#define RIPPLE_THRIFT_HBASELEDGERSAVER_H_INCLUDED
+
+#if RIPPLE_THRIFT_AVAILABLE
+
+#include <ripple/app/ledger/Ledger.h>
+#include <ripple/app/main/Application.h>
+#include <ripple/basics/BasicConfig.h>
+#include <ripple/protocol/TxFormats.h>
+#include <ripple/thrift/gen-cpp/Hbase.h>
+#include <beast/utility/Journal.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ripple
+{
+/**
+ * Writes validated ledgers and their transactions to HBase.
+ *
+ * Saving is a pipeline: SaveValidated only queues the ledger, worker threads
+ * build the mutations of queued ledgers and one commit thread writes every
+ * ledger prepared so far as a group, one mutateRows per table. A ledger row
+ * is written last, after the transactions of its group.
+ *
+ * Tables:
+ *  - Txs:        [Hex(LedgerSeq%16)][LedgerSeq]-[TxnType]-[TxnSeq] -> raw, meta
+ *  - TxIdx:      transaction hash -> Txs row key
+ *  - AccountTxs: [account hex][~LedgerSeq][~TxnSeq] -> Txs row key, an
+ *                account's rows scan from its newest transaction
+ *  - Ledgers:    LedgerSeq -> header fields
+ */
+class HBaseLedgerSaver : Application::SetupListener<HBaseLedgerSaver>
+{
+public:
+    struct Setup
+    {
+        /// Threads serializing ledgers.
+        std::size_t threads = 2;
+        /// Ledgers queued or in flight before SaveValidated waits.
+        std::size_t maxPending = 16;
+        /// Most ledgers written by one group commit.
+        std::size_t maxGroup = 8;
+    };
+
+    /// Returns the HBase client of the calling thread.
+    using Client = std::function<apache::hadoop::hbase::thrift::HbaseIf& ()>;
+
+    HBaseLedgerSaver (Application& app, Setup const& setup, Client client, beast::Journal journal);
+
+    ~HBaseLedgerSaver ();
+
+    static bool onSetup (Application& app);
+
+    /// Create the tables if they do not exist.
+    void initTables ();
+
+    /**
+     * Queue a validated ledger, waiting while too many are pending.
+     * @return false once the saver is stopped.
+     */
+    bool save (std::shared_ptr<Ledger const> const& ledger);
+
+    /// Wait until every queued ledger is written or given up.
+    void flush ();
+
+    /// Write what is pending and stop the threads.
+    void stop ();
+
+    static std::string txRowKey (LedgerIndex ledgerSeq, TxType txnType, std::uint32_t txnSeq);
+    static std::string accountTxPrefix (AccountID const& account);
+    static std::string accountTxRowKey (AccountID const& account, LedgerIndex ledgerSeq, std::uint32_t txnSeq);
+
+    static char const* const tableLedgers;
+    static char const* const tableTxs;
+    static char const* const tableTxIndex;
+    static char const* const tableAccountTxs;
+
+private:
+    using BatchMutations = std::vector<apache::hadoop::hbase::thrift::BatchMutation>;
+
+    // Mutations of one ledger, ready to be written.
+    struct Prepared
+    {
+        LedgerIndex seq;
+        uint256 hash;
+        std::map<std::string, BatchMutations> rows;
+        apache::hadoop::hbase::thrift::BatchMutation ledgerRow;
+    };
+
+    void prepareThread ();
+    void commitThread ();
+
+    Prepared prepare (std::shared_ptr<Ledger const> const& ledger);
+    // Whether a Ledgers row is already stored for each ledger of the group.
+    std::vector<bool> isStored (std::vector<Prepared> const& group);
+    bool commit (std::vector<Prepared> const& group);
+    void done (std::size_t count);
+
+    Application& m_app;
+    Setup const m_setup;
+    Client m_client;
+    beast::Journal m_journal;
+
+    std::mutex m_mutex;
+    std::condition_variable m_queueCond;    // ledgers to prepare, or stopping
+    std::condition_variable m_preparedCond; // ledgers to commit, or stopping
+    std::condition_variable m_doneCond;     // pending count went down
+    std::deque<std::shared_ptr<Ledger const>> m_queue;
+    std::deque<Prepared> m_prepared;
+    std::size_t m_pending = 0;              // queued, preparing, prepared or committing
+    std::size_t m_preparing = 0;
+    bool m_stopping = false;
+
+    std::vector<std::thread> m_threads;
+};
+
+}
+
+#endif
+
+#endif
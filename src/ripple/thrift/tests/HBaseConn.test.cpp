@@ -0,0 +1,90 @@
+#include <BeastConfig.h>
+#include <ripple/thrift/HBaseConn.h>
+#include <beast/unit_test/suite.h>
+
+namespace ripple {
+namespace test {
+
+class HBaseConn_test : public beast::unit_test::suite
+{
+    static
+    std::vector<std::string>
+    makeRows (std::size_t count)
+    {
+        std::vector<std::string> rows;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            char row[24];
+            std::snprintf (row, sizeof (row), "%04zu", i);
+            rows.push_back (row);
+        }
+        return rows;
+    }
+
+    // Every range is non-empty, ends are increasing and cover all rows.
+    bool
+    covers (std::vector<std::size_t> const& ends, std::size_t count)
+    {
+        std::size_t begin = 0;
+        for (auto end : ends)
+        {
+            if (end <= begin)
+                return false;
+            begin = end;
+        }
+        return begin == count;
+    }
+
+    void
+    testPartition ()
+    {
+        testcase ("partition rows");
+
+        expect (partitionRows ({}, {}, 4).empty ());
+
+        auto const rows = makeRows (100);
+
+        auto ends = partitionRows (rows, {}, 1);
+        expect (ends == std::vector<std::size_t> {100});
+
+        ends = partitionRows (rows, {}, 4);
+        expect (ends == std::vector<std::size_t> ({25, 50, 75, 100}));
+
+        // Never more parts than rows.
+        ends = partitionRows (makeRows (3), {}, 8);
+        expect (ends == std::vector<std::size_t> ({1, 2, 3}));
+
+        // Cuts move onto nearby region starts.
+        ends = partitionRows (rows, {"0022", "0060"}, 4);
+        expect (ends == std::vector<std::size_t> ({22, 50, 75, 100}));
+        ends = partitionRows (rows, {"0046", "0052"}, 2);
+        expect (ends == std::vector<std::size_t> ({52, 100}));
+
+        // But not onto far ones.
+        ends = partitionRows (rows, {"0013"}, 2);
+        expect (ends == std::vector<std::size_t> ({50, 100}));
+
+        // Many small regions still give at most the asked parts.
+        std::vector<std::string> regions;
+        for (std::size_t i = 1; i < 100; i += 3)
+            regions.push_back (rows[i]);
+        for (std::size_t parts = 1; parts <= 10; ++parts)
+        {
+            ends = partitionRows (rows, regions, parts);
+            expect (covers (ends, rows.size ()));
+            expect (ends.size () <= parts);
+        }
+    }
+
+public:
+    void
+    run ()
+    {
+        testPartition ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(HBaseConn,thrift,ripple);
+
+} // test
+} // ripple
@@ -0,0 +1,346 @@
+#include <BeastConfig.h>
+#include <ripple/thrift/HBaseLedgerSaver.h>
+#include <ripple/test/jtx.h>
+#include <algorithm>
+#include <atomic>
+
+namespace ripple {
+namespace test {
+
+class HBaseLedgerSaver_test : public beast::unit_test::suite
+{
+    using Text = apache::hadoop::hbase::thrift::Text;
+
+    // Keeps the tables in memory, optionally failing the next writes.
+    class MemoryHbase : public apache::hadoop::hbase::thrift::HbaseNull
+    {
+    public:
+        // table -> row -> column -> value
+        using Table = std::map<Text, std::map<Text, Text>>;
+
+        std::mutex mutex;
+        std::map<Text, Table> tables;
+        std::atomic<int> failWrites {0};
+        std::atomic<int> writes {0};
+
+        void createTable (Text const& tableName,
+            std::vector<apache::hadoop::hbase::thrift::ColumnDescriptor> const&) override
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            if (tables.count (tableName))
+            {
+                apache::hadoop::hbase::thrift::AlreadyExists ae;
+                ae.message = tableName;
+                throw ae;
+            }
+            tables[tableName];
+        }
+
+        void getRowsWithColumns (std::vector<apache::hadoop::hbase::thrift::TRowResult>& result,
+            Text const& tableName, std::vector<Text> const& rows,
+            std::vector<Text> const& columns, std::map<Text, Text> const&) override
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            auto const& table = tables[tableName];
+            for (auto const& row : rows)
+            {
+                auto const found = table.find (row);
+                if (found == table.end ())
+                    continue;
+                result.emplace_back ();
+                result.back ().row = row;
+                for (auto const& column : columns)
+                {
+                    auto const cell = found->second.find (column);
+                    if (cell != found->second.end ())
+                        result.back ().columns[column].value = cell->second;
+                }
+            }
+        }
+
+        void mutateRow (Text const& tableName, Text const& row,
+            std::vector<apache::hadoop::hbase::thrift::Mutation> const& mutations,
+            std::map<Text, Text> const&) override
+        {
+            write ();
+            std::lock_guard<std::mutex> lock (mutex);
+            for (auto const& mutation : mutations)
+                tables[tableName][row][mutation.column] = mutation.value;
+        }
+
+        void mutateRows (Text const& tableName,
+            std::vector<apache::hadoop::hbase::thrift::BatchMutation> const& rowBatches,
+            std::map<Text, Text> const&) override
+        {
+            write ();
+            std::lock_guard<std::mutex> lock (mutex);
+            for (auto const& batch : rowBatches)
+                for (auto const& mutation : batch.mutations)
+                    tables[tableName][batch.row][mutation.column] = mutation.value;
+        }
+
+        std::size_t rows (Text const& tableName)
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            return tables[tableName].size ();
+        }
+
+        boost::optional<Text> cell (Text const& tableName, Text const& row, Text const& column)
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            auto const& table = tables[tableName];
+            auto const found = table.find (row);
+            if (found == table.end () || !found->second.count (column))
+                return boost::none;
+            return found->second.at (column);
+        }
+
+    private:
+        void write ()
+        {
+            ++writes;
+            if (failWrites > 0)
+            {
+                --failWrites;
+                apache::hadoop::hbase::thrift::IOError error;
+                error.message = "injected";
+                throw error;
+            }
+        }
+    };
+
+    static
+    std::shared_ptr<Ledger const>
+    closed (jtx::Env& env)
+    {
+        return std::dynamic_pointer_cast<Ledger const> (env.closed ());
+    }
+
+    // Closes ledgers with a payment from alice to bob in each.
+    static
+    std::vector<std::shared_ptr<Ledger const>>
+    closeLedgers (jtx::Env& env, int count)
+    {
+        using namespace jtx;
+        std::vector<std::shared_ptr<Ledger const>> ledgers;
+        env.fund (XRP (10000), "alice", "bob");
+        env.close ();
+        ledgers.push_back (closed (env));
+        for (int i = 0; i < count - 1; ++i)
+        {
+            env (pay ("alice", "bob", XRP (1 + i)));
+            env.close ();
+            ledgers.push_back (closed (env));
+        }
+        return ledgers;
+    }
+
+    void
+    testKeys ()
+    {
+        testcase ("row keys");
+
+        expect (HBaseLedgerSaver::txRowKey (33, ttPAYMENT, 2) == "133-0-2");
+        expect (HBaseLedgerSaver::txRowKey (31, ttPAYMENT, 0) == "F31-0-0");
+
+        auto const alice = jtx::Account ("alice").id ();
+        auto const bob = jtx::Account ("bob").id ();
+        auto const prefix = HBaseLedgerSaver::accountTxPrefix (alice);
+        expect (prefix == strHex (alice.data (), alice.size ()));
+        expect (prefix.size () == 40);
+        expect (HBaseLedgerSaver::accountTxRowKey (alice, 1, 2) ==
+            prefix + "FFFFFFFEFFFFFFFD");
+        expect (HBaseLedgerSaver::accountTxRowKey (alice, 0xFFFFFFFF, 0) ==
+            prefix + "00000000FFFFFFFF");
+
+        // Newer transactions sort first within an account, across digit
+        // counts of the ledger and transaction sequences.
+        auto const older = HBaseLedgerSaver::accountTxRowKey (alice, 10, 5);
+        auto const sameLedger = HBaseLedgerSaver::accountTxRowKey (alice, 10, 6);
+        auto const newer = HBaseLedgerSaver::accountTxRowKey (alice, 11, 0);
+        expect (older.compare (0, prefix.size (), prefix) == 0);
+        expect (newer < sameLedger);
+        expect (sameLedger < older);
+        expect (HBaseLedgerSaver::accountTxRowKey (alice, 256, 0) <
+            HBaseLedgerSaver::accountTxRowKey (alice, 255, 0));
+        expect (HBaseLedgerSaver::accountTxRowKey (alice, 7, 10) <
+            HBaseLedgerSaver::accountTxRowKey (alice, 7, 9));
+
+        // Rows of one account never interleave with another's.
+        auto const bobKey = HBaseLedgerSaver::accountTxRowKey (bob, 10, 5);
+        if (alice < bob)
+            expect (HBaseLedgerSaver::accountTxRowKey (alice, 0, 0) < bobKey);
+        else
+            expect (bobKey < HBaseLedgerSaver::accountTxRowKey (alice, 0xFFFFFFFF, 0xFFFFFFFF));
+    }
+
+    // The ledger and transaction sequences of a Txs row key.
+    static
+    std::pair<LedgerIndex, std::uint32_t>
+    parseTxRowKey (std::string const& rowKey)
+    {
+        auto const first = rowKey.find ('-');
+        auto const last = rowKey.rfind ('-');
+        return std::make_pair (
+            static_cast<LedgerIndex> (std::stoul (rowKey.substr (1, first - 1))),
+            static_cast<std::uint32_t> (std::stoul (rowKey.substr (last + 1))));
+    }
+
+    void
+    testSave ()
+    {
+        testcase ("save");
+
+        jtx::Env env (*this);
+        MemoryHbase hbase;
+        HBaseLedgerSaver::Setup setup;
+        setup.threads = 2;
+        setup.maxPending = 3;
+        setup.maxGroup = 2;
+        HBaseLedgerSaver saver (env.app (), setup,
+            [&hbase]() -> apache::hadoop::hbase::thrift::HbaseIf& { return hbase; },
+            beast::Journal ());
+        saver.initTables ();
+        // Existing tables are fine.
+        saver.initTables ();
+
+        auto const ledgers = closeLedgers (env, 6);
+        for (auto const& ledger : ledgers)
+            expect (saver.save (ledger));
+        saver.flush ();
+
+        expect (hbase.rows (HBaseLedgerSaver::tableLedgers) == ledgers.size ());
+        for (auto const& ledger : ledgers)
+        {
+            auto const hash = hbase.cell (HBaseLedgerSaver::tableLedgers,
+                to_string (ledger->info ().seq), "d:h");
+            expect (hash && *hash == to_string (ledger->info ().hash));
+        }
+
+        // The payments are indexed by hash and by both accounts.
+        auto const alice = jtx::Account ("alice").id ();
+        auto const bob = jtx::Account ("bob").id ();
+        std::size_t payments = 0;
+        for (auto const& ledger : ledgers)
+        {
+            for (auto const& item : ledger->txs)
+            {
+                auto const& tx = *item.first;
+                if (tx.getTxnType () != ttPAYMENT || tx.getAccountID (sfAccount) != alice)
+                    continue;
+                ++payments;
+                auto const txnSeq = item.second->getFieldU32 (sfTransactionIndex);
+                auto const rowKey = HBaseLedgerSaver::txRowKey (ledger->info ().seq, ttPAYMENT, txnSeq);
+                auto const indexed = hbase.cell (HBaseLedgerSaver::tableTxIndex,
+                    to_string (tx.getTransactionID ()), "d:v");
+                expect (indexed && *indexed == rowKey);
+                expect (!!hbase.cell (HBaseLedgerSaver::tableTxs, rowKey, "d:r"));
+                expect (!!hbase.cell (HBaseLedgerSaver::tableTxs, rowKey, "d:m"));
+                for (auto const& account : {alice, bob})
+                {
+                    auto const byAccount = hbase.cell (HBaseLedgerSaver::tableAccountTxs,
+                        HBaseLedgerSaver::accountTxRowKey (account, ledger->info ().seq, txnSeq), "d:v");
+                    expect (byAccount && *byAccount == rowKey);
+                }
+            }
+        }
+        expect (payments == ledgers.size () - 1);
+
+        // A prefix scan of an account, in HBase row order, walks its
+        // transactions from the newest one.
+        {
+            auto const prefix = HBaseLedgerSaver::accountTxPrefix (alice);
+            std::vector<std::pair<LedgerIndex, std::uint32_t>> scanned;
+            std::lock_guard<std::mutex> lock (hbase.mutex);
+            auto const& table = hbase.tables[HBaseLedgerSaver::tableAccountTxs];
+            for (auto it = table.lower_bound (prefix);
+                 it != table.end () && it->first.compare (0, prefix.size (), prefix) == 0; ++it)
+            {
+                auto const& rowKey = it->second.at ("d:v");
+                expect (hbase.tables[HBaseLedgerSaver::tableTxs].count (rowKey) == 1);
+                scanned.push_back (parseTxRowKey (rowKey));
+            }
+            expect (scanned.size () > payments);
+            expect (scanned.front ().first == ledgers.back ()->info ().seq);
+            expect (std::adjacent_find (scanned.begin (), scanned.end (),
+                [](auto const& a, auto const& b) { return !(b < a); }) == scanned.end ());
+        }
+
+        // Saving a ledger again writes nothing new.
+        auto const writes = hbase.writes.load ();
+        expect (saver.save (ledgers.back ()));
+        saver.flush ();
+        expect (hbase.writes == writes);
+
+        saver.stop ();
+        expect (!saver.save (ledgers.back ()));
+    }
+
+    void
+    testRetry ()
+    {
+        testcase ("retry");
+
+        jtx::Env env (*this);
+        MemoryHbase hbase;
+        HBaseLedgerSaver saver (env.app (), HBaseLedgerSaver::Setup (),
+            [&hbase]() -> apache::hadoop::hbase::thrift::HbaseIf& { return hbase; },
+            beast::Journal ());
+        saver.initTables ();
+
+        auto const ledgers = closeLedgers (env, 3);
+        hbase.failWrites = 3;
+        for (auto const& ledger : ledgers)
+            expect (saver.save (ledger));
+        saver.flush ();
+
+        expect (hbase.failWrites == 0);
+        expect (hbase.rows (HBaseLedgerSaver::tableLedgers) == ledgers.size ());
+    }
+
+    void
+    testMismatch ()
+    {
+        testcase ("mismatch");
+
+        jtx::Env env (*this);
+        MemoryHbase hbase;
+        HBaseLedgerSaver saver (env.app (), HBaseLedgerSaver::Setup (),
+            [&hbase]() -> apache::hadoop::hbase::thrift::HbaseIf& { return hbase; },
+            beast::Journal ());
+        saver.initTables ();
+
+        auto const ledgers = closeLedgers (env, 2);
+        auto const& ledger = ledgers.back ();
+        auto const row = to_string (ledger->info ().seq);
+        auto const other = to_string (ledger->info ().parentHash);
+        {
+            std::lock_guard<std::mutex> lock (hbase.mutex);
+            hbase.tables[HBaseLedgerSaver::tableLedgers][row]["d:h"] = other;
+        }
+
+        // Another ledger stored at this sequence is kept as it is.
+        expect (saver.save (ledger));
+        saver.flush ();
+        auto const hash = hbase.cell (HBaseLedgerSaver::tableLedgers, row, "d:h");
+        expect (hash && *hash == other);
+        expect (hbase.rows (HBaseLedgerSaver::tableTxs) == 0);
+        expect (hbase.rows (HBaseLedgerSaver::tableTxIndex) == 0);
+        expect (hbase.rows (HBaseLedgerSaver::tableAccountTxs) == 0);
+    }
+
+public:
+    void
+    run ()
+    {
+        testKeys ();
+        testSave ();
+        testRetry ();
+        testMismatch ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(HBaseLedgerSaver,thrift,ripple);
+
+} // test
+} // ripple
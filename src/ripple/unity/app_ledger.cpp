@@ -28,6 +28,7 @@
 #include <ripple/app/ledger/LedgerHistory.cpp>
 #include <ripple/app/ledger/LedgerProposal.cpp>
 #include <ripple/app/ledger/OrderBookDB.cpp>
+#include <ripple/app/ledger/StateDiffStream.cpp>
 #include <ripple/app/ledger/TransactionStateSF.cpp>
 
 #include <ripple/app/ledger/impl/ConsensusImp.cpp>
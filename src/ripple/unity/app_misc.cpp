@@ -28,6 +28,7 @@
 #include <ripple/app/misc/UniqueNodeList.cpp>
 #include <ripple/app/misc/Validations.cpp>
 #include <ripple/app/misc/DividendMasterImpl.cpp>
+#include <ripple/app/misc/ProposalTally.cpp>
 
 #include <ripple/app/misc/impl/AccountTxPaging.cpp>
 #include <ripple/app/misc/impl/Transaction.cpp>
@@ -21,6 +21,7 @@
 
 #include <ripple/app/tests/AccountTxPaging.test.cpp>
 #include <ripple/app/tests/AmendmentTable.test.cpp>
+#include <ripple/app/tests/CloseTimeIndex.test.cpp>
 #include <ripple/app/tests/Asset.test.cpp>
 #include <ripple/app/tests/CrossingLimits_test.cpp>
 #include <ripple/app/tests/DeliverMin.test.cpp>
@@ -28,11 +29,14 @@
 #include <ripple/app/tests/MultiSign.test.cpp>
 #include <ripple/app/tests/OfferStream.test.cpp>
 #include <ripple/app/tests/Offer.test.cpp>
+#include <ripple/app/tests/OrderBookDB.test.cpp>
 #include <ripple/app/tests/Path_test.cpp>
+#include <ripple/app/tests/ProposalTally.test.cpp>
 #include <ripple/app/tests/Refer.test.cpp>
 #include <ripple/app/tests/Regression_test.cpp>
 #include <ripple/app/tests/SusPay_test.cpp>
 #include <ripple/app/tests/SetAuth_test.cpp>
+#include <ripple/app/tests/StateDiffStream.test.cpp>
 #include <ripple/app/tests/OversizeMeta_test.cpp>
 #include <ripple/app/tests/Taker.test.cpp>
 #include <ripple/app/tests/TxQ_test.cpp>
@@ -39,6 +39,7 @@
 #include <ripple/basics/tests/contract.test.cpp>
 #include <ripple/basics/tests/hardened_hash_test.cpp>
 #include <ripple/basics/tests/KeyCache.test.cpp>
+#include <ripple/basics/tests/ParallelFor.test.cpp>
 #include <ripple/basics/tests/RangeSet.test.cpp>
 #include <ripple/basics/tests/StringUtilities.test.cpp>
 #include <ripple/basics/tests/TaggedCache.test.cpp>
@@ -33,6 +33,7 @@
 #include <ripple/crypto/impl/RandomNumbers.cpp>
 #include <ripple/crypto/impl/RFC1751.cpp>
 #include <ripple/crypto/impl/AltBn128.cpp>
+#include <ripple/crypto/impl/Bn254.cpp>
 
 #include <ripple/crypto/tests/CKey.test.cpp>
 #include <ripple/crypto/tests/ECDSACanonical.test.cpp>
@@ -35,6 +35,7 @@
 
 #include <ripple/ledger/tests/BookDirs_test.cpp>
 #include <ripple/ledger/tests/Directory_test.cpp>
+#include <ripple/ledger/tests/ItemTable_test.cpp>
 #include <ripple/ledger/tests/PaymentSandbox_test.cpp>
 #include <ripple/ledger/tests/SkipList_test.cpp>
 #include <ripple/ledger/tests/View_test.cpp>
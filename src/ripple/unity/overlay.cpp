@@ -30,7 +30,10 @@
 #include <ripple/overlay/impl/TrafficCount.cpp>
 
 #include <ripple/overlay/tests/cluster_test.cpp>
+#include <ripple/overlay/tests/coalesce.test.cpp>
+#include <ripple/overlay/tests/compression.test.cpp>
 #include <ripple/overlay/tests/manifest_test.cpp>
+#include <ripple/overlay/tests/ProtocolMessage.test.cpp>
 #include <ripple/overlay/tests/short_read.test.cpp>
 #include <ripple/overlay/tests/TMHello.test.cpp>
 
@@ -27,4 +27,5 @@
 #include <ripple/shamap/impl/SHAMapTreeNode.cpp>
 #include <ripple/shamap/tests/FetchPack.test.cpp>
 #include <ripple/shamap/tests/SHAMap.test.cpp>
+#include <ripple/shamap/tests/SHAMapInnerNode.test.cpp>
 #include <ripple/shamap/tests/SHAMapSync.test.cpp>
@@ -20,5 +20,7 @@
 #include <ripple/thrift/gen-cpp/hbase_types.cpp>
 
 #include <ripple/thrift/HBaseLedgerSaver.cpp>
+#include <ripple/thrift/tests/HBaseConn.test.cpp>
+#include <ripple/thrift/tests/HBaseLedgerSaver.test.cpp>
 
 #endif